@@ -75,7 +75,7 @@ float4 ps(vOut i) : SV_Target
     float3 bitangent = cross(normal, tangent) * i.tangent.w;
     float3x3 tbn = float3x3(tangent, bitangent, normal);
 
-    float3 bumpNorm = Textures[cbMaterial.NormalTexture].Sample(LinearWrapSampler, i.uv).xyz * 2.0f - 1.0f;
+    float3 bumpNorm = UnpackNormal(Textures[cbMaterial.NormalTexture].Sample(LinearWrapSampler, i.uv).xy);
     bumpNorm = normalize(mul(bumpNorm, tbn));
 
     float3 bp = BlinnPhong(cbLight.Lights[0].Direction, cbLight.Lights[0].Color, cbCamera.Position, i.wpos, bumpNorm);
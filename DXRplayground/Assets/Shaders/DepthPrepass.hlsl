@@ -3,13 +3,15 @@ struct CbCamera
     float4x4 ViewProjection;
     float3 Position;
 };
-struct CbObject
+struct InstanceData
 {
-    float4x4 ToWorld[2];
+    float4x4 ToWorld;
+    uint UserData;
+    uint3 Padding;
 };
 
 ConstantBuffer<CbCamera> cbCamera : register(b0);
-ConstantBuffer<CbObject> cbObject : register(b1);
+StructuredBuffer<InstanceData> Instances : register(t0, space1);
 
 struct vIn
 {
@@ -21,7 +23,7 @@ struct vIn
 
 float4 vs(vIn i, uint ind : SV_InstanceID) : SV_Position
 {
-    float4 wPos = mul(float4(i.pos.xyz, 1.0f), cbObject.ToWorld[ind]);
+    float4 wPos = mul(float4(i.pos.xyz, 1.0f), Instances[ind].ToWorld);
     return mul(wPos, cbCamera.ViewProjection);
 }
 
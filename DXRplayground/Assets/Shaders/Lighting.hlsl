@@ -13,6 +13,15 @@ float4 RGBtosRGB(float4 c)
     return float4(pow(c.rgb, 1.0f / 2.2f), c.a);
 }
 
+// Tangent space normal from the xy of a normal map, z is reconstructed as BC5 maps don't have it.
+float3 UnpackNormal(float2 xy)
+{
+    float3 n;
+    n.xy = xy * 2.0f - 1.0f;
+    n.z = sqrt(saturate(1.0f - dot(n.xy, n.xy)));
+    return n;
+}
+
 float3 BlinnPhong(float3 lightDir, float3 lightColor, float3 eyePos, float3 pos, float3 n)
 {
     float3 v = normalize(pos - eyePos);
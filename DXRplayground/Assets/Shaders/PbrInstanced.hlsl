@@ -5,9 +5,11 @@ struct CbCamera
     float4x4 ViewProjection;
     float3 Position;
 };
-struct CbObject
+struct InstanceData
 {
-    float4x4 ToWorld[2];
+    float4x4 ToWorld;
+    uint UserData;
+    uint3 Padding;
 };
 
 struct CbMaterial
@@ -32,11 +34,11 @@ struct CbLight
 };
 
 ConstantBuffer<CbCamera> cbCamera : register(b0);
-ConstantBuffer<CbObject> cbObject : register(b1);
 ConstantBuffer<CbMaterial> cbMaterial : register(b2);
 ConstantBuffer<CbLight> cbLight : register(b3);
 
 Texture2D<float4> Textures[10000] : register(t0);
+StructuredBuffer<InstanceData> Instances : register(t0, space1);
 
 SamplerState LinearClampSampler : register(s0);
 SamplerState LinearWrapSampler : register(s1);
@@ -61,7 +63,7 @@ struct vOut
 vOut vs(vIn i, uint ind : SV_InstanceID)
 {
     vOut o;
-    float4 wPos = mul(float4(i.pos.xyz, 1.0f), cbObject.ToWorld[ind]);
+    float4 wPos = mul(float4(i.pos.xyz, 1.0f), Instances[ind].ToWorld);
     o.wpos = wPos.xyz;
     o.pos = mul(wPos, cbCamera.ViewProjection);
     o.norm = i.norm;
@@ -83,7 +85,7 @@ float4 ps(vOut pIn) : SV_Target
     float3 bitangent = cross(normal, tangent) * pIn.tangent.w;
     float3x3 tbn = float3x3(tangent, bitangent, normal);
 
-    float3 bumpNorm = Textures[cbMaterial.NormalTexture].Sample(LinearWrapSampler, pIn.uv).xyz * 2.0f - 1.0f;
+    float3 bumpNorm = UnpackNormal(Textures[cbMaterial.NormalTexture].Sample(LinearWrapSampler, pIn.uv).xy);
     float3 N = normalize(mul(bumpNorm, tbn));
 
     float3 wpos = pIn.wpos;
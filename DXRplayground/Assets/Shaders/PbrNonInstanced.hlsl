@@ -36,11 +36,40 @@ ConstantBuffer<CbObject> cbObject : register(b1);
 ConstantBuffer<CbMaterial> cbMaterial : register(b2);
 ConstantBuffer<CbLight> cbLight : register(b3);
 
+#ifdef QUANTIZED_VERTICES
+struct CbMeshQuantization
+{
+    float3 PositionMin;
+    float Padding0;
+    float3 PositionExtent;
+    float Padding1;
+};
+ConstantBuffer<CbMeshQuantization> cbMeshQuantization : register(b4);
+#endif
+
 Texture2D<float4> Textures[10000] : register(t0);
 
 SamplerState LinearClampSampler : register(s0);
 SamplerState LinearWrapSampler : register(s1);
 
+#ifdef QUANTIZED_VERTICES
+// Layout of QuantizedVertex, see GetInputLayoutQuantized().
+struct vIn
+{
+    float4 pos : POSITION; // UNORM16 inside the mesh bounds, w is the tangent handedness.
+    float2 norm : NORMAL; // Octahedral SNORM16.
+    float2 uv : TEXCOORD0; // Half.
+    float2 tangent : TANGENT0; // Octahedral SNORM16.
+};
+
+float3 OctDecode(float2 e)
+{
+    float3 v = float3(e.xy, 1.0f - abs(e.x) - abs(e.y));
+    float t = saturate(-v.z);
+    v.xy += v.xy >= 0.0f ? -t : t;
+    return normalize(v);
+}
+#else
 struct vIn
 {
     float3 pos : POSITION;
@@ -48,6 +77,7 @@ struct vIn
     float2 uv : TEXCOORD0;
     float4 tangent : TANGENT0;
 };
+#endif
 
 struct vOut
 {
@@ -61,11 +91,20 @@ struct vOut
 vOut vs(vIn i, uint ind : SV_InstanceID)
 {
     vOut o;
-    float4 wPos = mul(float4(i.pos.xyz, 1.0f), cbObject.ToWorld);
+#ifdef QUANTIZED_VERTICES
+    float3 pos = cbMeshQuantization.PositionMin + i.pos.xyz * cbMeshQuantization.PositionExtent;
+    float3 norm = OctDecode(i.norm);
+    float4 tangent = float4(OctDecode(i.tangent), i.pos.w * 2.0f - 1.0f);
+#else
+    float3 pos = i.pos.xyz;
+    float3 norm = i.norm;
+    float4 tangent = i.tangent;
+#endif
+    float4 wPos = mul(float4(pos, 1.0f), cbObject.ToWorld);
     o.wpos = wPos.xyz;
     o.pos = mul(wPos, cbCamera.ViewProjection);
-    o.norm = i.norm;
-    o.tangent = i.tangent;
+    o.norm = norm;
+    o.tangent = tangent;
     o.uv = i.uv;
     return o;
 }
@@ -83,7 +122,7 @@ float4 ps(vOut pIn) : SV_Target
     float3 bitangent = cross(normal, tangent) * pIn.tangent.w;
     float3x3 tbn = float3x3(tangent, bitangent, normal);
 
-    float3 bumpNorm = Textures[cbMaterial.NormalTexture].Sample(LinearWrapSampler, pIn.uv).xyz * 2.0f - 1.0f;
+    float3 bumpNorm = UnpackNormal(Textures[cbMaterial.NormalTexture].Sample(LinearWrapSampler, pIn.uv).xy);
     float3 N = normalize(mul(bumpNorm, tbn));
 
     float3 wpos = pIn.wpos;
@@ -6,9 +6,11 @@ struct CbCamera
     float3 Position;
     float Padding;
 };
-struct CbObject
+struct InstanceData
 {
-    float4x4 ToWorld[100];
+    float4x4 ToWorld;
+    uint UserData;
+    uint3 Padding;
 };
 
 struct Material
@@ -36,11 +38,11 @@ struct CbLight
 };
 
 ConstantBuffer<CbCamera> cbCamera : register(b0);
-ConstantBuffer<CbObject> cbObject : register(b1);
 ConstantBuffer<CbMaterial> cbMaterial : register(b2);
 ConstantBuffer<CbLight> cbLight : register(b3);
 
 Texture2D<float4> Textures[10000] : register(t0);
+StructuredBuffer<InstanceData> Instances : register(t0, space1);
 
 SamplerState LinearClampSampler : register(s0);
 SamplerState LinearWrapSampler : register(s1);
@@ -66,13 +68,13 @@ struct vOut
 vOut vs(vIn i, uint ind : SV_InstanceID)
 {
     vOut o;
-    float4 wPos = mul(float4(i.pos.xyz * 0.5f, 1.0f), cbObject.ToWorld[ind]);
+    float4 wPos = mul(float4(i.pos.xyz * 0.5f, 1.0f), Instances[ind].ToWorld);
     o.wpos = wPos.xyz;
     o.pos = mul(wPos, cbCamera.ViewProjection);
-    o.norm = mul(float4(normalize(i.norm), 0.0f), cbObject.ToWorld[ind]).xyz;
+    o.norm = mul(float4(normalize(i.norm), 0.0f), Instances[ind].ToWorld).xyz;
     o.tangent = i.tangent;
     o.uv = i.uv;
-    o.instanceID = ind;
+    o.instanceID = Instances[ind].UserData; // Index of the material.
     return o;
 }
 
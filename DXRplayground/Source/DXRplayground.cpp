@@ -1,12 +1,14 @@
 #define WIN32_LEAN_AND_MEAN
 
 #include <windows.h>
+#include <cstring>
 #include <thread>
 
 #include "DXrenderer/RenderPipeline.h"
 #include "WindowsApp.h"
 
 #include "Scene/GltfViewer.h"
+#include "Scene/LoadingBenchmark.h"
 #include "Scene/PbrTester.h"
 #include "Scene/RtTester.h"
 
@@ -17,12 +19,18 @@ namespace
 RenderPipeline DirectXPipeline;
 }
 
-RtTester scene;
+RtTester rtTester;
+LoadingBenchmark loadingBenchmark;
+Scene* scene = &rtTester;
 
 int WINAPI WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE prevInstance, _In_ PSTR cmdLine, _In_ int nCmdShow)
 {
+    // The correctness checks are in DXRplaygroundTests, the benchmark only shows the timings.
+    if (strstr(cmdLine, "-benchmark") != nullptr)
+        scene = &loadingBenchmark;
+
     WindowsApp::Init(hInstance, nCmdShow, L"DirectX Playground");
-    DirectXPipeline.Init(WindowsApp::GetHWND(), 1920, 1080, &scene);
+    DirectXPipeline.Init(WindowsApp::GetHWND(), 1920, 1080, scene);
     WindowsApp::Run();
     return 0;
 } 
@@ -35,7 +43,7 @@ void Init()
 
 void Run()
 {
-    DirectXPipeline.Render(&scene);
+    DirectXPipeline.Render(scene);
 }
 
 void Shutdown()
@@ -0,0 +1,217 @@
+#include "DXrenderer/Buffers/GeometryPool.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#include "External/Dx12Helpers/d3dx12.h"
+#include "DXrenderer/DXhelpers.h"
+
+namespace DirectxPlayground
+{
+namespace
+{
+constexpr UINT IndexUnitSize = sizeof(USHORT);
+}
+
+GeometryPool::GeometryPool(ID3D12Device* device, UINT64 blockSize /*= DefaultBlockSize*/)
+    : m_device(device)
+    , m_blockSize(blockSize)
+{
+}
+
+GeometryPool::~GeometryPool()
+{
+    for (auto block : m_vertexBlocks)
+        delete block;
+    for (auto block : m_indexBlocks)
+        delete block;
+}
+
+GeometryPool::VertexRange GeometryPool::AllocateVertices(UINT stride, UINT count)
+{
+    VertexRange range;
+    range.Stride = stride;
+    range.Block = Allocate(m_vertexBlocks, stride, count, 1, range.Allocation);
+    return range;
+}
+
+GeometryPool::IndexRange GeometryPool::AllocateIndices(DXGI_FORMAT format, UINT count)
+{
+    assert(format == DXGI_FORMAT_R16_UINT || format == DXGI_FORMAT_R32_UINT);
+    UINT64 units = format == DXGI_FORMAT_R16_UINT ? 1 : 2;
+    IndexRange range;
+    range.Format = format;
+    range.Block = Allocate(m_indexBlocks, IndexUnitSize, UINT64(count) * units, units, range.Allocation);
+    return range;
+}
+
+void GeometryPool::Free(const VertexRange& range)
+{
+    if (range.IsValid())
+        m_vertexBlocks[range.Block]->Allocator.Free(range.Allocation);
+}
+
+void GeometryPool::Free(const IndexRange& range)
+{
+    if (range.IsValid())
+        m_indexBlocks[range.Block]->Allocator.Free(range.Allocation);
+}
+
+void GeometryPool::FreeDeferred(const VertexRange& range)
+{
+    if (range.IsValid())
+        m_deferredFrees.push_back({ false, range.Block, range.Allocation });
+}
+
+void GeometryPool::FreeDeferred(const IndexRange& range)
+{
+    if (range.IsValid())
+        m_deferredFrees.push_back({ true, range.Block, range.Allocation });
+}
+
+void GeometryPool::Upload(ID3D12GraphicsCommandList* commandList, const VertexRange& range, const byte* data)
+{
+    Block& block = *m_vertexBlocks[range.Block];
+    CopyToBlock(commandList, block, range.Allocation.Offset * range.Stride, data, range.Allocation.Size * range.Stride);
+}
+
+void GeometryPool::Upload(ID3D12GraphicsCommandList* commandList, const IndexRange& range, const byte* data)
+{
+    Block& block = *m_indexBlocks[range.Block];
+    CopyToBlock(commandList, block, range.Allocation.Offset * IndexUnitSize, data, range.Allocation.Size * IndexUnitSize);
+}
+
+void GeometryPool::ReleaseStaging()
+{
+    for (auto& staging : m_staging)
+        staging.Resource->Unmap(0, nullptr);
+    m_staging.clear();
+    for (const auto& deferred : m_deferredFrees)
+        FreeNow(deferred);
+    m_deferredFrees.clear();
+}
+
+void GeometryPool::RetireStaging(UINT64 fenceValue)
+{
+    for (auto& staging : m_staging)
+    {
+        staging.FenceValue = fenceValue;
+        m_retiredStaging.push_back(staging);
+    }
+    m_staging.clear();
+    for (auto& deferred : m_deferredFrees)
+    {
+        deferred.FenceValue = fenceValue;
+        m_retiredFrees.push_back(deferred);
+    }
+    m_deferredFrees.clear();
+}
+
+void GeometryPool::ReleaseCompletedStaging(UINT64 completedFenceValue)
+{
+    size_t releasedCount = 0;
+    while (releasedCount < m_retiredStaging.size() && m_retiredStaging[releasedCount].FenceValue <= completedFenceValue)
+        m_retiredStaging[releasedCount++].Resource->Unmap(0, nullptr);
+    m_retiredStaging.erase(m_retiredStaging.begin(), m_retiredStaging.begin() + releasedCount);
+
+    size_t freedCount = 0;
+    while (freedCount < m_retiredFrees.size() && m_retiredFrees[freedCount].FenceValue <= completedFenceValue)
+        FreeNow(m_retiredFrees[freedCount++]);
+    m_retiredFrees.erase(m_retiredFrees.begin(), m_retiredFrees.begin() + freedCount);
+}
+
+UINT64 GeometryPool::GetAllocatedBytes() const
+{
+    UINT64 bytes = 0;
+    for (const auto block : m_vertexBlocks)
+        bytes += (block->Allocator.GetCapacity() - block->Allocator.GetFreeSize()) * block->Stride;
+    for (const auto block : m_indexBlocks)
+        bytes += (block->Allocator.GetCapacity() - block->Allocator.GetFreeSize()) * block->Stride;
+    return bytes;
+}
+
+UINT GeometryPool::Allocate(std::vector<Block*>& blocks, UINT stride, UINT64 count, UINT64 alignment, OffsetAllocator::Allocation& allocation)
+{
+    for (UINT i = 0; i < blocks.size(); ++i)
+    {
+        if (blocks[i]->Stride != stride)
+            continue;
+        allocation = blocks[i]->Allocator.Allocate(count, alignment);
+        if (allocation.IsValid())
+            return i;
+    }
+    blocks.push_back(CreateBlock(std::max(m_blockSize / stride, count), stride));
+    allocation = blocks.back()->Allocator.Allocate(count, alignment);
+    assert(allocation.IsValid());
+    return UINT(blocks.size() - 1);
+}
+
+void GeometryPool::FreeNow(const DeferredFree& deferred)
+{
+    std::vector<Block*>& blocks = deferred.IsIndexRange ? m_indexBlocks : m_vertexBlocks;
+    blocks[deferred.Block]->Allocator.Free(deferred.Allocation);
+}
+
+GeometryPool::Block* GeometryPool::CreateBlock(UINT64 capacity, UINT stride)
+{
+    Block* block = new Block(capacity, stride);
+    UINT64 size = capacity * stride;
+
+    // Buffers are created in COMMON no matter what's asked, the first upload moves it to the read state.
+    CD3DX12_HEAP_PROPERTIES heapProps(D3D12_HEAP_TYPE_DEFAULT);
+    CD3DX12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(size);
+    ThrowIfFailed(m_device->CreateCommittedResource(
+        &heapProps,
+        D3D12_HEAP_FLAG_NONE,
+        &bufferDesc,
+        D3D12_RESOURCE_STATE_COMMON,
+        nullptr,
+        IID_PPV_ARGS(&block->Resource)));
+    SetDXobjectName(block->Resource.Get(), L"GeometryPool block");
+
+    D3D12_GPU_VIRTUAL_ADDRESS address = block->Resource->GetGPUVirtualAddress();
+    block->VertexView.BufferLocation = address;
+    block->VertexView.SizeInBytes = UINT(size);
+    block->VertexView.StrideInBytes = stride;
+    block->IndexViews[0] = { address, UINT(size), DXGI_FORMAT_R16_UINT };
+    block->IndexViews[1] = { address, UINT(size), DXGI_FORMAT_R32_UINT };
+    return block;
+}
+
+void GeometryPool::CopyToBlock(ID3D12GraphicsCommandList* commandList, Block& block, UINT64 byteOffset, const byte* data, UINT64 size)
+{
+    if (m_staging.empty() || m_staging.back().Size - m_staging.back().Used < size)
+    {
+        StagingBuffer staging;
+        staging.Size = std::max(m_blockSize / 4, (size + 3) & ~UINT64(3));
+        CD3DX12_HEAP_PROPERTIES uploadHeapProps(D3D12_HEAP_TYPE_UPLOAD);
+        CD3DX12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(staging.Size);
+        ThrowIfFailed(m_device->CreateCommittedResource(
+            &uploadHeapProps,
+            D3D12_HEAP_FLAG_NONE,
+            &bufferDesc,
+            D3D12_RESOURCE_STATE_GENERIC_READ,
+            nullptr,
+            IID_PPV_ARGS(&staging.Resource)));
+        CD3DX12_RANGE range(0, 0);
+        staging.Resource->Map(0, &range, reinterpret_cast<void**>(&staging.Data));
+        m_staging.push_back(staging);
+    }
+    StagingBuffer& staging = m_staging.back();
+    memcpy(staging.Data + staging.Used, data, size);
+
+    if (block.State != D3D12_RESOURCE_STATE_COPY_DEST)
+    {
+        auto toCopy = CD3DX12_RESOURCE_BARRIER::Transition(block.Resource.Get(), block.State, D3D12_RESOURCE_STATE_COPY_DEST);
+        commandList->ResourceBarrier(1, &toCopy);
+    }
+    commandList->CopyBufferRegion(block.Resource.Get(), byteOffset, staging.Resource.Get(), staging.Used, size);
+    auto toRead = CD3DX12_RESOURCE_BARRIER::Transition(block.Resource.Get(), D3D12_RESOURCE_STATE_COPY_DEST, ReadState);
+    commandList->ResourceBarrier(1, &toRead);
+    block.State = ReadState;
+
+    // Keeps the next copy source 4 byte aligned.
+    staging.Used += (size + 3) & ~UINT64(3);
+}
+}
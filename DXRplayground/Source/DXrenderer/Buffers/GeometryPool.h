@@ -0,0 +1,177 @@
+#pragma once
+
+#include <d3d12.h>
+#include <vector>
+#include <wrl.h>
+
+#include "Utils/OffsetAllocator.h"
+
+namespace DirectxPlayground
+{
+// Large default heap vertex and index buffers shared by all the pooled meshes. Every mesh gets a range in them, so the draws
+// with the same vertex format bind the buffers once and differ only by BaseVertexLocation and StartIndexLocation.
+// Vertex blocks hold one stride each, so a range offset is the base vertex. Index blocks are allocated in 16 bit units and have
+// both an R16 and an R32 view, 32 bit ranges are aligned to 2 units so their start index is the offset / 2.
+// The blocks stay in a combined read state: vertex, index and non pixel shader resource (for the BLAS builds).
+class GeometryPool
+{
+public:
+    struct VertexRange
+    {
+        UINT Block = 0;
+        UINT Stride = 0;
+        OffsetAllocator::Allocation Allocation; // In vertices.
+
+        bool IsValid() const
+        {
+            return Allocation.IsValid();
+        }
+    };
+
+    struct IndexRange
+    {
+        UINT Block = 0;
+        DXGI_FORMAT Format = DXGI_FORMAT_UNKNOWN;
+        OffsetAllocator::Allocation Allocation; // In 16 bit units.
+
+        bool IsValid() const
+        {
+            return Allocation.IsValid();
+        }
+    };
+
+    static constexpr UINT64 DefaultBlockSize = 64ULL * 1024 * 1024;
+    static constexpr D3D12_RESOURCE_STATES ReadState = D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER | D3D12_RESOURCE_STATE_INDEX_BUFFER
+        | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE;
+
+    explicit GeometryPool(ID3D12Device* device, UINT64 blockSize = DefaultBlockSize);
+    GeometryPool(const GeometryPool&) = delete;
+    GeometryPool(GeometryPool&&) = delete;
+    GeometryPool& operator=(const GeometryPool&) = delete;
+    GeometryPool& operator=(GeometryPool&&) = delete;
+    ~GeometryPool();
+
+    // A new block is created if none has the room. Ranges bigger than the block size get a dedicated block.
+    VertexRange AllocateVertices(UINT stride, UINT count);
+    IndexRange AllocateIndices(DXGI_FORMAT format, UINT count);
+    void Free(const VertexRange& range);
+    void Free(const IndexRange& range);
+    // For the ranges the frames in flight may still read: freed along with the staging, by ReleaseStaging or once the fence
+    // of the next RetireStaging has completed.
+    void FreeDeferred(const VertexRange& range);
+    void FreeDeferred(const IndexRange& range);
+
+    // Records the copy from a staging buffer. The staging memory stays until ReleaseStaging, call it once the command list is executed.
+    void Upload(ID3D12GraphicsCommandList* commandList, const VertexRange& range, const byte* data);
+    void Upload(ID3D12GraphicsCommandList* commandList, const IndexRange& range, const byte* data);
+    void ReleaseStaging();
+    // For the uploads recorded into a frame command list: the staging used so far and the deferred frees wait for the frame
+    // fence instead, and ReleaseCompletedStaging releases them once the GPU has passed it.
+    void RetireStaging(UINT64 fenceValue);
+    void ReleaseCompletedStaging(UINT64 completedFenceValue);
+
+    const D3D12_VERTEX_BUFFER_VIEW& GetVertexBufferView(const VertexRange& range) const; // Of the whole block, see GetBaseVertex.
+    const D3D12_INDEX_BUFFER_VIEW& GetIndexBufferView(const IndexRange& range) const; // Of the whole block, see GetStartIndex.
+    UINT GetBaseVertex(const VertexRange& range) const;
+    UINT GetStartIndex(const IndexRange& range) const;
+    D3D12_GPU_VIRTUAL_ADDRESS GetGpuAddress(const VertexRange& range) const; // Of the range start.
+    D3D12_GPU_VIRTUAL_ADDRESS GetGpuAddress(const IndexRange& range) const;
+    ID3D12Resource* GetResource(const VertexRange& range) const;
+    ID3D12Resource* GetResource(const IndexRange& range) const;
+
+    UINT GetBlocksCount() const;
+    UINT64 GetAllocatedBytes() const;
+
+private:
+    struct Block
+    {
+        Block(UINT64 capacity, UINT stride)
+            : Allocator(capacity)
+            , Stride(stride)
+        {}
+
+        Microsoft::WRL::ComPtr<ID3D12Resource> Resource;
+        OffsetAllocator Allocator; // In Stride sized units.
+        UINT Stride = 0;
+        D3D12_RESOURCE_STATES State = D3D12_RESOURCE_STATE_COMMON;
+        D3D12_VERTEX_BUFFER_VIEW VertexView{};
+        D3D12_INDEX_BUFFER_VIEW IndexViews[2]{}; // R16 and R32.
+    };
+
+    struct StagingBuffer
+    {
+        Microsoft::WRL::ComPtr<ID3D12Resource> Resource;
+        byte* Data = nullptr;
+        UINT64 Size = 0;
+        UINT64 Used = 0;
+        UINT64 FenceValue = 0; // Set when retired.
+    };
+
+    struct DeferredFree
+    {
+        bool IsIndexRange = false;
+        UINT Block = 0;
+        OffsetAllocator::Allocation Allocation;
+        UINT64 FenceValue = 0; // Set when retired.
+    };
+
+    UINT Allocate(std::vector<Block*>& blocks, UINT stride, UINT64 count, UINT64 alignment, OffsetAllocator::Allocation& allocation);
+    Block* CreateBlock(UINT64 capacity, UINT stride);
+    void CopyToBlock(ID3D12GraphicsCommandList* commandList, Block& block, UINT64 byteOffset, const byte* data, UINT64 size);
+    void FreeNow(const DeferredFree& deferred);
+
+    ID3D12Device* m_device = nullptr;
+    UINT64 m_blockSize = 0;
+    std::vector<Block*> m_vertexBlocks; // Different strides mixed, Block::Stride tells them apart.
+    std::vector<Block*> m_indexBlocks;
+    std::vector<StagingBuffer> m_staging;
+    std::vector<StagingBuffer> m_retiredStaging; // In the fence order.
+    std::vector<DeferredFree> m_deferredFrees;
+    std::vector<DeferredFree> m_retiredFrees; // In the fence order.
+};
+
+inline const D3D12_VERTEX_BUFFER_VIEW& GeometryPool::GetVertexBufferView(const VertexRange& range) const
+{
+    return m_vertexBlocks[range.Block]->VertexView;
+}
+
+inline const D3D12_INDEX_BUFFER_VIEW& GeometryPool::GetIndexBufferView(const IndexRange& range) const
+{
+    return m_indexBlocks[range.Block]->IndexViews[range.Format == DXGI_FORMAT_R16_UINT ? 0 : 1];
+}
+
+inline UINT GeometryPool::GetBaseVertex(const VertexRange& range) const
+{
+    return UINT(range.Allocation.Offset);
+}
+
+inline UINT GeometryPool::GetStartIndex(const IndexRange& range) const
+{
+    return UINT(range.Format == DXGI_FORMAT_R16_UINT ? range.Allocation.Offset : range.Allocation.Offset / 2);
+}
+
+inline D3D12_GPU_VIRTUAL_ADDRESS GeometryPool::GetGpuAddress(const VertexRange& range) const
+{
+    return m_vertexBlocks[range.Block]->Resource->GetGPUVirtualAddress() + range.Allocation.Offset * range.Stride;
+}
+
+inline D3D12_GPU_VIRTUAL_ADDRESS GeometryPool::GetGpuAddress(const IndexRange& range) const
+{
+    return m_indexBlocks[range.Block]->Resource->GetGPUVirtualAddress() + range.Allocation.Offset * sizeof(USHORT);
+}
+
+inline ID3D12Resource* GeometryPool::GetResource(const VertexRange& range) const
+{
+    return m_vertexBlocks[range.Block]->Resource.Get();
+}
+
+inline ID3D12Resource* GeometryPool::GetResource(const IndexRange& range) const
+{
+    return m_indexBlocks[range.Block]->Resource.Get();
+}
+
+inline UINT GeometryPool::GetBlocksCount() const
+{
+    return UINT(m_vertexBlocks.size() + m_indexBlocks.size());
+}
+}
@@ -54,6 +54,13 @@ void UploadBuffer::UploadData(UINT frameIndex, const byte* data)
     memcpy(m_data + frameIndex * m_frameDataSize, data, m_rawDataSize);
 }
 
+void UploadBuffer::UploadData(UINT frameIndex, const byte* data, size_t size)
+{
+    assert(frameIndex < m_framesCount && "Asked frame index for the buffer is bigger than maxFrames for this buffer");
+    assert(size <= m_rawDataSize && "The data doesn't fit the frame");
+    memcpy(m_data + frameIndex * m_frameDataSize, data, size);
+}
+
 D3D12_GPU_VIRTUAL_ADDRESS UploadBuffer::GetFrameDataGpuAddress(UINT frame) const
 {
     assert(frame < m_framesCount && "Asked frame index for the buffer is bigger than maxFrames for this buffer");
@@ -20,6 +20,7 @@ public:
 
     ID3D12Resource* GetResource() const;
     void UploadData(UINT frameIndex, const byte* data);
+    void UploadData(UINT frameIndex, const byte* data, size_t size); // The first size bytes of the frame data, for the buffers filled only partly.
     template <typename T>
     void UploadData(UINT frameIndex, T& data);
 
@@ -0,0 +1,227 @@
+#include "DXrenderer/Culling/FrustumCulling.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace DirectxPlayground
+{
+namespace
+{
+constexpr UINT PlanesCount = 6;
+
+// The planes with the absolute normals next to them, the box projection radius needs those.
+struct PlaneConstants
+{
+    float N[PlanesCount][3];
+    float D[PlanesCount];
+    float AbsN[PlanesCount][3];
+};
+
+PlaneConstants GetPlaneConstants(const FrustumPlanes& planes)
+{
+    PlaneConstants res;
+    for (UINT p = 0; p < PlanesCount; ++p)
+    {
+        for (UINT c = 0; c < 3; ++c)
+        {
+            res.N[p][c] = planes.Planes[p][c];
+            res.AbsN[p][c] = std::abs(planes.Planes[p][c]);
+        }
+        res.D[p] = planes.Planes[p][3];
+    }
+    return res;
+}
+
+// Branchless compaction, the index is always written and the count moves only for the visible ones.
+inline size_t AppendVisible(UINT mask, size_t base, size_t lanes, UINT* visible, size_t count)
+{
+    for (size_t lane = 0; lane < lanes; ++lane)
+    {
+        visible[count] = UINT(base + lane);
+        count += (mask >> lane) & 1;
+    }
+    return count;
+}
+
+template <CullShape Shape>
+size_t CullScalar(const PlaneConstants& pc, const CullingBounds& b, UINT* visible)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < b.Count; ++i)
+    {
+        UINT inside = 1;
+        for (UINT p = 0; p < PlanesCount; ++p)
+        {
+            float dist = ((b.CenterX[i] * pc.N[p][0] + b.CenterY[i] * pc.N[p][1]) + b.CenterZ[i] * pc.N[p][2]) + pc.D[p];
+            float radius = Shape == CullShape::Box ? (b.ExtentX[i] * pc.AbsN[p][0] + b.ExtentY[i] * pc.AbsN[p][1]) + b.ExtentZ[i] * pc.AbsN[p][2] : b.Radius[i];
+            inside &= dist + radius >= 0.0f ? 1 : 0;
+        }
+        visible[count] = UINT(i);
+        count += inside;
+    }
+    return count;
+}
+
+template <CullShape Shape>
+SIMD_TARGET_SSE41 size_t CullSSE(const PlaneConstants& pc, const CullingBounds& b, UINT* visible)
+{
+    const __m128 zero = _mm_setzero_ps();
+    size_t count = 0;
+    for (size_t base = 0; base < b.Count; base += 4)
+    {
+        __m128 cx = _mm_loadu_ps(&b.CenterX[base]);
+        __m128 cy = _mm_loadu_ps(&b.CenterY[base]);
+        __m128 cz = _mm_loadu_ps(&b.CenterZ[base]);
+        __m128 ex = _mm_loadu_ps(&b.ExtentX[base]);
+        __m128 ey = _mm_loadu_ps(&b.ExtentY[base]);
+        __m128 ez = _mm_loadu_ps(&b.ExtentZ[base]);
+        __m128 sphereRadius = _mm_loadu_ps(&b.Radius[base]);
+        __m128 inside = _mm_cmpeq_ps(zero, zero);
+        for (UINT p = 0; p < PlanesCount; ++p)
+        {
+            __m128 dist = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(cx, _mm_set1_ps(pc.N[p][0])), _mm_mul_ps(cy, _mm_set1_ps(pc.N[p][1]))),
+                _mm_mul_ps(cz, _mm_set1_ps(pc.N[p][2]))), _mm_set1_ps(pc.D[p]));
+            __m128 radius = sphereRadius;
+            if (Shape == CullShape::Box)
+            {
+                radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ex, _mm_set1_ps(pc.AbsN[p][0])), _mm_mul_ps(ey, _mm_set1_ps(pc.AbsN[p][1]))),
+                    _mm_mul_ps(ez, _mm_set1_ps(pc.AbsN[p][2])));
+            }
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(dist, radius), zero));
+        }
+        count = AppendVisible(UINT(_mm_movemask_ps(inside)), base, std::min<size_t>(4, b.Count - base), visible, count);
+    }
+    return count;
+}
+
+// No FMA on purpose, the results must match the scalar reference bit for bit.
+template <CullShape Shape>
+SIMD_TARGET_AVX2 size_t CullAVX2(const PlaneConstants& pc, const CullingBounds& b, UINT* visible)
+{
+    const __m256 zero = _mm256_setzero_ps();
+    size_t count = 0;
+    for (size_t base = 0; base < b.Count; base += 8)
+    {
+        __m256 cx = _mm256_loadu_ps(&b.CenterX[base]);
+        __m256 cy = _mm256_loadu_ps(&b.CenterY[base]);
+        __m256 cz = _mm256_loadu_ps(&b.CenterZ[base]);
+        __m256 ex = _mm256_loadu_ps(&b.ExtentX[base]);
+        __m256 ey = _mm256_loadu_ps(&b.ExtentY[base]);
+        __m256 ez = _mm256_loadu_ps(&b.ExtentZ[base]);
+        __m256 sphereRadius = _mm256_loadu_ps(&b.Radius[base]);
+        __m256 inside = _mm256_cmp_ps(zero, zero, _CMP_EQ_OQ);
+        for (UINT p = 0; p < PlanesCount; ++p)
+        {
+            __m256 dist = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(cx, _mm256_set1_ps(pc.N[p][0])), _mm256_mul_ps(cy, _mm256_set1_ps(pc.N[p][1]))),
+                _mm256_mul_ps(cz, _mm256_set1_ps(pc.N[p][2]))), _mm256_set1_ps(pc.D[p]));
+            __m256 radius = sphereRadius;
+            if (Shape == CullShape::Box)
+            {
+                radius = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ex, _mm256_set1_ps(pc.AbsN[p][0])), _mm256_mul_ps(ey, _mm256_set1_ps(pc.AbsN[p][1]))),
+                    _mm256_mul_ps(ez, _mm256_set1_ps(pc.AbsN[p][2])));
+            }
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(dist, radius), zero, _CMP_GE_OQ));
+        }
+        count = AppendVisible(UINT(_mm256_movemask_ps(inside)), base, std::min<size_t>(8, b.Count - base), visible, count);
+    }
+    return count;
+}
+
+template <CullShape Shape>
+size_t Cull(const PlaneConstants& pc, const CullingBounds& bounds, UINT* visible, SimdLevel level)
+{
+    switch (level)
+    {
+    case SimdLevel::AVX2:
+        return CullAVX2<Shape>(pc, bounds, visible);
+    case SimdLevel::SSE41:
+        return CullSSE<Shape>(pc, bounds, visible);
+    default:
+        return CullScalar<Shape>(pc, bounds, visible);
+    }
+}
+}
+
+FrustumPlanes ExtractFrustumPlanes(const float viewProjection[4][4])
+{
+    // clip = v * M, so the clip components are dot products with the columns. Inside is -w <= x <= w, -w <= y <= w, 0 <= z <= w.
+    auto column = [&viewProjection](UINT c, float res[4])
+    {
+        for (UINT r = 0; r < 4; ++r)
+            res[r] = viewProjection[r][c];
+    };
+    float x[4], y[4], z[4], w[4];
+    column(0, x);
+    column(1, y);
+    column(2, z);
+    column(3, w);
+
+    FrustumPlanes res;
+    for (UINT c = 0; c < 4; ++c)
+    {
+        res.Planes[0][c] = w[c] + x[c];
+        res.Planes[1][c] = w[c] - x[c];
+        res.Planes[2][c] = w[c] + y[c];
+        res.Planes[3][c] = w[c] - y[c];
+        res.Planes[4][c] = z[c];
+        res.Planes[5][c] = w[c] - z[c];
+    }
+    for (auto& plane : res.Planes)
+    {
+        float length = std::sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+        if (length < 1e-6f)
+        {
+            plane[0] = plane[1] = plane[2] = 0.0f;
+            plane[3] = 1.0f;
+            continue;
+        }
+        for (UINT c = 0; c < 4; ++c)
+            plane[c] /= length;
+    }
+    return res;
+}
+
+void CullingBounds::Clear()
+{
+    CenterX.clear();
+    CenterY.clear();
+    CenterZ.clear();
+    ExtentX.clear();
+    ExtentY.clear();
+    ExtentZ.clear();
+    Radius.clear();
+    Count = 0;
+}
+
+void CullingBounds::Reserve(size_t count)
+{
+    size_t padded = (count + Padding - 1) / Padding * Padding;
+    for (auto stream : { &CenterX, &CenterY, &CenterZ, &ExtentX, &ExtentY, &ExtentZ, &Radius })
+        stream->reserve(padded);
+}
+
+UINT CullingBounds::Add(const float center[3], const float extents[3], float radius)
+{
+    if (Count == CenterX.size())
+    {
+        for (auto stream : { &CenterX, &CenterY, &CenterZ, &ExtentX, &ExtentY, &ExtentZ, &Radius })
+            stream->resize(Count + Padding, 0.0f);
+    }
+    CenterX[Count] = center[0];
+    CenterY[Count] = center[1];
+    CenterZ[Count] = center[2];
+    ExtentX[Count] = extents[0];
+    ExtentY[Count] = extents[1];
+    ExtentZ[Count] = extents[2];
+    Radius[Count] = radius;
+    return UINT(Count++);
+}
+
+size_t FrustumCull(const FrustumPlanes& planes, const CullingBounds& bounds, CullShape shape, UINT* visible, SimdLevel level /*= GetSimdLevel()*/)
+{
+    PlaneConstants pc = GetPlaneConstants(planes);
+    if (shape == CullShape::Box)
+        return Cull<CullShape::Box>(pc, bounds, visible, level);
+    return Cull<CullShape::Sphere>(pc, bounds, visible, level);
+}
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <vector>
+#include <windows.h>
+
+#include "Utils/Simd.h"
+
+namespace DirectxPlayground
+{
+// Normalized planes with the normals pointing inside, a point p is inside a plane if dot(p, n) + d >= 0.
+// Left, right, bottom, top, near, far.
+struct FrustumPlanes
+{
+    float Planes[6][4] = {};
+};
+
+// For row vectors, i.e. Camera::GetViewProjection as is, and the D3D [0, 1] clip depth.
+// A degenerate plane (the far one of an infinite projection) becomes one that everything is inside of.
+FrustumPlanes ExtractFrustumPlanes(const float viewProjection[4][4]);
+
+// World space bounds of the draws in SoA, so the culling tests 4 or 8 of them per plane at once.
+// The arrays are padded to the widest SIMD width, the padding is never reported as visible.
+struct CullingBounds
+{
+    static constexpr size_t Padding = 8;
+
+    void Clear();
+    void Reserve(size_t count);
+    UINT Add(const float center[3], const float extents[3], float radius); // Returns the index reported by the culling.
+
+    std::vector<float> CenterX;
+    std::vector<float> CenterY;
+    std::vector<float> CenterZ;
+    std::vector<float> ExtentX; // Half sizes of the AABB.
+    std::vector<float> ExtentY;
+    std::vector<float> ExtentZ;
+    std::vector<float> Radius; // Of the bounding sphere around Center.
+    size_t Count = 0;
+};
+
+enum class CullShape
+{
+    Box,
+    Sphere
+};
+
+// Writes the indices of the bounds intersecting or inside the frustum to visible in the ascending order and returns their count,
+// visible needs room for bounds.Count. Conservative: boxes crossing two planes outside the frustum corner pass.
+// All the levels do the same float operations in the same order, so they give exactly the same result.
+size_t FrustumCull(const FrustumPlanes& planes, const CullingBounds& bounds, CullShape shape, UINT* visible, SimdLevel level = GetSimdLevel());
+}
@@ -0,0 +1,419 @@
+#include "DXrenderer/Culling/OcclusionBuffer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+#include "DXrenderer/Culling/FrustumCulling.h"
+#include "Utils/ThreadPool.h"
+
+#include "External/TinyGLTF/stb_image_write.h"
+
+namespace DirectxPlayground
+{
+namespace
+{
+constexpr UINT ClipPlanesCount = 6;
+constexpr UINT MaxClippedVertices = 3 + ClipPlanesCount;
+
+// Near, far, left, right, bottom, top in the clip space, inside is >= 0.
+const float ClipPlanes[ClipPlanesCount][4] = {
+    { 0.0f, 0.0f, 1.0f, 0.0f },
+    { 0.0f, 0.0f, -1.0f, 1.0f },
+    { 1.0f, 0.0f, 0.0f, 1.0f },
+    { -1.0f, 0.0f, 0.0f, 1.0f },
+    { 0.0f, 1.0f, 0.0f, 1.0f },
+    { 0.0f, -1.0f, 0.0f, 1.0f } };
+
+template <typename V>
+float PlaneDistance(const V& v, const float plane[4])
+{
+    return v.X * plane[0] + v.Y * plane[1] + v.Z * plane[2] + v.W * plane[3];
+}
+
+template <typename V>
+V TransformPoint(const float p[3], const float m[4][4])
+{
+    V res;
+    res.X = p[0] * m[0][0] + p[1] * m[1][0] + p[2] * m[2][0] + m[3][0];
+    res.Y = p[0] * m[0][1] + p[1] * m[1][1] + p[2] * m[2][1] + m[3][1];
+    res.Z = p[0] * m[0][2] + p[1] * m[1][2] + p[2] * m[2][2] + m[3][2];
+    res.W = p[0] * m[0][3] + p[1] * m[1][3] + p[2] * m[2][3] + m[3][3];
+    return res;
+}
+
+template <typename T>
+inline float EvalDepth(const T& t, float x, float y)
+{
+    return std::min(std::max(t.DepthA * x + t.DepthB * y + t.DepthC, t.MinDepth), t.MaxDepth);
+}
+
+template <typename T>
+void RasterizeRowsScalar(const T& t, float* depth, UINT width, int minX, int minY, int maxX, int maxY)
+{
+    for (int y = minY; y <= maxY; ++y)
+    {
+        float py = float(y) + 0.5f;
+        float* row = depth + size_t(y) * width;
+        for (int x = minX; x <= maxX; ++x)
+        {
+            float px = float(x) + 0.5f;
+            bool inside = true;
+            for (UINT e = 0; e < 3; ++e)
+                inside &= t.EdgeA[e] * px + t.EdgeB[e] * py + t.EdgeC[e] >= 0.0f;
+            if (inside)
+                row[x] = std::min(row[x], EvalDepth(t, px, py));
+        }
+    }
+}
+
+// minX is aligned to 4 inside the tile, the tile width is a multiple of it, so the whole steps stay inside the row.
+template <typename T>
+SIMD_TARGET_SSE41 void RasterizeRowsSSE(const T& t, float* depth, UINT width, int minX, int minY, int maxX, int maxY)
+{
+    const __m128 laneOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 minDepth = _mm_set1_ps(t.MinDepth);
+    const __m128 maxDepth = _mm_set1_ps(t.MaxDepth);
+    for (int y = minY; y <= maxY; ++y)
+    {
+        __m128 py = _mm_set1_ps(float(y) + 0.5f);
+        float* row = depth + size_t(y) * width;
+        for (int x = minX; x <= maxX; x += 4)
+        {
+            __m128 px = _mm_add_ps(_mm_set1_ps(float(x)), laneOffsets);
+            __m128 inside = _mm_cmpeq_ps(zero, zero);
+            for (UINT e = 0; e < 3; ++e)
+            {
+                __m128 edge = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(t.EdgeA[e]), px), _mm_mul_ps(_mm_set1_ps(t.EdgeB[e]), py)), _mm_set1_ps(t.EdgeC[e]));
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(edge, zero));
+            }
+            if (_mm_movemask_ps(inside) == 0)
+                continue;
+            __m128 z = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(t.DepthA), px), _mm_mul_ps(_mm_set1_ps(t.DepthB), py)), _mm_set1_ps(t.DepthC));
+            z = _mm_min_ps(_mm_max_ps(z, minDepth), maxDepth);
+            __m128 current = _mm_loadu_ps(row + x);
+            _mm_storeu_ps(row + x, _mm_blendv_ps(current, _mm_min_ps(current, z), inside));
+        }
+    }
+}
+
+template <typename T>
+SIMD_TARGET_AVX2 void RasterizeRowsAVX2(const T& t, float* depth, UINT width, int minX, int minY, int maxX, int maxY)
+{
+    const __m256 laneOffsets = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 minDepth = _mm256_set1_ps(t.MinDepth);
+    const __m256 maxDepth = _mm256_set1_ps(t.MaxDepth);
+    for (int y = minY; y <= maxY; ++y)
+    {
+        __m256 py = _mm256_set1_ps(float(y) + 0.5f);
+        float* row = depth + size_t(y) * width;
+        for (int x = minX; x <= maxX; x += 8)
+        {
+            __m256 px = _mm256_add_ps(_mm256_set1_ps(float(x)), laneOffsets);
+            __m256 inside = _mm256_cmp_ps(zero, zero, _CMP_EQ_OQ);
+            for (UINT e = 0; e < 3; ++e)
+            {
+                __m256 edge = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(t.EdgeA[e]), px), _mm256_mul_ps(_mm256_set1_ps(t.EdgeB[e]), py)), _mm256_set1_ps(t.EdgeC[e]));
+                inside = _mm256_and_ps(inside, _mm256_cmp_ps(edge, zero, _CMP_GE_OQ));
+            }
+            if (_mm256_movemask_ps(inside) == 0)
+                continue;
+            __m256 z = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(t.DepthA), px), _mm256_mul_ps(_mm256_set1_ps(t.DepthB), py)), _mm256_set1_ps(t.DepthC));
+            z = _mm256_min_ps(_mm256_max_ps(z, minDepth), maxDepth);
+            __m256 current = _mm256_loadu_ps(row + x);
+            _mm256_storeu_ps(row + x, _mm256_blendv_ps(current, _mm256_min_ps(current, z), inside));
+        }
+    }
+}
+}
+
+OcclusionBuffer::OcclusionBuffer(UINT width, UINT height)
+    : m_width((width + TileWidth - 1) / TileWidth * TileWidth)
+    , m_height((height + TileHeight - 1) / TileHeight * TileHeight)
+{
+    m_tilesX = m_width / TileWidth;
+    m_tilesY = m_height / TileHeight;
+    m_depth.resize(size_t(m_width) * m_height);
+    m_tileMaxDepth.resize(size_t(m_tilesX) * m_tilesY);
+    m_bins.resize(m_tileMaxDepth.size());
+    Clear();
+}
+
+void OcclusionBuffer::Clear()
+{
+    std::fill(m_depth.begin(), m_depth.end(), 1.0f);
+    std::fill(m_tileMaxDepth.begin(), m_tileMaxDepth.end(), 1.0f);
+    m_triangles.clear();
+}
+
+void OcclusionBuffer::AddOccluder(const byte* positions, size_t positionsStride, size_t vertexCount, const UINT* indices, size_t indexCount, const float toClip[4][4])
+{
+    m_clipVertices.resize(vertexCount);
+    for (size_t i = 0; i < vertexCount; ++i)
+    {
+        float p[3];
+        memcpy(p, positions + positionsStride * i, sizeof(p));
+        m_clipVertices[i] = TransformPoint<ClipVertex>(p, toClip);
+    }
+    for (size_t i = 0; i + 2 < indexCount; i += 3)
+    {
+        assert(indices[i] < vertexCount && indices[i + 1] < vertexCount && indices[i + 2] < vertexCount);
+        AddClippedTriangle(m_clipVertices[indices[i]], m_clipVertices[indices[i + 1]], m_clipVertices[indices[i + 2]]);
+    }
+}
+
+void OcclusionBuffer::AddClippedTriangle(const ClipVertex& v0, const ClipVertex& v1, const ClipVertex& v2)
+{
+    UINT outsideAny = 0;
+    for (const auto& plane : ClipPlanes)
+    {
+        UINT outside = (PlaneDistance(v0, plane) < 0.0f ? 1 : 0) + (PlaneDistance(v1, plane) < 0.0f ? 1 : 0) + (PlaneDistance(v2, plane) < 0.0f ? 1 : 0);
+        if (outside == 3)
+            return;
+        outsideAny += outside;
+    }
+    if (outsideAny == 0)
+    {
+        SetupTriangle(v0, v1, v2);
+        return;
+    }
+
+    // Sutherland-Hodgman against the planes the triangle crosses, then a fan.
+    ClipVertex polygon[2][MaxClippedVertices] = { { v0, v1, v2 } };
+    UINT count = 3;
+    UINT src = 0;
+    for (const auto& plane : ClipPlanes)
+    {
+        UINT dst = 1 - src;
+        UINT clippedCount = 0;
+        for (UINT i = 0; i < count; ++i)
+        {
+            const ClipVertex& a = polygon[src][i];
+            const ClipVertex& b = polygon[src][(i + 1) % count];
+            float da = PlaneDistance(a, plane);
+            float db = PlaneDistance(b, plane);
+            if (da >= 0.0f)
+                polygon[dst][clippedCount++] = a;
+            if ((da >= 0.0f) != (db >= 0.0f))
+            {
+                float t = da / (da - db);
+                polygon[dst][clippedCount++] = { a.X + (b.X - a.X) * t, a.Y + (b.Y - a.Y) * t, a.Z + (b.Z - a.Z) * t, a.W + (b.W - a.W) * t };
+            }
+        }
+        count = clippedCount;
+        src = dst;
+        if (count < 3)
+            return;
+    }
+    for (UINT i = 1; i + 1 < count; ++i)
+        SetupTriangle(polygon[src][0], polygon[src][i], polygon[src][i + 1]);
+}
+
+void OcclusionBuffer::SetupTriangle(const ClipVertex& v0, const ClipVertex& v1, const ClipVertex& v2)
+{
+    float x[3], y[3], z[3];
+    const ClipVertex* v[3] = { &v0, &v1, &v2 };
+    for (UINT i = 0; i < 3; ++i)
+    {
+        float invW = 1.0f / v[i]->W;
+        x[i] = (v[i]->X * invW * 0.5f + 0.5f) * float(m_width);
+        y[i] = (0.5f - v[i]->Y * invW * 0.5f) * float(m_height);
+        z[i] = v[i]->Z * invW;
+    }
+
+    float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+    if (std::abs(area) < 1e-8f)
+        return;
+
+    Triangle t;
+    t.MinX = std::max(0, int(std::ceil(std::min({ x[0], x[1], x[2] }) - 0.5f)));
+    t.MaxX = std::min(int(m_width) - 1, int(std::floor(std::max({ x[0], x[1], x[2] }) - 0.5f)));
+    t.MinY = std::max(0, int(std::ceil(std::min({ y[0], y[1], y[2] }) - 0.5f)));
+    t.MaxY = std::min(int(m_height) - 1, int(std::floor(std::max({ y[0], y[1], y[2] }) - 0.5f)));
+    if (t.MinX > t.MaxX || t.MinY > t.MaxY)
+        return; // Covers no pixel center.
+
+    // Both windings are occluders, the edges are flipped so the inside is positive either way.
+    float sign = area > 0.0f ? 1.0f : -1.0f;
+    for (UINT e = 0; e < 3; ++e)
+    {
+        UINT a = e;
+        UINT b = (e + 1) % 3;
+        t.EdgeA[e] = sign * (y[a] - y[b]);
+        t.EdgeB[e] = sign * (x[b] - x[a]);
+        t.EdgeC[e] = sign * (x[a] * y[b] - x[b] * y[a]);
+    }
+    float invArea = 1.0f / area;
+    t.DepthA = ((z[1] - z[0]) * (y[2] - y[0]) - (z[2] - z[0]) * (y[1] - y[0])) * invArea;
+    t.DepthB = ((z[2] - z[0]) * (x[1] - x[0]) - (z[1] - z[0]) * (x[2] - x[0])) * invArea;
+    t.DepthC = z[0] - t.DepthA * x[0] - t.DepthB * y[0];
+    t.MinDepth = std::min({ z[0], z[1], z[2] });
+    t.MaxDepth = std::max({ z[0], z[1], z[2] });
+    m_triangles.push_back(t);
+}
+
+void OcclusionBuffer::Rasterize(SimdLevel level /*= GetSimdLevel()*/, bool parallel /*= true*/)
+{
+    for (auto& bin : m_bins)
+        bin.clear();
+    for (UINT i = 0; i < m_triangles.size(); ++i)
+    {
+        const Triangle& t = m_triangles[i];
+        for (UINT ty = UINT(t.MinY) / TileHeight; ty <= UINT(t.MaxY) / TileHeight; ++ty)
+        {
+            for (UINT tx = UINT(t.MinX) / TileWidth; tx <= UINT(t.MaxX) / TileWidth; ++tx)
+                m_bins[ty * m_tilesX + tx].push_back(i);
+        }
+    }
+
+    // The tiles don't share pixels, so they need no synchronization.
+    if (parallel)
+    {
+        ThreadPool::Get().ParallelFor(m_bins.size(), [this, level](size_t tile) { RasterizeTile(UINT(tile), level); });
+        return;
+    }
+    for (UINT tile = 0; tile < m_bins.size(); ++tile)
+        RasterizeTile(tile, level);
+}
+
+void OcclusionBuffer::RasterizeTile(UINT tile, SimdLevel level)
+{
+    int tileMinX = int(tile % m_tilesX * TileWidth);
+    int tileMinY = int(tile / m_tilesX * TileHeight);
+    int tileMaxX = tileMinX + int(TileWidth) - 1;
+    int tileMaxY = tileMinY + int(TileHeight) - 1;
+    UINT lanes = level == SimdLevel::AVX2 ? 8 : (level == SimdLevel::SSE41 ? 4 : 1);
+
+    for (UINT triangle : m_bins[tile])
+    {
+        const Triangle& t = m_triangles[triangle];
+        int minX = std::max(t.MinX, tileMinX);
+        int maxX = std::min(t.MaxX, tileMaxX);
+        int minY = std::max(t.MinY, tileMinY);
+        int maxY = std::min(t.MaxY, tileMaxY);
+        minX = tileMinX + ((minX - tileMinX) & ~int(lanes - 1));
+        switch (level)
+        {
+        case SimdLevel::AVX2:
+            RasterizeRowsAVX2(t, m_depth.data(), m_width, minX, minY, maxX, maxY);
+            break;
+        case SimdLevel::SSE41:
+            RasterizeRowsSSE(t, m_depth.data(), m_width, minX, minY, maxX, maxY);
+            break;
+        default:
+            RasterizeRowsScalar(t, m_depth.data(), m_width, minX, minY, maxX, maxY);
+            break;
+        }
+    }
+
+    float maxDepth = 0.0f;
+    for (int y = tileMinY; y <= tileMaxY; ++y)
+    {
+        const float* row = m_depth.data() + size_t(y) * m_width;
+        maxDepth = std::max(maxDepth, *std::max_element(row + tileMinX, row + tileMaxX + 1));
+    }
+    m_tileMaxDepth[tile] = maxDepth;
+}
+
+bool OcclusionBuffer::IsVisible(const float center[3], const float extents[3], const float viewProjection[4][4]) const
+{
+    float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX;
+    float minDepth = FLT_MAX;
+    for (UINT corner = 0; corner < 8; ++corner)
+    {
+        float p[3];
+        for (UINT c = 0; c < 3; ++c)
+            p[c] = center[c] + ((corner >> c) & 1 ? extents[c] : -extents[c]);
+        ClipVertex v = TransformPoint<ClipVertex>(p, viewProjection);
+        if (v.Z < 0.0f)
+            return true; // In front of the near plane or behind the camera, the projection can't be trusted.
+        float invW = 1.0f / v.W;
+        float x = (v.X * invW * 0.5f + 0.5f) * float(m_width);
+        float y = (0.5f - v.Y * invW * 0.5f) * float(m_height);
+        minX = std::min(minX, x);
+        maxX = std::max(maxX, x);
+        minY = std::min(minY, y);
+        maxY = std::max(maxY, y);
+        minDepth = std::min(minDepth, v.Z * invW);
+    }
+
+    // Every pixel the rect touches, not only the covered centers.
+    int rectMinX = std::max(0, int(std::floor(minX)));
+    int rectMinY = std::max(0, int(std::floor(minY)));
+    int rectMaxX = std::min(int(m_width) - 1, int(std::floor(maxX)));
+    int rectMaxY = std::min(int(m_height) - 1, int(std::floor(maxY)));
+    if (rectMinX > rectMaxX || rectMinY > rectMaxY)
+        return false;
+    return IsRectVisible(rectMinX, rectMinY, rectMaxX, rectMaxY, minDepth);
+}
+
+bool OcclusionBuffer::IsRectVisible(int minX, int minY, int maxX, int maxY, float minDepth) const
+{
+    for (int ty = minY / int(TileHeight); ty <= maxY / int(TileHeight); ++ty)
+    {
+        for (int tx = minX / int(TileWidth); tx <= maxX / int(TileWidth); ++tx)
+        {
+            if (minDepth > m_tileMaxDepth[ty * m_tilesX + tx])
+                continue; // Behind everything in the tile.
+
+            int y0 = std::max(minY, ty * int(TileHeight));
+            int y1 = std::min(maxY, (ty + 1) * int(TileHeight) - 1);
+            int x0 = std::max(minX, tx * int(TileWidth));
+            int x1 = std::min(maxX, (tx + 1) * int(TileWidth) - 1);
+            for (int y = y0; y <= y1; ++y)
+            {
+                const float* row = m_depth.data() + size_t(y) * m_width;
+                for (int x = x0; x <= x1; ++x)
+                {
+                    if (minDepth <= row[x])
+                        return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+size_t OcclusionBuffer::FilterVisible(const CullingBounds& bounds, UINT* indices, size_t count, const float viewProjection[4][4]) const
+{
+    size_t visibleCount = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        UINT index = indices[i];
+        float center[3] = { bounds.CenterX[index], bounds.CenterY[index], bounds.CenterZ[index] };
+        float extents[3] = { bounds.ExtentX[index], bounds.ExtentY[index], bounds.ExtentZ[index] };
+        if (IsVisible(center, extents, viewProjection))
+            indices[visibleCount++] = index;
+    }
+    return visibleCount;
+}
+
+void OcclusionBuffer::GetDebugImage(std::vector<byte>& pixels) const
+{
+    float minDepth = 1.0f;
+    float maxDepth = 0.0f;
+    for (float depth : m_depth)
+    {
+        if (depth >= 1.0f)
+            continue;
+        minDepth = std::min(minDepth, depth);
+        maxDepth = std::max(maxDepth, depth);
+    }
+    float range = std::max(maxDepth - minDepth, 1e-6f);
+
+    pixels.resize(m_depth.size());
+    for (size_t i = 0; i < m_depth.size(); ++i)
+        pixels[i] = m_depth[i] >= 1.0f ? 0 : byte(32.0f + 223.0f * (1.0f - (m_depth[i] - minDepth) / range));
+}
+
+bool OcclusionBuffer::SaveDebugImage(const std::string& path) const
+{
+    std::vector<byte> pixels;
+    GetDebugImage(pixels);
+    return stbi_write_png(path.c_str(), int(m_width), int(m_height), 1, pixels.data(), int(m_width)) != 0;
+}
+}
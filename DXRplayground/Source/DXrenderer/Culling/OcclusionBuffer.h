@@ -0,0 +1,108 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <windows.h>
+
+#include "Utils/Simd.h"
+
+namespace DirectxPlayground
+{
+struct CullingBounds;
+
+// Low resolution CPU depth buffer for occlusion culling. A few simplified occluders are rasterized into it, then the bounds of the draws
+// are tested against it before the draws are recorded. Nothing in it touches the device.
+// The depth is per pixel with the max per TileWidth x TileHeight tile on top, the tiles reject most of the tests without looking at the pixels.
+// Rasterization goes tile by tile on the thread pool, a pixel row of a tile is 4 or 8 pixels per SIMD step.
+// D3D depth: 0 is near, cleared to 1. Occluders are clipped to the frustum, occludees crossing the near plane are always visible.
+class OcclusionBuffer
+{
+public:
+    static constexpr UINT TileWidth = 32;
+    static constexpr UINT TileHeight = 8;
+
+    OcclusionBuffer(UINT width, UINT height); // Rounded up to whole tiles.
+    OcclusionBuffer(const OcclusionBuffer&) = delete;
+    OcclusionBuffer(OcclusionBuffer&&) = delete;
+    OcclusionBuffer& operator=(const OcclusionBuffer&) = delete;
+    OcclusionBuffer& operator=(OcclusionBuffer&&) = delete;
+
+    void Clear(); // Drops the occluders and resets the depth.
+
+    // Triangle list with float3 positions, toClip is the row vector world * view * projection, i.e. for Camera::GetViewProjection.
+    void AddOccluder(const byte* positions, size_t positionsStride, size_t vertexCount, const UINT* indices, size_t indexCount, const float toClip[4][4]);
+    void Rasterize(SimdLevel level = GetSimdLevel(), bool parallel = true);
+
+    // World space AABB. Conservative: false only if the box is behind the occluders at every pixel it covers, or off the screen.
+    bool IsVisible(const float center[3], const float extents[3], const float viewProjection[4][4]) const;
+    // Keeps the visible ones of indices into bounds in place, i.e. a FrustumCull result, and returns their count.
+    size_t FilterVisible(const CullingBounds& bounds, UINT* indices, size_t count, const float viewProjection[4][4]) const;
+
+    UINT GetWidth() const;
+    UINT GetHeight() const;
+    float GetDepth(UINT x, UINT y) const;
+    size_t GetTrianglesCount() const; // After the clipping.
+
+    // 8 bit grayscale, white is near. The far depth of a perspective projection is squeezed near 1, so it's remapped over the min and max depth written.
+    void GetDebugImage(std::vector<byte>& pixels) const;
+    bool SaveDebugImage(const std::string& path) const; // PNG.
+
+private:
+    // Screen space edge functions, inside is >= 0 for all three, and the depth plane. Evaluated at the pixel centers.
+    struct Triangle
+    {
+        float EdgeA[3];
+        float EdgeB[3];
+        float EdgeC[3];
+        float DepthA;
+        float DepthB;
+        float DepthC;
+        float MinDepth;
+        float MaxDepth;
+        int MinX;
+        int MinY;
+        int MaxX;
+        int MaxY;
+    };
+
+    struct ClipVertex
+    {
+        float X, Y, Z, W;
+    };
+
+    void AddClippedTriangle(const ClipVertex& v0, const ClipVertex& v1, const ClipVertex& v2);
+    void SetupTriangle(const ClipVertex& v0, const ClipVertex& v1, const ClipVertex& v2);
+    void RasterizeTile(UINT tile, SimdLevel level);
+    bool IsRectVisible(int minX, int minY, int maxX, int maxY, float minDepth) const;
+
+    UINT m_width = 0;
+    UINT m_height = 0;
+    UINT m_tilesX = 0;
+    UINT m_tilesY = 0;
+    std::vector<float> m_depth;
+    std::vector<float> m_tileMaxDepth;
+    std::vector<Triangle> m_triangles;
+    std::vector<std::vector<UINT>> m_bins; // Triangles touching each tile.
+    std::vector<ClipVertex> m_clipVertices; // Scratch for AddOccluder.
+};
+
+inline UINT OcclusionBuffer::GetWidth() const
+{
+    return m_width;
+}
+
+inline UINT OcclusionBuffer::GetHeight() const
+{
+    return m_height;
+}
+
+inline float OcclusionBuffer::GetDepth(UINT x, UINT y) const
+{
+    return m_depth[size_t(y) * m_width + x];
+}
+
+inline size_t OcclusionBuffer::GetTrianglesCount() const
+{
+    return m_triangles.size();
+}
+}
@@ -108,16 +108,30 @@ void BottomLevelAccelerationStructure::Prebuild(RenderContext& context, const D3
         desc.Triangles.VertexBuffer.StrideInBytes = sizeof(Vertex);
         desc.Flags = D3D12_RAYTRACING_GEOMETRY_FLAG_OPAQUE;
     }
+    const DXGI_FORMAT vertexFormat = desc.Triangles.VertexFormat;
+    const UINT64 vertexStride = desc.Triangles.VertexBuffer.StrideInBytes;
     for (const auto model : m_models)
     {
-        for (const auto mesh : model->GetMeshes())
+        const auto& meshes = model->GetMeshes();
+        for (UINT meshIndex = 0; meshIndex < meshes.size(); ++meshIndex)
         {
-            m_toNonPixelTransitions.push_back(CD3DX12_RESOURCE_BARRIER::Transition(mesh->GetIndexBufferResource(), D3D12_RESOURCE_STATE_INDEX_BUFFER, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE));
-            m_toNonPixelTransitions.push_back(CD3DX12_RESOURCE_BARRIER::Transition(mesh->GetVertexBufferResource(), D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE));
-
-            m_toIndexVertexTransitions.push_back(CD3DX12_RESOURCE_BARRIER::Transition(mesh->GetIndexBufferResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_INDEX_BUFFER));
-            m_toIndexVertexTransitions.push_back(CD3DX12_RESOURCE_BARRIER::Transition(mesh->GetVertexBufferResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER));
-
+            const auto mesh = meshes[meshIndex];
+            // The geometry pool blocks are always readable by the builds.
+            if (!mesh->IsPooled())
+            {
+                m_toNonPixelTransitions.push_back(CD3DX12_RESOURCE_BARRIER::Transition(mesh->GetIndexBufferResource(), D3D12_RESOURCE_STATE_INDEX_BUFFER, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE));
+                m_toNonPixelTransitions.push_back(CD3DX12_RESOURCE_BARRIER::Transition(mesh->GetVertexBufferResource(), D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE));
+
+                m_toIndexVertexTransitions.push_back(CD3DX12_RESOURCE_BARRIER::Transition(mesh->GetIndexBufferResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_INDEX_BUFFER));
+                m_toIndexVertexTransitions.push_back(CD3DX12_RESOURCE_BARRIER::Transition(mesh->GetVertexBufferResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER));
+            }
+
+            // Quantized positions go in as UNORM16 (the w handedness is ignored), the mesh transform dequantizes them.
+            // The UNORM vertex formats need raytracing tier 1.1.
+            desc.Triangles.VertexFormat = mesh->HasQuantizedVertices() ? DXGI_FORMAT_R16G16B16A16_UNORM : vertexFormat;
+            desc.Triangles.VertexBuffer.StrideInBytes = mesh->HasQuantizedVertices() ? sizeof(QuantizedVertex) : vertexStride;
+            desc.Triangles.IndexFormat = mesh->GetIndexFormat();
+            desc.Triangles.Transform3x4 = model->GetMeshTransform3x4GpuAddress(meshIndex);
             desc.Triangles.IndexBuffer = mesh->GetIndexBufferGpuAddress();
             desc.Triangles.IndexCount = mesh->GetIndexCount();
             desc.Triangles.VertexCount = mesh->GetVertexCount();
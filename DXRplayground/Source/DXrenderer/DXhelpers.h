@@ -92,6 +92,19 @@ inline std::array<D3D12_INPUT_ELEMENT_DESC, 4>& GetInputLayoutUV_N_T()
     return layout;
 }
 
+// QuantizedVertex. Positions are in the mesh bounds, shaders dequantize them with the bounds constant buffer.
+inline std::array<D3D12_INPUT_ELEMENT_DESC, 4>& GetInputLayoutQuantized()
+{
+    static std::array<D3D12_INPUT_ELEMENT_DESC, 4> layout =
+    { {
+        { "POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+        { "TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT, 0, 8, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+        { "NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+        { "TANGENT", 0, DXGI_FORMAT_R16G16_SNORM, 0, 16, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
+    } };
+    return layout;
+}
+
 
 constexpr UINT ConstantBuffersCountPerSpace = 8;
 constexpr UINT MaxSpacesForConstantBuffers = 2;
@@ -99,6 +112,7 @@ constexpr UINT MaxUAV = 6;
 constexpr UINT MaxSpacesForUAV = 2;
 constexpr UINT TextureTableIndex = ConstantBuffersCountPerSpace * MaxSpacesForConstantBuffers + MaxUAV * MaxSpacesForUAV;
 constexpr UINT UAVCubemapTableIndex = TextureTableIndex + 1;
+constexpr UINT InstanceDataRootIndex = UAVCubemapTableIndex + 1; // Root SRV t0 space1, StructuredBuffer<InstanceData>. See InstanceBatcher.
 
 inline UINT GetCBRootParamIndex(UINT index, UINT space = 0)
 {
@@ -154,6 +168,9 @@ inline HRESULT CreateCommonRootSignature(ID3D12Device* device, REFIID riid, void
     cbParams.emplace_back();
     cbParams.back().InitAsDescriptorTable(1, &cubeUavRange, D3D12_SHADER_VISIBILITY_ALL);
 
+    cbParams.emplace_back();
+    cbParams.back().InitAsShaderResourceView(0, 1);
+
     CD3DX12_STATIC_SAMPLER_DESC linearClamp(
         0,
         D3D12_FILTER_MIN_MAG_MIP_LINEAR,
@@ -229,6 +246,44 @@ inline UINT GetPixelSize(DXGI_FORMAT format)
     return formats.at(format);
 }
 
+// Bytes per 4x4 block of the block compressed formats, 0 for the others.
+inline UINT GetCompressedBlockSize(DXGI_FORMAT format)
+{
+    switch (format)
+    {
+    case DXGI_FORMAT_BC1_UNORM:
+    case DXGI_FORMAT_BC1_UNORM_SRGB:
+    case DXGI_FORMAT_BC4_UNORM:
+    case DXGI_FORMAT_BC4_SNORM:
+        return 8;
+    case DXGI_FORMAT_BC2_UNORM:
+    case DXGI_FORMAT_BC2_UNORM_SRGB:
+    case DXGI_FORMAT_BC3_UNORM:
+    case DXGI_FORMAT_BC3_UNORM_SRGB:
+    case DXGI_FORMAT_BC5_UNORM:
+    case DXGI_FORMAT_BC5_SNORM:
+    case DXGI_FORMAT_BC6H_UF16:
+    case DXGI_FORMAT_BC6H_SF16:
+    case DXGI_FORMAT_BC7_UNORM:
+    case DXGI_FORMAT_BC7_UNORM_SRGB:
+        return 16;
+    default:
+        return 0;
+    }
+}
+
+// Tightly packed row of texels, or of 4x4 blocks for the block compressed formats.
+inline UINT GetRowPitch(DXGI_FORMAT format, UINT width)
+{
+    UINT blockSize = GetCompressedBlockSize(format);
+    return blockSize > 0 ? ((width + 3) / 4) * blockSize : width * GetPixelSize(format);
+}
+
+inline UINT GetRowsCount(DXGI_FORMAT format, UINT height)
+{
+    return GetCompressedBlockSize(format) > 0 ? (height + 3) / 4 : height;
+}
+
 inline constexpr DirectX::XMFLOAT4X4 IdentityMatrix{
     1.0f, 0.0f, 0.0f, 0.0f,
     0.0f, 1.0f, 0.0f, 0.0f,
@@ -0,0 +1,253 @@
+#include "DXrenderer/DrawQueue.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#include "Utils/RadixSort.h"
+#include "Utils/Timer.h"
+
+namespace DirectxPlayground
+{
+namespace
+{
+constexpr UINT PassBits = 4;
+constexpr UINT PsoBits = 16;
+constexpr UINT MaterialBits = 20;
+constexpr UINT DepthBits = 24;
+
+bool operator==(const D3D12_VERTEX_BUFFER_VIEW& a, const D3D12_VERTEX_BUFFER_VIEW& b)
+{
+    return a.BufferLocation == b.BufferLocation && a.SizeInBytes == b.SizeInBytes && a.StrideInBytes == b.StrideInBytes;
+}
+
+bool operator==(const D3D12_INDEX_BUFFER_VIEW& a, const D3D12_INDEX_BUFFER_VIEW& b)
+{
+    return a.BufferLocation == b.BufferLocation && a.SizeInBytes == b.SizeInBytes && a.Format == b.Format;
+}
+}
+
+D3DDrawCommandList::D3DDrawCommandList(ID3D12GraphicsCommandList* commandList)
+    : m_commandList(commandList)
+{
+}
+
+void D3DDrawCommandList::SetPipelineState(ID3D12PipelineState* pso)
+{
+    m_commandList->SetPipelineState(pso);
+}
+
+void D3DDrawCommandList::SetGraphicsRootConstantBufferView(UINT rootIndex, D3D12_GPU_VIRTUAL_ADDRESS address)
+{
+    m_commandList->SetGraphicsRootConstantBufferView(rootIndex, address);
+}
+
+void D3DDrawCommandList::SetGraphicsRootShaderResourceView(UINT rootIndex, D3D12_GPU_VIRTUAL_ADDRESS address)
+{
+    m_commandList->SetGraphicsRootShaderResourceView(rootIndex, address);
+}
+
+void D3DDrawCommandList::IASetVertexBuffers(const D3D12_VERTEX_BUFFER_VIEW& view)
+{
+    m_commandList->IASetVertexBuffers(0, 1, &view);
+}
+
+void D3DDrawCommandList::IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW& view)
+{
+    m_commandList->IASetIndexBuffer(&view);
+}
+
+void D3DDrawCommandList::IASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY topology)
+{
+    m_commandList->IASetPrimitiveTopology(topology);
+}
+
+void D3DDrawCommandList::DrawIndexedInstanced(UINT indexCount, UINT instanceCount, UINT startIndex, INT baseVertex, UINT startInstance)
+{
+    m_commandList->DrawIndexedInstanced(indexCount, instanceCount, startIndex, baseVertex, startInstance);
+}
+
+RedundantStateFilter::RedundantStateFilter(IDrawCommandList& target)
+    : m_target(target)
+{
+}
+
+void RedundantStateFilter::Reset()
+{
+    m_pso = nullptr;
+    m_validRootDescriptors = 0;
+    m_vertexBuffer = {};
+    m_indexBuffer = {};
+    m_topology = D3D_PRIMITIVE_TOPOLOGY_UNDEFINED;
+}
+
+void RedundantStateFilter::ResetStats()
+{
+    m_stats = {};
+}
+
+void RedundantStateFilter::SetPipelineState(ID3D12PipelineState* pso)
+{
+    if (pso == m_pso)
+    {
+        ++m_stats.PsoElided;
+        return;
+    }
+    m_pso = pso;
+    ++m_stats.PsoBinds;
+    m_target.SetPipelineState(pso);
+}
+
+void RedundantStateFilter::SetGraphicsRootConstantBufferView(UINT rootIndex, D3D12_GPU_VIRTUAL_ADDRESS address)
+{
+    if (IsBound(rootIndex, address))
+    {
+        ++m_stats.CbvElided;
+        return;
+    }
+    ++m_stats.CbvBinds;
+    m_target.SetGraphicsRootConstantBufferView(rootIndex, address);
+}
+
+void RedundantStateFilter::SetGraphicsRootShaderResourceView(UINT rootIndex, D3D12_GPU_VIRTUAL_ADDRESS address)
+{
+    if (IsBound(rootIndex, address))
+    {
+        ++m_stats.SrvElided;
+        return;
+    }
+    ++m_stats.SrvBinds;
+    m_target.SetGraphicsRootShaderResourceView(rootIndex, address);
+}
+
+void RedundantStateFilter::IASetVertexBuffers(const D3D12_VERTEX_BUFFER_VIEW& view)
+{
+    if (m_vertexBuffer.BufferLocation != 0 && view == m_vertexBuffer)
+    {
+        ++m_stats.VertexBufferElided;
+        return;
+    }
+    m_vertexBuffer = view;
+    ++m_stats.VertexBufferBinds;
+    m_target.IASetVertexBuffers(view);
+}
+
+void RedundantStateFilter::IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW& view)
+{
+    if (m_indexBuffer.BufferLocation != 0 && view == m_indexBuffer)
+    {
+        ++m_stats.IndexBufferElided;
+        return;
+    }
+    m_indexBuffer = view;
+    ++m_stats.IndexBufferBinds;
+    m_target.IASetIndexBuffer(view);
+}
+
+void RedundantStateFilter::IASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY topology)
+{
+    if (topology == m_topology)
+    {
+        ++m_stats.TopologyElided;
+        return;
+    }
+    m_topology = topology;
+    ++m_stats.TopologyBinds;
+    m_target.IASetPrimitiveTopology(topology);
+}
+
+void RedundantStateFilter::DrawIndexedInstanced(UINT indexCount, UINT instanceCount, UINT startIndex, INT baseVertex, UINT startInstance)
+{
+    ++m_stats.Draws;
+    m_target.DrawIndexedInstanced(indexCount, instanceCount, startIndex, baseVertex, startInstance);
+}
+
+bool RedundantStateFilter::IsBound(UINT rootIndex, D3D12_GPU_VIRTUAL_ADDRESS address)
+{
+    // Remembers the address as bound if it isn't yet, the caller binds it then.
+    assert(rootIndex < MaxRootParameters);
+    UINT bit = 1u << rootIndex;
+    if ((m_validRootDescriptors & bit) != 0 && m_rootDescriptors[rootIndex] == address)
+        return true;
+    m_validRootDescriptors |= bit;
+    m_rootDescriptors[rootIndex] = address;
+    return false;
+}
+
+void DrawPacket::AddCbv(UINT rootIndex, D3D12_GPU_VIRTUAL_ADDRESS address)
+{
+    assert(CbvCount < MaxCbvs);
+    Cbvs[CbvCount++] = { rootIndex, address };
+}
+
+void DrawPacket::AddSrv(UINT rootIndex, D3D12_GPU_VIRTUAL_ADDRESS address)
+{
+    assert(SrvCount < MaxSrvs);
+    Srvs[SrvCount++] = { rootIndex, address };
+}
+
+UINT64 DrawQueue::MakeSortKey(UINT pass, UINT psoId, UINT materialId, float depth)
+{
+    assert(pass < (1u << PassBits) && psoId < (1u << PsoBits));
+    // Non negative floats order the same as their bits, the top ones are enough for the front to back order.
+    UINT depthBits;
+    depth = std::max(depth, 0.0f);
+    memcpy(&depthBits, &depth, sizeof(depthBits));
+    depthBits >>= 31 - DepthBits;
+
+    UINT64 key = UINT64(pass) << (PsoBits + MaterialBits + DepthBits);
+    key |= UINT64(psoId) << (MaterialBits + DepthBits);
+    key |= UINT64(materialId & ((1u << MaterialBits) - 1)) << DepthBits;
+    key |= UINT64(depthBits);
+    return key;
+}
+
+UINT DrawQueue::GetPsoId(ID3D12PipelineState* pso)
+{
+    auto it = m_psoIds.find(pso);
+    if (it != m_psoIds.end())
+        return it->second;
+    UINT id = UINT(m_psoIds.size());
+    m_psoIds.emplace(pso, id);
+    return id;
+}
+
+void DrawQueue::Submit(const DrawPacket& packet)
+{
+    m_packets.push_back(packet);
+}
+
+void DrawQueue::Flush(IDrawCommandList& commandList)
+{
+    size_t count = m_packets.size();
+    Timer timer;
+    m_keys.resize(count);
+    m_order.resize(count);
+    m_keysScratch.resize(count);
+    m_orderScratch.resize(count);
+    for (UINT i = 0; i < count; ++i)
+    {
+        m_keys[i] = m_packets[i].SortKey;
+        m_order[i] = i;
+    }
+    RadixSort(m_keys.data(), m_order.data(), count, m_keysScratch.data(), m_orderScratch.data());
+    m_lastSortMs = timer.GetElapsedMs();
+
+    RedundantStateFilter filter(commandList);
+    for (UINT index : m_order)
+    {
+        const DrawPacket& packet = m_packets[index];
+        filter.SetPipelineState(packet.Pso);
+        for (UINT i = 0; i < packet.CbvCount; ++i)
+            filter.SetGraphicsRootConstantBufferView(packet.Cbvs[i].RootIndex, packet.Cbvs[i].Address);
+        for (UINT i = 0; i < packet.SrvCount; ++i)
+            filter.SetGraphicsRootShaderResourceView(packet.Srvs[i].RootIndex, packet.Srvs[i].Address);
+        filter.IASetVertexBuffers(packet.VertexBuffer);
+        filter.IASetIndexBuffer(packet.IndexBuffer);
+        filter.IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+        filter.DrawIndexedInstanced(packet.IndexCount, packet.InstanceCount, packet.StartIndex, packet.BaseVertex, packet.StartInstance);
+    }
+    m_lastFlushStats = filter.GetStats();
+    m_packets.clear();
+}
+}
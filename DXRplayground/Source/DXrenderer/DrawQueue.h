@@ -0,0 +1,169 @@
+#pragma once
+
+#include <d3d12.h>
+#include <unordered_map>
+#include <vector>
+
+namespace DirectxPlayground
+{
+// The part of ID3D12GraphicsCommandList the draw queue records. The D3D one forwards, a recording one can stand in for it without a device.
+class IDrawCommandList
+{
+public:
+    virtual ~IDrawCommandList() = default;
+
+    virtual void SetPipelineState(ID3D12PipelineState* pso) = 0;
+    virtual void SetGraphicsRootConstantBufferView(UINT rootIndex, D3D12_GPU_VIRTUAL_ADDRESS address) = 0;
+    virtual void SetGraphicsRootShaderResourceView(UINT rootIndex, D3D12_GPU_VIRTUAL_ADDRESS address) = 0;
+    virtual void IASetVertexBuffers(const D3D12_VERTEX_BUFFER_VIEW& view) = 0; // Slot 0 only, all the inputs are interleaved.
+    virtual void IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW& view) = 0;
+    virtual void IASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY topology) = 0;
+    virtual void DrawIndexedInstanced(UINT indexCount, UINT instanceCount, UINT startIndex, INT baseVertex, UINT startInstance) = 0;
+};
+
+class D3DDrawCommandList : public IDrawCommandList
+{
+public:
+    explicit D3DDrawCommandList(ID3D12GraphicsCommandList* commandList);
+
+    void SetPipelineState(ID3D12PipelineState* pso) override;
+    void SetGraphicsRootConstantBufferView(UINT rootIndex, D3D12_GPU_VIRTUAL_ADDRESS address) override;
+    void SetGraphicsRootShaderResourceView(UINT rootIndex, D3D12_GPU_VIRTUAL_ADDRESS address) override;
+    void IASetVertexBuffers(const D3D12_VERTEX_BUFFER_VIEW& view) override;
+    void IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW& view) override;
+    void IASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY topology) override;
+    void DrawIndexedInstanced(UINT indexCount, UINT instanceCount, UINT startIndex, INT baseVertex, UINT startInstance) override;
+
+private:
+    ID3D12GraphicsCommandList* m_commandList = nullptr;
+};
+
+struct DrawStateStats
+{
+    UINT Draws = 0;
+    UINT PsoBinds = 0;
+    UINT PsoElided = 0;
+    UINT CbvBinds = 0;
+    UINT CbvElided = 0;
+    UINT SrvBinds = 0;
+    UINT SrvElided = 0;
+    UINT VertexBufferBinds = 0;
+    UINT VertexBufferElided = 0;
+    UINT IndexBufferBinds = 0;
+    UINT IndexBufferElided = 0;
+    UINT TopologyBinds = 0;
+    UINT TopologyElided = 0;
+};
+
+// Passes a bind on only if it changes what's bound. Knows nothing about what was bound before it, so Reset it
+// whenever the state is lost or set behind its back, i.e. a new command list or root signature.
+class RedundantStateFilter : public IDrawCommandList
+{
+public:
+    static constexpr UINT MaxRootParameters = 32;
+
+    explicit RedundantStateFilter(IDrawCommandList& target);
+
+    void Reset();
+    const DrawStateStats& GetStats() const;
+    void ResetStats();
+
+    void SetPipelineState(ID3D12PipelineState* pso) override;
+    void SetGraphicsRootConstantBufferView(UINT rootIndex, D3D12_GPU_VIRTUAL_ADDRESS address) override;
+    void SetGraphicsRootShaderResourceView(UINT rootIndex, D3D12_GPU_VIRTUAL_ADDRESS address) override;
+    void IASetVertexBuffers(const D3D12_VERTEX_BUFFER_VIEW& view) override;
+    void IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW& view) override;
+    void IASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY topology) override;
+    void DrawIndexedInstanced(UINT indexCount, UINT instanceCount, UINT startIndex, INT baseVertex, UINT startInstance) override;
+
+private:
+    bool IsBound(UINT rootIndex, D3D12_GPU_VIRTUAL_ADDRESS address);
+
+    IDrawCommandList& m_target;
+    DrawStateStats m_stats;
+    ID3D12PipelineState* m_pso = nullptr;
+    D3D12_GPU_VIRTUAL_ADDRESS m_rootDescriptors[MaxRootParameters]{}; // A root parameter is either a CBV or an SRV, never both.
+    UINT m_validRootDescriptors = 0; // Bit per root parameter.
+    D3D12_VERTEX_BUFFER_VIEW m_vertexBuffer{};
+    D3D12_INDEX_BUFFER_VIEW m_indexBuffer{};
+    D3D12_PRIMITIVE_TOPOLOGY m_topology = D3D_PRIMITIVE_TOPOLOGY_UNDEFINED;
+};
+
+// Everything a draw binds, the per pass state (root signature, descriptor heaps, the camera and the lights) is set by the scene before the flush.
+struct DrawPacket
+{
+    static constexpr UINT MaxCbvs = 4;
+    static constexpr UINT MaxSrvs = 2;
+
+    struct RootDescriptor
+    {
+        UINT RootIndex = 0;
+        D3D12_GPU_VIRTUAL_ADDRESS Address = 0;
+    };
+
+    UINT64 SortKey = 0;
+    ID3D12PipelineState* Pso = nullptr;
+    RootDescriptor Cbvs[MaxCbvs];
+    UINT CbvCount = 0;
+    RootDescriptor Srvs[MaxSrvs];
+    UINT SrvCount = 0;
+    D3D12_VERTEX_BUFFER_VIEW VertexBuffer{};
+    D3D12_INDEX_BUFFER_VIEW IndexBuffer{};
+    UINT IndexCount = 0;
+    UINT InstanceCount = 1;
+    UINT StartIndex = 0;
+    INT BaseVertex = 0;
+    UINT StartInstance = 0;
+
+    void AddCbv(UINT rootIndex, D3D12_GPU_VIRTUAL_ADDRESS address);
+    void AddSrv(UINT rootIndex, D3D12_GPU_VIRTUAL_ADDRESS address);
+};
+
+// Scenes submit the draws in any order, the flush records them sorted by the key through a RedundantStateFilter.
+// Key bits, high to low: pass 4, pso 16, material 20, depth 24. So a pass is drawn PSO by PSO, material by material and front to back inside.
+class DrawQueue
+{
+public:
+    static UINT64 MakeSortKey(UINT pass, UINT psoId, UINT materialId, float depth);
+
+    UINT GetPsoId(ID3D12PipelineState* pso); // Small stable ids for the keys, in the order the PSOs are first seen.
+
+    void Submit(const DrawPacket& packet);
+    // Sorts, records and clears the queue. The filter state starts from scratch every flush.
+    void Flush(IDrawCommandList& commandList);
+
+    size_t GetSize() const;
+    const DrawStateStats& GetLastFlushStats() const;
+    double GetLastSortMs() const;
+
+private:
+    std::vector<DrawPacket> m_packets;
+    std::vector<UINT64> m_keys;
+    std::vector<UINT> m_order;
+    std::vector<UINT64> m_keysScratch;
+    std::vector<UINT> m_orderScratch;
+    std::unordered_map<ID3D12PipelineState*, UINT> m_psoIds;
+    DrawStateStats m_lastFlushStats;
+    double m_lastSortMs = 0.0;
+};
+
+inline const DrawStateStats& RedundantStateFilter::GetStats() const
+{
+    return m_stats;
+}
+
+inline size_t DrawQueue::GetSize() const
+{
+    return m_packets.size();
+}
+
+inline const DrawStateStats& DrawQueue::GetLastFlushStats() const
+{
+    return m_lastFlushStats;
+}
+
+inline double DrawQueue::GetLastSortMs() const
+{
+    return m_lastSortMs;
+}
+}
@@ -0,0 +1,362 @@
+#include "DXrenderer/Geometry/AccessorGather.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+namespace DirectxPlayground
+{
+namespace
+{
+void GatherScalar(const byte* src, size_t srcStride, byte* dst, size_t dstStride, size_t count, UINT components, const float* scale)
+{
+    for (size_t i = 0; i < count; ++i, src += srcStride, dst += dstStride)
+    {
+        float tmp[4];
+        memcpy(tmp, src, sizeof(float) * components);
+        for (UINT c = 0; c < components; ++c)
+            tmp[c] *= scale[c];
+        memcpy(dst, tmp, sizeof(float) * components);
+    }
+}
+
+SIMD_TARGET_SSE41 inline void StorePartial(float* dst, __m128 v, UINT components)
+{
+    if (components == 4)
+    {
+        _mm_storeu_ps(dst, v);
+        return;
+    }
+    if (components == 1)
+    {
+        _mm_store_ss(dst, v);
+        return;
+    }
+    _mm_storel_pi(reinterpret_cast<__m64*>(dst), v);
+    if (components == 3)
+        _mm_store_ss(dst + 2, _mm_movehl_ps(v, v));
+}
+
+// Elements that can be loaded as a whole register of loadSize bytes without reading past the accessor, i.e. past the last element.
+// The rest go through the scalar path.
+size_t GetFullLoadCount(size_t srcStride, size_t count, size_t elementSize, size_t loadSize)
+{
+    if (count == 0)
+        return 0;
+    const size_t readableBytes = srcStride * (count - 1) + elementSize;
+    if (readableBytes < loadSize)
+        return 0;
+    if (srcStride == 0)
+        return count;
+    return std::min(count, (readableBytes - loadSize) / srcStride + 1);
+}
+
+// Full 16 byte loads read past the element, so the last elements (one for the usual strides) are copied by the scalar loop.
+SIMD_TARGET_SSE41 void GatherSSE(const byte* src, size_t srcStride, byte* dst, size_t dstStride, size_t count, UINT components, const float* scale)
+{
+    float scale4[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+    memcpy(scale4, scale, sizeof(float) * components);
+    const __m128 s = _mm_loadu_ps(scale4);
+
+    const size_t simdCount = GetFullLoadCount(srcStride, count, sizeof(float) * components, sizeof(__m128));
+    for (size_t i = 0; i < simdCount; ++i, src += srcStride, dst += dstStride)
+    {
+        __m128 v = _mm_mul_ps(_mm_loadu_ps(reinterpret_cast<const float*>(src)), s);
+        StorePartial(reinterpret_cast<float*>(dst), v, components);
+    }
+    GatherScalar(src, srcStride, dst, dstStride, count - simdCount, components, scale);
+}
+
+// Eight elements per iteration: a component of all of them is fetched with one gather and scaled as a whole register,
+// then the registers are transposed back to elements. The gathers read exactly the component floats, so nothing is read past
+// the accessor. The gather indices are 32 bit and in floats: a float accessor stride is a multiple of 4 and at most 252 by the spec,
+// anything else takes the SSE path.
+SIMD_TARGET_AVX2 void GatherAVX2(const byte* src, size_t srcStride, byte* dst, size_t dstStride, size_t count, UINT components, const float* scale)
+{
+    if (srcStride % sizeof(float) != 0 || srcStride > 1024)
+    {
+        GatherSSE(src, srcStride, dst, dstStride, count, components, scale);
+        return;
+    }
+
+    const __m256i indices = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(int(srcStride / sizeof(float))));
+    const __m256 sx = _mm256_set1_ps(scale[0]);
+    const __m256 sy = _mm256_set1_ps(scale[1]);
+    const __m256 sz = _mm256_set1_ps(components > 2 ? scale[2] : 0.0f);
+    const __m256 sw = _mm256_set1_ps(components > 3 ? scale[3] : 0.0f);
+    const __m256 zero = _mm256_setzero_ps();
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8, src += srcStride * 8)
+    {
+        const float* s = reinterpret_cast<const float*>(src);
+        __m256 x = _mm256_mul_ps(_mm256_i32gather_ps(s, indices, 4), sx);
+        __m256 y = _mm256_mul_ps(_mm256_i32gather_ps(s + 1, indices, 4), sy);
+        __m256 z = components > 2 ? _mm256_mul_ps(_mm256_i32gather_ps(s + 2, indices, 4), sz) : zero;
+        __m256 w = components > 3 ? _mm256_mul_ps(_mm256_i32gather_ps(s + 3, indices, 4), sw) : zero;
+
+        // 4x8 transpose, the low halves get the elements 0-3 and the high halves the elements 4-7.
+        __m256 xy0 = _mm256_unpacklo_ps(x, y);
+        __m256 xy1 = _mm256_unpackhi_ps(x, y);
+        __m256 zw0 = _mm256_unpacklo_ps(z, w);
+        __m256 zw1 = _mm256_unpackhi_ps(z, w);
+        __m256 elements[4] = {
+            _mm256_shuffle_ps(xy0, zw0, _MM_SHUFFLE(1, 0, 1, 0)),
+            _mm256_shuffle_ps(xy0, zw0, _MM_SHUFFLE(3, 2, 3, 2)),
+            _mm256_shuffle_ps(xy1, zw1, _MM_SHUFFLE(1, 0, 1, 0)),
+            _mm256_shuffle_ps(xy1, zw1, _MM_SHUFFLE(3, 2, 3, 2)) };
+        for (UINT e = 0; e < 4; ++e, dst += dstStride)
+            StorePartial(reinterpret_cast<float*>(dst), _mm256_castps256_ps128(elements[e]), components);
+        for (UINT e = 0; e < 4; ++e, dst += dstStride)
+            StorePartial(reinterpret_cast<float*>(dst), _mm256_extractf128_ps(elements[e], 1), components);
+    }
+    GatherScalar(src, srcStride, dst, dstStride, count - i, components, scale);
+}
+
+UINT GetComponentSize(ComponentType type)
+{
+    switch (type)
+    {
+    case ComponentType::Byte:
+    case ComponentType::UnsignedByte:
+        return 1;
+    case ComponentType::Short:
+    case ComponentType::UnsignedShort:
+        return 2;
+    default:
+        return 4;
+    }
+}
+
+// Multiplier taking a normalized integer to [0, 1] or [-1, 1]. Signed ones also need the clamp, the most negative value is below -1.
+float GetNormalizationScale(ComponentType type, bool normalized)
+{
+    if (!normalized)
+        return 1.0f;
+    switch (type)
+    {
+    case ComponentType::Byte:
+        return 1.0f / 127.0f;
+    case ComponentType::UnsignedByte:
+        return 1.0f / 255.0f;
+    case ComponentType::Short:
+        return 1.0f / 32767.0f;
+    case ComponentType::UnsignedShort:
+        return 1.0f / 65535.0f;
+    default:
+        return 1.0f;
+    }
+}
+
+float ReadComponent(const byte* src, ComponentType type)
+{
+    switch (type)
+    {
+    case ComponentType::Byte:
+        return float(*reinterpret_cast<const signed char*>(src));
+    case ComponentType::UnsignedByte:
+        return float(*src);
+    case ComponentType::Short:
+    {
+        SHORT v;
+        memcpy(&v, src, sizeof(v));
+        return float(v);
+    }
+    case ComponentType::UnsignedShort:
+    {
+        USHORT v;
+        memcpy(&v, src, sizeof(v));
+        return float(v);
+    }
+    case ComponentType::UnsignedInt:
+    {
+        UINT v;
+        memcpy(&v, src, sizeof(v));
+        return float(v);
+    }
+    default:
+    {
+        float v;
+        memcpy(&v, src, sizeof(v));
+        return v;
+    }
+    }
+}
+
+struct ElementConversion
+{
+    ComponentType Type = ComponentType::Float;
+    bool ClampToMinusOne = false;
+    float Normalization = 1.0f; // Applied and clamped before the user scale.
+    float Scale[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+    float Offset[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+};
+
+void ConvertScalar(const byte* src, size_t srcStride, byte* dst, size_t dstStride, size_t count, UINT components, const ElementConversion& conv)
+{
+    const UINT componentSize = GetComponentSize(conv.Type);
+    for (size_t i = 0; i < count; ++i, src += srcStride, dst += dstStride)
+    {
+        float tmp[4];
+        for (UINT c = 0; c < components; ++c)
+        {
+            float v = ReadComponent(src + c * componentSize, conv.Type) * conv.Normalization;
+            if (conv.ClampToMinusOne)
+                v = v < -1.0f ? -1.0f : v;
+            tmp[c] = v * conv.Scale[c] + conv.Offset[c];
+        }
+        memcpy(dst, tmp, sizeof(float) * components);
+    }
+}
+
+SIMD_TARGET_SSE41 inline __m128 LoadElementSSE(const byte* src, ComponentType type)
+{
+    switch (type)
+    {
+    case ComponentType::Byte:
+    {
+        int v;
+        memcpy(&v, src, sizeof(v));
+        return _mm_cvtepi32_ps(_mm_cvtepi8_epi32(_mm_cvtsi32_si128(v)));
+    }
+    case ComponentType::UnsignedByte:
+    {
+        int v;
+        memcpy(&v, src, sizeof(v));
+        return _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(v)));
+    }
+    case ComponentType::Short:
+        return _mm_cvtepi32_ps(_mm_cvtepi16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src))));
+    case ComponentType::UnsignedShort:
+        return _mm_cvtepi32_ps(_mm_cvtepu16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src))));
+    default:
+        return _mm_loadu_ps(reinterpret_cast<const float*>(src));
+    }
+}
+
+// Every element is loaded as a whole register: 4 bytes for bytes, 8 for shorts, 16 for floats. The lanes past `components` are garbage
+// and aren't stored. Only the last elements could read past the accessor that way, they go through the scalar path.
+SIMD_TARGET_SSE41 void ConvertSSE(const byte* src, size_t srcStride, byte* dst, size_t dstStride, size_t count, UINT components, const ElementConversion& conv)
+{
+    const UINT componentSize = GetComponentSize(conv.Type);
+    const size_t loadSize = conv.Type == ComponentType::Float ? 16 : componentSize * 4;
+    const size_t simdCount = GetFullLoadCount(srcStride, count, size_t(componentSize) * components, loadSize);
+
+    const __m128 normalization = _mm_set1_ps(conv.Normalization);
+    const __m128 minusOne = _mm_set1_ps(-1.0f);
+    const __m128 scale = _mm_loadu_ps(conv.Scale);
+    const __m128 offset = _mm_loadu_ps(conv.Offset);
+    for (size_t i = 0; i < simdCount; ++i, src += srcStride, dst += dstStride)
+    {
+        __m128 v = _mm_mul_ps(LoadElementSSE(src, conv.Type), normalization);
+        if (conv.ClampToMinusOne)
+            v = _mm_max_ps(v, minusOne);
+        StorePartial(reinterpret_cast<float*>(dst), _mm_add_ps(_mm_mul_ps(v, scale), offset), components);
+    }
+    ConvertScalar(src, srcStride, dst, dstStride, count - simdCount, components, conv);
+}
+
+void ReadIndices(const byte* src, ComponentType type, UINT* dst, size_t count)
+{
+    switch (type)
+    {
+    case ComponentType::UnsignedByte:
+        for (size_t i = 0; i < count; ++i)
+            dst[i] = src[i];
+        break;
+    case ComponentType::UnsignedShort:
+        for (size_t i = 0; i < count; ++i)
+        {
+            USHORT v;
+            memcpy(&v, src + i * sizeof(USHORT), sizeof(v));
+            dst[i] = v;
+        }
+        break;
+    default:
+        memcpy(dst, src, sizeof(UINT) * count);
+        break;
+    }
+}
+}
+
+void GatherFloatElements(const byte* src, size_t srcStride, byte* dst, size_t dstStride, size_t count, UINT components, const float* scale /*= nullptr*/, SimdLevel level /*= GetSimdLevel()*/)
+{
+    assert(components >= 2 && components <= 4 && "Only float2, float3 and float4 elements are supported");
+    static const float identityScale[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+    if (scale == nullptr)
+        scale = identityScale;
+
+    switch (level)
+    {
+    case SimdLevel::AVX2:
+        GatherAVX2(src, srcStride, dst, dstStride, count, components, scale);
+        break;
+    case SimdLevel::SSE41:
+        GatherSSE(src, srcStride, dst, dstStride, count, components, scale);
+        break;
+    default:
+        GatherScalar(src, srcStride, dst, dstStride, count, components, scale);
+        break;
+    }
+}
+
+void GatherElements(const byte* src, size_t srcStride, ComponentType type, bool normalized, byte* dst, size_t dstStride, size_t count, UINT components,
+    const float* scale /*= nullptr*/, const float* offset /*= nullptr*/, SimdLevel level /*= GetSimdLevel()*/)
+{
+    assert(components >= 1 && components <= 4);
+    if (type == ComponentType::Float && offset == nullptr && components >= 2)
+    {
+        GatherFloatElements(src, srcStride, dst, dstStride, count, components, scale, level);
+        return;
+    }
+
+    ElementConversion conv;
+    conv.Type = type;
+    conv.Normalization = GetNormalizationScale(type, normalized);
+    conv.ClampToMinusOne = normalized && (type == ComponentType::Byte || type == ComponentType::Short);
+    if (scale != nullptr)
+        memcpy(conv.Scale, scale, sizeof(float) * components);
+    if (offset != nullptr)
+        memcpy(conv.Offset, offset, sizeof(float) * components);
+
+    // 32 bit integers aren't allowed for vertex attributes by the spec, they aren't worth a kernel.
+    if (level != SimdLevel::Scalar && type != ComponentType::UnsignedInt)
+        ConvertSSE(src, srcStride, dst, dstStride, count, components, conv);
+    else
+        ConvertScalar(src, srcStride, dst, dstStride, count, components, conv);
+}
+
+bool ScatterElements(const byte* indices, ComponentType indexType, const byte* values, ComponentType type, bool normalized, byte* dst, size_t dstStride,
+    size_t dstCount, size_t count, UINT components, const float* scale /*= nullptr*/, const float* offset /*= nullptr*/, SimdLevel level /*= GetSimdLevel()*/)
+{
+    assert(components >= 1 && components <= 4);
+    assert((indexType == ComponentType::UnsignedByte || indexType == ComponentType::UnsignedShort || indexType == ComponentType::UnsignedInt)
+        && "Sparse indices must be unsigned");
+
+    // Small enough to stay in L1 together with the indices.
+    constexpr size_t blockSize = 256;
+    UINT blockIndices[blockSize];
+    float blockValues[blockSize * 4];
+    const size_t indexSize = GetComponentSize(indexType);
+    const size_t valueSize = size_t(GetComponentSize(type)) * components;
+    const size_t elementSize = sizeof(float) * components;
+
+    bool inRange = true;
+    for (size_t start = 0; start < count; start += blockSize)
+    {
+        size_t n = std::min(blockSize, count - start);
+        ReadIndices(indices + start * indexSize, indexType, blockIndices, n);
+        GatherElements(values + start * valueSize, valueSize, type, normalized, reinterpret_cast<byte*>(blockValues), elementSize, n, components, scale, offset, level);
+        for (size_t i = 0; i < n; ++i)
+        {
+            if (blockIndices[i] >= dstCount)
+            {
+                inRange = false;
+                continue;
+            }
+            memcpy(dst + size_t(blockIndices[i]) * dstStride, blockValues + i * components, elementSize);
+        }
+    }
+    return inRange;
+}
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <windows.h>
+
+#include "Utils/Simd.h"
+
+namespace DirectxPlayground
+{
+// Copies count elements of `components` (2, 3 or 4) floats from a strided source into a strided destination,
+// i.e. from a glTF accessor straight into one field of an interleaved vertex array. Optional per component scale is baked in.
+void GatherFloatElements(const byte* src, size_t srcStride, byte* dst, size_t dstStride, size_t count, UINT components, const float* scale = nullptr, SimdLevel level = GetSimdLevel());
+
+// glTF accessor component types, the values match the spec so tinygltf ones can be cast directly.
+enum class ComponentType : UINT
+{
+    Byte = 5120,
+    UnsignedByte = 5121,
+    Short = 5122,
+    UnsignedShort = 5123,
+    UnsignedInt = 5125,
+    Float = 5126
+};
+
+// The same for any component type, i.e. KHR_mesh_quantization attributes. Normalized integers map to [0, 1] or [-1, 1] per the spec,
+// the other ones are converted as is. Then dst = value * scale + offset, both are optional and per component.
+void GatherElements(const byte* src, size_t srcStride, ComponentType type, bool normalized, byte* dst, size_t dstStride, size_t count, UINT components,
+    const float* scale = nullptr, const float* offset = nullptr, SimdLevel level = GetSimdLevel());
+
+// glTF sparse accessor overlay: element indices[i] of dst is replaced with values[i], converted as GatherElements does.
+// The values are tightly packed as the spec requires. They are converted in blocks with the vectorized gather and then stored by index,
+// there are no scatter stores below AVX-512. Indices past dstCount are skipped, returns false if there were any.
+bool ScatterElements(const byte* indices, ComponentType indexType, const byte* values, ComponentType type, bool normalized, byte* dst, size_t dstStride,
+    size_t dstCount, size_t count, UINT components, const float* scale = nullptr, const float* offset = nullptr, SimdLevel level = GetSimdLevel());
+}
@@ -0,0 +1,358 @@
+#include "DXrenderer/Geometry/MeshCache.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+
+#include "Utils/FileStamp.h"
+#include "Utils/Hash.h"
+#include "Utils/Logger.h"
+
+namespace DirectxPlayground
+{
+namespace
+{
+constexpr UINT CacheMagic = 0x434D5844; // "DXMC"
+constexpr UINT CacheVersion = 4; // Bump on any change of the layout, Vertex or Material.
+constexpr size_t BlobAlignment = 16;
+
+struct FileHeader
+{
+    UINT Magic = CacheMagic;
+    UINT Version = CacheVersion;
+    UINT VertexSize = sizeof(Vertex);
+    UINT MaterialSize = sizeof(Material);
+    UINT64 SourceSize = 0;
+    INT64 SourceTime = 0;
+    UINT64 SourceHash = 0;
+    UINT DependencyCount = 0;
+    UINT ImageCount = 0;
+    UINT TextureCount = 0;
+    UINT MaterialCount = 0;
+    UINT NodeCount = 0;
+    UINT MeshCount = 0;
+    UINT ProcessingFlags = 0;
+    UINT Padding = 0;
+    UINT64 FileSize = 0;
+};
+
+struct DependencyHeader
+{
+    UINT64 Size = 0;
+    INT64 Time = 0;
+};
+
+struct MeshHeader
+{
+    int MaterialIndex = -1;
+    UINT VertexCount = 0;
+    UINT IndexCount = 0;
+    UINT NodeIndex = 0;
+    UINT64 VertexOffset = 0;
+    UINT64 IndexOffset = 0;
+};
+
+class BlobWriter
+{
+public:
+    template <typename T>
+    size_t Write(const T& value)
+    {
+        return WriteBytes(&value, sizeof(T));
+    }
+
+    size_t WriteBytes(const void* data, size_t size)
+    {
+        size_t offset = m_data.size();
+        m_data.resize(offset + size);
+        if (size > 0)
+            memcpy(m_data.data() + offset, data, size);
+        return offset;
+    }
+
+    void WriteString(const std::string& str)
+    {
+        Write(UINT(str.size()));
+        WriteBytes(str.data(), str.size());
+        Align(sizeof(UINT));
+    }
+
+    void Align(size_t alignment)
+    {
+        m_data.resize((m_data.size() + alignment - 1) & ~(alignment - 1));
+    }
+
+    template <typename T>
+    void Patch(size_t offset, const T& value)
+    {
+        memcpy(m_data.data() + offset, &value, sizeof(T));
+    }
+
+    size_t GetSize() const
+    {
+        return m_data.size();
+    }
+
+    const std::vector<byte>& GetData() const
+    {
+        return m_data;
+    }
+
+private:
+    std::vector<byte> m_data;
+};
+
+class BlobReader
+{
+public:
+    BlobReader(const byte* data, size_t size)
+        : m_data(data)
+        , m_size(size)
+    {}
+
+    template <typename T>
+    const T* Read(size_t count = 1)
+    {
+        return reinterpret_cast<const T*>(ReadBytes(sizeof(T) * count));
+    }
+
+    const byte* ReadBytes(size_t size)
+    {
+        if (!m_valid || size > m_size - m_offset)
+        {
+            m_valid = false;
+            return nullptr;
+        }
+        const byte* res = m_data + m_offset;
+        m_offset += size;
+        return res;
+    }
+
+    bool ReadString(std::string& str)
+    {
+        const UINT* length = Read<UINT>();
+        const byte* chars = length != nullptr ? ReadBytes(*length) : nullptr;
+        if (chars == nullptr)
+            return false;
+        str.assign(reinterpret_cast<const char*>(chars), *length);
+        Align(sizeof(UINT));
+        return true;
+    }
+
+    void Align(size_t alignment)
+    {
+        m_offset = std::min(m_size, (m_offset + alignment - 1) & ~(alignment - 1));
+    }
+
+    const byte* GetBlob(UINT64 offset, size_t size) const
+    {
+        if (offset > m_size || size > m_size - offset)
+            return nullptr;
+        return m_data + offset;
+    }
+
+    bool IsValid() const
+    {
+        return m_valid;
+    }
+
+private:
+    const byte* m_data = nullptr;
+    size_t m_size = 0;
+    size_t m_offset = 0;
+    bool m_valid = true;
+};
+}
+
+std::string MeshCache::GetCachePath(const std::string& sourcePath)
+{
+    std::error_code ec;
+    std::filesystem::path source = std::filesystem::weakly_canonical(sourcePath, ec);
+    if (ec)
+        source = sourcePath;
+
+    std::stringstream ss;
+    ss << ASSETS_DIR << "Cache//Meshes//" << source.stem().string() << '_' << std::hex << std::setw(16) << std::setfill('0') << HashString(source.string()) << ".meshcache";
+    return ss.str();
+}
+
+bool MeshCache::Write(const std::string& sourcePath, const ModelData& data)
+{
+    std::filesystem::path source{ sourcePath };
+    std::filesystem::path sourceDir = source.parent_path();
+
+    FileHeader header;
+    FileStamp stamp;
+    if (!GetFileStamp(source, stamp) || !HashFile(sourcePath, header.SourceHash))
+        return false;
+    header.SourceSize = stamp.Size;
+    header.SourceTime = stamp.Time;
+    header.DependencyCount = UINT(data.Dependencies.size());
+    header.ImageCount = UINT(data.Images.size());
+    header.TextureCount = UINT(data.Textures.size());
+    header.MaterialCount = UINT(data.Materials.size());
+    header.NodeCount = UINT(data.Nodes.size());
+    header.MeshCount = UINT(data.Meshes.size());
+    header.ProcessingFlags = data.ProcessingFlags;
+
+    BlobWriter writer;
+    writer.Write(header);
+    for (const auto& dependency : data.Dependencies)
+    {
+        DependencyHeader dependencyHeader;
+        FileStamp dependencyStamp;
+        if (!GetFileStamp(sourceDir / dependency, dependencyStamp))
+            return false;
+        dependencyHeader.Size = dependencyStamp.Size;
+        dependencyHeader.Time = dependencyStamp.Time;
+        writer.Write(dependencyHeader);
+        writer.WriteString(dependency);
+    }
+    for (const auto& image : data.Images)
+        writer.WriteString(image);
+    writer.WriteBytes(data.Textures.data(), sizeof(int) * data.Textures.size());
+    writer.WriteBytes(data.Materials.data(), sizeof(Material) * data.Materials.size());
+    writer.WriteBytes(data.Nodes.data(), sizeof(NodeData) * data.Nodes.size());
+
+    writer.Align(alignof(MeshHeader));
+    std::vector<size_t> meshHeaderOffsets;
+    meshHeaderOffsets.reserve(data.Meshes.size());
+    for (const auto& mesh : data.Meshes)
+    {
+        MeshHeader meshHeader;
+        meshHeader.MaterialIndex = mesh.MaterialIndex;
+        meshHeader.VertexCount = mesh.VertexCount;
+        meshHeader.IndexCount = mesh.IndexCount;
+        meshHeader.NodeIndex = mesh.NodeIndex;
+        meshHeaderOffsets.push_back(writer.Write(meshHeader));
+    }
+
+    for (size_t i = 0; i < data.Meshes.size(); ++i)
+    {
+        const MeshData& mesh = data.Meshes[i];
+        MeshHeader meshHeader;
+        memcpy(&meshHeader, writer.GetData().data() + meshHeaderOffsets[i], sizeof(MeshHeader));
+
+        writer.Align(BlobAlignment);
+        meshHeader.VertexOffset = writer.WriteBytes(mesh.Vertices, sizeof(Vertex) * mesh.VertexCount);
+        writer.Align(BlobAlignment);
+        meshHeader.IndexOffset = writer.WriteBytes(mesh.Indices, sizeof(UINT) * mesh.IndexCount);
+        writer.Patch(meshHeaderOffsets[i], meshHeader);
+    }
+    header.FileSize = writer.GetSize();
+    writer.Patch(0, header);
+
+    std::string cachePath = GetCachePath(sourcePath);
+    std::string tmpPath = cachePath + ".tmp";
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(cachePath).parent_path(), ec);
+    {
+        std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!file)
+            return false;
+        file.write(reinterpret_cast<const char*>(writer.GetData().data()), writer.GetSize());
+        if (!file)
+            return false;
+    }
+    // Readers never see a half written cache.
+    std::filesystem::rename(tmpPath, cachePath, ec);
+    if (ec)
+    {
+        std::filesystem::remove(tmpPath, ec);
+        return false;
+    }
+    return true;
+}
+
+bool MeshCache::Open(const std::string& sourcePath, UINT processingFlags)
+{
+    m_data = {};
+    if (!m_file.Open(GetCachePath(sourcePath)))
+        return false;
+
+    BlobReader reader(m_file.GetData(), m_file.GetSize());
+    const FileHeader* header = reader.Read<FileHeader>();
+    if (header == nullptr || header->Magic != CacheMagic || header->Version != CacheVersion || header->VertexSize != sizeof(Vertex)
+        || header->MaterialSize != sizeof(Material) || header->FileSize != m_file.GetSize() || header->ProcessingFlags != processingFlags)
+    {
+        m_file.Close();
+        return false;
+    }
+
+    std::filesystem::path source{ sourcePath };
+    FileStamp stamp;
+    if (!GetFileStamp(source, stamp))
+    {
+        m_file.Close();
+        return false;
+    }
+    if (stamp.Size != header->SourceSize || stamp.Time != header->SourceTime)
+    {
+        // Touched but maybe not modified, the content decides.
+        UINT64 hash = 0;
+        if (stamp.Size != header->SourceSize || !HashFile(sourcePath, hash) || hash != header->SourceHash)
+        {
+            m_file.Close();
+            return false;
+        }
+    }
+
+    bool valid = true;
+    for (UINT i = 0; i < header->DependencyCount && valid; ++i)
+    {
+        const DependencyHeader* dependencyHeader = reader.Read<DependencyHeader>();
+        std::string dependency;
+        FileStamp dependencyStamp;
+        valid = dependencyHeader != nullptr && reader.ReadString(dependency) && GetFileStamp(source.parent_path() / dependency, dependencyStamp)
+            && dependencyStamp.Size == dependencyHeader->Size && dependencyStamp.Time == dependencyHeader->Time;
+        if (valid)
+            m_data.Dependencies.push_back(std::move(dependency));
+    }
+    for (UINT i = 0; i < header->ImageCount && valid; ++i)
+    {
+        m_data.Images.emplace_back();
+        valid = reader.ReadString(m_data.Images.back());
+    }
+
+    const int* textures = reader.Read<int>(header->TextureCount);
+    const Material* materials = reader.Read<Material>(header->MaterialCount);
+    const NodeData* nodes = reader.Read<NodeData>(header->NodeCount);
+    reader.Align(alignof(MeshHeader));
+    const MeshHeader* meshHeaders = reader.Read<MeshHeader>(header->MeshCount);
+    valid = valid && reader.IsValid();
+    if (valid)
+    {
+        m_data.Textures.assign(textures, textures + header->TextureCount);
+        m_data.Materials.assign(materials, materials + header->MaterialCount);
+        m_data.Nodes.assign(nodes, nodes + header->NodeCount);
+        for (UINT i = 0; i < header->NodeCount && valid; ++i)
+            valid = nodes[i].Parent == NodeHierarchy::NoParent || nodes[i].Parent < i;
+        m_data.Meshes.reserve(header->MeshCount);
+        for (UINT i = 0; i < header->MeshCount && valid; ++i)
+        {
+            const MeshHeader& meshHeader = meshHeaders[i];
+            MeshData mesh;
+            mesh.MaterialIndex = meshHeader.MaterialIndex;
+            mesh.VertexCount = meshHeader.VertexCount;
+            mesh.IndexCount = meshHeader.IndexCount;
+            mesh.NodeIndex = meshHeader.NodeIndex;
+            mesh.Vertices = reinterpret_cast<const Vertex*>(reader.GetBlob(meshHeader.VertexOffset, sizeof(Vertex) * size_t(mesh.VertexCount)));
+            mesh.Indices = reinterpret_cast<const UINT*>(reader.GetBlob(meshHeader.IndexOffset, sizeof(UINT) * size_t(mesh.IndexCount)));
+            valid = mesh.Vertices != nullptr && mesh.Indices != nullptr && mesh.NodeIndex < header->NodeCount;
+            m_data.Meshes.push_back(mesh);
+        }
+    }
+
+    m_data.ProcessingFlags = header->ProcessingFlags;
+    if (!valid)
+    {
+        LOG("Mesh cache for ", sourcePath, " is stale or corrupted");
+        m_data = {};
+        m_file.Close();
+        return false;
+    }
+    return true;
+}
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "DXrenderer/Model.h"
+#include "Utils/MappedFile.h"
+
+namespace DirectxPlayground
+{
+// Flat binary snapshot of a decoded glTF model: final vertex and index arrays per mesh, the flattened nodes, the material table and the image list.
+// It's written on a cold load and memory mapped on the next ones, so tinygltf and the accessor decoding are skipped entirely.
+// The cache is keyed by the source path and validated against the source mtime/size, falling back to the content hash.
+class MeshCache
+{
+public:
+    struct NodeData
+    {
+        UINT Parent = NodeHierarchy::NoParent;
+        XMFLOAT3 Translation = { 0.0f, 0.0f, 0.0f };
+        XMFLOAT4 Rotation = { 0.0f, 0.0f, 0.0f, 1.0f };
+        XMFLOAT3 Scale = { 1.0f, 1.0f, 1.0f };
+    };
+
+    struct MeshData
+    {
+        int MaterialIndex = -1;
+        UINT NodeIndex = 0;
+        const Vertex* Vertices = nullptr;
+        UINT VertexCount = 0;
+        const UINT* Indices = nullptr;
+        UINT IndexCount = 0;
+    };
+
+    struct ModelData
+    {
+        UINT ProcessingFlags = 0; // Loader settings the geometry was processed with, a cache built with other ones is stale.
+        std::vector<std::string> Dependencies; // Other files the model was built from (glTF buffers), relative to the source dir.
+        std::vector<std::string> Images;
+        std::vector<int> Textures;
+        std::vector<Material> Materials;
+        std::vector<NodeData> Nodes; // In the NodeHierarchy order.
+        std::vector<MeshData> Meshes;
+    };
+
+    static std::string GetCachePath(const std::string& sourcePath);
+    static bool Write(const std::string& sourcePath, const ModelData& data);
+
+    bool Open(const std::string& sourcePath, UINT processingFlags);
+    const ModelData& GetData() const;
+
+private:
+    MappedFile m_file;
+    ModelData m_data;
+};
+
+inline const MeshCache::ModelData& MeshCache::GetData() const
+{
+    return m_data;
+}
+}
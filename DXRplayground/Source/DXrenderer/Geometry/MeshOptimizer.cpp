@@ -0,0 +1,288 @@
+#include "DXrenderer/Geometry/MeshOptimizer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+namespace DirectxPlayground
+{
+namespace
+{
+constexpr UINT InvalidIndex = ~0U;
+constexpr UINT MinOverdrawClusterSize = 64; // In triangles. Smaller clusters are merged into the previous one.
+
+void ComputeTriangleCenterAndNormal(const byte* positions, size_t positionsStride, const UINT* triangle, float center[3], float normal[3])
+{
+    float p[3][3];
+    for (UINT i = 0; i < 3; ++i)
+        memcpy(p[i], positions + positionsStride * triangle[i], sizeof(float) * 3);
+
+    float e0[3] = { p[1][0] - p[0][0], p[1][1] - p[0][1], p[1][2] - p[0][2] };
+    float e1[3] = { p[2][0] - p[0][0], p[2][1] - p[0][1], p[2][2] - p[0][2] };
+    // Not normalized, the length is twice the area which is the weight we want anyway.
+    normal[0] = e0[1] * e1[2] - e0[2] * e1[1];
+    normal[1] = e0[2] * e1[0] - e0[0] * e1[2];
+    normal[2] = e0[0] * e1[1] - e0[1] * e1[0];
+    for (UINT c = 0; c < 3; ++c)
+        center[c] = (p[0][c] + p[1][c] + p[2][c]) / 3.0f;
+}
+}
+
+void BuildTriangleAdjacency(const UINT* indices, size_t indexCount, size_t vertexCount, TriangleAdjacency& adjacency)
+{
+    adjacency.Counts.assign(vertexCount, 0);
+    adjacency.Offsets.resize(vertexCount);
+    adjacency.Triangles.resize(indexCount);
+
+    for (size_t i = 0; i < indexCount; ++i)
+        adjacency.Counts[indices[i]]++;
+
+    UINT offset = 0;
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+        adjacency.Offsets[v] = offset;
+        offset += adjacency.Counts[v];
+    }
+
+    std::vector<UINT> fill = adjacency.Offsets;
+    for (size_t i = 0; i < indexCount; ++i)
+        adjacency.Triangles[fill[indices[i]]++] = UINT(i / 3);
+}
+
+float VertexCacheStats::GetAcmr() const
+{
+    return TrianglesCount > 0 ? float(double(TransformedCount) / double(TrianglesCount)) : 0.0f;
+}
+
+float VertexCacheStats::GetAtvr() const
+{
+    return VerticesCount > 0 ? float(double(TransformedCount) / double(VerticesCount)) : 0.0f;
+}
+
+VertexCacheStats& VertexCacheStats::operator+=(const VertexCacheStats& other)
+{
+    TrianglesCount += other.TrianglesCount;
+    VerticesCount += other.VerticesCount;
+    TransformedCount += other.TransformedCount;
+    return *this;
+}
+
+VertexCacheStats AnalyzeVertexCache(const UINT* indices, size_t indexCount, size_t vertexCount, UINT cacheSize /*= DefaultVertexCacheSize*/)
+{
+    assert(indexCount % 3 == 0);
+
+    VertexCacheStats stats;
+    stats.TrianglesCount = indexCount / 3;
+
+    // FIFO cache: a vertex is a hit if it entered the cache less than cacheSize misses ago.
+    std::vector<UINT64> cacheTime(vertexCount, 0);
+    std::vector<bool> used(vertexCount, false);
+    UINT64 timestamp = cacheSize + 1;
+    for (size_t i = 0; i < indexCount; ++i)
+    {
+        UINT v = indices[i];
+        assert(v < vertexCount);
+        if (!used[v])
+        {
+            used[v] = true;
+            stats.VerticesCount++;
+        }
+        if (timestamp - cacheTime[v] > cacheSize)
+        {
+            cacheTime[v] = timestamp++;
+            stats.TransformedCount++;
+        }
+    }
+    return stats;
+}
+
+void OptimizeVertexCache(UINT* dst, const UINT* indices, size_t indexCount, size_t vertexCount, UINT cacheSize /*= DefaultVertexCacheSize*/, std::vector<UINT>* clusters /*= nullptr*/)
+{
+    assert(dst != indices);
+    assert(indexCount % 3 == 0);
+    if (clusters != nullptr)
+        clusters->clear();
+    if (indexCount == 0)
+        return;
+
+    TriangleAdjacency adjacency;
+    BuildTriangleAdjacency(indices, indexCount, vertexCount, adjacency);
+
+    std::vector<UINT> liveTriangles = adjacency.Counts;
+    std::vector<UINT64> cacheTime(vertexCount, 0);
+    std::vector<bool> emitted(indexCount / 3, false);
+    std::vector<UINT> deadEnd;
+    std::vector<UINT> candidates;
+    deadEnd.reserve(indexCount);
+
+    UINT64 timestamp = cacheSize + 1;
+    size_t cursor = 0;
+    size_t outputCount = 0;
+
+    auto skipDeadEnd = [&]() -> UINT
+    {
+        while (!deadEnd.empty())
+        {
+            UINT v = deadEnd.back();
+            deadEnd.pop_back();
+            if (liveTriangles[v] > 0)
+                return v;
+        }
+        for (; cursor < vertexCount; ++cursor)
+        {
+            if (liveTriangles[cursor] > 0)
+                return UINT(cursor);
+        }
+        return InvalidIndex;
+    };
+
+    UINT fanning = skipDeadEnd();
+    if (clusters != nullptr)
+        clusters->push_back(0);
+    while (fanning != InvalidIndex)
+    {
+        candidates.clear();
+        const UINT* triangles = adjacency.Triangles.data() + adjacency.Offsets[fanning];
+        for (UINT t = 0; t < adjacency.Counts[fanning]; ++t)
+        {
+            UINT triangle = triangles[t];
+            if (emitted[triangle])
+                continue;
+            emitted[triangle] = true;
+
+            for (UINT i = 0; i < 3; ++i)
+            {
+                UINT v = indices[triangle * 3 + i];
+                dst[outputCount++] = v;
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                liveTriangles[v]--;
+                if (timestamp - cacheTime[v] > cacheSize)
+                    cacheTime[v] = timestamp++;
+            }
+        }
+
+        // The next fanning vertex is the one that will stay in the cache the longest after its fan is emitted.
+        UINT next = InvalidIndex;
+        INT64 bestPriority = -1;
+        for (UINT v : candidates)
+        {
+            if (liveTriangles[v] == 0)
+                continue;
+            INT64 priority = 0;
+            INT64 age = INT64(timestamp - cacheTime[v]);
+            if (age + 2 * INT64(liveTriangles[v]) <= INT64(cacheSize))
+                priority = age;
+            if (priority > bestPriority)
+            {
+                bestPriority = priority;
+                next = v;
+            }
+        }
+        if (next == InvalidIndex)
+        {
+            next = skipDeadEnd();
+            if (clusters != nullptr && next != InvalidIndex)
+                clusters->push_back(UINT(outputCount / 3));
+        }
+        fanning = next;
+    }
+    assert(outputCount == indexCount);
+}
+
+void OptimizeOverdraw(UINT* dst, const UINT* indices, size_t indexCount, const byte* positions, size_t positionsStride, const std::vector<UINT>& clusters)
+{
+    assert(dst != indices);
+    size_t trianglesCount = indexCount / 3;
+
+    std::vector<UINT> merged;
+    for (UINT start : clusters)
+    {
+        if (start < trianglesCount && (merged.empty() || start - merged.back() >= MinOverdrawClusterSize))
+            merged.push_back(start);
+    }
+    if (merged.empty() || merged[0] != 0)
+        merged.insert(merged.begin(), 0);
+
+    // Area weighted centroid and normal per cluster.
+    std::vector<float> clusterData(merged.size() * 6, 0.0f);
+    float meshCenter[3] = {};
+    float meshArea = 0.0f;
+    for (size_t c = 0; c < merged.size(); ++c)
+    {
+        size_t begin = merged[c];
+        size_t end = c + 1 < merged.size() ? merged[c + 1] : trianglesCount;
+        float* center = &clusterData[c * 6];
+        float* normal = &clusterData[c * 6 + 3];
+        float clusterArea = 0.0f;
+        for (size_t t = begin; t < end; ++t)
+        {
+            float triCenter[3];
+            float triNormal[3];
+            ComputeTriangleCenterAndNormal(positions, positionsStride, indices + t * 3, triCenter, triNormal);
+            float area = std::sqrt(triNormal[0] * triNormal[0] + triNormal[1] * triNormal[1] + triNormal[2] * triNormal[2]);
+            for (UINT i = 0; i < 3; ++i)
+            {
+                center[i] += triCenter[i] * area;
+                normal[i] += triNormal[i];
+            }
+            clusterArea += area;
+        }
+        for (UINT i = 0; i < 3; ++i)
+        {
+            meshCenter[i] += center[i];
+            center[i] = clusterArea > 0.0f ? center[i] / clusterArea : 0.0f;
+        }
+        meshArea += clusterArea;
+
+        float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        for (UINT i = 0; i < 3; ++i)
+            normal[i] = length > 0.0f ? normal[i] / length : 0.0f;
+    }
+    for (UINT i = 0; i < 3; ++i)
+        meshCenter[i] = meshArea > 0.0f ? meshCenter[i] / meshArea : 0.0f;
+
+    std::vector<float> sortKeys(merged.size());
+    for (size_t c = 0; c < merged.size(); ++c)
+    {
+        const float* center = &clusterData[c * 6];
+        const float* normal = &clusterData[c * 6 + 3];
+        sortKeys[c] = (center[0] - meshCenter[0]) * normal[0] + (center[1] - meshCenter[1]) * normal[1] + (center[2] - meshCenter[2]) * normal[2];
+    }
+
+    std::vector<UINT> order(merged.size());
+    for (UINT c = 0; c < order.size(); ++c)
+        order[c] = c;
+    std::stable_sort(order.begin(), order.end(), [&sortKeys](UINT a, UINT b) { return sortKeys[a] > sortKeys[b]; });
+
+    size_t outputCount = 0;
+    for (UINT c : order)
+    {
+        size_t begin = merged[c];
+        size_t end = c + 1 < merged.size() ? merged[c + 1] : trianglesCount;
+        memcpy(dst + outputCount, indices + begin * 3, sizeof(UINT) * (end - begin) * 3);
+        outputCount += (end - begin) * 3;
+    }
+    assert(outputCount == indexCount);
+}
+
+size_t OptimizeVertexFetch(byte* dstVertices, UINT* indices, size_t indexCount, const byte* vertices, size_t vertexCount, size_t vertexSize)
+{
+    assert(dstVertices != vertices);
+
+    std::vector<UINT> remap(vertexCount, InvalidIndex);
+    UINT nextVertex = 0;
+    for (size_t i = 0; i < indexCount; ++i)
+    {
+        UINT& newIndex = remap[indices[i]];
+        if (newIndex == InvalidIndex)
+        {
+            newIndex = nextVertex++;
+            memcpy(dstVertices + vertexSize * newIndex, vertices + vertexSize * indices[i], vertexSize);
+        }
+        indices[i] = newIndex;
+    }
+    return nextVertex;
+}
+}
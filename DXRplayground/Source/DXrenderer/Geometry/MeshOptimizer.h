@@ -0,0 +1,44 @@
+#pragma once
+
+#include <vector>
+#include <windows.h>
+
+namespace DirectxPlayground
+{
+constexpr UINT DefaultVertexCacheSize = 16;
+
+struct VertexCacheStats
+{
+    UINT64 TrianglesCount = 0;
+    UINT64 VerticesCount = 0;
+    UINT64 TransformedCount = 0; // Vertex shader invocations with a FIFO post-transform cache.
+
+    float GetAcmr() const; // Transformed vertices per triangle. 3 is the worst, ~0.5 is the best for a regular grid.
+    float GetAtvr() const; // Transformed vertices per unique vertex. 1 is the best.
+
+    VertexCacheStats& operator+=(const VertexCacheStats& other);
+};
+
+// Triangles using each vertex, CSR layout: Triangles[Offsets[v]] .. Triangles[Offsets[v] + Counts[v] - 1].
+struct TriangleAdjacency
+{
+    std::vector<UINT> Counts;
+    std::vector<UINT> Offsets;
+    std::vector<UINT> Triangles;
+};
+
+void BuildTriangleAdjacency(const UINT* indices, size_t indexCount, size_t vertexCount, TriangleAdjacency& adjacency);
+
+VertexCacheStats AnalyzeVertexCache(const UINT* indices, size_t indexCount, size_t vertexCount, UINT cacheSize = DefaultVertexCacheSize);
+
+// Tipsify (Sander et al. 2007). Reorders the triangles for the post-transform cache. dst must not alias indices.
+// Optionally outputs the starts (in triangles) of the clusters the order breaks into, these can be reordered freely without hurting the cache much.
+void OptimizeVertexCache(UINT* dst, const UINT* indices, size_t indexCount, size_t vertexCount, UINT cacheSize = DefaultVertexCacheSize, std::vector<UINT>* clusters = nullptr);
+
+// Sorts the clusters from OptimizeVertexCache so the ones facing out of the mesh go first, which roughly draws occluders before occludees.
+void OptimizeOverdraw(UINT* dst, const UINT* indices, size_t indexCount, const byte* positions, size_t positionsStride, const std::vector<UINT>& clusters);
+
+// Renumbers the vertices in the order of the first use and drops the unreferenced ones. Indices are remapped in place.
+// Returns the new vertex count. dstVertices must not alias vertices and have room for vertexCount vertices.
+size_t OptimizeVertexFetch(byte* dstVertices, UINT* indices, size_t indexCount, const byte* vertices, size_t vertexCount, size_t vertexSize);
+}
@@ -0,0 +1,526 @@
+#include "DXrenderer/Geometry/MeshSimplifier.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+#include "DXrenderer/Geometry/MeshOptimizer.h"
+
+namespace DirectxPlayground
+{
+namespace
+{
+constexpr UINT InvalidIndex = ~0U;
+constexpr UINT MultipleIndex = ~0U - 1;
+constexpr float BorderWeight = 10.0f; // Open edges are kept in place by a perpendicular plane with this weight.
+
+enum class VertexKind : byte
+{
+    Manifold,
+    Border, // Single wedge on an open edge loop.
+    Seam, // Two wedges that share a position, the attribute seam runs through it.
+    Locked,
+};
+
+struct Quadric
+{
+    float A00 = 0.0f;
+    float A11 = 0.0f;
+    float A22 = 0.0f;
+    float A10 = 0.0f;
+    float A20 = 0.0f;
+    float A21 = 0.0f;
+    float B0 = 0.0f;
+    float B1 = 0.0f;
+    float B2 = 0.0f;
+    float C = 0.0f;
+    float W = 0.0f;
+
+    Quadric& operator+=(const Quadric& q)
+    {
+        A00 += q.A00;
+        A11 += q.A11;
+        A22 += q.A22;
+        A10 += q.A10;
+        A20 += q.A20;
+        A21 += q.A21;
+        B0 += q.B0;
+        B1 += q.B1;
+        B2 += q.B2;
+        C += q.C;
+        W += q.W;
+        return *this;
+    }
+};
+
+struct Collapse
+{
+    UINT From = 0;
+    UINT To = 0;
+    float Error = 0.0f;
+};
+
+const float* GetPosition(const std::vector<float>& positions, UINT v)
+{
+    return &positions[size_t(v) * 3];
+}
+
+void Cross(const float a[3], const float b[3], float res[3])
+{
+    res[0] = a[1] * b[2] - a[2] * b[1];
+    res[1] = a[2] * b[0] - a[0] * b[2];
+    res[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+float Dot(const float a[3], const float b[3])
+{
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+// Plane n.x + d = 0 with unit n.
+Quadric QuadricFromPlane(float a, float b, float c, float d, float weight)
+{
+    Quadric q;
+    q.A00 = a * a * weight;
+    q.A11 = b * b * weight;
+    q.A22 = c * c * weight;
+    q.A10 = a * b * weight;
+    q.A20 = a * c * weight;
+    q.A21 = b * c * weight;
+    q.B0 = a * d * weight;
+    q.B1 = b * d * weight;
+    q.B2 = c * d * weight;
+    q.C = d * d * weight;
+    q.W = weight;
+    return q;
+}
+
+float QuadricError(const Quadric& q, const float v[3])
+{
+    float rx = q.A00 * v[0] + q.A10 * v[1] + q.A20 * v[2];
+    float ry = q.A10 * v[0] + q.A11 * v[1] + q.A21 * v[2];
+    float rz = q.A20 * v[0] + q.A21 * v[1] + q.A22 * v[2];
+    float r = rx * v[0] + ry * v[1] + rz * v[2] + 2.0f * (q.B0 * v[0] + q.B1 * v[1] + q.B2 * v[2]) + q.C;
+    return q.W > 0.0f ? std::fabs(r) / q.W : 0.0f;
+}
+
+bool TriangleNormal(const float* p0, const float* p1, const float* p2, float n[3])
+{
+    float e0[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+    float e1[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+    Cross(e0, e1, n);
+    return Dot(n, n) > 0.0f;
+}
+
+struct PositionKey
+{
+    UINT Bits[3];
+
+    bool operator==(const PositionKey& other) const
+    {
+        return Bits[0] == other.Bits[0] && Bits[1] == other.Bits[1] && Bits[2] == other.Bits[2];
+    }
+};
+
+struct PositionKeyHasher
+{
+    size_t operator()(const PositionKey& key) const
+    {
+        UINT64 h = key.Bits[0] * 0x9E3779B97F4A7C15ULL;
+        h ^= (h >> 29) + key.Bits[1] * 0xC2B2AE3D27D4EB4FULL;
+        h ^= (h >> 32) + key.Bits[2] * 0x165667B19E3779F9ULL;
+        return size_t(h ^ (h >> 31));
+    }
+};
+
+class Simplifier
+{
+public:
+    Simplifier(UINT* indices, size_t indexCount, const byte* positions, size_t positionsStride, size_t vertexCount);
+
+    size_t Run(size_t targetIndexCount, float targetError, float& resultError);
+
+private:
+    void BuildPositionRemap();
+    void ClassifyVertices();
+    void ComputeQuadrics();
+    bool HasOpposite(UINT from, UINT to) const;
+    bool GetCollapseTarget(UINT from, UINT to, UINT& siblingFrom, UINT& siblingTo) const;
+    bool HasTriangleFlips(UINT from, UINT to) const;
+    void Lock(UINT v);
+
+    UINT* m_indices = nullptr;
+    size_t m_indexCount = 0;
+    size_t m_vertexCount = 0;
+    std::vector<float> m_positions; // Normalized to the unit cube, so the errors are relative.
+
+    std::vector<UINT> m_remap; // Vertex -> first vertex with the same position.
+    std::vector<UINT> m_wedge; // Cyclic list of vertices with the same position.
+    std::vector<UINT> m_openIn;
+    std::vector<UINT> m_openOut;
+    std::vector<VertexKind> m_kinds;
+    std::vector<Quadric> m_quadrics; // Per position, i.e. indexed by m_remap.
+
+    TriangleAdjacency m_adjacency;
+    std::vector<UINT> m_collapseRemap;
+    std::vector<bool> m_locked;
+};
+
+Simplifier::Simplifier(UINT* indices, size_t indexCount, const byte* positions, size_t positionsStride, size_t vertexCount)
+    : m_indices(indices)
+    , m_indexCount(indexCount)
+    , m_vertexCount(vertexCount)
+{
+    float minP[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+    m_positions.resize(vertexCount * 3);
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+        memcpy(&m_positions[v * 3], positions + positionsStride * v, sizeof(float) * 3);
+        for (UINT c = 0; c < 3; ++c)
+            minP[c] = std::min(minP[c], m_positions[v * 3 + c]);
+    }
+    float scale = GetSimplificationScale(positions, positionsStride, vertexCount);
+    float invScale = scale > 0.0f ? 1.0f / scale : 0.0f;
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+        for (UINT c = 0; c < 3; ++c)
+            m_positions[v * 3 + c] = (m_positions[v * 3 + c] - minP[c]) * invScale;
+    }
+}
+
+void Simplifier::BuildPositionRemap()
+{
+    m_remap.resize(m_vertexCount);
+    m_wedge.resize(m_vertexCount);
+
+    // Exact equality only, welding nearly equal positions is a job for a separate pass.
+    std::unordered_map<PositionKey, UINT, PositionKeyHasher> firstVertex;
+    firstVertex.reserve(m_vertexCount);
+    for (UINT v = 0; v < m_vertexCount; ++v)
+    {
+        PositionKey key;
+        memcpy(key.Bits, GetPosition(m_positions, v), sizeof(key.Bits));
+        auto it = firstVertex.emplace(key, v).first;
+        UINT first = it->second;
+        m_remap[v] = first;
+        if (first == v)
+        {
+            m_wedge[v] = v;
+        }
+        else
+        {
+            m_wedge[v] = m_wedge[first];
+            m_wedge[first] = v;
+        }
+    }
+}
+
+bool Simplifier::HasOpposite(UINT from, UINT to) const
+{
+    const UINT* triangles = m_adjacency.Triangles.data() + m_adjacency.Offsets[to];
+    for (UINT i = 0; i < m_adjacency.Counts[to]; ++i)
+    {
+        const UINT* tri = m_indices + size_t(triangles[i]) * 3;
+        for (UINT c = 0; c < 3; ++c)
+        {
+            if (tri[c] == to && tri[(c + 1) % 3] == from)
+                return true;
+        }
+    }
+    return false;
+}
+
+void Simplifier::ClassifyVertices()
+{
+    m_openIn.assign(m_vertexCount, InvalidIndex);
+    m_openOut.assign(m_vertexCount, InvalidIndex);
+    auto setOpen = [](UINT& slot, UINT v) { slot = (slot == InvalidIndex || slot == v) ? v : MultipleIndex; };
+
+    for (size_t i = 0; i < m_indexCount; i += 3)
+    {
+        for (UINT c = 0; c < 3; ++c)
+        {
+            UINT from = m_indices[i + c];
+            UINT to = m_indices[i + (c + 1) % 3];
+            if (!HasOpposite(from, to))
+            {
+                setOpen(m_openOut[from], to);
+                setOpen(m_openIn[to], from);
+            }
+        }
+    }
+
+    auto isSingle = [](UINT v) { return v != InvalidIndex && v != MultipleIndex; };
+    m_kinds.assign(m_vertexCount, VertexKind::Locked);
+    for (UINT v = 0; v < m_vertexCount; ++v)
+    {
+        UINT sibling = m_wedge[v];
+        if (sibling == v)
+        {
+            if (m_openIn[v] == InvalidIndex && m_openOut[v] == InvalidIndex)
+                m_kinds[v] = VertexKind::Manifold;
+            else if (isSingle(m_openIn[v]) && isSingle(m_openOut[v]))
+                m_kinds[v] = VertexKind::Border;
+        }
+        else if (m_wedge[sibling] == v && isSingle(m_openIn[v]) && isSingle(m_openOut[v]) && isSingle(m_openIn[sibling]) && isSingle(m_openOut[sibling]))
+        {
+            // The two sides of the seam must run along the same positions in the opposite directions.
+            if (m_remap[m_openOut[v]] == m_remap[m_openIn[sibling]] && m_remap[m_openIn[v]] == m_remap[m_openOut[sibling]])
+                m_kinds[v] = VertexKind::Seam;
+        }
+    }
+}
+
+void Simplifier::ComputeQuadrics()
+{
+    m_quadrics.assign(m_vertexCount, Quadric{});
+    for (size_t i = 0; i < m_indexCount; i += 3)
+    {
+        const float* p[3] = { GetPosition(m_positions, m_indices[i]), GetPosition(m_positions, m_indices[i + 1]), GetPosition(m_positions, m_indices[i + 2]) };
+        float n[3];
+        if (!TriangleNormal(p[0], p[1], p[2], n))
+            continue;
+        float length = std::sqrt(Dot(n, n));
+        for (UINT c = 0; c < 3; ++c)
+            n[c] /= length;
+        Quadric q = QuadricFromPlane(n[0], n[1], n[2], -Dot(n, p[0]), length * 0.5f);
+        for (UINT c = 0; c < 3; ++c)
+            m_quadrics[m_remap[m_indices[i + c]]] += q;
+
+        for (UINT c = 0; c < 3; ++c)
+        {
+            UINT from = m_indices[i + c];
+            UINT to = m_indices[i + (c + 1) % 3];
+            if (m_openOut[from] == InvalidIndex || m_remap[from] == m_remap[to])
+                continue;
+            // Seams are open in the index topology but closed geometrically, they need the plane as much as borders do.
+            const float* p0 = GetPosition(m_positions, from);
+            const float* p1 = GetPosition(m_positions, to);
+            float edge[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+            float edgeLength = std::sqrt(Dot(edge, edge));
+            float plane[3];
+            Cross(edge, n, plane);
+            float planeLength = std::sqrt(Dot(plane, plane));
+            if (planeLength == 0.0f || HasOpposite(from, to))
+                continue;
+            for (UINT k = 0; k < 3; ++k)
+                plane[k] /= planeLength;
+            Quadric edgeQuadric = QuadricFromPlane(plane[0], plane[1], plane[2], -Dot(plane, p0), edgeLength * BorderWeight);
+            m_quadrics[m_remap[from]] += edgeQuadric;
+            m_quadrics[m_remap[to]] += edgeQuadric;
+        }
+    }
+}
+
+bool Simplifier::GetCollapseTarget(UINT from, UINT to, UINT& siblingFrom, UINT& siblingTo) const
+{
+    siblingFrom = InvalidIndex;
+    siblingTo = InvalidIndex;
+    if (m_remap[from] == m_remap[to])
+        return false;
+
+    switch (m_kinds[from])
+    {
+    case VertexKind::Manifold:
+        return true;
+    case VertexKind::Border:
+        return m_kinds[to] == VertexKind::Border && (m_openOut[from] == to || m_openIn[from] == to);
+    case VertexKind::Seam:
+    {
+        if (m_kinds[to] != VertexKind::Seam)
+            return false;
+        siblingFrom = m_wedge[from];
+        if (m_openOut[from] == to)
+            siblingTo = m_openIn[siblingFrom];
+        else if (m_openIn[from] == to)
+            siblingTo = m_openOut[siblingFrom];
+        else
+            return false;
+        return siblingTo != to && m_remap[siblingTo] == m_remap[to];
+    }
+    default:
+        return false;
+    }
+}
+
+bool Simplifier::HasTriangleFlips(UINT from, UINT to) const
+{
+    const float* target = GetPosition(m_positions, to);
+    const UINT* triangles = m_adjacency.Triangles.data() + m_adjacency.Offsets[from];
+    for (UINT i = 0; i < m_adjacency.Counts[from]; ++i)
+    {
+        const UINT* tri = m_indices + size_t(triangles[i]) * 3;
+        UINT corners[3] = { m_collapseRemap[tri[0]], m_collapseRemap[tri[1]], m_collapseRemap[tri[2]] };
+        if (m_remap[corners[0]] == m_remap[to] || m_remap[corners[1]] == m_remap[to] || m_remap[corners[2]] == m_remap[to])
+            continue; // The triangle collapses away.
+
+        const float* p[3];
+        const float* moved[3];
+        for (UINT c = 0; c < 3; ++c)
+        {
+            p[c] = GetPosition(m_positions, corners[c]);
+            moved[c] = corners[c] == from ? target : p[c];
+        }
+        float n0[3];
+        float n1[3];
+        TriangleNormal(p[0], p[1], p[2], n0);
+        if (!TriangleNormal(moved[0], moved[1], moved[2], n1) || Dot(n0, n1) <= 0.0f)
+            return true;
+    }
+    return false;
+}
+
+void Simplifier::Lock(UINT v)
+{
+    UINT w = v;
+    do
+    {
+        m_locked[w] = true;
+        w = m_wedge[w];
+    } while (w != v);
+}
+
+size_t Simplifier::Run(size_t targetIndexCount, float targetError, float& resultError)
+{
+    BuildPositionRemap();
+    BuildTriangleAdjacency(m_indices, m_indexCount, m_vertexCount, m_adjacency);
+    ClassifyVertices();
+    ComputeQuadrics();
+
+    float errorLimit = targetError * targetError;
+    float maxError = 0.0f;
+    std::vector<Collapse> collapses;
+    for (bool firstPass = true; m_indexCount > targetIndexCount; firstPass = false)
+    {
+        // Collapses move the borders and seams, so the topology is rebuilt every pass. The quadrics just accumulate.
+        if (!firstPass)
+        {
+            BuildTriangleAdjacency(m_indices, m_indexCount, m_vertexCount, m_adjacency);
+            ClassifyVertices();
+        }
+
+        collapses.clear();
+        for (size_t i = 0; i < m_indexCount; i += 3)
+        {
+            for (UINT c = 0; c < 3; ++c)
+            {
+                UINT a = m_indices[i + c];
+                UINT b = m_indices[i + (c + 1) % 3];
+                UINT sf;
+                UINT st;
+                // Either direction is fine, pick the cheaper one.
+                float errorAB = GetCollapseTarget(a, b, sf, st) ? QuadricError(m_quadrics[m_remap[a]], GetPosition(m_positions, b)) : FLT_MAX;
+                float errorBA = GetCollapseTarget(b, a, sf, st) ? QuadricError(m_quadrics[m_remap[b]], GetPosition(m_positions, a)) : FLT_MAX;
+                if (errorAB == FLT_MAX && errorBA == FLT_MAX)
+                    continue;
+                if (errorAB <= errorBA)
+                    collapses.push_back({ a, b, errorAB });
+                else
+                    collapses.push_back({ b, a, errorBA });
+            }
+        }
+        if (collapses.empty())
+            break;
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b)
+        {
+            if (a.Error != b.Error)
+                return a.Error < b.Error;
+            return a.From != b.From ? a.From < b.From : a.To < b.To;
+        });
+
+        m_collapseRemap.resize(m_vertexCount);
+        for (UINT v = 0; v < m_vertexCount; ++v)
+            m_collapseRemap[v] = v;
+        m_locked.assign(m_vertexCount, false);
+
+        // Every collapse removes up to two triangles. Don't overshoot the target too much in one pass.
+        size_t trianglesToRemove = (m_indexCount - targetIndexCount) / 3;
+        size_t removed = 0;
+        size_t performed = 0;
+        for (const Collapse& collapse : collapses)
+        {
+            if (collapse.Error > errorLimit || removed >= trianglesToRemove)
+                break;
+
+            UINT siblingFrom;
+            UINT siblingTo;
+            GetCollapseTarget(collapse.From, collapse.To, siblingFrom, siblingTo);
+            if (m_locked[collapse.From] || m_locked[collapse.To])
+                continue;
+            if (HasTriangleFlips(collapse.From, collapse.To) || (siblingFrom != InvalidIndex && HasTriangleFlips(siblingFrom, siblingTo)))
+                continue;
+
+            m_collapseRemap[collapse.From] = collapse.To;
+            if (siblingFrom != InvalidIndex)
+                m_collapseRemap[siblingFrom] = siblingTo;
+            m_quadrics[m_remap[collapse.To]] += m_quadrics[m_remap[collapse.From]];
+            Lock(collapse.From);
+            Lock(collapse.To);
+
+            maxError = std::max(maxError, collapse.Error);
+            removed += m_kinds[collapse.From] == VertexKind::Border ? 1 : 2;
+            ++performed;
+        }
+        if (performed == 0)
+            break;
+
+        size_t write = 0;
+        for (size_t i = 0; i < m_indexCount; i += 3)
+        {
+            UINT a = m_collapseRemap[m_indices[i]];
+            UINT b = m_collapseRemap[m_indices[i + 1]];
+            UINT c = m_collapseRemap[m_indices[i + 2]];
+            if (m_remap[a] == m_remap[b] || m_remap[b] == m_remap[c] || m_remap[a] == m_remap[c])
+                continue;
+            m_indices[write++] = a;
+            m_indices[write++] = b;
+            m_indices[write++] = c;
+        }
+        m_indexCount = write;
+    }
+
+    resultError = std::sqrt(maxError);
+    return m_indexCount;
+}
+}
+
+float GetSimplificationScale(const byte* positions, size_t positionsStride, size_t vertexCount)
+{
+    float minP[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+    float maxP[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+        float p[3];
+        memcpy(p, positions + positionsStride * v, sizeof(p));
+        for (UINT c = 0; c < 3; ++c)
+        {
+            minP[c] = std::min(minP[c], p[c]);
+            maxP[c] = std::max(maxP[c], p[c]);
+        }
+    }
+    return vertexCount > 0 ? std::max(maxP[0] - minP[0], std::max(maxP[1] - minP[1], maxP[2] - minP[2])) : 0.0f;
+}
+
+size_t SimplifyMesh(UINT* dst, const UINT* indices, size_t indexCount, const byte* positions, size_t positionsStride, size_t vertexCount,
+    size_t targetIndexCount, float targetError, float* resultError /*= nullptr*/)
+{
+    assert(indexCount % 3 == 0);
+    if (dst != indices)
+        memcpy(dst, indices, sizeof(UINT) * indexCount);
+
+    float error = 0.0f;
+    size_t res = indexCount;
+    if (targetIndexCount < indexCount)
+    {
+        Simplifier simplifier(dst, indexCount, positions, positionsStride, vertexCount);
+        res = simplifier.Run(targetIndexCount, targetError, error);
+    }
+    if (resultError != nullptr)
+        *resultError = error;
+    return res;
+}
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <windows.h>
+
+namespace DirectxPlayground
+{
+// Size the simplification errors are relative to: the largest extent of the positions bounding box.
+float GetSimplificationScale(const byte* positions, size_t positionsStride, size_t vertexCount);
+
+// Quadric error edge collapse simplification. Collapses vertices onto each other and never creates new ones,
+// so every level of detail can share the original vertex buffer and just get its own indices.
+// Vertices with the same position but different attributes (UV and normal seams) are only collapsed along the seam and both sides together,
+// open borders only along the border, everything more complex is locked.
+// Stops at targetIndexCount or when the next collapse would exceed targetError (relative to GetSimplificationScale).
+// dst has room for indexCount indices and may alias indices. Returns the new index count, the reached relative error goes to resultError.
+size_t SimplifyMesh(UINT* dst, const UINT* indices, size_t indexCount, const byte* positions, size_t positionsStride, size_t vertexCount,
+    size_t targetIndexCount, float targetError, float* resultError = nullptr);
+}
@@ -0,0 +1,458 @@
+#include "DXrenderer/Geometry/MeshletBuilder.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+#include "DXrenderer/Geometry/MeshOptimizer.h"
+
+namespace DirectxPlayground
+{
+namespace
+{
+constexpr UINT InvalidIndex = ~0U;
+constexpr float MinConeSpread = 0.1f; // Cones wider than ~84 degrees from the axis don't cull anything useful.
+
+float Dot(const float a[3], const float b[3])
+{
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+float DistanceSq(const float a[3], const float b[3])
+{
+    float d[3] = { a[0] - b[0], a[1] - b[1], a[2] - b[2] };
+    return Dot(d, d);
+}
+
+void LoadPosition(const byte* positions, size_t positionsStride, UINT index, float p[3])
+{
+    memcpy(p, positions + positionsStride * index, sizeof(float) * 3);
+}
+
+float TriangleDistanceSq(const UINT* triangle, const byte* positions, size_t positionsStride, const float point[3])
+{
+    float center[3] = {};
+    for (UINT i = 0; i < 3; ++i)
+    {
+        float p[3];
+        LoadPosition(positions, positionsStride, triangle[i], p);
+        for (UINT c = 0; c < 3; ++c)
+            center[c] += p[c] * (1.0f / 3.0f);
+    }
+    return DistanceSq(center, point);
+}
+
+// Triangle centroids in a k-d tree, for the nearest triangle not emitted yet when the meshlet still has room but nothing adjacent fits.
+// Emitted triangles stay in the leaves, the per node counts of the remaining ones let the search skip the emptied subtrees.
+class TriangleKdTree
+{
+public:
+    static constexpr UINT LeafSize = 8;
+
+    void Build(const UINT* indices, size_t trianglesCount, const byte* positions, size_t positionsStride, const std::vector<bool>& emitted)
+    {
+        m_centroids.resize(trianglesCount * 3);
+        for (size_t t = 0; t < trianglesCount; ++t)
+        {
+            for (UINT c = 0; c < 3; ++c)
+                m_centroids[t * 3 + c] = 0.0f;
+            for (UINT i = 0; i < 3; ++i)
+            {
+                float p[3];
+                LoadPosition(positions, positionsStride, indices[t * 3 + i], p);
+                for (UINT c = 0; c < 3; ++c)
+                    m_centroids[t * 3 + c] += p[c] * (1.0f / 3.0f);
+            }
+        }
+        m_items.resize(trianglesCount);
+        for (UINT t = 0; t < trianglesCount; ++t)
+            m_items[t] = t;
+        m_leafOf.resize(trianglesCount);
+        m_removed = emitted;
+        m_nodes.clear();
+        BuildNode(0, UINT(trianglesCount), InvalidIndex);
+    }
+
+    void Remove(UINT triangle)
+    {
+        m_removed[triangle] = true;
+        for (UINT node = m_leafOf[triangle]; node != InvalidIndex; node = m_nodes[node].Parent)
+            --m_nodes[node].Remaining;
+    }
+
+    // Ties go to the lowest triangle index, so the result doesn't depend on the tree layout.
+    UINT FindNearest(const float point[3]) const
+    {
+        UINT best = InvalidIndex;
+        float bestDistance = FLT_MAX;
+        FindNearest(0, point, best, bestDistance);
+        return best;
+    }
+
+private:
+    struct Node
+    {
+        UINT Begin = 0; // Items of the subtree.
+        UINT End = 0;
+        UINT Parent = InvalidIndex;
+        UINT Left = InvalidIndex; // InvalidIndex for leaves. The right child follows the whole left subtree.
+        UINT Right = InvalidIndex;
+        UINT Axis = 0;
+        float Split = 0.0f;
+        UINT Remaining = 0;
+    };
+
+    UINT BuildNode(UINT begin, UINT end, UINT parent)
+    {
+        UINT index = UINT(m_nodes.size());
+        m_nodes.emplace_back();
+        m_nodes[index].Begin = begin;
+        m_nodes[index].End = end;
+        m_nodes[index].Parent = parent;
+        for (UINT i = begin; i < end; ++i)
+            m_nodes[index].Remaining += m_removed[m_items[i]] ? 0 : 1;
+
+        float minP[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+        float maxP[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+        for (UINT i = begin; i < end; ++i)
+        {
+            for (UINT c = 0; c < 3; ++c)
+            {
+                minP[c] = std::min(minP[c], m_centroids[m_items[i] * 3 + c]);
+                maxP[c] = std::max(maxP[c], m_centroids[m_items[i] * 3 + c]);
+            }
+        }
+        UINT axis = 0;
+        for (UINT c = 1; c < 3; ++c)
+            axis = maxP[c] - minP[c] > maxP[axis] - minP[axis] ? c : axis;
+
+        if (end - begin <= LeafSize || maxP[axis] <= minP[axis])
+        {
+            for (UINT i = begin; i < end; ++i)
+                m_leafOf[m_items[i]] = index;
+            return index;
+        }
+
+        // A strict order with the index as the tie break, so the halves are the same whatever nth_element does with equal keys.
+        UINT middle = begin + (end - begin) / 2;
+        auto less = [this, axis](UINT a, UINT b)
+        {
+            float ka = m_centroids[a * 3 + axis];
+            float kb = m_centroids[b * 3 + axis];
+            return ka < kb || (ka == kb && a < b);
+        };
+        std::nth_element(m_items.begin() + begin, m_items.begin() + middle, m_items.begin() + end, less);
+        m_nodes[index].Axis = axis;
+        m_nodes[index].Split = m_centroids[m_items[middle] * 3 + axis];
+        UINT left = BuildNode(begin, middle, index);
+        UINT right = BuildNode(middle, end, index);
+        m_nodes[index].Left = left;
+        m_nodes[index].Right = right;
+        return index;
+    }
+
+    void FindNearest(UINT nodeIndex, const float point[3], UINT& best, float& bestDistance) const
+    {
+        const Node& node = m_nodes[nodeIndex];
+        if (node.Remaining == 0)
+            return;
+        if (node.Left == InvalidIndex)
+        {
+            for (UINT i = node.Begin; i < node.End; ++i)
+            {
+                UINT triangle = m_items[i];
+                if (m_removed[triangle])
+                    continue;
+                float distance = DistanceSq(&m_centroids[triangle * 3], point);
+                if (distance < bestDistance || (distance == bestDistance && triangle < best))
+                {
+                    best = triangle;
+                    bestDistance = distance;
+                }
+            }
+            return;
+        }
+
+        // The left items are at most Split along the axis and the right ones at least Split.
+        float delta = point[node.Axis] - node.Split;
+        FindNearest(delta < 0.0f ? node.Left : node.Right, point, best, bestDistance);
+        if (delta * delta <= bestDistance)
+            FindNearest(delta < 0.0f ? node.Right : node.Left, point, best, bestDistance);
+    }
+
+    std::vector<float> m_centroids;
+    std::vector<UINT> m_items;
+    std::vector<UINT> m_leafOf;
+    std::vector<bool> m_removed;
+    std::vector<Node> m_nodes;
+};
+
+// Ritter's sphere: start from the most distant pair of axis extremes and grow to include every point.
+void ComputeBoundingSphere(const std::vector<float>& points, MeshletBounds& bounds)
+{
+    size_t count = points.size() / 3;
+    size_t minIndex[3] = {};
+    size_t maxIndex[3] = {};
+    for (size_t i = 1; i < count; ++i)
+    {
+        for (UINT axis = 0; axis < 3; ++axis)
+        {
+            if (points[i * 3 + axis] < points[minIndex[axis] * 3 + axis])
+                minIndex[axis] = i;
+            if (points[i * 3 + axis] > points[maxIndex[axis] * 3 + axis])
+                maxIndex[axis] = i;
+        }
+    }
+
+    UINT bestAxis = 0;
+    float bestDistance = -1.0f;
+    for (UINT axis = 0; axis < 3; ++axis)
+    {
+        float distance = DistanceSq(&points[minIndex[axis] * 3], &points[maxIndex[axis] * 3]);
+        if (distance > bestDistance)
+        {
+            bestDistance = distance;
+            bestAxis = axis;
+        }
+    }
+
+    const float* p0 = &points[minIndex[bestAxis] * 3];
+    const float* p1 = &points[maxIndex[bestAxis] * 3];
+    float center[3] = { (p0[0] + p1[0]) * 0.5f, (p0[1] + p1[1]) * 0.5f, (p0[2] + p1[2]) * 0.5f };
+    float radius = std::sqrt(bestDistance) * 0.5f;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        const float* p = &points[i * 3];
+        float distanceSq = DistanceSq(p, center);
+        if (distanceSq > radius * radius)
+        {
+            float distance = std::sqrt(distanceSq);
+            float newRadius = (radius + distance) * 0.5f;
+            float k = (newRadius - radius) / distance;
+            for (UINT c = 0; c < 3; ++c)
+                center[c] += (p[c] - center[c]) * k;
+            radius = newRadius;
+        }
+    }
+
+    memcpy(bounds.Center, center, sizeof(center));
+    bounds.Radius = radius;
+}
+
+void ComputeNormalCone(const std::vector<float>& normals, const std::vector<float>& corners, MeshletBounds& bounds)
+{
+    size_t count = normals.size() / 3;
+    float axis[3] = {};
+    for (size_t i = 0; i < count; ++i)
+    {
+        for (UINT c = 0; c < 3; ++c)
+            axis[c] += normals[i * 3 + c];
+    }
+    float length = std::sqrt(Dot(axis, axis));
+    if (length < 1e-6f)
+        return;
+    for (UINT c = 0; c < 3; ++c)
+        axis[c] /= length;
+
+    float minDot = 1.0f;
+    for (size_t i = 0; i < count; ++i)
+        minDot = std::min(minDot, Dot(&normals[i * 3], axis));
+    if (minDot <= MinConeSpread)
+        return;
+
+    // Move the apex back along the axis until every triangle plane is in front of it.
+    float maxT = 0.0f;
+    for (size_t i = 0; i < count; ++i)
+    {
+        float toCenter[3] = { bounds.Center[0] - corners[i * 3 + 0], bounds.Center[1] - corners[i * 3 + 1], bounds.Center[2] - corners[i * 3 + 2] };
+        float dc = Dot(toCenter, &normals[i * 3]);
+        float dn = Dot(axis, &normals[i * 3]);
+        maxT = std::max(maxT, dc / dn); // dn >= minDot > 0
+    }
+
+    for (UINT c = 0; c < 3; ++c)
+    {
+        bounds.ConeApex[c] = bounds.Center[c] - axis[c] * maxT;
+        bounds.ConeAxis[c] = axis[c];
+    }
+    bounds.ConeCutoff = std::sqrt(1.0f - minDot * minDot);
+}
+
+MeshletBounds ComputeMeshletBounds(const MeshletData& data, const Meshlet& meshlet, const byte* positions, size_t positionsStride)
+{
+    MeshletBounds bounds;
+
+    std::vector<float> points(meshlet.VertexCount * 3);
+    for (UINT i = 0; i < meshlet.VertexCount; ++i)
+        LoadPosition(positions, positionsStride, data.VertexIndices[meshlet.VertexOffset + i], &points[i * 3]);
+    ComputeBoundingSphere(points, bounds);
+
+    std::vector<float> normals;
+    std::vector<float> corners;
+    normals.reserve(meshlet.TriangleCount * 3);
+    corners.reserve(meshlet.TriangleCount * 3);
+    for (UINT t = 0; t < meshlet.TriangleCount; ++t)
+    {
+        const byte* local = &data.Triangles[meshlet.TriangleOffset + t * 3];
+        const float* p0 = &points[local[0] * 3];
+        const float* p1 = &points[local[1] * 3];
+        const float* p2 = &points[local[2] * 3];
+        float e0[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+        float e1[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+        float n[3] = { e0[1] * e1[2] - e0[2] * e1[1], e0[2] * e1[0] - e0[0] * e1[2], e0[0] * e1[1] - e0[1] * e1[0] };
+        float length = std::sqrt(Dot(n, n));
+        if (length < 1e-12f)
+            continue; // Degenerate triangles don't constrain the cone.
+        for (UINT c = 0; c < 3; ++c)
+        {
+            normals.push_back(n[c] / length);
+            corners.push_back(p0[c]);
+        }
+    }
+    ComputeNormalCone(normals, corners, bounds);
+    return bounds;
+}
+}
+
+void BuildMeshlets(MeshletData& meshlets, const UINT* indices, size_t indexCount, const byte* positions, size_t positionsStride, size_t vertexCount)
+{
+    assert(indexCount % 3 == 0);
+    meshlets = {};
+    size_t trianglesCount = indexCount / 3;
+    if (trianglesCount == 0)
+        return;
+
+    TriangleAdjacency adjacency;
+    BuildTriangleAdjacency(indices, indexCount, vertexCount, adjacency);
+
+    std::vector<bool> emitted(trianglesCount, false);
+    std::vector<UINT> localIndex(vertexCount, InvalidIndex);
+    std::vector<UINT> candidates;
+    std::vector<UINT> candidateOf(trianglesCount, InvalidIndex); // Meshlet the triangle is already a candidate of, avoids duplicates.
+    size_t seedCursor = 0;
+    TriangleKdTree nearestTriangles; // Built on the first use, meshes without disconnected pieces never need it.
+    bool nearestTrianglesBuilt = false;
+
+    Meshlet current;
+    float centerSum[3] = {};
+    auto closeMeshlet = [&]()
+    {
+        memset(centerSum, 0, sizeof(centerSum));
+        for (UINT i = 0; i < current.VertexCount; ++i)
+            localIndex[meshlets.VertexIndices[current.VertexOffset + i]] = InvalidIndex;
+        meshlets.Meshlets.push_back(current);
+
+        current = {};
+        current.VertexOffset = UINT(meshlets.VertexIndices.size());
+        current.TriangleOffset = UINT(meshlets.Triangles.size());
+        candidates.clear();
+    };
+    auto newVerticesCount = [&](UINT triangle)
+    {
+        UINT res = 0;
+        for (UINT i = 0; i < 3; ++i)
+            res += localIndex[indices[triangle * 3 + i]] == InvalidIndex ? 1 : 0;
+        return res;
+    };
+
+    size_t emittedCount = 0;
+    while (emittedCount < trianglesCount)
+    {
+        UINT triangle = InvalidIndex;
+        if (current.TriangleCount == 0)
+        {
+            while (emitted[seedCursor])
+                ++seedCursor;
+            triangle = UINT(seedCursor);
+        }
+        else
+        {
+            // Fewest new vertices first, then the closest to the meshlet center to keep it round rather than a long strip,
+            // then the lowest triangle index, so the result doesn't depend on the candidate order.
+            float center[3];
+            for (UINT c = 0; c < 3; ++c)
+                center[c] = centerSum[c] / float(current.VertexCount);
+            UINT bestNew = 4;
+            float bestDistance = 0.0f;
+            size_t write = 0;
+            for (size_t i = 0; i < candidates.size(); ++i)
+            {
+                UINT candidate = candidates[i];
+                if (emitted[candidate])
+                    continue;
+                candidates[write++] = candidate;
+                UINT newCount = newVerticesCount(candidate);
+                if (current.VertexCount + newCount > MaxMeshletVertices)
+                    continue;
+                float distance = TriangleDistanceSq(indices + candidate * 3, positions, positionsStride, center);
+                if (newCount < bestNew || (newCount == bestNew && (distance < bestDistance || (distance == bestDistance && candidate < triangle))))
+                {
+                    bestNew = newCount;
+                    bestDistance = distance;
+                    triangle = candidate;
+                }
+            }
+            candidates.resize(write);
+
+            // Nothing adjacent fits. A triangle that shares no vertex with the meshlet adds 3, if there is room for them
+            // the meshlet takes the nearest one instead of closing half empty, i.e. on meshes of many small disconnected pieces.
+            if (triangle == InvalidIndex && current.VertexCount + 3 <= MaxMeshletVertices)
+            {
+                if (!nearestTrianglesBuilt)
+                {
+                    nearestTriangles.Build(indices, trianglesCount, positions, positionsStride, emitted);
+                    nearestTrianglesBuilt = true;
+                }
+                triangle = nearestTriangles.FindNearest(center);
+            }
+            if (triangle == InvalidIndex)
+            {
+                closeMeshlet();
+                continue;
+            }
+        }
+
+        emitted[triangle] = true;
+        ++emittedCount;
+        if (nearestTrianglesBuilt)
+            nearestTriangles.Remove(triangle);
+        for (UINT i = 0; i < 3; ++i)
+        {
+            UINT v = indices[triangle * 3 + i];
+            if (localIndex[v] == InvalidIndex)
+            {
+                localIndex[v] = current.VertexCount++;
+                meshlets.VertexIndices.push_back(v);
+                float p[3];
+                LoadPosition(positions, positionsStride, v, p);
+                for (UINT c = 0; c < 3; ++c)
+                    centerSum[c] += p[c];
+                const UINT* adjacent = adjacency.Triangles.data() + adjacency.Offsets[v];
+                for (UINT t = 0; t < adjacency.Counts[v]; ++t)
+                {
+                    UINT candidate = adjacent[t];
+                    if (!emitted[candidate] && candidateOf[candidate] != meshlets.Meshlets.size())
+                    {
+                        candidateOf[candidate] = UINT(meshlets.Meshlets.size());
+                        candidates.push_back(candidate);
+                    }
+                }
+            }
+            meshlets.Triangles.push_back(byte(localIndex[v]));
+        }
+        current.TriangleCount++;
+
+        if (current.TriangleCount == MaxMeshletTriangles)
+            closeMeshlet();
+    }
+    if (current.TriangleCount > 0)
+        closeMeshlet();
+
+    meshlets.Bounds.reserve(meshlets.Meshlets.size());
+    for (const auto& meshlet : meshlets.Meshlets)
+        meshlets.Bounds.push_back(ComputeMeshletBounds(meshlets, meshlet, positions, positionsStride));
+}
+}
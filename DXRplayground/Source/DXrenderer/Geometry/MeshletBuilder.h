@@ -0,0 +1,43 @@
+#pragma once
+
+#include <vector>
+#include <windows.h>
+
+namespace DirectxPlayground
+{
+// Limits recommended for D3D12 mesh shaders: 64 vertices and up to 126 primitives, 124 keeps the triangle data 4 bytes aligned.
+constexpr UINT MaxMeshletVertices = 64;
+constexpr UINT MaxMeshletTriangles = 124;
+
+struct Meshlet
+{
+    UINT VertexOffset = 0; // Into MeshletData::VertexIndices.
+    UINT VertexCount = 0;
+    UINT TriangleOffset = 0; // Into MeshletData::Triangles, in bytes (3 local indices per triangle).
+    UINT TriangleCount = 0;
+};
+
+struct MeshletBounds
+{
+    float Center[3] = {};
+    float Radius = 0.0f;
+    // Backface cone: the whole meshlet is backfacing if dot(normalize(ConeApex - cameraPos), ConeAxis) >= ConeCutoff.
+    // A degenerate cone has ConeCutoff == 1 and is never culled.
+    float ConeApex[3] = {};
+    float ConeAxis[3] = {};
+    float ConeCutoff = 1.0f;
+};
+
+struct MeshletData
+{
+    std::vector<Meshlet> Meshlets;
+    std::vector<MeshletBounds> Bounds;
+    std::vector<UINT> VertexIndices; // Meshlet local vertex -> mesh vertex.
+    std::vector<byte> Triangles; // Meshlet local vertex indices.
+};
+
+// Greedily grows meshlets over the triangle adjacency, preferring triangles that add the fewest new vertices. When no adjacent
+// triangle fits, continues with the nearest triangle left, so a meshlet only closes at the vertex or triangle limit.
+// Deterministic for the same input. Works best on vertex cache optimized indices since the seeds are taken in index order.
+void BuildMeshlets(MeshletData& meshlets, const UINT* indices, size_t indexCount, const byte* positions, size_t positionsStride, size_t vertexCount);
+}
@@ -0,0 +1,318 @@
+#include "DXrenderer/Geometry/TangentGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace DirectxPlayground
+{
+namespace
+{
+constexpr UINT InvalidIndex = ~0U;
+constexpr float TangentEpsilon = 1e-20f; // Squared lengths below it are treated as zero, the inputs are in arbitrary model units.
+constexpr size_t TrianglesPerBlock = 4;
+constexpr size_t CornerBlockSize = TrianglesPerBlock * 3 * 3;
+
+// Weighted corner tangents are kept SoA in blocks of 4 triangles, the layout the SSE path produces directly.
+size_t GetCornerIndex(size_t triangle, UINT corner, UINT component)
+{
+    return (triangle / TrianglesPerBlock) * CornerBlockSize + corner * 12 + component * 4 + triangle % TrianglesPerBlock;
+}
+
+void Load3(const byte* stream, size_t stride, UINT index, float v[3])
+{
+    memcpy(v, stream + stride * index, sizeof(float) * 3);
+}
+
+void Sub3(const float a[3], const float b[3], float res[3])
+{
+    for (UINT c = 0; c < 3; ++c)
+        res[c] = a[c] - b[c];
+}
+
+float Dot3(const float a[3], const float b[3])
+{
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+void ProjectOnPlane(const float v[3], const float n[3], float res[3])
+{
+    float d = Dot3(n, v);
+    for (UINT c = 0; c < 3; ++c)
+        res[c] = v[c] - n[c] * d;
+}
+
+void ProcessTriangleScalar(const TangentInput& input, const UINT* triangle, size_t triangleIndex, float* corners, signed char& orientation)
+{
+    float p[3][3];
+    float n[3][3];
+    float uv[3][2];
+    for (UINT k = 0; k < 3; ++k)
+    {
+        Load3(input.Positions, input.Stride, triangle[k], p[k]);
+        Load3(input.Normals, input.Stride, triangle[k], n[k]);
+        memcpy(uv[k], input.Uvs + input.Stride * triangle[k], sizeof(float) * 2);
+    }
+
+    float d1[3];
+    float d2[3];
+    Sub3(p[1], p[0], d1);
+    Sub3(p[2], p[0], d2);
+    float s1 = uv[1][0] - uv[0][0];
+    float t1 = uv[1][1] - uv[0][1];
+    float s2 = uv[2][0] - uv[0][0];
+    float t2 = uv[2][1] - uv[0][1];
+    float signedArea = s1 * t2 - s2 * t1;
+    orientation = signedArea > 0.0f ? 1 : (signedArea < 0.0f ? -1 : 0);
+
+    // dP/du up to the 1 / |area| factor, it's normalized anyway after the projection.
+    float tangent[3];
+    for (UINT c = 0; c < 3; ++c)
+        tangent[c] = (t2 * d1[c] - t1 * d2[c]) * (signedArea < 0.0f ? -1.0f : 1.0f);
+
+    for (UINT k = 0; k < 3; ++k)
+    {
+        float e0[3];
+        float e1[3];
+        Sub3(p[(k + 1) % 3], p[k], e0);
+        Sub3(p[(k + 2) % 3], p[k], e1);
+
+        float tp[3];
+        float e0p[3];
+        float e1p[3];
+        ProjectOnPlane(tangent, n[k], tp);
+        ProjectOnPlane(e0, n[k], e0p);
+        ProjectOnPlane(e1, n[k], e1p);
+        float tLenSq = Dot3(tp, tp);
+        float e0LenSq = Dot3(e0p, e0p);
+        float e1LenSq = Dot3(e1p, e1p);
+
+        float weight = 0.0f;
+        if (orientation != 0 && tLenSq > TangentEpsilon && e0LenSq > TangentEpsilon && e1LenSq > TangentEpsilon)
+        {
+            float cosAngle = std::clamp(Dot3(e0p, e1p) / std::sqrt(e0LenSq * e1LenSq), -1.0f, 1.0f);
+            weight = std::acos(cosAngle) / std::sqrt(tLenSq);
+        }
+        for (UINT c = 0; c < 3; ++c)
+            corners[GetCornerIndex(triangleIndex, k, c)] = tp[c] * weight;
+    }
+}
+
+struct Vec3SSE
+{
+    __m128 X;
+    __m128 Y;
+    __m128 Z;
+};
+
+SIMD_TARGET_SSE41 inline Vec3SSE Gather3(const byte* stream, size_t stride, const UINT* triangles, UINT corner)
+{
+    alignas(16) float v[3][4];
+    for (UINT lane = 0; lane < 4; ++lane)
+    {
+        const float* src = reinterpret_cast<const float*>(stream + stride * triangles[lane * 3 + corner]);
+        v[0][lane] = src[0];
+        v[1][lane] = src[1];
+        v[2][lane] = src[2];
+    }
+    return { _mm_load_ps(v[0]), _mm_load_ps(v[1]), _mm_load_ps(v[2]) };
+}
+
+SIMD_TARGET_SSE41 inline Vec3SSE Sub(const Vec3SSE& a, const Vec3SSE& b)
+{
+    return { _mm_sub_ps(a.X, b.X), _mm_sub_ps(a.Y, b.Y), _mm_sub_ps(a.Z, b.Z) };
+}
+
+SIMD_TARGET_SSE41 inline __m128 Dot(const Vec3SSE& a, const Vec3SSE& b)
+{
+    return _mm_add_ps(_mm_add_ps(_mm_mul_ps(a.X, b.X), _mm_mul_ps(a.Y, b.Y)), _mm_mul_ps(a.Z, b.Z));
+}
+
+SIMD_TARGET_SSE41 inline Vec3SSE ProjectOnPlane(const Vec3SSE& v, const Vec3SSE& n)
+{
+    __m128 d = Dot(n, v);
+    return { _mm_sub_ps(v.X, _mm_mul_ps(n.X, d)), _mm_sub_ps(v.Y, _mm_mul_ps(n.Y, d)), _mm_sub_ps(v.Z, _mm_mul_ps(n.Z, d)) };
+}
+
+// Abramowitz and Stegun 4.4.45, the error is below 7e-5 rad which is plenty for a weight.
+SIMD_TARGET_SSE41 inline __m128 Acos(__m128 x)
+{
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    __m128 a = _mm_andnot_ps(signMask, x);
+    __m128 poly = _mm_set1_ps(-0.0187293f);
+    poly = _mm_add_ps(_mm_mul_ps(poly, a), _mm_set1_ps(0.0742610f));
+    poly = _mm_add_ps(_mm_mul_ps(poly, a), _mm_set1_ps(-0.2121144f));
+    poly = _mm_add_ps(_mm_mul_ps(poly, a), _mm_set1_ps(1.5707288f));
+    __m128 res = _mm_mul_ps(poly, _mm_sqrt_ps(_mm_sub_ps(_mm_set1_ps(1.0f), a)));
+    __m128 negative = _mm_cmplt_ps(x, _mm_setzero_ps());
+    return _mm_blendv_ps(res, _mm_sub_ps(_mm_set1_ps(3.14159265f), res), negative);
+}
+
+SIMD_TARGET_SSE41 void ProcessTrianglesSSE(const TangentInput& input, const UINT* indices, size_t triangleCount, float* corners, signed char* orientations)
+{
+    const __m128 epsilon = _mm_set1_ps(TangentEpsilon);
+    const __m128 zero = _mm_setzero_ps();
+    size_t t = 0;
+    for (; t + TrianglesPerBlock <= triangleCount; t += TrianglesPerBlock)
+    {
+        const UINT* triangles = indices + t * 3;
+        Vec3SSE p[3];
+        Vec3SSE n[3];
+        __m128 u[3];
+        __m128 v[3];
+        for (UINT k = 0; k < 3; ++k)
+        {
+            p[k] = Gather3(input.Positions, input.Stride, triangles, k);
+            n[k] = Gather3(input.Normals, input.Stride, triangles, k);
+            alignas(16) float uv[2][4];
+            for (UINT lane = 0; lane < 4; ++lane)
+            {
+                const float* src = reinterpret_cast<const float*>(input.Uvs + input.Stride * triangles[lane * 3 + k]);
+                uv[0][lane] = src[0];
+                uv[1][lane] = src[1];
+            }
+            u[k] = _mm_load_ps(uv[0]);
+            v[k] = _mm_load_ps(uv[1]);
+        }
+
+        Vec3SSE d1 = Sub(p[1], p[0]);
+        Vec3SSE d2 = Sub(p[2], p[0]);
+        __m128 s1 = _mm_sub_ps(u[1], u[0]);
+        __m128 t1 = _mm_sub_ps(v[1], v[0]);
+        __m128 s2 = _mm_sub_ps(u[2], u[0]);
+        __m128 t2 = _mm_sub_ps(v[2], v[0]);
+        __m128 signedArea = _mm_sub_ps(_mm_mul_ps(s1, t2), _mm_mul_ps(s2, t1));
+        __m128 positive = _mm_cmpgt_ps(signedArea, zero);
+        __m128 negative = _mm_cmplt_ps(signedArea, zero);
+        int positiveMask = _mm_movemask_ps(positive);
+        int negativeMask = _mm_movemask_ps(negative);
+        for (UINT lane = 0; lane < 4; ++lane)
+            orientations[t + lane] = (positiveMask >> lane) & 1 ? 1 : ((negativeMask >> lane) & 1 ? -1 : 0);
+
+        // dP/du up to the 1 / |area| factor, the sign of the area is moved over with a xor.
+        __m128 areaSign = _mm_and_ps(signedArea, _mm_set1_ps(-0.0f));
+        Vec3SSE tangent = {
+            _mm_xor_ps(_mm_sub_ps(_mm_mul_ps(t2, d1.X), _mm_mul_ps(t1, d2.X)), areaSign),
+            _mm_xor_ps(_mm_sub_ps(_mm_mul_ps(t2, d1.Y), _mm_mul_ps(t1, d2.Y)), areaSign),
+            _mm_xor_ps(_mm_sub_ps(_mm_mul_ps(t2, d1.Z), _mm_mul_ps(t1, d2.Z)), areaSign) };
+        __m128 oriented = _mm_or_ps(positive, negative);
+
+        float* block = corners + (t / TrianglesPerBlock) * CornerBlockSize;
+        for (UINT k = 0; k < 3; ++k)
+        {
+            Vec3SSE tp = ProjectOnPlane(tangent, n[k]);
+            Vec3SSE e0p = ProjectOnPlane(Sub(p[(k + 1) % 3], p[k]), n[k]);
+            Vec3SSE e1p = ProjectOnPlane(Sub(p[(k + 2) % 3], p[k]), n[k]);
+            __m128 tLenSq = Dot(tp, tp);
+            __m128 e0LenSq = Dot(e0p, e0p);
+            __m128 e1LenSq = Dot(e1p, e1p);
+
+            __m128 valid = _mm_and_ps(oriented, _mm_and_ps(_mm_cmpgt_ps(tLenSq, epsilon), _mm_and_ps(_mm_cmpgt_ps(e0LenSq, epsilon), _mm_cmpgt_ps(e1LenSq, epsilon))));
+            // Invalid lanes may divide by zero here, the result is masked out below.
+            __m128 cosAngle = _mm_div_ps(Dot(e0p, e1p), _mm_sqrt_ps(_mm_mul_ps(e0LenSq, e1LenSq)));
+            cosAngle = _mm_min_ps(_mm_max_ps(cosAngle, _mm_set1_ps(-1.0f)), _mm_set1_ps(1.0f));
+            __m128 weight = _mm_and_ps(valid, _mm_div_ps(Acos(cosAngle), _mm_sqrt_ps(tLenSq)));
+
+            _mm_storeu_ps(block + k * 12 + 0, _mm_mul_ps(tp.X, weight));
+            _mm_storeu_ps(block + k * 12 + 4, _mm_mul_ps(tp.Y, weight));
+            _mm_storeu_ps(block + k * 12 + 8, _mm_mul_ps(tp.Z, weight));
+        }
+    }
+    for (; t < triangleCount; ++t)
+        ProcessTriangleScalar(input, indices + t * 3, t, corners, orientations[t]);
+}
+
+void BuildPerpendicular(const float n[3], float res[3])
+{
+    // Any tangent is as good as another without a uv gradient, it just has to be orthogonal to the normal.
+    float axis[3] = { 0.0f, 0.0f, 0.0f };
+    axis[std::fabs(n[0]) < 0.9f ? 0 : 1] = 1.0f;
+    ProjectOnPlane(axis, n, res);
+    float len = std::sqrt(Dot3(res, res));
+    for (UINT c = 0; c < 3; ++c)
+        res[c] = len > 0.0f ? res[c] / len : axis[c];
+}
+}
+
+void GenerateTangents(std::vector<float>& tangents, std::vector<UINT>& splitVertices, UINT* indices, size_t indexCount, const TangentInput& input, SimdLevel level /*= GetSimdLevel()*/)
+{
+    const size_t triangleCount = indexCount / 3;
+    const size_t vertexCount = input.VertexCount;
+    std::vector<float> corners(((triangleCount + TrianglesPerBlock - 1) / TrianglesPerBlock) * CornerBlockSize);
+    std::vector<signed char> orientations(triangleCount);
+
+    if (level != SimdLevel::Scalar)
+    {
+        ProcessTrianglesSSE(input, indices, triangleCount, corners.data(), orientations.data());
+    }
+    else
+    {
+        for (size_t t = 0; t < triangleCount; ++t)
+            ProcessTriangleScalar(input, indices + t * 3, t, corners.data(), orientations[t]);
+    }
+
+    // Two accumulators per vertex, one per uv winding: xyz and whether any triangle contributed.
+    std::vector<float> accum(vertexCount * 8, 0.0f);
+    for (size_t t = 0; t < triangleCount; ++t)
+    {
+        if (orientations[t] == 0)
+            continue;
+        UINT group = orientations[t] > 0 ? 0 : 1;
+        for (UINT k = 0; k < 3; ++k)
+        {
+            float* acc = accum.data() + size_t(indices[t * 3 + k]) * 8 + group * 4;
+            for (UINT c = 0; c < 3; ++c)
+                acc[c] += corners[GetCornerIndex(t, k, c)];
+            acc[3] = 1.0f;
+        }
+    }
+
+    splitVertices.clear();
+    std::vector<UINT> splitOf(vertexCount, InvalidIndex);
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+        if (accum[v * 8 + 3] > 0.0f && accum[v * 8 + 7] > 0.0f)
+        {
+            splitOf[v] = UINT(vertexCount + splitVertices.size());
+            splitVertices.push_back(UINT(v));
+        }
+    }
+    for (size_t t = 0; t < triangleCount; ++t)
+    {
+        if (orientations[t] >= 0)
+            continue;
+        for (UINT k = 0; k < 3; ++k)
+        {
+            UINT& index = indices[t * 3 + k];
+            if (splitOf[index] != InvalidIndex)
+                index = splitOf[index];
+        }
+    }
+
+    tangents.resize((vertexCount + splitVertices.size()) * 4);
+    for (size_t v = 0; v < vertexCount + splitVertices.size(); ++v)
+    {
+        bool isSplit = v >= vertexCount;
+        UINT source = isSplit ? splitVertices[v - vertexCount] : UINT(v);
+        // Split vertices take the negative winding, the originals keep the positive one if they have it.
+        UINT group = isSplit || accum[size_t(source) * 8 + 3] == 0.0f ? 1 : 0;
+        const float* acc = accum.data() + size_t(source) * 8 + group * 4;
+
+        float* res = tangents.data() + v * 4;
+        float lenSq = Dot3(acc, acc);
+        if (acc[3] > 0.0f && lenSq > TangentEpsilon)
+        {
+            float invLen = 1.0f / std::sqrt(lenSq);
+            for (UINT c = 0; c < 3; ++c)
+                res[c] = acc[c] * invLen;
+        }
+        else
+        {
+            float n[3];
+            Load3(input.Normals, input.Stride, source, n);
+            BuildPerpendicular(n, res);
+        }
+        res[3] = group == 0 || acc[3] == 0.0f ? 1.0f : -1.0f;
+    }
+}
+}
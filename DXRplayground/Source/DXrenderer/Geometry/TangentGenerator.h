@@ -0,0 +1,26 @@
+#pragma once
+
+#include <vector>
+#include <windows.h>
+
+#include "Utils/Simd.h"
+
+namespace DirectxPlayground
+{
+struct TangentInput
+{
+    const byte* Positions = nullptr; // float3
+    const byte* Normals = nullptr; // float3, normalized
+    const byte* Uvs = nullptr; // float2
+    size_t Stride = 0;
+    size_t VertexCount = 0;
+};
+
+// MikkTSpace style tangents (Mikkelsen 2008). Per corner tangents from the uv gradient are projected on the vertex normal,
+// weighted by the corner angle and summed over the triangles sharing the vertex. Triangles with the opposite uv winding aren't mixed,
+// a vertex used by both gets split so mirrored uvs keep their own handedness.
+// tangents receives float4 per vertex with the bitangent sign in w, VertexCount + splitVertices.size() of them.
+// splitVertices[i] is the source of the new vertex VertexCount + i, the indices are updated in place to use it.
+// The per triangle part runs 4 triangles per iteration with SSE, the accumulation is scalar since triangles share vertices.
+void GenerateTangents(std::vector<float>& tangents, std::vector<UINT>& splitVertices, UINT* indices, size_t indexCount, const TangentInput& input, SimdLevel level = GetSimdLevel());
+}
@@ -0,0 +1,245 @@
+#include "DXrenderer/Geometry/VertexQuantization.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+namespace DirectxPlayground
+{
+namespace
+{
+constexpr float RadToDeg = 57.2957795f;
+
+void LoadFloats(const byte* src, size_t index, size_t stride, float* dst, UINT count)
+{
+    memcpy(dst, src + stride * index, sizeof(float) * count);
+}
+
+SHORT ToSnorm16(float v)
+{
+    return SHORT(std::lround(std::clamp(v, -1.0f, 1.0f) * 32767.0f));
+}
+
+float FromSnorm16(SHORT v)
+{
+    return std::max(float(v) / 32767.0f, -1.0f);
+}
+
+float AngleDegrees(const float a[3], const float b[3])
+{
+    float la = std::sqrt(a[0] * a[0] + a[1] * a[1] + a[2] * a[2]);
+    float lb = std::sqrt(b[0] * b[0] + b[1] * b[1] + b[2] * b[2]);
+    if (la == 0.0f || lb == 0.0f)
+        return 0.0f;
+    float cosAngle = (a[0] * b[0] + a[1] * b[1] + a[2] * b[2]) / (la * lb);
+    return std::acos(std::clamp(cosAngle, -1.0f, 1.0f)) * RadToDeg;
+}
+}
+
+USHORT FloatToHalf(float value)
+{
+    UINT bits;
+    memcpy(&bits, &value, sizeof(bits));
+    UINT sign = (bits >> 16) & 0x8000;
+    UINT exponent = (bits >> 23) & 0xFF;
+    UINT mantissa = bits & 0x7FFFFF;
+
+    if (exponent == 0xFF)
+        return USHORT(sign | 0x7C00 | (mantissa != 0 ? 0x200 : 0)); // Inf or NaN.
+
+    int halfExponent = int(exponent) - 127 + 15;
+    if (halfExponent >= 31)
+        return USHORT(sign | 0x7C00);
+
+    // Round to the nearest even in both the normal and the subnormal cases. A carry out of the mantissa correctly bumps the exponent.
+    UINT half;
+    UINT remainder;
+    UINT halfway;
+    if (halfExponent <= 0)
+    {
+        if (halfExponent < -10)
+            return USHORT(sign);
+        mantissa |= 0x800000;
+        UINT shift = UINT(14 - halfExponent);
+        half = mantissa >> shift;
+        remainder = mantissa & ((1U << shift) - 1);
+        halfway = 1U << (shift - 1);
+    }
+    else
+    {
+        half = (UINT(halfExponent) << 10) | (mantissa >> 13);
+        remainder = mantissa & 0x1FFF;
+        halfway = 0x1000;
+    }
+    if (remainder > halfway || (remainder == halfway && (half & 1) != 0))
+        ++half;
+    return USHORT(sign | half);
+}
+
+float HalfToFloat(USHORT value)
+{
+    UINT sign = UINT(value & 0x8000) << 16;
+    UINT exponent = (value >> 10) & 0x1F;
+    UINT mantissa = value & 0x3FF;
+
+    UINT bits;
+    if (exponent == 0x1F)
+    {
+        bits = sign | 0x7F800000 | (mantissa << 13);
+    }
+    else if (exponent != 0)
+    {
+        bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+    }
+    else if (mantissa != 0)
+    {
+        // Subnormal half is a normal float.
+        exponent = 127 - 15 + 1;
+        while ((mantissa & 0x400) == 0)
+        {
+            mantissa <<= 1;
+            --exponent;
+        }
+        bits = sign | (exponent << 23) | ((mantissa & 0x3FF) << 13);
+    }
+    else
+    {
+        bits = sign;
+    }
+    float res;
+    memcpy(&res, &bits, sizeof(res));
+    return res;
+}
+
+void OctEncode(const float n[3], SHORT res[2])
+{
+    float l1 = std::fabs(n[0]) + std::fabs(n[1]) + std::fabs(n[2]);
+    if (l1 == 0.0f)
+    {
+        res[0] = 0;
+        res[1] = 0;
+        return;
+    }
+    float x = n[0] / l1;
+    float y = n[1] / l1;
+    if (n[2] < 0.0f)
+    {
+        float foldedX = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        float foldedY = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = foldedX;
+        y = foldedY;
+    }
+    res[0] = ToSnorm16(x);
+    res[1] = ToSnorm16(y);
+}
+
+void OctDecode(const SHORT e[2], float n[3])
+{
+    float x = FromSnorm16(e[0]);
+    float y = FromSnorm16(e[1]);
+    float z = 1.0f - std::fabs(x) - std::fabs(y);
+    float t = std::max(-z, 0.0f);
+    x += x >= 0.0f ? -t : t;
+    y += y >= 0.0f ? -t : t;
+    float length = std::sqrt(x * x + y * y + z * z);
+    n[0] = x / length;
+    n[1] = y / length;
+    n[2] = z / length;
+}
+
+QuantizationBounds ComputeQuantizationBounds(const byte* positions, size_t positionsStride, size_t count)
+{
+    QuantizationBounds bounds;
+    if (count == 0)
+        return bounds;
+    float minP[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+    float maxP[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+    for (size_t i = 0; i < count; ++i)
+    {
+        float p[3];
+        LoadFloats(positions, i, positionsStride, p, 3);
+        for (UINT c = 0; c < 3; ++c)
+        {
+            minP[c] = std::min(minP[c], p[c]);
+            maxP[c] = std::max(maxP[c], p[c]);
+        }
+    }
+    for (UINT c = 0; c < 3; ++c)
+    {
+        bounds.Min[c] = minP[c];
+        bounds.Extent[c] = maxP[c] - minP[c];
+    }
+    return bounds;
+}
+
+void QuantizeVertices(QuantizedVertex* dst, const VertexStreams& src, size_t count, const QuantizationBounds& bounds)
+{
+    float invExtent[3];
+    for (UINT c = 0; c < 3; ++c)
+        invExtent[c] = bounds.Extent[c] > 0.0f ? 1.0f / bounds.Extent[c] : 0.0f;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        float pos[3];
+        float uv[2];
+        float norm[3];
+        float tangent[4];
+        LoadFloats(src.Positions, i, src.Stride, pos, 3);
+        LoadFloats(src.Uvs, i, src.Stride, uv, 2);
+        LoadFloats(src.Normals, i, src.Stride, norm, 3);
+        LoadFloats(src.Tangents, i, src.Stride, tangent, 4);
+
+        QuantizedVertex& v = dst[i];
+        for (UINT c = 0; c < 3; ++c)
+            v.Pos[c] = USHORT(std::lround(std::clamp((pos[c] - bounds.Min[c]) * invExtent[c], 0.0f, 1.0f) * 65535.0f));
+        v.Pos[3] = tangent[3] < 0.0f ? 0 : 65535;
+        v.Uv[0] = FloatToHalf(uv[0]);
+        v.Uv[1] = FloatToHalf(uv[1]);
+        OctEncode(norm, v.Norm);
+        OctEncode(tangent, v.Tangent);
+    }
+}
+
+void DequantizeVertex(const QuantizedVertex& v, const QuantizationBounds& bounds, float pos[3], float uv[2], float norm[3], float tangent[4])
+{
+    for (UINT c = 0; c < 3; ++c)
+        pos[c] = bounds.Min[c] + float(v.Pos[c]) / 65535.0f * bounds.Extent[c];
+    uv[0] = HalfToFloat(v.Uv[0]);
+    uv[1] = HalfToFloat(v.Uv[1]);
+    OctDecode(v.Norm, norm);
+    OctDecode(v.Tangent, tangent);
+    tangent[3] = v.Pos[3] == 0 ? -1.0f : 1.0f;
+}
+
+QuantizationError MeasureQuantizationError(const QuantizedVertex* quantized, const VertexStreams& src, size_t count, const QuantizationBounds& bounds)
+{
+    QuantizationError error;
+    for (size_t i = 0; i < count; ++i)
+    {
+        float pos[3];
+        float uv[2];
+        float norm[3];
+        float tangent[4];
+        LoadFloats(src.Positions, i, src.Stride, pos, 3);
+        LoadFloats(src.Uvs, i, src.Stride, uv, 2);
+        LoadFloats(src.Normals, i, src.Stride, norm, 3);
+        LoadFloats(src.Tangents, i, src.Stride, tangent, 4);
+
+        float dPos[3];
+        float dUv[2];
+        float dNorm[3];
+        float dTangent[4];
+        DequantizeVertex(quantized[i], bounds, dPos, dUv, dNorm, dTangent);
+
+        for (UINT c = 0; c < 3; ++c)
+            error.Position = std::max(error.Position, std::fabs(pos[c] - dPos[c]));
+        for (UINT c = 0; c < 2; ++c)
+            error.Uv = std::max(error.Uv, std::fabs(uv[c] - dUv[c]));
+        error.NormalDegrees = std::max(error.NormalDegrees, AngleDegrees(norm, dNorm));
+        error.TangentDegrees = std::max(error.TangentDegrees, AngleDegrees(tangent, dTangent));
+        error.HandednessPreserved = error.HandednessPreserved && ((tangent[3] < 0.0f) == (dTangent[3] < 0.0f));
+    }
+    return error;
+}
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <windows.h>
+
+namespace DirectxPlayground
+{
+// 20 bytes instead of the 48 of Vertex. Matches GetInputLayoutQuantized.
+struct QuantizedVertex
+{
+    USHORT Pos[4]; // UNORM16 inside the mesh QuantizationBounds. w is the tangent handedness: 0 for -1, 65535 for 1.
+    USHORT Uv[2]; // Half floats.
+    SHORT Norm[2]; // Octahedral SNORM16.
+    SHORT Tangent[2]; // Octahedral SNORM16.
+};
+static_assert(sizeof(QuantizedVertex) == 20, "QuantizedVertex must match the input layout");
+
+struct QuantizationBounds
+{
+    float Min[3] = {};
+    float Extent[3] = {};
+};
+
+// Float streams of an interleaved vertex array, i.e. the Vertex fields. Tangents are float4 with the handedness in w.
+struct VertexStreams
+{
+    const byte* Positions = nullptr;
+    const byte* Uvs = nullptr;
+    const byte* Normals = nullptr;
+    const byte* Tangents = nullptr;
+    size_t Stride = 0;
+};
+
+struct QuantizationError
+{
+    float Position = 0.0f; // Model units.
+    float Uv = 0.0f;
+    float NormalDegrees = 0.0f;
+    float TangentDegrees = 0.0f;
+    bool HandednessPreserved = true;
+};
+
+USHORT FloatToHalf(float value);
+float HalfToFloat(USHORT value);
+void OctEncode(const float n[3], SHORT res[2]);
+void OctDecode(const SHORT e[2], float n[3]);
+
+QuantizationBounds ComputeQuantizationBounds(const byte* positions, size_t positionsStride, size_t count);
+void QuantizeVertices(QuantizedVertex* dst, const VertexStreams& src, size_t count, const QuantizationBounds& bounds);
+void DequantizeVertex(const QuantizedVertex& v, const QuantizationBounds& bounds, float pos[3], float uv[2], float norm[3], float tangent[4]);
+
+// Encode -> decode round trip against the source, the worst case per attribute.
+QuantizationError MeasureQuantizationError(const QuantizedVertex* quantized, const VertexStreams& src, size_t count, const QuantizationBounds& bounds);
+}
@@ -0,0 +1,148 @@
+#include "DXrenderer/Geometry/VertexWelder.h"
+
+#include "Utils/Hash.h"
+
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace DirectxPlayground
+{
+namespace
+{
+constexpr UINT InvalidIndex = ~0U;
+constexpr size_t MaxVertexComponents = 64;
+
+size_t GetTableCapacity(size_t vertexCount)
+{
+    // Power of two for the mask and at most half full, linear probing degrades quickly above that.
+    size_t capacity = 16;
+    while (capacity < vertexCount * 2)
+        capacity *= 2;
+    return capacity;
+}
+
+class ExactVertexKey
+{
+public:
+    ExactVertexKey(const byte* vertices, size_t vertexSize)
+        : m_vertices(vertices)
+        , m_vertexSize(vertexSize)
+    {
+    }
+
+    UINT64 Hash(size_t v) const
+    {
+        return HashBytes(m_vertices + v * m_vertexSize, m_vertexSize);
+    }
+
+    bool Equal(size_t a, size_t b) const
+    {
+        return memcmp(m_vertices + a * m_vertexSize, m_vertices + b * m_vertexSize, m_vertexSize) == 0;
+    }
+
+private:
+    const byte* m_vertices = nullptr;
+    size_t m_vertexSize = 0;
+};
+
+class QuantizedVertexKey
+{
+public:
+    QuantizedVertexKey(const byte* vertices, size_t vertexSize, float epsilon)
+        : m_vertices(vertices)
+        , m_vertexSize(vertexSize)
+        , m_componentsCount(vertexSize / sizeof(float))
+        , m_invEpsilon(1.0 / double(epsilon))
+    {
+        assert(vertexSize % sizeof(float) == 0 && m_componentsCount <= MaxVertexComponents);
+    }
+
+    UINT64 Hash(size_t v) const
+    {
+        INT64 cells[MaxVertexComponents];
+        Quantize(v, cells);
+        return HashBytes(cells, m_componentsCount * sizeof(INT64));
+    }
+
+    bool Equal(size_t a, size_t b) const
+    {
+        INT64 cellsA[MaxVertexComponents];
+        INT64 cellsB[MaxVertexComponents];
+        Quantize(a, cellsA);
+        Quantize(b, cellsB);
+        return memcmp(cellsA, cellsB, m_componentsCount * sizeof(INT64)) == 0;
+    }
+
+private:
+    void Quantize(size_t v, INT64* cells) const
+    {
+        const byte* vertex = m_vertices + v * m_vertexSize;
+        for (size_t c = 0; c < m_componentsCount; ++c)
+        {
+            float value;
+            memcpy(&value, vertex + c * sizeof(float), sizeof(float));
+            cells[c] = INT64(std::floor(double(value) * m_invEpsilon + 0.5));
+        }
+    }
+
+    const byte* m_vertices = nullptr;
+    size_t m_vertexSize = 0;
+    size_t m_componentsCount = 0;
+    double m_invEpsilon = 0.0;
+};
+
+template <typename Key>
+size_t GenerateRemap(UINT* remap, size_t vertexCount, const Key& key)
+{
+    // The table keeps source vertex indices, the key functions compare the vertex data behind them.
+    std::vector<UINT> table(GetTableCapacity(vertexCount), InvalidIndex);
+    size_t mask = table.size() - 1;
+    size_t uniqueCount = 0;
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+        size_t slot = size_t(key.Hash(v)) & mask;
+        while (table[slot] != InvalidIndex && !key.Equal(table[slot], v))
+            slot = (slot + 1) & mask;
+
+        if (table[slot] == InvalidIndex)
+        {
+            table[slot] = UINT(v);
+            remap[v] = UINT(uniqueCount++);
+        }
+        else
+        {
+            remap[v] = remap[table[slot]];
+        }
+    }
+    return uniqueCount;
+}
+}
+
+size_t GenerateVertexRemap(UINT* remap, const byte* vertices, size_t vertexCount, size_t vertexSize, float epsilon /*= 0.0f*/)
+{
+    if (epsilon > 0.0f)
+        return GenerateRemap(remap, vertexCount, QuantizedVertexKey(vertices, vertexSize, epsilon));
+    return GenerateRemap(remap, vertexCount, ExactVertexKey(vertices, vertexSize));
+}
+
+void RemapVertices(byte* dst, const byte* vertices, size_t vertexCount, size_t vertexSize, const UINT* remap)
+{
+    // Unique indices are handed out in order, so the first occurrence is the one hitting the next free slot.
+    size_t next = 0;
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+        if (remap[v] != next)
+            continue;
+        memcpy(dst + next * vertexSize, vertices + v * vertexSize, vertexSize);
+        ++next;
+    }
+}
+
+void RemapIndices(UINT* dst, const UINT* indices, size_t indexCount, const UINT* remap)
+{
+    for (size_t i = 0; i < indexCount; ++i)
+        dst[i] = remap[indices[i]];
+}
+}
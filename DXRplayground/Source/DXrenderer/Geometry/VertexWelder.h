@@ -0,0 +1,18 @@
+#pragma once
+
+#include <windows.h>
+
+namespace DirectxPlayground
+{
+// Finds duplicated vertices with a flat open addressing hash table, so it stays cache friendly for millions of vertices.
+// With epsilon == 0 only bit identical vertices are merged. Otherwise the vertex is treated as floats and every component is
+// snapped to a grid with this step before hashing and comparing. Near duplicates falling into different grid cells stay apart.
+// remap[v] is the new index of vertex v, the unique vertices keep the order of their first occurrence. Returns the unique vertex count.
+size_t GenerateVertexRemap(UINT* remap, const byte* vertices, size_t vertexCount, size_t vertexSize, float epsilon = 0.0f);
+
+// dst has room for the unique vertex count and gets the first occurrence of every unique vertex. dst must not alias vertices.
+void RemapVertices(byte* dst, const byte* vertices, size_t vertexCount, size_t vertexSize, const UINT* remap);
+
+// dst may alias indices.
+void RemapIndices(UINT* dst, const UINT* indices, size_t indexCount, const UINT* remap);
+}
@@ -0,0 +1,266 @@
+#include "DXrenderer/GltfDocument.h"
+
+#include "DXrenderer/Geometry/AccessorGather.h"
+#include "Utils/Logger.h"
+
+#include <cassert>
+#include <cstring>
+#include <filesystem>
+
+#define JSON_NOEXCEPTION // Has to match Model.cpp where json.hpp is included by the tinygltf implementation.
+#include "External/TinyGLTF/json.hpp"
+
+namespace DirectxPlayground
+{
+namespace
+{
+constexpr UINT GlbMagic = 0x46546C67; // "glTF"
+constexpr UINT GlbChunkJson = 0x4E4F534A; // "JSON"
+constexpr UINT GlbChunkBin = 0x004E4942; // "BIN\0"
+
+struct GlbHeader
+{
+    UINT Magic;
+    UINT Version;
+    UINT Length;
+};
+
+struct GlbChunkHeader
+{
+    UINT Length;
+    UINT Type;
+};
+
+bool IsDataUri(const std::string& uri)
+{
+    return uri.rfind("data:", 0) == 0;
+}
+
+int HexDigitValue(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+// False for a '%' not followed by two hex digits.
+bool DecodeUri(const std::string& uri, std::string& res)
+{
+    res.clear();
+    res.reserve(uri.size());
+    for (size_t i = 0; i < uri.size(); ++i)
+    {
+        if (uri[i] != '%')
+        {
+            res.push_back(uri[i]);
+            continue;
+        }
+        int high = i + 1 < uri.size() ? HexDigitValue(uri[i + 1]) : -1;
+        int low = i + 2 < uri.size() ? HexDigitValue(uri[i + 2]) : -1;
+        if (high < 0 || low < 0)
+            return false;
+        res.push_back(char(high * 16 + low));
+        i += 2;
+    }
+    return true;
+}
+
+bool ReadGlbChunks(const byte* data, size_t size, const char*& json, size_t& jsonSize, const byte*& bin, size_t& binSize)
+{
+    if (size < sizeof(GlbHeader) + sizeof(GlbChunkHeader))
+        return false;
+    GlbHeader header;
+    memcpy(&header, data, sizeof(header));
+    if (header.Magic != GlbMagic || header.Version != 2 || header.Length > size)
+        return false;
+
+    bin = nullptr;
+    binSize = 0;
+    json = nullptr;
+    size_t offset = sizeof(GlbHeader);
+    while (offset + sizeof(GlbChunkHeader) <= header.Length)
+    {
+        GlbChunkHeader chunk;
+        memcpy(&chunk, data + offset, sizeof(chunk));
+        offset += sizeof(GlbChunkHeader);
+        if (offset + chunk.Length > header.Length)
+            return false;
+        if (chunk.Type == GlbChunkJson && json == nullptr)
+        {
+            json = reinterpret_cast<const char*>(data + offset);
+            jsonSize = chunk.Length;
+        }
+        else if (chunk.Type == GlbChunkBin && bin == nullptr)
+        {
+            bin = data + offset;
+            binSize = chunk.Length;
+        }
+        offset += chunk.Length;
+    }
+    return json != nullptr;
+}
+}
+
+void GatherAccessor(const GltfDocument& document, const tinygltf::Accessor& accessor, byte* dst, size_t dstStride, UINT components,
+    const float* scale /*= nullptr*/, const float* offset /*= nullptr*/)
+{
+    const tinygltf::Model& model = document.GetModel();
+    ComponentType type = static_cast<ComponentType>(accessor.componentType);
+    if (accessor.bufferView >= 0)
+    {
+        const tinygltf::BufferView& bufferView = model.bufferViews[accessor.bufferView];
+        const byte* bufferStart = document.GetBufferData(bufferView.buffer) + bufferView.byteOffset + accessor.byteOffset;
+        GatherElements(bufferStart, accessor.ByteStride(bufferView), type, accessor.normalized, dst, dstStride, accessor.count, components, scale, offset);
+    }
+    else
+    {
+        // Zero stride over a zero element, so the scale and offset still apply.
+        const float zero[4] = {};
+        GatherElements(reinterpret_cast<const byte*>(zero), 0, ComponentType::Float, false, dst, dstStride, accessor.count, components, scale, offset);
+    }
+
+    if (!accessor.sparse.isSparse)
+        return;
+    const auto& sparse = accessor.sparse;
+    const tinygltf::BufferView& indicesView = model.bufferViews[sparse.indices.bufferView];
+    const tinygltf::BufferView& valuesView = model.bufferViews[sparse.values.bufferView];
+    const byte* indices = document.GetBufferData(indicesView.buffer) + indicesView.byteOffset + sparse.indices.byteOffset;
+    const byte* values = document.GetBufferData(valuesView.buffer) + valuesView.byteOffset + sparse.values.byteOffset;
+    if (!ScatterElements(indices, static_cast<ComponentType>(sparse.indices.componentType), values, type, accessor.normalized, dst, dstStride, accessor.count,
+        size_t(sparse.count), components, scale, offset))
+    {
+        LOG("GLTF Warning: sparse accessor ", accessor.name, " has indices past its count, they are skipped");
+    }
+}
+
+bool GltfDocument::Load(const std::string& path, bool mapBuffers)
+{
+    if (mapBuffers && LoadMapped(path))
+        return true;
+    return LoadWithTinyGltf(path);
+}
+
+bool GltfDocument::LoadMapped(const std::string& path)
+{
+    auto file = std::make_unique<MappedFile>();
+    if (!file->Open(path))
+        return false;
+
+    const char* jsonText = reinterpret_cast<const char*>(file->GetData());
+    size_t jsonSize = file->GetSize();
+    const byte* glbBin = nullptr;
+    size_t glbBinSize = 0;
+    bool isBinary = std::filesystem::path(path).extension() == ".glb";
+    if (isBinary && !ReadGlbChunks(file->GetData(), file->GetSize(), jsonText, jsonSize, glbBin, glbBinSize))
+    {
+        LOG("Invalid glb ", path);
+        return false;
+    }
+
+    nlohmann::json json = nlohmann::json::parse(jsonText, jsonText + jsonSize, nullptr, false);
+    if (json.is_discarded())
+        return false;
+
+    std::string dir = std::filesystem::path(path).parent_path().string() + '\\';
+    std::vector<const byte*> buffers;
+    std::vector<std::unique_ptr<MappedFile>> files;
+    std::vector<std::string> externalUris;
+    if (json.count("buffers") > 0)
+    {
+        for (const auto& buffer : json["buffers"])
+        {
+            size_t byteLength = buffer.value("byteLength", size_t(0));
+            std::string uri = buffer.value("uri", std::string());
+            if (uri.empty())
+            {
+                if (!isBinary || glbBin == nullptr || glbBinSize < byteLength)
+                    return false;
+                buffers.push_back(glbBin);
+                continue;
+            }
+            if (IsDataUri(uri))
+                return false; // base64 has to be decoded anyway, leave it to tinygltf.
+
+            std::string decodedUri;
+            if (!DecodeUri(uri, decodedUri))
+            {
+                LOG("Malformed glTF buffer uri ", uri);
+                return false;
+            }
+            auto bufferFile = std::make_unique<MappedFile>();
+            if (!bufferFile->Open(dir + decodedUri) || bufferFile->GetSize() < byteLength)
+            {
+                LOG("Failed to map glTF buffer ", uri);
+                return false;
+            }
+            buffers.push_back(bufferFile->GetData());
+            files.push_back(std::move(bufferFile));
+            externalUris.push_back(uri);
+        }
+    }
+    std::vector<std::string> imageUris;
+    if (json.count("images") > 0)
+    {
+        for (const auto& image : json["images"])
+            imageUris.push_back(image.value("uri", std::string()));
+    }
+
+    // Accessors and buffer views only keep the buffer indices, tinygltf doesn't check them against the buffers array.
+    json.erase("buffers");
+    json.erase("images");
+    std::string strippedJson = json.dump();
+
+    tinygltf::TinyGLTF loader;
+    std::string err;
+    std::string warn;
+    if (!loader.LoadASCIIFromString(&m_model, &err, &warn, strippedJson.c_str(), UINT(strippedJson.size()), dir))
+    {
+        LOG("Failed to load model ", path, ": ", err);
+        return false;
+    }
+
+    files.push_back(std::move(file));
+    m_files = std::move(files);
+    m_buffers = std::move(buffers);
+    m_imageUris = std::move(imageUris);
+    m_externalBufferUris = std::move(externalUris);
+    m_isMapped = true;
+    return true;
+}
+
+bool GltfDocument::LoadWithTinyGltf(const std::string& path)
+{
+    tinygltf::TinyGLTF loader;
+    std::string err;
+    std::string warn;
+
+    bool res = false;
+    std::string ext = std::filesystem::path(path).extension().string();
+    if (ext == ".glb")
+        res = loader.LoadBinaryFromFile(&m_model, &err, &warn, path.c_str());
+    else if (ext == ".gltf")
+        res = loader.LoadASCIIFromFile(&m_model, &err, &warn, path.c_str());
+    else
+        assert(false);
+    if (!res)
+    {
+        LOG("Failed to load model ", path, ": ", err);
+        return false;
+    }
+
+    for (const auto& buffer : m_model.buffers)
+    {
+        m_buffers.push_back(buffer.data.data());
+        if (!buffer.uri.empty() && !IsDataUri(buffer.uri)) // .glb and embedded buffers are covered by the source file itself.
+            m_externalBufferUris.push_back(buffer.uri);
+    }
+    for (const auto& image : m_model.images)
+        m_imageUris.push_back(image.uri);
+    m_isMapped = false;
+    return true;
+}
+}
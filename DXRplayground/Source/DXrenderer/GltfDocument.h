@@ -0,0 +1,75 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <windows.h>
+
+#include "External/TinyGLTF/tiny_gltf.h"
+#include "Utils/MappedFile.h"
+
+namespace DirectxPlayground
+{
+// A glTF file with its buffers. With mapBuffers the .gltf/.glb and the .bin files are memory mapped and the accessors read straight
+// from the mapped views: tinygltf only parses the JSON without the buffers and images, so it neither copies the buffers into
+// tinygltf::Buffer::data nor decodes the images nobody uses (textures are loaded by the TextureManager from the uris).
+// Otherwise it's the plain tinygltf load. Files with base64 embedded buffers always take that path.
+class GltfDocument
+{
+public:
+    GltfDocument() = default;
+    GltfDocument(const GltfDocument&) = delete;
+    GltfDocument(GltfDocument&&) = delete;
+    GltfDocument& operator=(const GltfDocument&) = delete;
+    GltfDocument& operator=(GltfDocument&&) = delete;
+
+    bool Load(const std::string& path, bool mapBuffers);
+
+    const tinygltf::Model& GetModel() const;
+    const byte* GetBufferData(int buffer) const;
+    const std::vector<std::string>& GetImageUris() const;
+    const std::vector<std::string>& GetExternalBufferUris() const; // .bin files the document depends on.
+    bool IsMapped() const;
+
+private:
+    bool LoadMapped(const std::string& path);
+    bool LoadWithTinyGltf(const std::string& path);
+
+    tinygltf::Model m_model;
+    std::vector<const byte*> m_buffers;
+    std::vector<std::string> m_imageUris;
+    std::vector<std::string> m_externalBufferUris;
+    std::vector<std::unique_ptr<MappedFile>> m_files;
+    bool m_isMapped = false;
+};
+
+// Base view (or zeros without one) and then the sparse substitution on top of it, straight into one field of the interleaved vertices.
+// Converted to float as the accessor type says, then value * scale + offset per component.
+void GatherAccessor(const GltfDocument& document, const tinygltf::Accessor& accessor, byte* dst, size_t dstStride, UINT components,
+    const float* scale = nullptr, const float* offset = nullptr);
+
+inline const tinygltf::Model& GltfDocument::GetModel() const
+{
+    return m_model;
+}
+
+inline const byte* GltfDocument::GetBufferData(int buffer) const
+{
+    return m_buffers[buffer];
+}
+
+inline const std::vector<std::string>& GltfDocument::GetImageUris() const
+{
+    return m_imageUris;
+}
+
+inline const std::vector<std::string>& GltfDocument::GetExternalBufferUris() const
+{
+    return m_externalBufferUris;
+}
+
+inline bool GltfDocument::IsMapped() const
+{
+    return m_isMapped;
+}
+}
@@ -0,0 +1,83 @@
+#include "DXrenderer/InstanceBatcher.h"
+
+#include <algorithm>
+
+#include "Utils/RadixSort.h"
+#include "Utils/ThreadPool.h"
+
+namespace DirectxPlayground
+{
+namespace
+{
+constexpr size_t GatherChunkSize = 16 * 1024;
+}
+
+void InstanceBatcher::Clear()
+{
+    m_entries.clear();
+    m_keys.clear();
+    m_packed.clear();
+    m_groups.clear();
+}
+
+void InstanceBatcher::Reserve(size_t count)
+{
+    m_entries.reserve(count);
+    m_keys.reserve(count);
+}
+
+void InstanceBatcher::Add(UINT mesh, UINT material, const float toWorld[4][4], UINT userData /*= 0*/)
+{
+    InstanceData& entry = m_entries.emplace_back();
+    for (UINT row = 0; row < 4; ++row)
+    {
+        for (UINT column = 0; column < 4; ++column)
+            entry.ToWorld[row][column] = toWorld[column][row];
+    }
+    entry.UserData = userData;
+    entry.Padding[0] = entry.Padding[1] = entry.Padding[2] = 0;
+    m_keys.push_back((UINT64(mesh) << 32) | material);
+}
+
+void InstanceBatcher::Build(bool parallel /*= true*/)
+{
+    size_t count = m_entries.size();
+    m_sortedKeys.assign(m_keys.begin(), m_keys.end());
+    m_order.resize(count);
+    m_keysScratch.resize(count);
+    m_orderScratch.resize(count);
+    for (UINT i = 0; i < count; ++i)
+        m_order[i] = i;
+    // Stable, so a group keeps the order the instances were added in.
+    RadixSort(m_sortedKeys.data(), m_order.data(), count, m_keysScratch.data(), m_orderScratch.data());
+
+    m_groups.clear();
+    for (UINT i = 0; i < count; ++i)
+    {
+        if (i == 0 || m_sortedKeys[i] != m_sortedKeys[i - 1])
+        {
+            InstanceGroup& group = m_groups.emplace_back();
+            group.Mesh = UINT(m_sortedKeys[i] >> 32);
+            group.Material = UINT(m_sortedKeys[i] & 0xFFFFFFFF);
+            group.FirstInstance = i;
+        }
+        ++m_groups.back().InstanceCount;
+    }
+
+    m_packed.resize(count);
+    auto gather = [this, count](size_t chunk)
+    {
+        size_t end = std::min(count, (chunk + 1) * GatherChunkSize);
+        for (size_t i = chunk * GatherChunkSize; i < end; ++i)
+            m_packed[i] = m_entries[m_order[i]];
+    };
+    size_t chunksCount = (count + GatherChunkSize - 1) / GatherChunkSize;
+    if (parallel && chunksCount > 1)
+    {
+        ThreadPool::Get().ParallelFor(chunksCount, gather);
+        return;
+    }
+    for (size_t chunk = 0; chunk < chunksCount; ++chunk)
+        gather(chunk);
+}
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <vector>
+#include <windows.h>
+
+namespace DirectxPlayground
+{
+// One record of the per frame StructuredBuffer<InstanceData> bound at InstanceDataRootIndex. A group's draw binds the buffer at
+// its first instance, so the shaders index it with SV_InstanceID as is.
+struct InstanceData
+{
+    float ToWorld[4][4]; // Transposed.
+    UINT UserData; // Up to the scene, i.e. an index into a material table.
+    UINT Padding[3];
+};
+
+// Same mesh and material, drawn with one DrawIndexedInstanced of InstanceCount instances starting at FirstInstance of the packed data.
+struct InstanceGroup
+{
+    UINT Mesh = 0;
+    UINT Material = 0;
+    UINT FirstInstance = 0;
+    UINT InstanceCount = 0;
+};
+
+// Scenes add (mesh, material, transform) entries in any order, Build groups the ones with the same mesh and material and packs their
+// records group by group. Mesh and material are ids the scene picks, the batcher only compares them. Nothing in it touches the device.
+// The groups are sorted by mesh then material, the instances keep the order they were added in inside a group.
+class InstanceBatcher
+{
+public:
+    void Clear();
+    void Reserve(size_t count);
+
+    // Can be called after a Build to add more, the next Build regroups everything. toWorld is the row vector one, i.e. an XMFLOAT4X4 as DirectXMath builds it.
+    void Add(UINT mesh, UINT material, const float toWorld[4][4], UINT userData = 0);
+    void Build(bool parallel = true);
+
+    const std::vector<InstanceGroup>& GetGroups() const;
+    const InstanceData* GetInstanceData() const; // Build result, GetInstanceCount records.
+    size_t GetInstanceCount() const;
+    size_t GetInstanceDataSize() const; // In bytes.
+
+private:
+    std::vector<InstanceData> m_entries; // In the order they were added.
+    std::vector<UINT64> m_keys; // Mesh in the high half, material in the low one.
+    std::vector<UINT64> m_sortedKeys;
+    std::vector<UINT> m_order;
+    std::vector<UINT64> m_keysScratch;
+    std::vector<UINT> m_orderScratch;
+    std::vector<InstanceData> m_packed;
+    std::vector<InstanceGroup> m_groups;
+};
+
+inline const std::vector<InstanceGroup>& InstanceBatcher::GetGroups() const
+{
+    return m_groups;
+}
+
+inline const InstanceData* InstanceBatcher::GetInstanceData() const
+{
+    return m_packed.data();
+}
+
+inline size_t InstanceBatcher::GetInstanceCount() const
+{
+    return m_packed.size();
+}
+
+inline size_t InstanceBatcher::GetInstanceDataSize() const
+{
+    return m_packed.size() * sizeof(InstanceData);
+}
+}
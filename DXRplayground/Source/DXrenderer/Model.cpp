@@ -3,9 +3,17 @@
 #include "DXrenderer/RenderContext.h"
 #include "DXrenderer/Textures/TextureManager.h"
 #include "DXrenderer/Buffers/UploadBuffer.h"
+#include "DXrenderer/GltfDocument.h"
+#include "DXrenderer/Geometry/AccessorGather.h"
+#include "DXrenderer/Geometry/MeshCache.h"
+#include "Utils/Hash.h"
 #include "Utils/Logger.h"
+#include "Utils/ThreadPool.h"
+#include "Utils/Timer.h"
 
+#include <algorithm>
 #include <filesystem>
+#include <stdexcept>
 
 #define TINYGLTF_IMPLEMENTATION
 #define TINYGLTF_NOEXCEPTION
@@ -17,6 +25,72 @@ namespace DirectxPlayground
 {
 namespace
 {
+enum ProcessingFlags : UINT
+{
+    ProcessingOptimize = 1 << 0,
+    ProcessingWeld = 1 << 1,
+    ProcessingTangents = 1 << 2,
+    ProcessingValuesMask = 0xFFFF0000, // Hash of the processing values the flags can't express.
+};
+
+// What glTF draws the primitives without a material with: no textures and a white base color.
+const Material DefaultMaterial = { -1, -1, -1, -1, { 1.0f, 1.0f, 1.0f, 1.0f } };
+
+UINT GetProcessingFlags(const ModelLoadSettings& settings)
+{
+    UINT flags = 0;
+    if (settings.OptimizeMeshes)
+        flags |= ProcessingOptimize;
+    if (settings.GenerateTangents)
+        flags |= ProcessingTangents;
+    if (settings.WeldVertices)
+    {
+        flags |= ProcessingWeld;
+        flags |= UINT(HashBytes(&settings.WeldEpsilon, sizeof(settings.WeldEpsilon))) & ProcessingValuesMask;
+    }
+    return flags;
+}
+
+// KHR_texture_transform of the material's texCoord 0 textures. It's baked into the uvs, so all of them have to agree.
+void GetTextureTransform(const tinygltf::Model& model, int materialIndex, float scale[2], float offset[2])
+{
+    if (materialIndex < 0)
+        return;
+    const tinygltf::Material& material = model.materials[materialIndex];
+    const tinygltf::ExtensionMap* textureExtensions[] = {
+        &material.pbrMetallicRoughness.baseColorTexture.extensions,
+        &material.pbrMetallicRoughness.metallicRoughnessTexture.extensions,
+        &material.normalTexture.extensions,
+        &material.occlusionTexture.extensions };
+    bool found = false;
+    for (const auto extensions : textureExtensions)
+    {
+        auto it = extensions->find("KHR_texture_transform");
+        if (it == extensions->end())
+            continue;
+        const tinygltf::Value& transform = it->second;
+        float s[2] = { 1.0f, 1.0f };
+        float o[2] = { 0.0f, 0.0f };
+        for (int i = 0; i < 2 && transform.Has("scale"); ++i)
+            s[i] = float(transform.Get("scale").Get(i).GetNumberAsDouble());
+        for (int i = 0; i < 2 && transform.Has("offset"); ++i)
+            o[i] = float(transform.Get("offset").Get(i).GetNumberAsDouble());
+        if (transform.Has("rotation") && transform.Get("rotation").GetNumberAsDouble() != 0.0)
+            LOG("GLTF Warning: KHR_texture_transform rotation isn't supported");
+        if (transform.Has("texCoord") && transform.Get("texCoord").GetNumberAsInt() != 0)
+            LOG("GLTF Warning: KHR_texture_transform texCoord override isn't supported");
+
+        if (found && (s[0] != scale[0] || s[1] != scale[1] || o[0] != offset[0] || o[1] != offset[1]))
+            LOG("GLTF Warning: textures of material ", material.name, " have different KHR_texture_transform, only the first one is used");
+        if (!found)
+        {
+            memcpy(scale, s, sizeof(s));
+            memcpy(offset, o, sizeof(o));
+        }
+        found = true;
+    }
+}
+
 template <typename T>
 T GetElementFromBuffer(const byte* bufferStart, UINT byteStride, size_t elemIndex, UINT offsetInElem = 0)
 {
@@ -24,27 +98,145 @@ T GetElementFromBuffer(const byte* bufferStart, UINT byteStride, size_t elemInde
 }
 }
 
-Model::Model(RenderContext& ctx, const std::string& path)
+Model::Model(RenderContext& ctx, const std::string& path, const ModelLoadSettings& settings /*= {}*/)
+    : Model(path, settings, ctx.Device)
 {
-    tinygltf::Model model;
-    LoadModel(path, model);
+    CreateGpuResources(ctx);
+}
 
-    for (UINT i = 0; i < model.accessors.size(); ++i)
+Model::Model(const std::string& path, const ModelLoadSettings& settings, ID3D12Device* uploadDevice /*= nullptr*/)
+    : m_path(path)
+    , m_settings(settings)
+    , m_uploadDevice(uploadDevice)
+{
+    m_loadStats.FromCache = settings.UseMeshCache && LoadFromCache(path, settings);
+    if (!m_loadStats.FromCache)
+        LoadFromGLTF(path, settings);
+    if (!settings.LodErrors.empty())
+        BuildLods(settings);
+    if (settings.BuildMeshlets)
+        BuildMeshlets(settings);
+
+    m_nodes.UpdateWorldTransforms();
+    for (auto mesh : m_meshes)
     {
-        const auto& accessor = model.accessors[i];
-        if (accessor.sparse.isSparse)
-        {
-            assert("Sparse accessors aren't supported at the moment" && false);
-        }
+        if (mesh->m_lods.empty())
+            mesh->m_lods.push_back({ 0, mesh->m_indexCount, 0.0f });
+        CacheMeshInfo(mesh);
     }
+    m_uploadDevice = nullptr;
+}
 
-    std::filesystem::path pathToModel{ path };
-    std::string dir = pathToModel.parent_path().string() + '\\';
-    for (const auto& image : model.images)
+void Model::CreateGpuResources(RenderContext& ctx)
+{
+    assert(!HasGpuResources());
+    Timer timer;
+    CreateTextures(ctx);
+    for (auto mesh : m_meshes)
     {
-        UINT index = ctx.TexManager->CreateTexture(ctx, dir + image.uri).SRVOffset;
-        m_images.push_back({ index, image.uri });
+        ResolveMaterial(mesh);
+        CreateMeshBuffers(ctx, mesh, m_settings);
+
+        // The pooled views cover the whole block, so the sizes come from the counts.
+        UINT vertexStride = mesh->GetVertexBufferView().StrideInBytes;
+        UINT indexSize = mesh->GetIndexFormat() == DXGI_FORMAT_R16_UINT ? sizeof(USHORT) : sizeof(UINT);
+        m_loadStats.GpuGeometryBytes += UINT64(vertexStride) * mesh->m_vertexCount + UINT64(indexSize) * mesh->GetSourceIndexCount();
+        m_loadStats.FullPrecisionGeometryBytes += sizeof(Vertex) * mesh->m_vertexCount + sizeof(UINT) * mesh->GetSourceIndexCount();
+        ReleaseCpuData(mesh, m_settings.CpuResidency);
+        m_loadStats.ResidentCpuGeometryBytes += mesh->GetResidentCpuBytes();
     }
+    SafeDelete(m_meshCache); // Everything is on its way to the GPU, the meshes hold their own copies of what's kept.
+    CreateMeshTransformBuffer(ctx); // After the vertex buffers, they set the quantization bounds.
+    m_loadStats.UploadMs = timer.GetElapsedMs();
+    m_loadStats.PrimitivesCount = UINT(m_meshes.size());
+    m_loadStats.NodesCount = m_nodes.GetCount();
+
+    LOG("Model ", m_path, " loaded", m_loadStats.FromCache ? " from the mesh cache" : "", ". Primitives: ", m_loadStats.PrimitivesCount, " parse: ", m_loadStats.ParseMs,
+        "ms textures (", m_settings.ParallelTextureDecode ? "parallel" : "serial", "): ", m_loadStats.TexturesMs, "ms, ", m_loadStats.TextureCacheHits, " of ", m_images.size(),
+        " images from the texture cache, ", m_loadStats.SharedTextures, " shared, decode (", m_settings.ParallelDecode ? "parallel" : "serial", "): ", m_loadStats.DecodeMs,
+        "ms cache write: ", m_loadStats.CacheWriteMs, "ms upload: ", m_loadStats.UploadMs, "ms geometry: ", m_loadStats.GpuGeometryBytes / 1024, "KB (",
+        m_loadStats.FullPrecisionGeometryBytes / 1024, "KB with full precision vertices and 32 bit indices) resident on the CPU: ", m_loadStats.ResidentCpuGeometryBytes / 1024, "KB");
+}
+
+Model::Model(RenderContext& ctx, std::vector<Vertex> vertices, std::vector<UINT> indices)
+{
+    m_meshes.emplace_back(new Mesh{});
+    Mesh* sMesh = m_meshes.back();
+
+    sMesh->m_vertices.swap(vertices);
+    sMesh->m_indices.swap(indices);
+    sMesh->m_indexCount = static_cast<UINT>(sMesh->m_indices.size());
+    sMesh->m_lods.push_back({ 0, sMesh->m_indexCount, 0.0f });
+
+    CacheMeshInfo(sMesh);
+    m_nodes.AddNode(NodeHierarchy::NoParent, { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f, 1.0f }, { 1.0f, 1.0f, 1.0f });
+    m_nodes.UpdateWorldTransforms();
+    CreateVertexBuffer(ctx, sMesh, false);
+    CreateIndexBuffer(ctx, sMesh);
+    CreateMeshTransformBuffer(ctx);
+}
+
+Model::~Model()
+{
+    if (m_textureManager != nullptr)
+    {
+        for (const auto& image : m_images)
+            m_textureManager->ReleaseTexture(image.IndexInHeap);
+    }
+    // Never uploaded, the cache misses still go to the TextureCache.
+    for (auto& image : m_decodedImages)
+        TextureManager::ReleaseDecodedImage(image);
+    for (auto submesh : m_meshes)
+    {
+        delete submesh;
+    }
+    m_meshes.clear();
+    SafeDelete(m_meshTransforms3x4);
+    SafeDelete(m_meshCache);
+}
+
+void Model::UpdateMeshes(UINT frame)
+{
+    m_nodes.UpdateWorldTransforms();
+    XMMATRIX toWorld = XMLoadFloat4x4(&m_transform);
+    for (auto mesh : m_meshes)
+    {
+        mesh->UpdateMaterialBuffer(frame);
+
+        XMFLOAT4X4 meshToWorld;
+        XMStoreFloat4x4(&meshToWorld, XMMatrixTranspose(XMMatrixMultiply(XMLoadFloat4x4(&m_nodes.GetWorldTransform(mesh->m_nodeIndex)), toWorld)));
+        mesh->m_transformBuffer->UploadData(frame, meshToWorld);
+    }
+}
+
+void Model::GetMeshWorldBounds(const Mesh* mesh, BoundingBox& box, float& sphereRadius) const
+{
+    XMMATRIX meshToWorld = XMMatrixMultiply(XMLoadFloat4x4(&m_nodes.GetWorldTransform(mesh->m_nodeIndex)), XMLoadFloat4x4(&m_transform));
+    BoundingSphere sphere;
+    mesh->m_bounds.Transform(box, meshToWorld);
+    mesh->m_sphere.Transform(sphere, meshToWorld);
+
+    XMVECTOR center = XMLoadFloat3(&box.Center);
+    float boxRadius = XMVectorGetX(XMVector3Length(XMLoadFloat3(&box.Extents)));
+    float shiftedRadius = XMVectorGetX(XMVector3Length(XMLoadFloat3(&sphere.Center) - center)) + sphere.Radius;
+    sphereRadius = std::min(boxRadius, shiftedRadius);
+}
+
+void Model::LoadFromGLTF(const std::string& path, const ModelLoadSettings& settings)
+{
+    Timer timer;
+    GltfDocument document;
+    if (!document.Load(path, settings.MapBuffers))
+    {
+        std::stringstream ss;
+        ss << "Failed to load model " << path << std::endl;
+        OutputDebugStringA(ss.str().c_str());
+        throw std::runtime_error(ss.str()); // ModelLoader reports it on the handle, a synchronous load doesn't go on with nothing loaded.
+    }
+    const tinygltf::Model& model = document.GetModel();
+    m_loadStats.ParseMs = timer.GetElapsedMs();
+    m_loadStats.MappedBuffers = document.IsMapped();
+
     for (const auto& texture : model.textures)
     {
         m_textures.push_back(texture.source);
@@ -58,174 +250,589 @@ Model::Model(RenderContext& ctx, const std::string& path)
         m.OcclusionTexture = mat.occlusionTexture.index;
         m_materials.push_back(m);
     }
+    // After the materials, they tell the color maps and the normal maps apart for the mips.
+    timer.Reset();
+    DecodeTextures(path, document.GetImageUris(), settings);
+    m_loadStats.TexturesMs = timer.GetElapsedMs();
 
+    std::vector<PrimitiveRef> primitives;
     const tinygltf::Scene& scene = model.scenes[model.defaultScene];
+    m_nodes.Reserve(model.nodes.size());
     for (int node : scene.nodes)
-        ParseModelNodes(ctx, model, model.nodes[node]);
+        ParseModelNodes(model, node, NodeHierarchy::NoParent, primitives);
+
+    m_meshes.reserve(primitives.size());
+    for (size_t i = 0; i < primitives.size(); ++i)
+        m_meshes.push_back(new Mesh{});
+
+    // Every primitive writes only to its own mesh, everything else is read only at this point.
+    timer.Reset();
+    std::vector<VertexCacheStats> cacheStats(settings.OptimizeMeshes ? primitives.size() * 2 : 0);
+    std::vector<double> optimizeMs(settings.OptimizeMeshes ? primitives.size() : 0);
+    std::vector<double> weldMs(settings.WeldVertices ? primitives.size() : 0);
+    std::vector<UINT> verticesBeforeWeld(settings.WeldVertices ? primitives.size() : 0);
+    std::vector<double> tangentsMs(primitives.size(), 0.0);
+    std::vector<bool> needsTangents(primitives.size());
+    for (size_t i = 0; i < primitives.size(); ++i)
+    {
+        const auto& attributes = primitives[i].Primitive->attributes;
+        needsTangents[i] = settings.GenerateTangents && attributes.count("TANGENT") == 0;
+        if (needsTangents[i] && (attributes.count("NORMAL") == 0 || attributes.count("TEXCOORD_0") == 0))
+        {
+            LOG("GLTF Warning: a primitive without TANGENT has no NORMAL or TEXCOORD_0 to generate them from");
+            needsTangents[i] = false;
+        }
+    }
+    auto decode = [&](size_t i)
+    {
+        DecodePrimitive(m_meshes[i], document, primitives[i]);
+        if (settings.WeldVertices)
+        {
+            Timer weldTimer;
+            verticesBeforeWeld[i] = UINT(m_meshes[i]->m_vertices.size());
+            WeldMesh(m_meshes[i], settings.WeldEpsilon);
+            weldMs[i] = weldTimer.GetElapsedMs();
+        }
+        // After the weld, so the vertices shared in the source are shared here too and get one smooth tangent.
+        if (needsTangents[i])
+        {
+            Timer tangentsTimer;
+            GenerateMeshTangents(m_meshes[i]);
+            tangentsMs[i] = tangentsTimer.GetElapsedMs();
+        }
+        if (settings.OptimizeMeshes)
+        {
+            Timer optimizeTimer;
+            OptimizeMesh(m_meshes[i], cacheStats[i * 2], cacheStats[i * 2 + 1]);
+            optimizeMs[i] = optimizeTimer.GetElapsedMs();
+        }
+    };
+    if (settings.ParallelDecode)
+        ThreadPool::Get().ParallelFor(primitives.size(), decode);
+    else
+        for (size_t i = 0; i < primitives.size(); ++i)
+            decode(i);
+    m_loadStats.DecodeMs = timer.GetElapsedMs();
+
+    for (size_t i = 0; i < weldMs.size(); ++i)
+    {
+        m_loadStats.WeldMs += weldMs[i];
+        m_loadStats.VerticesBeforeWeld += verticesBeforeWeld[i];
+        m_loadStats.VerticesAfterWeld += m_meshes[i]->m_vertices.size();
+    }
+    if (settings.WeldVertices)
+    {
+        LOG("Model ", path, " vertex welding (", settings.WeldEpsilon > 0.0f ? "epsilon" : "exact", "). Vertices: ", m_loadStats.VerticesBeforeWeld,
+            " -> ", m_loadStats.VerticesAfterWeld, " in ", m_loadStats.WeldMs, "ms");
+    }
+
+    for (size_t i = 0; i < primitives.size(); ++i)
+    {
+        m_loadStats.TangentsMs += tangentsMs[i];
+        m_loadStats.TangentsGeneratedCount += needsTangents[i] ? 1 : 0;
+    }
+    if (m_loadStats.TangentsGeneratedCount > 0)
+        LOG("Model ", path, " generated tangents for ", m_loadStats.TangentsGeneratedCount, " primitives in ", m_loadStats.TangentsMs, "ms");
+
+    for (size_t i = 0; i < optimizeMs.size(); ++i)
+    {
+        m_loadStats.OptimizeMs += optimizeMs[i];
+        m_loadStats.VertexCacheBefore += cacheStats[i * 2];
+        m_loadStats.VertexCacheAfter += cacheStats[i * 2 + 1];
+    }
+    if (settings.OptimizeMeshes)
+    {
+        LOG("Model ", path, " vertex cache optimization. ACMR: ", m_loadStats.VertexCacheBefore.GetAcmr(), " -> ", m_loadStats.VertexCacheAfter.GetAcmr(),
+            " ATVR: ", m_loadStats.VertexCacheBefore.GetAtvr(), " -> ", m_loadStats.VertexCacheAfter.GetAtvr());
+    }
+
+    if (settings.UseMeshCache)
+    {
+        timer.Reset();
+        WriteMeshCache(path, document, settings);
+        m_loadStats.CacheWriteMs = timer.GetElapsedMs();
+    }
 }
 
-Model::Model(RenderContext& ctx, std::vector<Vertex> vertices, std::vector<UINT> indices)
+bool Model::LoadFromCache(const std::string& path, const ModelLoadSettings& settings)
 {
-    m_meshes.emplace_back(new Mesh{});
-    Mesh* sMesh = m_meshes.back();
+    Timer timer;
+    MeshCache* cache = new MeshCache();
+    if (!cache->Open(path, GetProcessingFlags(settings)))
+    {
+        delete cache;
+        return false;
+    }
+    m_meshCache = cache;
+    const MeshCache::ModelData& data = cache->GetData();
+    m_loadStats.ParseMs = timer.GetElapsedMs();
+
+    m_textures = data.Textures;
+    m_materials = data.Materials;
+    timer.Reset();
+    DecodeTextures(path, data.Images, settings);
+    m_loadStats.TexturesMs = timer.GetElapsedMs();
+    m_nodes.Reserve(data.Nodes.size());
+    for (const auto& node : data.Nodes)
+        m_nodes.AddNode(node.Parent, node.Translation, node.Rotation, node.Scale);
+
+    timer.Reset();
+    m_meshes.reserve(data.Meshes.size());
+    for (const auto& meshData : data.Meshes)
+    {
+        Mesh* mesh = new Mesh{};
+        mesh->m_materialIndex = meshData.MaterialIndex;
+        mesh->m_nodeIndex = meshData.NodeIndex;
+        // Nothing is copied, the buffers are uploaded straight from the mapping.
+        mesh->m_cachedVertices = meshData.Vertices;
+        mesh->m_cachedIndices = meshData.Indices;
+        mesh->m_vertexCount = meshData.VertexCount;
+        mesh->m_indexCount = meshData.IndexCount;
+        m_meshes.push_back(mesh);
+    }
+    m_loadStats.DecodeMs = timer.GetElapsedMs();
+    return true;
+}
 
-    sMesh->m_vertices.swap(vertices);
-    sMesh->m_indices.swap(indices);
-    sMesh->m_indexCount = static_cast<UINT>(sMesh->m_indices.size());
+void Model::DecodeTextures(const std::string& path, const std::vector<std::string>& uris, const ModelLoadSettings& settings)
+{
+    std::filesystem::path pathToModel{ path };
+    std::string dir = pathToModel.parent_path().string() + '\\';
+    std::vector<std::string> filenames;
+    filenames.reserve(uris.size());
+    for (const auto& uri : uris)
+    {
+        filenames.push_back(dir + uri);
+        m_images.push_back({ 0, uri, filenames.back() });
+    }
 
-    sMesh->m_vertexBuffer = new VertexBuffer(reinterpret_cast<byte*>(sMesh->m_vertices.data()), static_cast<UINT>(sizeof(Vertex) * sMesh->m_vertices.size()), sizeof(Vertex), ctx.CommandList, ctx.Device);
-    sMesh->m_indexBuffer = new IndexBuffer(reinterpret_cast<byte*>(sMesh->m_indices.data()), static_cast<UINT>(sizeof(UINT) * sMesh->m_indices.size()), ctx.CommandList, ctx.Device, DXGI_FORMAT_R32_UINT);
+    std::vector<ImageProcessing> processing(uris.size());
+    for (auto& imageProcessing : processing)
+    {
+        imageProcessing.GenerateMips = settings.GenerateMips;
+        imageProcessing.Mips.Filter = settings.TextureMipFilter;
+        imageProcessing.Compression = settings.TextureBlockCompression;
+        imageProcessing.UseCache = settings.UseTextureCache;
+    }
+    auto imageOf = [this](int texture) { return texture == -1 ? -1 : m_textures[texture]; };
+    auto addUsage = [&processing, &imageOf](int texture, UINT usage)
+    {
+        if (int image = imageOf(texture); image != -1)
+            processing[image].Usage |= usage;
+    };
+    for (const auto& material : m_materials)
+    {
+        addUsage(material.BaseColorTexture, TextureUsageBaseColor);
+        addUsage(material.NormalTexture, TextureUsageNormal);
+        addUsage(material.MetallicRoughnessTexture, TextureUsageMetallicRoughness);
+        addUsage(material.OcclusionTexture, TextureUsageOcclusion);
+    }
+    // Occlusion and metallic roughness are linear data, i.e. the defaults.
+    for (auto& imageProcessing : processing)
+    {
+        imageProcessing.Mips.Srgb = (imageProcessing.Usage & TextureUsageBaseColor) != 0;
+        imageProcessing.Mips.NormalMap = (imageProcessing.Usage & TextureUsageNormal) != 0;
+    }
+
+    ImageDecodeStats stats;
+    TextureManager::DecodeImages(filenames, m_decodedImages, &stats, settings.ParallelTextureDecode, processing, m_uploadDevice);
+    for (size_t i = 0; i < stats.FileMs.size(); ++i)
+    {
+        m_loadStats.TexturesCpuMs += stats.FileMs[i];
+        m_loadStats.SlowestTextureMs = std::max(m_loadStats.SlowestTextureMs, stats.FileMs[i]);
+        m_loadStats.MipsCpuMs += stats.FileMipsMs[i];
+        m_loadStats.CompressCpuMs += stats.FileCompressMs[i];
+    }
+    m_loadStats.TextureCacheHits = stats.CacheHitsCount;
+    if (stats.FailedCount > 0)
+        LOG("Model ", path, " failed to decode ", stats.FailedCount, " of ", uris.size(), " images");
 }
 
-Model::~Model()
+void Model::CreateTextures(RenderContext& ctx)
 {
-    for (auto submesh : m_meshes)
+    // The pixels are copied to the upload heap right away, or are there already for the cache hits, nothing references the decoded ones after.
+    m_textureManager = ctx.TexManager;
+    UINT sharedBefore = m_textureManager->GetSharingStats().PathHits + m_textureManager->GetSharingStats().ContentHits;
+    for (size_t i = 0; i < m_images.size(); ++i)
     {
-        delete submesh;
+        m_images[i].IndexInHeap = m_textureManager->CreateTexture(ctx, m_decodedImages[i], m_images[i].Path, m_settings.ShareTextures).SRVOffset;
+        TextureManager::ReleaseDecodedImage(m_decodedImages[i]);
     }
-    m_meshes.clear();
+    m_loadStats.SharedTextures = m_textureManager->GetSharingStats().PathHits + m_textureManager->GetSharingStats().ContentHits - sharedBefore;
+    std::vector<DecodedImage>().swap(m_decodedImages);
 }
 
-void Model::UpdateMeshes(UINT frame)
+void Model::WriteMeshCache(const std::string& path, const GltfDocument& document, const ModelLoadSettings& settings)
 {
-    for (auto mesh : m_meshes)
-        mesh->UpdateMaterialBuffer(frame);
+    MeshCache::ModelData data;
+    data.ProcessingFlags = GetProcessingFlags(settings);
+    data.Dependencies = document.GetExternalBufferUris();
+    for (const auto& image : m_images)
+        data.Images.push_back(image.Name);
+    data.Textures = m_textures;
+    data.Materials = m_materials;
+    for (UINT i = 0; i < m_nodes.GetCount(); ++i)
+        data.Nodes.push_back({ m_nodes.GetParent(i), m_nodes.GetTranslation(i), m_nodes.GetRotation(i), m_nodes.GetScale(i) });
+    for (const auto mesh : m_meshes)
+        data.Meshes.push_back({ mesh->m_materialIndex, mesh->m_nodeIndex, mesh->m_vertices.data(), UINT(mesh->m_vertices.size()), mesh->m_indices.data(), mesh->GetIndexCount() });
+
+    if (!MeshCache::Write(path, data))
+        LOG("Failed to write the mesh cache for ", path);
 }
 
-void Model::LoadModel(const std::string& path, tinygltf::Model& model)
+void Model::ParseModelNodes(const tinygltf::Model& model, int nodeIndex, UINT parent, std::vector<PrimitiveRef>& primitives)
 {
-    tinygltf::TinyGLTF loader;
-    std::string err;
-    std::string warn;
+    // Pre-order, so the flattened array is topologically sorted.
+    const tinygltf::Node& node = model.nodes[nodeIndex];
+    UINT flatIndex = 0;
+    if (node.matrix.size() == 16)
+    {
+        // Column major for column vectors is the same memory as row major for row vectors.
+        XMFLOAT4X4 local;
+        for (UINT i = 0; i < 16; ++i)
+            local.m[i / 4][i % 4] = static_cast<float>(node.matrix[i]);
+        flatIndex = m_nodes.AddNode(parent, local);
+    }
+    else
+    {
+        XMFLOAT3 translation = { 0.0f, 0.0f, 0.0f };
+        XMFLOAT4 rotation = { 0.0f, 0.0f, 0.0f, 1.0f };
+        XMFLOAT3 scale = { 1.0f, 1.0f, 1.0f };
+        if (node.translation.size() == 3)
+            translation = { float(node.translation[0]), float(node.translation[1]), float(node.translation[2]) };
+        if (node.rotation.size() == 4)
+            rotation = { float(node.rotation[0]), float(node.rotation[1]), float(node.rotation[2]), float(node.rotation[3]) };
+        if (node.scale.size() == 3)
+            scale = { float(node.scale[0]), float(node.scale[1]), float(node.scale[2]) };
+        flatIndex = m_nodes.AddNode(parent, translation, rotation, scale);
+    }
 
-    bool res = false;
+    if (node.mesh != -1) // Camera usually
+    {
+        for (const auto& primitive : model.meshes[node.mesh].primitives)
+            primitives.push_back({ &primitive, flatIndex });
+    }
+    for (int i : node.children)
+    {
+        ParseModelNodes(model, i, flatIndex, primitives);
+    }
+}
 
-    size_t lastPeriod = path.find_last_of('.');
-    if (lastPeriod == std::string::npos)
-        assert(false);
-    std::string ext = path.substr(lastPeriod);
+void Model::DecodePrimitive(Mesh* mesh, const GltfDocument& document, const PrimitiveRef& primitive)
+{
+    ParseVertices(mesh, document, *primitive.Primitive);
+    ParseIndices(mesh, document, *primitive.Primitive);
+    mesh->m_materialIndex = primitive.Primitive->material;
+    mesh->m_nodeIndex = primitive.NodeIndex;
 
-    if (ext == ".glb")
-        res = loader.LoadBinaryFromFile(&model, &err, &warn, path.c_str());
-    else if (ext == ".gltf")
-        res = loader.LoadASCIIFromFile(&model, &err, &warn, path.c_str());
-    else
-        assert(false);
-    if (!res)
+    mesh->m_indexCount = static_cast<UINT>(mesh->m_indices.size());
+}
+
+void Model::ResolveMaterial(Mesh* mesh)
+{
+    const Material& modelMat = mesh->m_materialIndex == -1 ? DefaultMaterial : m_materials[mesh->m_materialIndex];
+    if (modelMat.BaseColorTexture != -1)
+        mesh->m_material.BaseColorTexture = m_images[m_textures[modelMat.BaseColorTexture]].IndexInHeap;
+    if (modelMat.MetallicRoughnessTexture != -1)
+        mesh->m_material.MetallicRoughnessTexture = m_images[m_textures[modelMat.MetallicRoughnessTexture]].IndexInHeap;
+    if (modelMat.NormalTexture != -1)
+        mesh->m_material.NormalTexture = m_images[m_textures[modelMat.NormalTexture]].IndexInHeap;
+    if (modelMat.OcclusionTexture != -1)
+        mesh->m_material.OcclusionTexture = m_images[m_textures[modelMat.OcclusionTexture]].IndexInHeap;
+    memcpy(mesh->m_material.BaseColorFactor, modelMat.BaseColorFactor, sizeof(float) * 4);
+}
+
+void Model::CreateMeshBuffers(RenderContext& ctx, Mesh* mesh, const ModelLoadSettings& settings)
+{
+    if (settings.UseGeometryPool)
+        mesh->m_pool = ctx.GeoPool;
+    CreateVertexBuffer(ctx, mesh, settings.QuantizeVertices);
+    CreateIndexBuffer(ctx, mesh);
+    mesh->m_materialBuffer = new UploadBuffer(*ctx.Device, sizeof(Material), true, RenderContext::FramesCount);
+    mesh->m_transformBuffer = new UploadBuffer(*ctx.Device, sizeof(XMFLOAT4X4), true, RenderContext::FramesCount);
+}
+
+void Model::CacheMeshInfo(Mesh* mesh)
+{
+    mesh->m_vertexCount = UINT(mesh->GetSourceVertexCount());
+    if (mesh->m_vertexCount == 0)
+        return;
+    const Vertex* vertices = mesh->GetSourceVertices();
+    BoundingBox::CreateFromPoints(mesh->m_bounds, mesh->m_vertexCount, &vertices[0].Pos, sizeof(Vertex));
+    BoundingSphere::CreateFromPoints(mesh->m_sphere, mesh->m_vertexCount, &vertices[0].Pos, sizeof(Vertex));
+}
+
+void Model::ReleaseCpuData(Mesh* mesh, CpuMeshResidency residency)
+{
+    // The buffers copy the data to the upload heap on creation, nothing on the GPU side references these arrays.
+    // The meshes from the mesh cache copy out only what the residency keeps, the mapping is closed after the upload.
+    const Vertex* vertices = mesh->GetSourceVertices();
+    if (residency == CpuMeshResidency::PositionsAndIndices)
     {
-        std::stringstream ss;
-        ss << "Failed to load model " << path << std::endl;
-        OutputDebugStringA(ss.str().c_str());
-        assert(ss.str().c_str() && false);
+        mesh->m_positions.resize(mesh->m_vertexCount);
+        for (size_t i = 0; i < mesh->m_positions.size(); ++i)
+            mesh->m_positions[i] = vertices[i].Pos;
     }
+    if (residency != CpuMeshResidency::Full)
+        std::vector<Vertex>().swap(mesh->m_vertices);
+    else if (mesh->m_cachedVertices != nullptr)
+        mesh->m_vertices.assign(vertices, vertices + mesh->m_vertexCount);
+    if (residency == CpuMeshResidency::None)
+        std::vector<UINT>().swap(mesh->m_indices);
+    else if (mesh->m_cachedIndices != nullptr)
+        mesh->m_indices.assign(mesh->m_cachedIndices, mesh->m_cachedIndices + mesh->m_indexCount);
+    mesh->m_cachedVertices = nullptr;
+    mesh->m_cachedIndices = nullptr;
 }
 
-void Model::ParseModelNodes(RenderContext& ctx, const tinygltf::Model& model, const tinygltf::Node& node)
+void Model::CreateMeshTransformBuffer(RenderContext& ctx)
 {
-    if (node.mesh != -1) // Camera usually
-        ParseGLTFMesh(ctx, model, node, model.meshes[node.mesh]);
-    for (int i : node.children)
+    // One element per mesh instead of per frame. The BLAS reads it only while it's built, so the load time pose is enough.
+    constexpr UINT transform3x4Size = sizeof(float) * 12;
+    m_meshTransforms3x4 = new UploadBuffer(*ctx.Device, transform3x4Size, false, std::max(UINT(m_meshes.size()), 1U));
+    for (UINT i = 0; i < m_meshes.size(); ++i)
     {
-        ParseModelNodes(ctx, model, model.nodes[i]);
+        const Mesh* mesh = m_meshes[i];
+        XMMATRIX transform = XMLoadFloat4x4(&m_nodes.GetWorldTransform(mesh->GetNodeIndex()));
+        if (mesh->HasQuantizedVertices())
+        {
+            // The BLAS reads the UNORM16 positions as [0, 1], the same Min + p * Extent as DequantizeVertex.
+            const QuantizationBounds& bounds = mesh->GetQuantizationBounds();
+            XMMATRIX dequantize = XMMatrixScaling(bounds.Extent[0], bounds.Extent[1], bounds.Extent[2]) * XMMatrixTranslation(bounds.Min[0], bounds.Min[1], bounds.Min[2]);
+            transform = dequantize * transform;
+        }
+        XMFLOAT4X4 transposed;
+        XMStoreFloat4x4(&transposed, XMMatrixTranspose(transform));
+        m_meshTransforms3x4->UploadData(i, reinterpret_cast<const byte*>(&transposed));
     }
 }
 
-void Model::ParseGLTFMesh(RenderContext& ctx, const tinygltf::Model& model, const tinygltf::Node& node, const tinygltf::Mesh& gltfMesh)
+void Model::WeldMesh(Mesh* mesh, float epsilon)
 {
-    for (size_t i = 0; i < gltfMesh.primitives.size(); ++i)
+    std::vector<Vertex>& vertices = mesh->m_vertices;
+    std::vector<UINT> remap(vertices.size());
+    size_t uniqueCount = GenerateVertexRemap(remap.data(), reinterpret_cast<const byte*>(vertices.data()), vertices.size(), sizeof(Vertex), epsilon);
+    if (uniqueCount == vertices.size())
+        return;
+
+    std::vector<Vertex> unique(uniqueCount);
+    RemapVertices(reinterpret_cast<byte*>(unique.data()), reinterpret_cast<const byte*>(vertices.data()), vertices.size(), sizeof(Vertex), remap.data());
+    RemapIndices(mesh->m_indices.data(), mesh->m_indices.data(), mesh->m_indices.size(), remap.data());
+    vertices.swap(unique);
+}
+
+void Model::GenerateMeshTangents(Mesh* mesh)
+{
+    std::vector<Vertex>& vertices = mesh->m_vertices;
+    const byte* base = reinterpret_cast<const byte*>(vertices.data());
+    TangentInput input;
+    input.Positions = base + offsetof(Vertex, Pos);
+    input.Normals = base + offsetof(Vertex, Norm);
+    input.Uvs = base + offsetof(Vertex, Uv);
+    input.Stride = sizeof(Vertex);
+    input.VertexCount = vertices.size();
+
+    std::vector<float> tangents;
+    std::vector<UINT> splitVertices;
+    GenerateTangents(tangents, splitVertices, mesh->m_indices.data(), mesh->m_indices.size(), input);
+
+    for (UINT source : splitVertices)
+        vertices.push_back(vertices[source]);
+    for (size_t v = 0; v < vertices.size(); ++v)
+        vertices[v].Tangent = { tangents[v * 4 + 0], tangents[v * 4 + 1], tangents[v * 4 + 2], tangents[v * 4 + 3] };
+}
+
+void Model::OptimizeMesh(Mesh* mesh, VertexCacheStats& before, VertexCacheStats& after)
+{
+    std::vector<UINT>& indices = mesh->m_indices;
+    std::vector<Vertex>& vertices = mesh->m_vertices;
+    before = AnalyzeVertexCache(indices.data(), indices.size(), vertices.size());
+
+    std::vector<UINT> clusters;
+    std::vector<UINT> tmp(indices.size());
+    OptimizeVertexCache(tmp.data(), indices.data(), indices.size(), vertices.size(), DefaultVertexCacheSize, &clusters);
+    OptimizeOverdraw(indices.data(), tmp.data(), tmp.size(), reinterpret_cast<const byte*>(vertices.data()) + offsetof(Vertex, Pos), sizeof(Vertex), clusters);
+
+    std::vector<Vertex> fetchOrdered(vertices.size());
+    size_t vertexCount = OptimizeVertexFetch(reinterpret_cast<byte*>(fetchOrdered.data()), indices.data(), indices.size(),
+        reinterpret_cast<const byte*>(vertices.data()), vertices.size(), sizeof(Vertex));
+    fetchOrdered.resize(vertexCount);
+    vertices.swap(fetchOrdered);
+
+    after = AnalyzeVertexCache(indices.data(), indices.size(), vertices.size());
+}
+
+void Model::BuildMeshlets(const ModelLoadSettings& settings)
+{
+    Timer timer;
+    auto build = [this](size_t i)
     {
-        m_meshes.push_back(new Mesh{});
-        Mesh* mesh = m_meshes.back();
+        Mesh* mesh = m_meshes[i];
+        DirectxPlayground::BuildMeshlets(mesh->m_meshlets, mesh->GetSourceIndices(), mesh->m_indexCount,
+            reinterpret_cast<const byte*>(mesh->GetSourceVertices()) + offsetof(Vertex, Pos), sizeof(Vertex), mesh->GetSourceVertexCount());
+    };
+    if (settings.ParallelDecode)
+        ThreadPool::Get().ParallelFor(m_meshes.size(), build);
+    else
+        for (size_t i = 0; i < m_meshes.size(); ++i)
+            build(i);
+    m_loadStats.MeshletsMs = timer.GetElapsedMs();
+
+    for (const auto mesh : m_meshes)
+        m_loadStats.MeshletsCount += UINT(mesh->m_meshlets.Meshlets.size());
+    LOG("Built ", m_loadStats.MeshletsCount, " meshlets in ", m_loadStats.MeshletsMs, "ms");
+}
+
+void Model::BuildLods(const ModelLoadSettings& settings)
+{
+    Timer timer;
+    auto build = [&](size_t i) { BuildMeshLods(m_meshes[i], settings); };
+    if (settings.ParallelDecode)
+        ThreadPool::Get().ParallelFor(m_meshes.size(), build);
+    else
+        for (size_t i = 0; i < m_meshes.size(); ++i)
+            build(i);
+    m_loadStats.LodsMs = timer.GetElapsedMs();
+    LOG("Built LODs in ", m_loadStats.LodsMs, "ms");
+}
 
-        tinygltf::Primitive primitive = gltfMesh.primitives[i];
+void Model::BuildMeshLods(Mesh* mesh, const ModelLoadSettings& settings)
+{
+    const byte* positions = reinterpret_cast<const byte*>(mesh->GetSourceVertices()) + offsetof(Vertex, Pos);
+    size_t vertexCount = mesh->GetSourceVertexCount();
+    // The levels go after LOD 0, which needs indices of its own to append to.
+    if (mesh->m_cachedIndices != nullptr)
+    {
+        mesh->m_indices.assign(mesh->m_cachedIndices, mesh->m_cachedIndices + mesh->m_indexCount);
+        mesh->m_cachedIndices = nullptr;
+    }
+    float scale = GetSimplificationScale(positions, sizeof(Vertex), vertexCount);
 
-        ParseVertices(mesh, model, node, primitive);
-        ParseIndices(mesh, model, primitive);
+    mesh->m_lods.clear();
+    mesh->m_lods.push_back({ 0, mesh->m_indexCount, 0.0f });
 
-        mesh->m_indexCount = static_cast<UINT>(mesh->m_indices.size());
+    // Every level is simplified from the previous one, which is much faster than from LOD 0. The errors add up, so each step gets what's left of the budget.
+    std::vector<UINT> lodIndices(mesh->m_indexCount);
+    std::vector<UINT> reordered;
+    float error = 0.0f;
+    for (float targetError : settings.LodErrors)
+    {
+        const MeshLod& source = mesh->m_lods.back();
+        if (targetError <= error)
+            continue;
+        size_t targetIndexCount = size_t(float(source.IndexCount / 3) * settings.LodTriangleRatio) * 3;
+        float reachedError = 0.0f;
+        size_t indexCount = SimplifyMesh(lodIndices.data(), mesh->m_indices.data() + source.StartIndex, source.IndexCount, positions, sizeof(Vertex), vertexCount,
+            targetIndexCount, targetError - error, &reachedError);
+        if (indexCount == 0 || indexCount > size_t(source.IndexCount) * 9 / 10)
+            break; // Can't be simplified any further within the error, more levels would be just the same.
+
+        if (settings.OptimizeMeshes)
+        {
+            reordered.resize(indexCount);
+            OptimizeVertexCache(reordered.data(), lodIndices.data(), indexCount, vertexCount);
+            memcpy(lodIndices.data(), reordered.data(), sizeof(UINT) * indexCount);
+        }
 
-        Material& modelMat = m_materials[primitive.material];
-        if (modelMat.BaseColorTexture != -1)
-            mesh->m_material.BaseColorTexture = m_images[m_textures[modelMat.BaseColorTexture]].IndexInHeap;
-        if (modelMat.MetallicRoughnessTexture != -1)
-            mesh->m_material.MetallicRoughnessTexture = m_images[m_textures[modelMat.MetallicRoughnessTexture]].IndexInHeap;
-        if (modelMat.NormalTexture != -1)
-            mesh->m_material.NormalTexture = m_images[m_textures[modelMat.NormalTexture]].IndexInHeap;
-        if (modelMat.OcclusionTexture != -1)
-            mesh->m_material.OcclusionTexture = m_images[m_textures[modelMat.OcclusionTexture]].IndexInHeap;
-        memcpy(mesh->m_material.BaseColorFactor, modelMat.BaseColorFactor, sizeof(float) * 4);
+        error += reachedError;
+        UINT startIndex = UINT(mesh->m_indices.size());
+        mesh->m_indices.insert(mesh->m_indices.end(), lodIndices.begin(), lodIndices.begin() + indexCount);
+        mesh->m_lods.push_back({ startIndex, UINT(indexCount), error * scale });
+    }
+}
 
-        mesh->m_vertexBuffer = new VertexBuffer(reinterpret_cast<byte*>(mesh->m_vertices.data()), static_cast<UINT>(sizeof(Vertex) * mesh->m_vertices.size()), sizeof(Vertex), ctx.CommandList, ctx.Device);
-        mesh->m_indexBuffer = new IndexBuffer(reinterpret_cast<byte*>(mesh->m_indices.data()), static_cast<UINT>(sizeof(UINT) * mesh->m_indices.size()), ctx.CommandList, ctx.Device, DXGI_FORMAT_R32_UINT);
-        mesh->m_materialBuffer = new UploadBuffer(*ctx.Device, sizeof(Material), true, RenderContext::FramesCount);
+void Model::CreateVertexBuffer(RenderContext& ctx, Mesh* mesh, bool quantize)
+{
+    if (!quantize)
+    {
+        UploadVertices(ctx, mesh, reinterpret_cast<const byte*>(mesh->GetSourceVertices()), sizeof(Vertex));
+        return;
     }
+
+    VertexStreams streams = GetVertexStreams(mesh->GetSourceVertices());
+    if (!mesh->m_quantizationBoundsFromSource)
+        mesh->m_quantizationBounds = ComputeQuantizationBounds(streams.Positions, streams.Stride, mesh->m_vertexCount);
+    std::vector<QuantizedVertex> quantized(mesh->m_vertexCount);
+    QuantizeVertices(quantized.data(), streams, quantized.size(), mesh->m_quantizationBounds);
+    UploadVertices(ctx, mesh, reinterpret_cast<byte*>(quantized.data()), sizeof(QuantizedVertex));
+
+    const QuantizationBounds& bounds = mesh->m_quantizationBounds;
+    XMFLOAT4 boundsData[2] = { { bounds.Min[0], bounds.Min[1], bounds.Min[2], 0.0f }, { bounds.Extent[0], bounds.Extent[1], bounds.Extent[2], 0.0f } };
+    mesh->m_quantizationBuffer = new UploadBuffer(*ctx.Device, sizeof(boundsData), true, 1);
+    mesh->m_quantizationBuffer->UploadData(0, boundsData);
 }
 
-void Model::ParseVertices(Mesh* mesh, const tinygltf::Model& model, const tinygltf::Node& node, const tinygltf::Primitive& primitive)
+void Model::CreateIndexBuffer(RenderContext& ctx, Mesh* mesh)
 {
-    for (auto& attrib : primitive.attributes)
+    // The CPU side keeps 32 bit indices for the geometry passes, the narrowing happens only here.
+    // 0xFFFF is left out so it can never be mistaken for a strip cut.
+    if (mesh->m_vertexCount > 0xFFFF)
+    {
+        UploadIndices(ctx, mesh, reinterpret_cast<const byte*>(mesh->GetSourceIndices()), DXGI_FORMAT_R32_UINT);
+        return;
+    }
+    std::vector<USHORT> indices(mesh->GetSourceIndices(), mesh->GetSourceIndices() + mesh->GetSourceIndexCount());
+    UploadIndices(ctx, mesh, reinterpret_cast<const byte*>(indices.data()), DXGI_FORMAT_R16_UINT);
+}
+
+void Model::UploadVertices(RenderContext& ctx, Mesh* mesh, const byte* vertices, UINT stride)
+{
+    UINT vertexCount = mesh->m_vertexCount;
+    if (mesh->m_pool == nullptr)
+    {
+        mesh->m_vertexBuffer = new VertexBuffer(vertices, stride * vertexCount, stride, ctx.CommandList, ctx.Device);
+        return;
+    }
+    mesh->m_vertexRange = mesh->m_pool->AllocateVertices(stride, vertexCount);
+    mesh->m_pool->Upload(ctx.CommandList, mesh->m_vertexRange, vertices);
+}
+
+void Model::UploadIndices(RenderContext& ctx, Mesh* mesh, const byte* indices, DXGI_FORMAT format)
+{
+    UINT indexCount = UINT(mesh->GetSourceIndexCount());
+    if (mesh->m_pool == nullptr)
     {
-        tinygltf::Accessor accessor = model.accessors[attrib.second];
-        const tinygltf::BufferView& bufferView = model.bufferViews[accessor.bufferView];
+        UINT indexSize = format == DXGI_FORMAT_R16_UINT ? sizeof(USHORT) : sizeof(UINT);
+        mesh->m_indexBuffer = new IndexBuffer(indices, indexSize * indexCount, ctx.CommandList, ctx.Device, format);
+        return;
+    }
+    mesh->m_indexRange = mesh->m_pool->AllocateIndices(format, indexCount);
+    mesh->m_pool->Upload(ctx.CommandList, mesh->m_indexRange, indices);
+}
 
-        const tinygltf::Buffer& buffer = model.buffers[bufferView.buffer];
-        const byte* bufferData = &model.buffers[bufferView.buffer].data.at(0);
-        const byte* bufferStart = bufferData + bufferView.byteOffset + accessor.byteOffset;
+void Model::ParseVertices(Mesh* mesh, const GltfDocument& document, const tinygltf::Primitive& primitive)
+{
+    const tinygltf::Model& model = document.GetModel();
+    for (auto& attrib : primitive.attributes)
+    {
+        const tinygltf::Accessor& accessor = model.accessors[attrib.second];
 
         size_t elemCount = accessor.count;
         if (mesh->m_vertices.empty())
             mesh->m_vertices.resize(elemCount);
         assert(mesh->m_vertices.size() == elemCount);
 
-        // TODO: don't assume the elem length in the buffer. i.e. UV can be more than 2 floats.
-        //uint32 size = 1;
-        //if (accessor.type != TINYGLTF_TYPE_SCALAR)
-        //    size = accessor.type;
-
-        UINT byteStride = accessor.ByteStride(bufferView);
-        XMFLOAT3 scale = { 1.0f, 1.0f, 1.0f };
-        if (node.scale.size() == 3)
-            scale = { static_cast<float>(node.scale[0]), static_cast<float>(node.scale[1]), static_cast<float>(node.scale[2]) };
-
+        byte* vertices = reinterpret_cast<byte*>(mesh->m_vertices.data());
         if (attrib.first.compare("POSITION") == 0)
         {
-            for (size_t i = 0; i < elemCount; ++i)
-            {
-                float x = GetElementFromBuffer<float>(bufferStart, byteStride, i, 0);
-                float y = GetElementFromBuffer<float>(bufferStart, byteStride, i, 4);
-                float z = GetElementFromBuffer<float>(bufferStart, byteStride, i, 8);
-                mesh->m_vertices[i].Pos = { x * scale.x, y * scale.y, z * scale.z }; // For now bake the scale directly in the position
-            }
+            // The node transform stays in the node. For KHR_mesh_quantization it's the dequantization transform, so the integer grid is kept as is.
+            GatherAccessor(document, accessor, vertices + offsetof(Vertex, Pos), sizeof(Vertex), 3);
+            SetSourceQuantizationBounds(mesh, accessor);
         }
         else if (attrib.first.compare("NORMAL") == 0)
         {
-            for (size_t i = 0; i < elemCount; ++i)
-            {
-                float x = GetElementFromBuffer<float>(bufferStart, byteStride, i, 0);
-                float y = GetElementFromBuffer<float>(bufferStart, byteStride, i, 4);
-                float z = GetElementFromBuffer<float>(bufferStart, byteStride, i, 8);
-                mesh->m_vertices[i].Norm = { x, y, z };
-            }
+            GatherAccessor(document, accessor, vertices + offsetof(Vertex, Norm), sizeof(Vertex), 3);
         }
         else if (attrib.first.compare("TEXCOORD_0") == 0)
         {
-            for (size_t i = 0; i < elemCount; ++i)
-            {
-                float u = GetElementFromBuffer<float>(bufferStart, byteStride, i, 0);
-                float v = GetElementFromBuffer<float>(bufferStart, byteStride, i, 4);
-                mesh->m_vertices[i].Uv = { u, v };
-            }
+            float scale[2] = { 1.0f, 1.0f };
+            float offset[2] = { 0.0f, 0.0f };
+            GetTextureTransform(model, primitive.material, scale, offset);
+            GatherAccessor(document, accessor, vertices + offsetof(Vertex, Uv), sizeof(Vertex), 2, scale, offset);
         }
         else if (attrib.first.compare("TANGENT") == 0)
         {
-            for (size_t i = 0; i < elemCount; ++i)
-            {
-                float x = GetElementFromBuffer<float>(bufferStart, byteStride, i, 0);
-                float y = GetElementFromBuffer<float>(bufferStart, byteStride, i, 4);
-                float z = GetElementFromBuffer<float>(bufferStart, byteStride, i, 8);
-                float w = GetElementFromBuffer<float>(bufferStart, byteStride, i, 12);
-                mesh->m_vertices[i].Tangent = { x, y, z, w };
-            }
+            GatherAccessor(document, accessor, vertices + offsetof(Vertex, Tangent), sizeof(Vertex), 4);
         }
         else
         {
@@ -234,28 +841,53 @@ void Model::ParseVertices(Mesh* mesh, const tinygltf::Model& model, const tinygl
     }
 }
 
-void Model::ParseIndices(Mesh* mesh, const tinygltf::Model& model, const tinygltf::Primitive& primitive)
+void Model::SetSourceQuantizationBounds(Mesh* mesh, const tinygltf::Accessor& accessor)
+{
+    // Integer positions (KHR_mesh_quantization) lie on a grid already. If QuantizedVertex uses the same grid the upload is lossless.
+    ComponentType type = static_cast<ComponentType>(accessor.componentType);
+    if (type == ComponentType::Float || type == ComponentType::UnsignedInt || accessor.minValues.size() != 3)
+        return;
+    float normalization = 1.0f;
+    if (accessor.normalized)
+    {
+        const float maxValues[] = { 127.0f, 255.0f, 32767.0f, 65535.0f };
+        normalization = 1.0f / maxValues[accessor.componentType - TINYGLTF_COMPONENT_TYPE_BYTE];
+    }
+    for (UINT c = 0; c < 3; ++c)
+    {
+        float minValue = float(accessor.minValues[c]) * normalization;
+        if (accessor.normalized && minValue < -1.0f)
+            minValue = -1.0f;
+        mesh->m_quantizationBounds.Min[c] = minValue;
+        mesh->m_quantizationBounds.Extent[c] = normalization * 65535.0f;
+    }
+    mesh->m_quantizationBoundsFromSource = true;
+}
+
+void Model::ParseIndices(Mesh* mesh, const GltfDocument& document, const tinygltf::Primitive& primitive)
 {
-    tinygltf::Accessor indexAccessor = model.accessors[primitive.indices];
+    const tinygltf::Model& model = document.GetModel();
+    const tinygltf::Accessor& indexAccessor = model.accessors[primitive.indices];
+    assert(!indexAccessor.sparse.isSparse && indexAccessor.bufferView >= 0 && "Sparse index accessors aren't supported");
     mesh->m_indices.reserve(indexAccessor.count);
 
     const tinygltf::BufferView& indexView = model.bufferViews[indexAccessor.bufferView];
-    const byte* bufferData = &model.buffers[indexView.buffer].data.at(0);
+    const byte* bufferData = document.GetBufferData(indexView.buffer);
     size_t byteOffset = indexView.byteOffset + indexAccessor.byteOffset;
-    size_t byteLength = indexView.byteLength;
 
     UINT byteStride = indexAccessor.ByteStride(indexView);
     const byte* bufferStart = bufferData + byteOffset;
     assert((indexAccessor.count % 3 == 0) && "GLTF index accessor doesn't represent triangles");
-    if (byteStride == 2)
+    // Unsigned, a signed short turns indices above 32767 into garbage.
+    if (indexAccessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT)
     {
         for (size_t i = 0; i < indexAccessor.count; i ++)
         {
-            short i0 = GetElementFromBuffer<short>(bufferStart, byteStride, i + 0);
+            USHORT i0 = GetElementFromBuffer<USHORT>(bufferStart, byteStride, i + 0);
             mesh->m_indices.push_back(i0);
         }
     }
-    else if (byteStride == 4)
+    else if (indexAccessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT)
     {
         for (size_t i = 0; i < indexAccessor.count; i++)
         {
@@ -263,6 +895,11 @@ void Model::ParseIndices(Mesh* mesh, const tinygltf::Model& model, const tinyglt
             mesh->m_indices.push_back(i0);
         }
     }
+    else if (indexAccessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE)
+    {
+        for (size_t i = 0; i < indexAccessor.count; i++)
+            mesh->m_indices.push_back(GetElementFromBuffer<byte>(bufferStart, byteStride, i));
+    }
     else
         assert(false);
 }
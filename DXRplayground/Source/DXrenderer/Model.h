@@ -2,17 +2,29 @@
 
 #include <d3d12.h>
 #include <DirectXMath.h>
+#include <DirectXCollision.h>
+#include <cstddef>
 #include <string>
 #include <vector>
 
+#include "Buffers/GeometryPool.h"
 #include "Buffers/HeapBuffer.h"
 #include "Buffers/UploadBuffer.h"
+#include "Geometry/MeshletBuilder.h"
+#include "Geometry/MeshSimplifier.h"
+#include "Geometry/TangentGenerator.h"
+#include "Geometry/VertexQuantization.h"
+#include "Geometry/VertexWelder.h"
+#include "Geometry/MeshOptimizer.h"
+#include "NodeHierarchy.h"
+#include "Textures/BlockCompression.h"
+#include "Textures/MipGenerator.h"
 #include "Utils/Helpers.h"
 
 namespace tinygltf
 {
+struct Accessor;
 class Model;
-class Node;
 struct Primitive;
 struct Mesh;
 }
@@ -22,7 +34,10 @@ namespace DirectxPlayground
 using namespace DirectX;
 
 struct RenderContext;
+class GltfDocument;
 class TextureManager;
+class MeshCache;
+struct DecodedImage;
 
 struct Vertex
 {
@@ -32,10 +47,23 @@ struct Vertex
     XMFLOAT4 Tangent;
 };
 
+inline VertexStreams GetVertexStreams(const Vertex* vertices)
+{
+    const byte* base = reinterpret_cast<const byte*>(vertices);
+    VertexStreams streams;
+    streams.Positions = base + offsetof(Vertex, Pos);
+    streams.Uvs = base + offsetof(Vertex, Uv);
+    streams.Normals = base + offsetof(Vertex, Norm);
+    streams.Tangents = base + offsetof(Vertex, Tangent);
+    streams.Stride = sizeof(Vertex);
+    return streams;
+}
+
 struct Image
 {
     UINT IndexInHeap = 0;
     std::string Name;
+    std::string Path; // Name next to the model file, what the TextureManager shares the texture by.
 };
 
 struct Material
@@ -47,6 +75,83 @@ struct Material
     float BaseColorFactor[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
 };
 
+struct MeshLod
+{
+    UINT StartIndex = 0; // All the levels live in the mesh index buffer one after another, LOD 0 first.
+    UINT IndexCount = 0;
+    float Error = 0.0f; // Upper bound of the geometric deviation from LOD 0, in the mesh units, i.e. before its node transform.
+};
+
+// Pixels per world unit at distance 1, for Model::Mesh::SelectLod. Multiply by NodeHierarchy::GetWorldScale of the mesh node.
+inline float GetLodProjectionScale(const XMFLOAT4X4& projection, float viewportHeight)
+{
+    return projection(1, 1) * viewportHeight * 0.5f;
+}
+
+enum class CpuMeshResidency
+{
+    Full, // Vertex and index arrays stay, e.g. for the CPU side processing after the load.
+    PositionsAndIndices, // Just what the CPU ray casts and culling need.
+    None, // Everything goes after the upload, the counts and bounds stay.
+};
+
+struct ModelLoadSettings
+{
+    bool ParallelDecode = true; // Decode glTF primitives on the thread pool. GPU buffers are still created in the node order.
+    bool ParallelTextureDecode = true; // Decode the images on the thread pool. Textures are still created in the glTF image order.
+    bool GenerateMips = true; // Full mip chains on the CPU right after the decode. Base color maps are filtered as sRGB, normal maps are renormalized.
+    MipFilter TextureMipFilter = MipFilter::Kaiser;
+    // Block compress the images by what the materials use them as: normal maps to BC5, occlusion only maps to BC4, the rest to BC7 or BC1/BC3.
+    TextureCompression TextureBlockCompression = TextureCompression::Quality;
+    bool UseTextureCache = true; // Take the processed images from the TextureCache, write them there after processing otherwise.
+    bool ShareTextures = true; // Take the textures already created from the same files or content, see TextureManager::CreateTexture.
+    bool MapBuffers = true; // Memory map the .gltf/.glb and .bin files and decode straight from them instead of tinygltf's copies.
+    bool UseMeshCache = true; // Load decoded geometry from the binary mesh cache if it's up to date, write it otherwise.
+    bool WeldVertices = true; // Merge duplicated vertices of every primitive and remap the indices.
+    float WeldEpsilon = 0.0f; // 0 merges only bit identical vertices, otherwise every component is snapped to a grid with this step first.
+    bool GenerateTangents = true; // MikkTSpace style tangents for the primitives without TANGENT. The result goes to the mesh cache.
+    bool OptimizeMeshes = false; // Reorder triangles for the post-transform cache and overdraw, then vertices for the fetch order.
+    bool BuildMeshlets = false; // Split every mesh into meshlets with culling bounds. Runs on the thread pool if ParallelDecode is set.
+    std::vector<float> LodErrors; // One extra LOD per entry with this max error relative to the mesh size, e.g. { 0.002f, 0.01f, 0.04f }.
+    float LodTriangleRatio = 0.5f; // Every LOD aims at this fraction of the previous one's triangles, the error target caps it.
+    bool QuantizeVertices = false; // Upload QuantizedVertex instead of Vertex. Needs GetInputLayoutQuantized and the bounds buffer bound in the shader, raytracing tier 1.1 for the BLAS.
+    CpuMeshResidency CpuResidency = CpuMeshResidency::Full; // What's left of the CPU copies of the meshes after the upload.
+    bool UseGeometryPool = true; // Sub-allocate the vertex and index buffers from RenderContext::GeoPool. Draws must use GetBaseVertex and GetStartIndex.
+};
+
+struct ModelLoadStats
+{
+    double ParseMs = 0.0;
+    double TexturesMs = 0.0; // Reading and decoding the image files. Creating the textures goes to UploadMs.
+    double TexturesCpuMs = 0.0; // The same summed over the files, i.e. what TexturesMs would be with the serial decode.
+    double SlowestTextureMs = 0.0; // The parallel decode can't take less than this.
+    double MipsCpuMs = 0.0; // The part of TexturesCpuMs spent on the mips.
+    double CompressCpuMs = 0.0; // The part of TexturesCpuMs spent on the block compression.
+    UINT TextureCacheHits = 0; // Images taken from the TextureCache as they are.
+    UINT SharedTextures = 0; // Images that got the texture already created for another model or image of this one, see TextureManager::CreateTexture.
+    double DecodeMs = 0.0;
+    double UploadMs = 0.0; // Everything Model::CreateGpuResources does.
+    double CacheWriteMs = 0.0;
+    double WeldMs = 0.0; // Summed over the primitives as OptimizeMs.
+    UINT64 VerticesBeforeWeld = 0; // Filled only when the meshes are welded on this load.
+    UINT64 VerticesAfterWeld = 0;
+    double TangentsMs = 0.0; // Summed over the primitives as OptimizeMs.
+    UINT TangentsGeneratedCount = 0; // Primitives that got generated tangents.
+    double OptimizeMs = 0.0; // Summed over the primitives, so it's the CPU time rather than the wall time with the parallel decode.
+    VertexCacheStats VertexCacheBefore; // Filled only when the meshes are optimized on this load, i.e. not from the cache.
+    VertexCacheStats VertexCacheAfter;
+    double MeshletsMs = 0.0;
+    UINT MeshletsCount = 0;
+    double LodsMs = 0.0;
+    UINT64 GpuGeometryBytes = 0; // Vertex and index buffers as uploaded.
+    UINT64 FullPrecisionGeometryBytes = 0; // The same with Vertex and 32 bit indices.
+    UINT64 ResidentCpuGeometryBytes = 0; // CPU copies left by CpuResidency.
+    UINT PrimitivesCount = 0;
+    UINT NodesCount = 0;
+    bool MappedBuffers = false; // glTF buffers were read from the mapped files, see MapBuffers.
+    bool FromCache = false; // ParseMs is the cache validation and DecodeMs only points the meshes into the mapped file then.
+};
+
 class Model
 {
 public:
@@ -59,35 +164,96 @@ public:
             SafeDelete(m_indexBuffer);
             SafeDelete(m_vertexBuffer);
             SafeDelete(m_materialBuffer);
+            SafeDelete(m_quantizationBuffer);
+            SafeDelete(m_transformBuffer);
+            // The frames in flight may still draw the ranges.
+            if (m_pool != nullptr)
+            {
+                m_pool->FreeDeferred(m_vertexRange);
+                m_pool->FreeDeferred(m_indexRange);
+            }
         }
 
         UINT GetIndexCount() const
         {
-            return UINT(m_indices.size());
+            return m_indexCount;
         }
         UINT GetVertexCount() const
         {
-            return UINT(m_vertices.size());
+            return m_vertexCount;
+        }
+        // Empty unless the model is loaded with CpuMeshResidency::Full. The meshes from the mesh cache fill it only in CreateGpuResources,
+        // they are read straight from the mapped file before.
+        const std::vector<Vertex>& GetVertices() const
+        {
+            return m_vertices;
+        }
+        // Empty with CpuMeshResidency::None. LOD 0 first, then the other levels.
+        const std::vector<UINT>& GetIndices() const
+        {
+            return m_indices;
+        }
+        // GetVertexCount positions with GetPositionStride, nullptr with CpuMeshResidency::None.
+        const byte* GetPositionData() const
+        {
+            if (GetSourceVertexCount() > 0)
+                return reinterpret_cast<const byte*>(GetSourceVertices()) + offsetof(Vertex, Pos);
+            return m_positions.empty() ? nullptr : reinterpret_cast<const byte*>(m_positions.data());
+        }
+        UINT GetPositionStride() const
+        {
+            return GetSourceVertexCount() > 0 ? sizeof(Vertex) : sizeof(XMFLOAT3);
+        }
+        // In the node space, see GetNodeIndex and Model::GetMeshWorldBounds.
+        const BoundingBox& GetBounds() const
+        {
+            return m_bounds;
+        }
+        const BoundingSphere& GetBoundingSphere() const
+        {
+            return m_sphere;
+        }
+        size_t GetResidentCpuBytes() const
+        {
+            return sizeof(Vertex) * m_vertices.capacity() + sizeof(XMFLOAT3) * m_positions.capacity() + sizeof(UINT) * m_indices.capacity();
         }
 
+        // Pooled meshes share the views with the other meshes of the same format, so bind them only when they change.
         const D3D12_VERTEX_BUFFER_VIEW& GetVertexBufferView() const
         {
-            return m_vertexBuffer->GetVertexBufferView();
+            return IsPooled() ? m_pool->GetVertexBufferView(m_vertexRange) : m_vertexBuffer->GetVertexBufferView();
         }
 
         const D3D12_INDEX_BUFFER_VIEW& GetIndexBufferView() const
         {
-            return m_indexBuffer->GetIndexBufferView();
+            return IsPooled() ? m_pool->GetIndexBufferView(m_indexRange) : m_indexBuffer->GetIndexBufferView();
+        }
+
+        // BaseVertexLocation and the StartIndexLocation to add to the LOD start index for the draws.
+        UINT GetBaseVertex() const
+        {
+            return IsPooled() ? m_pool->GetBaseVertex(m_vertexRange) : 0;
         }
 
+        UINT GetStartIndex() const
+        {
+            return IsPooled() ? m_pool->GetStartIndex(m_indexRange) : 0;
+        }
+
+        bool IsPooled() const
+        {
+            return m_pool != nullptr;
+        }
+
+        // Of the mesh data itself, not of the pool block.
         D3D12_GPU_VIRTUAL_ADDRESS GetVertexBufferGpuAddress() const
         {
-            return m_vertexBuffer->GetVertexBuffer()->GetGPUVirtualAddress();
+            return IsPooled() ? m_pool->GetGpuAddress(m_vertexRange) : m_vertexBuffer->GetVertexBuffer()->GetGPUVirtualAddress();
         }
 
         D3D12_GPU_VIRTUAL_ADDRESS GetIndexBufferGpuAddress() const
         {
-            return m_indexBuffer->GetIndexBuffer()->GetGPUVirtualAddress();
+            return IsPooled() ? m_pool->GetGpuAddress(m_indexRange) : m_indexBuffer->GetIndexBuffer()->GetGPUVirtualAddress();
         }
 
         D3D12_GPU_VIRTUAL_ADDRESS GetMaterialBufferGpuAddress(UINT frame) const
@@ -95,14 +261,78 @@ public:
             return m_materialBuffer->GetFrameDataGpuAddress(frame);
         }
 
+        DXGI_FORMAT GetIndexFormat() const
+        {
+            return GetIndexBufferView().Format;
+        }
+
+        bool HasQuantizedVertices() const
+        {
+            return m_quantizationBuffer != nullptr;
+        }
+
+        const QuantizationBounds& GetQuantizationBounds() const
+        {
+            return m_quantizationBounds;
+        }
+
+        // Bounds to dequantize the positions with: float3 Min, float pad, float3 Extent, float pad.
+        D3D12_GPU_VIRTUAL_ADDRESS GetQuantizationBufferGpuAddress() const
+        {
+            return m_quantizationBuffer->GetFrameDataGpuAddress(0);
+        }
+
+        const MeshletData& GetMeshlets() const
+        {
+            return m_meshlets;
+        }
+
+        UINT GetLodCount() const
+        {
+            return UINT(m_lods.size());
+        }
+
+        const MeshLod& GetLod(UINT lod) const
+        {
+            return m_lods[lod];
+        }
+
+        // The coarsest LOD with the error projected to no more than maxPixelError pixels. See GetLodProjectionScale.
+        UINT SelectLod(float distance, float projectionScale, float maxPixelError) const
+        {
+            for (UINT lod = GetLodCount() - 1; lod > 0; --lod)
+            {
+                if (m_lods[lod].Error * projectionScale <= maxPixelError * distance)
+                    return lod;
+            }
+            return 0;
+        }
+
         ID3D12Resource* GetIndexBufferResource() const
         {
-            return m_indexBuffer->GetIndexBuffer();
+            return IsPooled() ? m_pool->GetResource(m_indexRange) : m_indexBuffer->GetIndexBuffer();
         }
 
         ID3D12Resource* GetVertexBufferResource() const
         {
-            return m_vertexBuffer->GetVertexBuffer();
+            return IsPooled() ? m_pool->GetResource(m_vertexRange) : m_vertexBuffer->GetVertexBuffer();
+        }
+
+        UINT GetNodeIndex() const
+        {
+            return m_nodeIndex;
+        }
+
+        // Into the glTF materials, -1 for the default one.
+        int GetMaterialIndex() const
+        {
+            return m_materialIndex;
+        }
+
+        // Transposed mesh to world matrix, i.e. the node world transform times the model one. Updated by Model::UpdateMeshes.
+        D3D12_GPU_VIRTUAL_ADDRESS GetTransformBufferGpuAddress(UINT frame) const
+        {
+            return m_transformBuffer->GetFrameDataGpuAddress(frame);
         }
 
         void UpdateMaterialBuffer(UINT frame)
@@ -113,41 +343,135 @@ public:
     private:
         friend class Model;
 
-        UINT m_indexCount = 0;
+        // The CPU geometry until ReleaseCpuData, from the mapped mesh cache or the own arrays.
+        const Vertex* GetSourceVertices() const
+        {
+            return m_cachedVertices != nullptr ? m_cachedVertices : m_vertices.data();
+        }
+        const UINT* GetSourceIndices() const
+        {
+            return m_cachedIndices != nullptr ? m_cachedIndices : m_indices.data();
+        }
+        size_t GetSourceVertexCount() const
+        {
+            return m_cachedVertices != nullptr ? m_vertexCount : m_vertices.size();
+        }
+        size_t GetSourceIndexCount() const
+        {
+            return m_cachedIndices != nullptr ? m_indexCount : m_indices.size();
+        }
+
+        UINT m_indexCount = 0; // LOD 0 only, m_indices has the other levels after it.
+        int m_materialIndex = -1;
+        UINT m_nodeIndex = 0; // Into Model::m_nodes. The vertices are in the node space, nothing is baked into them.
         Material m_material{};
 
+        UINT m_vertexCount = 0; // Stays valid after the CPU copies are released.
+        BoundingBox m_bounds;
+        BoundingSphere m_sphere;
         std::vector<Vertex> m_vertices;
+        std::vector<XMFLOAT3> m_positions; // Only with CpuMeshResidency::PositionsAndIndices, m_vertices is empty then.
         std::vector<UINT> m_indices;
-
-        VertexBuffer* m_vertexBuffer = nullptr;
+        // Into Model::m_meshCache for the meshes loaded from it, until ReleaseCpuData copies what the residency keeps. m_vertices and m_indices
+        // are empty while these are set, the LODs take their own copy of the indices to append to.
+        const Vertex* m_cachedVertices = nullptr;
+        const UINT* m_cachedIndices = nullptr;
+        MeshletData m_meshlets;
+        std::vector<MeshLod> m_lods;
+
+        VertexBuffer* m_vertexBuffer = nullptr; // Both are null for the pooled meshes.
         IndexBuffer* m_indexBuffer = nullptr;
+        GeometryPool* m_pool = nullptr;
+        GeometryPool::VertexRange m_vertexRange;
+        GeometryPool::IndexRange m_indexRange;
 
         UploadBuffer* m_materialBuffer = nullptr;
+        UploadBuffer* m_transformBuffer = nullptr;
+
+        QuantizationBounds m_quantizationBounds;
+        bool m_quantizationBoundsFromSource = false; // The bounds match the grid of the source integer positions.
+        UploadBuffer* m_quantizationBuffer = nullptr;
     };
 
-    Model(RenderContext& ctx, const std::string& path);
+    Model(RenderContext& ctx, const std::string& path, const ModelLoadSettings& settings = {});
+    // The first half of the one above, see ModelLoader. Reads the files and does all the CPU processing, textures decoding included,
+    // but touches neither the device nor the render context, so it's safe on any thread. Nothing can be drawn before CreateGpuResources.
+    // With an uploadDevice the texture cache hits are read straight to upload buffers created on it, the device is free threaded.
+    Model(const std::string& path, const ModelLoadSettings& settings, ID3D12Device* uploadDevice = nullptr);
     Model(RenderContext& ctx, std::vector<Vertex> vertices, std::vector<UINT> indices);
     ~Model();
 
+    // The second half, on the render thread with ctx.CommandList open: creates the textures and the buffers and records their copies.
+    void CreateGpuResources(RenderContext& ctx);
+    bool HasGpuResources() const;
+
     UINT GetIndexCount() const;
+    const ModelLoadStats& GetLoadStats() const;
 
     const D3D12_VERTEX_BUFFER_VIEW& GetVertexBufferView() const;
     const D3D12_INDEX_BUFFER_VIEW& GetIndexBufferView() const;
 
     const std::vector<Mesh*>& GetMeshes() const;
-    void UpdateMeshes(UINT frame);
+    void UpdateMeshes(UINT frame); // Also recomputes the changed node transforms and uploads the mesh to world matrices.
+
+    void SetTransform(const XMFLOAT4X4& toWorld); // Not transposed, applied after the node transforms.
+    const XMFLOAT4X4& GetTransform() const;
+    NodeHierarchy& GetNodes(); // Change the local transforms here to animate the nodes, the vertex data is never touched.
+    const NodeHierarchy& GetNodes() const;
+    // 3x4 mesh vertex to model transforms of the load time pose in the DXR layout, for D3D12_RAYTRACING_GEOMETRY_TRIANGLES_DESC::Transform3x4.
+    // The node transform of the mesh, after the dequantization for the quantized meshes.
+    D3D12_GPU_VIRTUAL_ADDRESS GetMeshTransform3x4GpuAddress(UINT mesh) const;
+    // The mesh bounds through its node and the model transform, for the culling. The nodes must be updated, see UpdateMeshes.
+    // sphereRadius is around the box center as CullingBounds wants it, the smaller of the sphere around the box and the shifted mesh sphere.
+    void GetMeshWorldBounds(const Mesh* mesh, BoundingBox& box, float& sphereRadius) const;
 
 private:
-    void LoadModel(const std::string& path, tinygltf::Model& model);
-    void ParseModelNodes(RenderContext& ctx, const tinygltf::Model& model, const tinygltf::Node& node);
-    void ParseGLTFMesh(RenderContext& ctx, const tinygltf::Model& model, const tinygltf::Node& node, const tinygltf::Mesh& mesh);
-    void ParseVertices(Mesh* mesh, const tinygltf::Model& model, const tinygltf::Node& node, const tinygltf::Primitive& primitive);
-    void ParseIndices(Mesh* mesh, const tinygltf::Model& model, const tinygltf::Primitive& primitive);
+    struct PrimitiveRef
+    {
+        const tinygltf::Primitive* Primitive = nullptr;
+        UINT NodeIndex = 0;
+    };
 
+    void LoadFromGLTF(const std::string& path, const ModelLoadSettings& settings);
+    bool LoadFromCache(const std::string& path, const ModelLoadSettings& settings);
+    void DecodeTextures(const std::string& path, const std::vector<std::string>& uris, const ModelLoadSettings& settings);
+    void CreateTextures(RenderContext& ctx);
+    void WriteMeshCache(const std::string& path, const GltfDocument& document, const ModelLoadSettings& settings);
+    void ParseModelNodes(const tinygltf::Model& model, int nodeIndex, UINT parent, std::vector<PrimitiveRef>& primitives);
+    void DecodePrimitive(Mesh* mesh, const GltfDocument& document, const PrimitiveRef& primitive);
+    void ParseVertices(Mesh* mesh, const GltfDocument& document, const tinygltf::Primitive& primitive);
+    static void SetSourceQuantizationBounds(Mesh* mesh, const tinygltf::Accessor& accessor);
+    void ParseIndices(Mesh* mesh, const GltfDocument& document, const tinygltf::Primitive& primitive);
+    void WeldMesh(Mesh* mesh, float epsilon);
+    void GenerateMeshTangents(Mesh* mesh);
+    void OptimizeMesh(Mesh* mesh, VertexCacheStats& before, VertexCacheStats& after);
+    void BuildMeshlets(const ModelLoadSettings& settings);
+    void BuildLods(const ModelLoadSettings& settings);
+    void BuildMeshLods(Mesh* mesh, const ModelLoadSettings& settings);
+    void ResolveMaterial(Mesh* mesh);
+    static void CacheMeshInfo(Mesh* mesh);
+    static void ReleaseCpuData(Mesh* mesh, CpuMeshResidency residency);
+    void CreateMeshBuffers(RenderContext& ctx, Mesh* mesh, const ModelLoadSettings& settings);
+    static void CreateVertexBuffer(RenderContext& ctx, Mesh* mesh, bool quantize);
+    static void CreateIndexBuffer(RenderContext& ctx, Mesh* mesh);
+    static void UploadVertices(RenderContext& ctx, Mesh* mesh, const byte* vertices, UINT stride);
+    static void UploadIndices(RenderContext& ctx, Mesh* mesh, const byte* indices, DXGI_FORMAT format);
+    void CreateMeshTransformBuffer(RenderContext& ctx);
+
+    std::string m_path;
+    ModelLoadSettings m_settings;
     std::vector<Mesh*> m_meshes;
-    std::vector<Image> m_images;
+    std::vector<Image> m_images; // IndexInHeap is set by CreateTextures.
+    std::vector<DecodedImage> m_decodedImages; // Of m_images, released to the TextureCache writes once their textures are created.
+    ID3D12Device* m_uploadDevice = nullptr; // Only while the constructor runs, see DecodeTextures.
+    MeshCache* m_meshCache = nullptr; // Mapped from LoadFromCache until CreateGpuResources has uploaded the meshes from it.
+    TextureManager* m_textureManager = nullptr; // The textures are released to it on destruction. Set by CreateTextures.
     std::vector<int> m_textures;
     std::vector<Material> m_materials;
+    NodeHierarchy m_nodes;
+    XMFLOAT4X4 m_transform{ 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f };
+    UploadBuffer* m_meshTransforms3x4 = nullptr;
+    ModelLoadStats m_loadStats{};
 };
 
 inline UINT Model::GetIndexCount() const
@@ -155,6 +479,16 @@ inline UINT Model::GetIndexCount() const
     return m_meshes[0]->GetIndexCount();
 }
 
+inline const ModelLoadStats& Model::GetLoadStats() const
+{
+    return m_loadStats;
+}
+
+inline bool Model::HasGpuResources() const
+{
+    return m_meshTransforms3x4 != nullptr;
+}
+
 inline const D3D12_VERTEX_BUFFER_VIEW& Model::GetVertexBufferView() const
 {
     return m_meshes[0]->GetVertexBufferView();
@@ -169,4 +503,29 @@ inline const std::vector<Model::Mesh*>& Model::GetMeshes() const
 {
     return m_meshes;
 }
+
+inline void Model::SetTransform(const XMFLOAT4X4& toWorld)
+{
+    m_transform = toWorld;
+}
+
+inline const XMFLOAT4X4& Model::GetTransform() const
+{
+    return m_transform;
+}
+
+inline NodeHierarchy& Model::GetNodes()
+{
+    return m_nodes;
+}
+
+inline const NodeHierarchy& Model::GetNodes() const
+{
+    return m_nodes;
+}
+
+inline D3D12_GPU_VIRTUAL_ADDRESS Model::GetMeshTransform3x4GpuAddress(UINT mesh) const
+{
+    return m_meshTransforms3x4->GetFrameDataGpuAddress(mesh);
+}
 }
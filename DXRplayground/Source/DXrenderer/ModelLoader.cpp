@@ -0,0 +1,80 @@
+#include "DXrenderer/ModelLoader.h"
+
+#include <algorithm>
+
+#include "Utils/Helpers.h"
+#include "Utils/Logger.h"
+#include "Utils/ThreadPool.h"
+#include "Utils/Timer.h"
+
+namespace DirectxPlayground
+{
+ModelLoader::ModelLoader(ID3D12Device* device)
+    : m_device(device)
+{
+}
+
+ModelLoader::~ModelLoader()
+{
+    for (auto& request : m_pending)
+    {
+        request->CpuStage.wait();
+        SafeDelete(request->LoadedModel);
+    }
+}
+
+ModelLoadHandle ModelLoader::Load(const std::string& path, const ModelLoadSettings& settings /*= {}*/)
+{
+    auto request = std::make_shared<ModelLoadRequest>();
+    request->Path = path;
+    request->Settings = settings;
+    request->CpuStage = ThreadPool::Get().Submit([this, request]()
+    {
+        Timer timer;
+        // Caught here, the render thread finds out through the queue like for a loaded model.
+        try
+        {
+            request->LoadedModel = new Model(request->Path, request->Settings, m_device);
+        }
+        catch (const std::exception& e)
+        {
+            request->Error = e.what();
+        }
+        catch (...)
+        {
+            request->Error = "Unknown exception";
+        }
+        request->CpuMs = timer.GetElapsedMs();
+        m_cpuFinished.Push(request);
+    });
+    m_pending.push_back(request);
+
+    ModelLoadHandle handle;
+    handle.m_request = request;
+    return handle;
+}
+
+void ModelLoader::Update(RenderContext& ctx, UINT maxModels /*= 1*/)
+{
+    for (UINT i = 0; maxModels == 0 || i < maxModels; ++i)
+    {
+        std::optional<std::shared_ptr<ModelLoadRequest>> finished = m_cpuFinished.Pop();
+        if (!finished)
+            return;
+        ModelLoadRequest& request = **finished;
+        m_pending.erase(std::find(m_pending.begin(), m_pending.end(), *finished));
+        if (request.LoadedModel == nullptr)
+        {
+            request.Failed = true;
+            LOG("Model ", request.Path, " failed to load: ", request.Error);
+            continue;
+        }
+
+        Timer timer;
+        request.LoadedModel->CreateGpuResources(ctx);
+        request.GpuMs = timer.GetElapsedMs();
+        request.Ready = true;
+        LOG("Model ", request.Path, " streamed in. CPU stage: ", request.CpuMs, "ms on a worker, GPU handoff: ", request.GpuMs, "ms on the render thread");
+    }
+}
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "DXrenderer/Model.h"
+#include "Utils/ThreadSafeQueue.h"
+
+namespace DirectxPlayground
+{
+struct RenderContext;
+
+struct ModelLoadRequest
+{
+    std::string Path;
+    ModelLoadSettings Settings;
+    Model* LoadedModel = nullptr; // Created by the CPU stage.
+    std::future<void> CpuStage;
+    std::string Error; // What the CPU stage threw, LoadedModel stays nullptr then.
+    bool Ready = false; // Render thread only.
+    bool Failed = false; // Render thread only.
+    double CpuMs = 0.0; // Wall time of the CPU stage on its worker.
+    double GpuMs = 0.0; // Render thread time of the handoff, see ModelLoader::Update.
+};
+
+// What ModelLoader::Load returns, a future for a model that becomes drawable on the render thread. Query it on that thread only.
+class ModelLoadHandle
+{
+public:
+    bool IsValid() const;
+    // The GPU resources are created and their copies are recorded into the current frame, so the model can be drawn from this frame on.
+    bool IsReady() const;
+    // The CPU stage threw, see ModelLoadRequest::Error. Never becomes ready then.
+    bool IsFailed() const;
+    // nullptr until ready. The caller owns the model then and deletes it as if it created it.
+    Model* Get() const;
+    const ModelLoadRequest* GetRequest() const;
+
+private:
+    friend class ModelLoader;
+
+    std::shared_ptr<ModelLoadRequest> m_request;
+};
+
+// Loads the models in the background. The file reads, the glTF parsing, the geometry processing and the images decode run as
+// a thread pool task (Model's CPU constructor), the finished models are handed to the render thread through a queue and Update
+// only creates their GPU resources and records the copies, i.e. Model::CreateGpuResources. Owned by the RenderPipeline,
+// which calls Update at the frame start, so scenes only Load and poll the handles.
+class ModelLoader
+{
+public:
+    ModelLoader() = default;
+    explicit ModelLoader(ID3D12Device* device); // The texture cache hits are read straight to upload buffers on it then, see Model.
+    ModelLoader(const ModelLoader&) = delete;
+    ModelLoader(ModelLoader&&) = delete;
+    ModelLoader& operator=(const ModelLoader&) = delete;
+    ModelLoader& operator=(ModelLoader&&) = delete;
+    ~ModelLoader(); // Waits for the CPU stages in flight and deletes the models that never got ready.
+
+    ModelLoadHandle Load(const std::string& path, const ModelLoadSettings& settings = {});
+
+    // Render thread, with ctx.CommandList open. Hands over at most maxModels finished models per call to bound the frame hitch, 0 - all of them.
+    void Update(RenderContext& ctx, UINT maxModels = 1);
+
+    size_t GetPendingCount() const; // Neither ready nor failed yet, the CPU stage in flight or waiting for the handoff.
+
+private:
+    ThreadSafeQueue<std::shared_ptr<ModelLoadRequest>> m_cpuFinished;
+    std::vector<std::shared_ptr<ModelLoadRequest>> m_pending;
+    ID3D12Device* m_device = nullptr;
+};
+
+inline bool ModelLoadHandle::IsValid() const
+{
+    return m_request != nullptr;
+}
+
+inline bool ModelLoadHandle::IsReady() const
+{
+    return m_request != nullptr && m_request->Ready;
+}
+
+inline bool ModelLoadHandle::IsFailed() const
+{
+    return m_request != nullptr && m_request->Failed;
+}
+
+inline Model* ModelLoadHandle::Get() const
+{
+    return IsReady() ? m_request->LoadedModel : nullptr;
+}
+
+inline const ModelLoadRequest* ModelLoadHandle::GetRequest() const
+{
+    return m_request.get();
+}
+
+inline size_t ModelLoader::GetPendingCount() const
+{
+    return m_pending.size();
+}
+}
@@ -0,0 +1,81 @@
+#include "DXrenderer/NodeHierarchy.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace DirectxPlayground
+{
+void NodeHierarchy::Reserve(size_t count)
+{
+    m_parents.reserve(count);
+    m_translations.reserve(count);
+    m_rotations.reserve(count);
+    m_scales.reserve(count);
+    m_worldTransforms.reserve(count);
+}
+
+void NodeHierarchy::Clear()
+{
+    m_parents.clear();
+    m_translations.clear();
+    m_rotations.clear();
+    m_scales.clear();
+    m_worldTransforms.clear();
+    m_firstDirty = 0;
+}
+
+UINT NodeHierarchy::AddNode(UINT parent, const XMFLOAT3& translation, const XMFLOAT4& rotation, const XMFLOAT3& scale)
+{
+    UINT node = GetCount();
+    assert((parent == NoParent || parent < node) && "Nodes must be added parents first");
+    m_parents.push_back(parent);
+    m_translations.push_back(translation);
+    m_rotations.push_back(rotation);
+    m_scales.push_back(scale);
+    m_worldTransforms.emplace_back();
+    MarkDirty(node);
+    return node;
+}
+
+UINT NodeHierarchy::AddNode(UINT parent, const XMFLOAT4X4& local)
+{
+    XMVECTOR scale;
+    XMVECTOR rotation;
+    XMVECTOR translation;
+    bool decomposed = XMMatrixDecompose(&scale, &rotation, &translation, XMLoadFloat4x4(&local));
+    assert(decomposed && "Node matrix isn't a TRS");
+    (void)decomposed;
+
+    XMFLOAT3 t;
+    XMFLOAT4 r;
+    XMFLOAT3 s;
+    XMStoreFloat3(&t, translation);
+    XMStoreFloat4(&r, rotation);
+    XMStoreFloat3(&s, scale);
+    return AddNode(parent, t, r, s);
+}
+
+void NodeHierarchy::UpdateWorldTransforms()
+{
+    const UINT count = GetCount();
+    const XMVECTOR origin = XMVectorZero();
+    for (UINT i = m_firstDirty; i < count; ++i)
+    {
+        XMMATRIX local = XMMatrixAffineTransformation(XMLoadFloat3(&m_scales[i]), origin, XMLoadFloat4(&m_rotations[i]), XMLoadFloat3(&m_translations[i]));
+        UINT parent = m_parents[i];
+        if (parent != NoParent)
+            local = XMMatrixMultiply(local, XMLoadFloat4x4(&m_worldTransforms[parent]));
+        XMStoreFloat4x4(&m_worldTransforms[i], local);
+    }
+    m_firstDirty = count;
+}
+
+float NodeHierarchy::GetWorldScale(UINT node) const
+{
+    const XMFLOAT4X4& world = m_worldTransforms[node];
+    float maxScale = 0.0f;
+    for (UINT row = 0; row < 3; ++row)
+        maxScale = std::max(maxScale, XMVectorGetX(XMVector3Length(XMVectorSet(world(row, 0), world(row, 1), world(row, 2), 0.0f))));
+    return maxScale;
+}
+}
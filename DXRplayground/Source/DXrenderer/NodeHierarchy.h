@@ -0,0 +1,111 @@
+#pragma once
+
+#include <windows.h>
+#include <DirectXMath.h>
+#include <vector>
+
+namespace DirectxPlayground
+{
+using namespace DirectX;
+
+// A node tree flattened in topological order: every parent comes before its children. That makes the world transforms a single
+// linear pass where the parent's world matrix is always ready. The local TRS are kept as separate arrays (SoA), so animating
+// one channel doesn't touch the rest. Matrices are row major for row vectors, as everywhere on the CPU side.
+class NodeHierarchy
+{
+public:
+    static constexpr UINT NoParent = UINT(-1);
+
+    void Reserve(size_t count);
+    void Clear();
+
+    // The parent must be added already, that's what keeps the order topological.
+    UINT AddNode(UINT parent, const XMFLOAT3& translation, const XMFLOAT4& rotation, const XMFLOAT3& scale);
+    UINT AddNode(UINT parent, const XMFLOAT4X4& local); // Decomposed to TRS, glTF requires node matrices to be decomposable.
+
+    void SetTranslation(UINT node, const XMFLOAT3& translation);
+    void SetRotation(UINT node, const XMFLOAT4& rotation);
+    void SetScale(UINT node, const XMFLOAT3& scale);
+
+    // Recomputes the world transforms from the first changed node on. Nodes before it can't depend on it.
+    void UpdateWorldTransforms();
+
+    UINT GetCount() const;
+    UINT GetParent(UINT node) const;
+    const XMFLOAT3& GetTranslation(UINT node) const;
+    const XMFLOAT4& GetRotation(UINT node) const;
+    const XMFLOAT3& GetScale(UINT node) const;
+    const XMFLOAT4X4& GetWorldTransform(UINT node) const; // Valid after UpdateWorldTransforms.
+    float GetWorldScale(UINT node) const; // The largest axis scale of the world transform, for the errors measured in the local units.
+    bool IsDirty() const;
+
+private:
+    void MarkDirty(UINT node);
+
+    std::vector<UINT> m_parents;
+    std::vector<XMFLOAT3> m_translations;
+    std::vector<XMFLOAT4> m_rotations;
+    std::vector<XMFLOAT3> m_scales;
+    std::vector<XMFLOAT4X4> m_worldTransforms;
+    UINT m_firstDirty = 0;
+};
+
+inline UINT NodeHierarchy::GetCount() const
+{
+    return UINT(m_parents.size());
+}
+
+inline UINT NodeHierarchy::GetParent(UINT node) const
+{
+    return m_parents[node];
+}
+
+inline const XMFLOAT3& NodeHierarchy::GetTranslation(UINT node) const
+{
+    return m_translations[node];
+}
+
+inline const XMFLOAT4& NodeHierarchy::GetRotation(UINT node) const
+{
+    return m_rotations[node];
+}
+
+inline const XMFLOAT3& NodeHierarchy::GetScale(UINT node) const
+{
+    return m_scales[node];
+}
+
+inline const XMFLOAT4X4& NodeHierarchy::GetWorldTransform(UINT node) const
+{
+    return m_worldTransforms[node];
+}
+
+inline bool NodeHierarchy::IsDirty() const
+{
+    return m_firstDirty < GetCount();
+}
+
+inline void NodeHierarchy::SetTranslation(UINT node, const XMFLOAT3& translation)
+{
+    m_translations[node] = translation;
+    MarkDirty(node);
+}
+
+inline void NodeHierarchy::SetRotation(UINT node, const XMFLOAT4& rotation)
+{
+    m_rotations[node] = rotation;
+    MarkDirty(node);
+}
+
+inline void NodeHierarchy::SetScale(UINT node, const XMFLOAT3& scale)
+{
+    m_scales[node] = scale;
+    MarkDirty(node);
+}
+
+inline void NodeHierarchy::MarkDirty(UINT node)
+{
+    if (node < m_firstDirty)
+        m_firstDirty = node;
+}
+}
@@ -9,6 +9,8 @@ class TextureManager;
 class PsoManager;
 class IRenderPipeline;
 class ImguiTextureManager;
+class GeometryPool;
+class ModelLoader;
 
 struct RenderContext
 {
@@ -32,6 +34,8 @@ struct RenderContext
     TextureManager* TexManager = nullptr;
     ImguiTextureManager* ImguiTexManager = nullptr;
     PsoManager* PsoManager = nullptr;
+    GeometryPool* GeoPool = nullptr;
+    ModelLoader* ModelLoader = nullptr;
 
     IRenderPipeline* Pipeline = nullptr;
 };
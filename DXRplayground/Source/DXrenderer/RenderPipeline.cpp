@@ -8,6 +8,9 @@
 #include "WindowsApp.h"
 
 #include "DXrenderer/DXhelpers.h"
+#include "DXrenderer/Buffers/GeometryPool.h"
+#include "DXrenderer/ModelLoader.h"
+#include "DXrenderer/Textures/TextureCache.h"
 #include "DXrenderer/Textures/TextureManager.h"
 #include "DXrenderer/PsoManager.h"
 #include "DXrenderer/Shader.h"
@@ -22,8 +25,9 @@ using Microsoft::WRL::ComPtr;
 
 RenderPipeline::~RenderPipeline()
 {
-    SafeDelete(m_textureManager);
+    SafeDelete(m_textureManager); // After the scene, its models release their textures on destruction.
     SafeDelete(m_imguiTextureManager);
+    SafeDelete(m_geometryPool); // After the scene, its meshes give the ranges back on destruction.
 }
 
 void RenderPipeline::Init(HWND hwnd, int width, int height, Scene* scene)
@@ -93,6 +97,12 @@ void RenderPipeline::Init(HWND hwnd, int width, int height, Scene* scene)
     m_psoManager = new PsoManager();
     m_context.PsoManager = m_psoManager;
 
+    m_geometryPool = new GeometryPool(m_device.Get());
+    m_context.GeoPool = m_geometryPool;
+
+    m_modelLoader = new ModelLoader(m_device.Get());
+    m_context.ModelLoader = m_modelLoader;
+
     Flush();
     Resize(width, height);
 
@@ -110,6 +120,8 @@ void RenderPipeline::Init(HWND hwnd, int width, int height, Scene* scene)
     m_commandQueue->ExecuteCommandLists(_countof(cmdLists), cmdLists);
 
     Flush(); // 3 flushes in a row...
+    m_geometryPool->ReleaseStaging();
+    m_textureManager->ReleaseUploads();
 }
 
 void RenderPipeline::Flush()
@@ -190,6 +202,7 @@ void RenderPipeline::Render(Scene* scene)
     m_context.CommandList = m_commandList.Get();
 
     m_context.PsoManager->BeginFrame(m_context);
+    m_modelLoader->Update(m_context);
 
     scene->Render(m_context);
 
@@ -211,6 +224,8 @@ void RenderPipeline::Render(Scene* scene)
 
     m_fenceValues[m_swapChain.GetCurrentBackBufferIndex()] = ++m_currentFence;
     m_commandQueue->Signal(m_fence.Get(), m_currentFence);
+    m_geometryPool->RetireStaging(m_currentFence); // Of the models streamed in this frame.
+    m_textureManager->RetireUploads(m_currentFence); // And their textures, with the ones released in this frame.
 
     m_swapChain.ProceedToNextFrame();
 
@@ -226,12 +241,15 @@ void RenderPipeline::Render(Scene* scene)
         WaitForSingleObjectEx(fenceEventHandle, INFINITE, false);
         CloseHandle(fenceEventHandle);
     }
+    m_geometryPool->ReleaseCompletedStaging(m_fence->GetCompletedValue());
+    m_textureManager->ReleaseCompletedUploads(m_fence->GetCompletedValue());
 }
 
 void RenderPipeline::Shutdown()
 {
+    SafeDelete(m_modelLoader); // Waits for the loads in flight.
+    TextureCache::WaitForWrites(); // Their cache writes too, before the statics go.
     m_psoManager->Shutdown();
-    SafeDelete(m_textureManager); // To dtor to safely delete stuff
     SafeDelete(m_psoManager);
     if (m_context.Device != nullptr)
         Flush();
@@ -59,6 +59,8 @@ private:
     Swapchain m_swapChain;
     TextureManager* m_textureManager = nullptr;
     PsoManager* m_psoManager = nullptr;
+    GeometryPool* m_geometryPool = nullptr;
+    ModelLoader* m_modelLoader = nullptr;
 
     ImguiTextureManager* m_imguiTextureManager = nullptr;
 
@@ -0,0 +1,697 @@
+#include "DXrenderer/Textures/BlockCompression.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+#include "Utils/ThreadPool.h"
+
+namespace DirectxPlayground
+{
+namespace
+{
+constexpr UINT RefineIterations = 2;
+constexpr int Bc7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+struct Block
+{
+    byte Texels[16][4];
+};
+
+void LoadBlock(const byte* rgba, UINT width, UINT height, UINT blockX, UINT blockY, Block& block)
+{
+    for (UINT y = 0; y < 4; ++y)
+    {
+        UINT srcY = std::min(blockY * 4 + y, height - 1);
+        for (UINT x = 0; x < 4; ++x)
+        {
+            UINT srcX = std::min(blockX * 4 + x, width - 1);
+            memcpy(block.Texels[y * 4 + x], rgba + (size_t(srcY) * width + srcX) * 4, 4);
+        }
+    }
+}
+
+void StoreBlock(const Block& block, UINT width, UINT height, UINT blockX, UINT blockY, byte* rgba)
+{
+    for (UINT y = 0; y < 4 && blockY * 4 + y < height; ++y)
+        for (UINT x = 0; x < 4 && blockX * 4 + x < width; ++x)
+            memcpy(rgba + (size_t(blockY * 4 + y) * width + blockX * 4 + x) * 4, block.Texels[y * 4 + x], 4);
+}
+
+class BitWriter
+{
+public:
+    explicit BitWriter(byte* out)
+        : m_out(out)
+    {
+        memset(m_out, 0, 16);
+    }
+
+    void Write(UINT value, UINT bits)
+    {
+        for (UINT i = 0; i < bits; ++i, ++m_position)
+            m_out[m_position >> 3] |= byte(((value >> i) & 1) << (m_position & 7));
+    }
+
+private:
+    byte* m_out = nullptr;
+    UINT m_position = 0;
+};
+
+class BitReader
+{
+public:
+    explicit BitReader(const byte* in)
+        : m_in(in)
+    {}
+
+    UINT Read(UINT bits)
+    {
+        UINT res = 0;
+        for (UINT i = 0; i < bits; ++i, ++m_position)
+            res |= UINT((m_in[m_position >> 3] >> (m_position & 7)) & 1) << i;
+        return res;
+    }
+
+private:
+    const byte* m_in = nullptr;
+    UINT m_position = 0;
+};
+
+int Clamp(int value, int low, int high)
+{
+    return std::min(std::max(value, low), high);
+}
+
+// Mean and the principal axis of the first channels components of the block, the line both BC1 and BC7 put their endpoints on.
+void FitLine(const Block& block, UINT channels, float mean[4], float axis[4])
+{
+    for (UINT c = 0; c < 4; ++c)
+        mean[c] = axis[c] = 0.0f;
+    for (UINT i = 0; i < 16; ++i)
+        for (UINT c = 0; c < channels; ++c)
+            mean[c] += block.Texels[i][c];
+    for (UINT c = 0; c < channels; ++c)
+        mean[c] /= 16.0f;
+
+    float covariance[4][4] = {};
+    for (UINT i = 0; i < 16; ++i)
+    {
+        float d[4] = {};
+        for (UINT c = 0; c < channels; ++c)
+            d[c] = block.Texels[i][c] - mean[c];
+        for (UINT a = 0; a < channels; ++a)
+            for (UINT b = 0; b < channels; ++b)
+                covariance[a][b] += d[a] * d[b];
+    }
+
+    // Power iteration, from the diagonal so a single dominant channel is found right away.
+    for (UINT c = 0; c < channels; ++c)
+        axis[c] = covariance[c][c];
+    for (UINT iteration = 0; iteration < 8; ++iteration)
+    {
+        float next[4] = {};
+        for (UINT a = 0; a < channels; ++a)
+            for (UINT b = 0; b < channels; ++b)
+                next[a] += covariance[a][b] * axis[b];
+        float length = 0.0f;
+        for (UINT c = 0; c < channels; ++c)
+            length = std::max(length, std::abs(next[c]));
+        if (length < 1e-6f)
+            break;
+        for (UINT c = 0; c < channels; ++c)
+            axis[c] = next[c] / length;
+    }
+}
+
+// Endpoints at the extremes of the texels projected on the line, clamped to [0, 255].
+void GetLineEndpoints(const Block& block, UINT channels, const float mean[4], const float axis[4], float end0[4], float end1[4])
+{
+    float axisLengthSqr = 0.0f;
+    for (UINT c = 0; c < channels; ++c)
+        axisLengthSqr += axis[c] * axis[c];
+    float minT = 0.0f;
+    float maxT = 0.0f;
+    if (axisLengthSqr > 1e-12f)
+    {
+        minT = 1e30f;
+        maxT = -1e30f;
+        for (UINT i = 0; i < 16; ++i)
+        {
+            float t = 0.0f;
+            for (UINT c = 0; c < channels; ++c)
+                t += (block.Texels[i][c] - mean[c]) * axis[c];
+            t /= axisLengthSqr;
+            minT = std::min(minT, t);
+            maxT = std::max(maxT, t);
+        }
+    }
+    for (UINT c = 0; c < 4; ++c)
+    {
+        end0[c] = c < channels ? std::min(255.0f, std::max(0.0f, mean[c] + axis[c] * maxT)) : 255.0f;
+        end1[c] = c < channels ? std::min(255.0f, std::max(0.0f, mean[c] + axis[c] * minT)) : 255.0f;
+    }
+}
+
+// Least squares endpoints for the given per texel weights of end1, returns false for a degenerate system, i.e. all the texels on one weight.
+bool SolveEndpoints(const Block& block, UINT channels, const float weights[16], float end0[4], float end1[4])
+{
+    float aa = 0.0f;
+    float ab = 0.0f;
+    float bb = 0.0f;
+    float ax[4] = {};
+    float bx[4] = {};
+    for (UINT i = 0; i < 16; ++i)
+    {
+        float b = weights[i];
+        float a = 1.0f - b;
+        aa += a * a;
+        ab += a * b;
+        bb += b * b;
+        for (UINT c = 0; c < channels; ++c)
+        {
+            ax[c] += a * block.Texels[i][c];
+            bx[c] += b * block.Texels[i][c];
+        }
+    }
+    float det = aa * bb - ab * ab;
+    if (std::abs(det) < 1e-6f)
+        return false;
+    for (UINT c = 0; c < channels; ++c)
+    {
+        end0[c] = std::min(255.0f, std::max(0.0f, (bb * ax[c] - ab * bx[c]) / det));
+        end1[c] = std::min(255.0f, std::max(0.0f, (aa * bx[c] - ab * ax[c]) / det));
+    }
+    return true;
+}
+
+// Picks the closest palette entry for every texel, returns the summed squared error.
+UINT SelectIndices(const Block& block, UINT channels, const int palette[][4], UINT paletteSize, UINT indices[16])
+{
+    UINT totalError = 0;
+    for (UINT i = 0; i < 16; ++i)
+    {
+        UINT bestError = ~0U;
+        for (UINT p = 0; p < paletteSize; ++p)
+        {
+            UINT error = 0;
+            for (UINT c = 0; c < channels; ++c)
+            {
+                int d = int(block.Texels[i][c]) - palette[p][c];
+                error += UINT(d * d);
+            }
+            if (error < bestError)
+            {
+                bestError = error;
+                indices[i] = p;
+            }
+        }
+        totalError += bestError;
+    }
+    return totalError;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// BC1 color
+
+UINT PackColor565(const float color[4])
+{
+    UINT r = UINT(Clamp(int(color[0] * 31.0f / 255.0f + 0.5f), 0, 31));
+    UINT g = UINT(Clamp(int(color[1] * 63.0f / 255.0f + 0.5f), 0, 63));
+    UINT b = UINT(Clamp(int(color[2] * 31.0f / 255.0f + 0.5f), 0, 31));
+    return (r << 11) | (g << 5) | b;
+}
+
+void UnpackColor565(UINT packed, int color[4])
+{
+    int r = (packed >> 11) & 31;
+    int g = (packed >> 5) & 63;
+    int b = packed & 31;
+    color[0] = (r << 3) | (r >> 2);
+    color[1] = (g << 2) | (g >> 4);
+    color[2] = (b << 3) | (b >> 2);
+    color[3] = 255;
+}
+
+// Four color mode only, BC1 picks it for color0 > color1 and BC3 always uses it.
+void BuildColorPalette(UINT color0, UINT color1, int palette[4][4])
+{
+    UnpackColor565(color0, palette[0]);
+    UnpackColor565(color1, palette[1]);
+    for (UINT c = 0; c < 4; ++c)
+    {
+        palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+        palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    }
+}
+
+UINT EvaluateColorEndpoints(const Block& block, UINT color0, UINT color1, UINT indices[16])
+{
+    int palette[4][4];
+    BuildColorPalette(color0, color1, palette);
+    return SelectIndices(block, 3, palette, 4, indices);
+}
+
+void EncodeColorBlock(const Block& block, byte* out)
+{
+    constexpr float PaletteWeights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+
+    float mean[4];
+    float axis[4];
+    float end0[4];
+    float end1[4];
+    FitLine(block, 3, mean, axis);
+    GetLineEndpoints(block, 3, mean, axis, end0, end1);
+
+    UINT color0 = PackColor565(end0);
+    UINT color1 = PackColor565(end1);
+    UINT indices[16];
+    UINT error = EvaluateColorEndpoints(block, color0, color1, indices);
+    for (UINT iteration = 0; iteration < RefineIterations && error > 0; ++iteration)
+    {
+        float weights[16];
+        for (UINT i = 0; i < 16; ++i)
+            weights[i] = PaletteWeights[indices[i]];
+        if (!SolveEndpoints(block, 3, weights, end0, end1))
+            break;
+        UINT candidate0 = PackColor565(end0);
+        UINT candidate1 = PackColor565(end1);
+        UINT candidateIndices[16];
+        UINT candidateError = EvaluateColorEndpoints(block, candidate0, candidate1, candidateIndices);
+        if (candidateError >= error)
+            break;
+        color0 = candidate0;
+        color1 = candidate1;
+        error = candidateError;
+        memcpy(indices, candidateIndices, sizeof(indices));
+    }
+
+    // color0 > color1 selects the four color mode in BC1. Equal endpoints give one color, index 0 is the same in both modes.
+    if (color0 < color1)
+    {
+        std::swap(color0, color1);
+        for (UINT& index : indices)
+            index ^= 1;
+    }
+    else if (color0 == color1)
+    {
+        for (UINT& index : indices)
+            index = 0;
+    }
+
+    UINT packedIndices = 0;
+    for (UINT i = 0; i < 16; ++i)
+        packedIndices |= indices[i] << (i * 2);
+    out[0] = byte(color0);
+    out[1] = byte(color0 >> 8);
+    out[2] = byte(color1);
+    out[3] = byte(color1 >> 8);
+    memcpy(out + 4, &packedIndices, 4);
+}
+
+void DecodeColorBlock(const byte* in, bool alwaysFourColors, Block& block)
+{
+    UINT color0 = in[0] | (UINT(in[1]) << 8);
+    UINT color1 = in[2] | (UINT(in[3]) << 8);
+    UINT packedIndices = 0;
+    memcpy(&packedIndices, in + 4, 4);
+
+    int palette[4][4];
+    BuildColorPalette(color0, color1, palette);
+    if (!alwaysFourColors && color0 <= color1)
+    {
+        for (UINT c = 0; c < 3; ++c)
+            palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+        palette[3][0] = palette[3][1] = palette[3][2] = palette[3][3] = 0;
+    }
+    for (UINT i = 0; i < 16; ++i)
+        for (UINT c = 0; c < 4; ++c)
+            block.Texels[i][c] = byte(palette[(packedIndices >> (i * 2)) & 3][c]);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// BC4 single channel, also BC3 alpha and both halves of BC5
+
+void BuildScalarPalette(UINT value0, UINT value1, int palette[8])
+{
+    palette[0] = int(value0);
+    palette[1] = int(value1);
+    if (value0 > value1)
+    {
+        for (int i = 2; i < 8; ++i)
+            palette[i] = ((8 - i) * palette[0] + (i - 1) * palette[1] + 3) / 7;
+    }
+    else
+    {
+        for (int i = 2; i < 6; ++i)
+            palette[i] = ((6 - i) * palette[0] + (i - 1) * palette[1] + 2) / 5;
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+}
+
+UINT EvaluateScalarEndpoints(const byte values[16], UINT value0, UINT value1, UINT indices[16])
+{
+    int palette[8];
+    BuildScalarPalette(value0, value1, palette);
+    UINT totalError = 0;
+    for (UINT i = 0; i < 16; ++i)
+    {
+        UINT bestError = ~0U;
+        for (UINT p = 0; p < 8; ++p)
+        {
+            int d = int(values[i]) - palette[p];
+            if (UINT(d * d) < bestError)
+            {
+                bestError = UINT(d * d);
+                indices[i] = p;
+            }
+        }
+        totalError += bestError;
+    }
+    return totalError;
+}
+
+void EncodeScalarBlock(const byte values[16], byte* out)
+{
+    // The weight of value1 for every index of the eight value mode.
+    constexpr float PaletteWeights[8] = { 0.0f, 1.0f, 1.0f / 7.0f, 2.0f / 7.0f, 3.0f / 7.0f, 4.0f / 7.0f, 5.0f / 7.0f, 6.0f / 7.0f };
+
+    UINT value0 = *std::max_element(values, values + 16);
+    UINT value1 = *std::min_element(values, values + 16);
+    UINT indices[16] = {};
+    UINT error = EvaluateScalarEndpoints(values, value0, value1, indices);
+    for (UINT iteration = 0; iteration < RefineIterations && error > 0; ++iteration)
+    {
+        Block block;
+        float weights[16];
+        for (UINT i = 0; i < 16; ++i)
+        {
+            block.Texels[i][0] = values[i];
+            weights[i] = PaletteWeights[indices[i]];
+        }
+        float end0[4];
+        float end1[4];
+        if (!SolveEndpoints(block, 1, weights, end0, end1))
+            break;
+        UINT candidate0 = UINT(end0[0] + 0.5f);
+        UINT candidate1 = UINT(end1[0] + 0.5f);
+        if (candidate0 <= candidate1)
+            break; // Would switch to the six value mode.
+        UINT candidateIndices[16];
+        UINT candidateError = EvaluateScalarEndpoints(values, candidate0, candidate1, candidateIndices);
+        if (candidateError >= error)
+            break;
+        value0 = candidate0;
+        value1 = candidate1;
+        error = candidateError;
+        memcpy(indices, candidateIndices, sizeof(indices));
+    }
+
+    out[0] = byte(value0);
+    out[1] = byte(value1);
+    UINT64 packedIndices = 0;
+    for (UINT i = 0; i < 16; ++i)
+        packedIndices |= UINT64(indices[i]) << (i * 3);
+    for (UINT i = 0; i < 6; ++i)
+        out[2 + i] = byte(packedIndices >> (i * 8));
+}
+
+void DecodeScalarBlock(const byte* in, Block& block, UINT channel)
+{
+    int palette[8];
+    BuildScalarPalette(in[0], in[1], palette);
+    UINT64 packedIndices = 0;
+    for (UINT i = 0; i < 6; ++i)
+        packedIndices |= UINT64(in[2 + i]) << (i * 8);
+    for (UINT i = 0; i < 16; ++i)
+        block.Texels[i][channel] = byte(palette[(packedIndices >> (i * 3)) & 7]);
+}
+
+void EncodeChannelBlock(const Block& block, UINT channel, byte* out)
+{
+    byte values[16];
+    for (UINT i = 0; i < 16; ++i)
+        values[i] = block.Texels[i][channel];
+    EncodeScalarBlock(values, out);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// BC7 mode 6
+
+struct Bc7Endpoint
+{
+    UINT Color[4] = {}; // 7 bits.
+    UINT PBit = 0;
+};
+
+// Both p-bits are tried, the one closer to the float endpoint wins.
+Bc7Endpoint QuantizeBc7Endpoint(const float value[4])
+{
+    Bc7Endpoint best;
+    float bestError = 1e30f;
+    for (UINT p = 0; p < 2; ++p)
+    {
+        Bc7Endpoint candidate;
+        candidate.PBit = p;
+        float error = 0.0f;
+        for (UINT c = 0; c < 4; ++c)
+        {
+            candidate.Color[c] = UINT(Clamp(int((value[c] - p) * 0.5f + 0.5f), 0, 127));
+            float d = float((candidate.Color[c] << 1) | p) - value[c];
+            error += d * d;
+        }
+        if (error < bestError)
+        {
+            bestError = error;
+            best = candidate;
+        }
+    }
+    return best;
+}
+
+void BuildBc7Palette(const Bc7Endpoint& end0, const Bc7Endpoint& end1, int palette[16][4])
+{
+    for (UINT c = 0; c < 4; ++c)
+    {
+        int e0 = int((end0.Color[c] << 1) | end0.PBit);
+        int e1 = int((end1.Color[c] << 1) | end1.PBit);
+        for (UINT i = 0; i < 16; ++i)
+            palette[i][c] = ((64 - Bc7Weights[i]) * e0 + Bc7Weights[i] * e1 + 32) >> 6;
+    }
+}
+
+UINT EvaluateBc7Endpoints(const Block& block, const Bc7Endpoint& end0, const Bc7Endpoint& end1, UINT indices[16])
+{
+    int palette[16][4];
+    BuildBc7Palette(end0, end1, palette);
+    return SelectIndices(block, 4, palette, 16, indices);
+}
+
+void EncodeBc7Block(const Block& block, byte* out)
+{
+    float mean[4];
+    float axis[4];
+    float endValue0[4];
+    float endValue1[4];
+    FitLine(block, 4, mean, axis);
+    GetLineEndpoints(block, 4, mean, axis, endValue0, endValue1);
+
+    Bc7Endpoint end0 = QuantizeBc7Endpoint(endValue0);
+    Bc7Endpoint end1 = QuantizeBc7Endpoint(endValue1);
+    UINT indices[16];
+    UINT error = EvaluateBc7Endpoints(block, end0, end1, indices);
+    for (UINT iteration = 0; iteration < RefineIterations && error > 0; ++iteration)
+    {
+        float weights[16];
+        for (UINT i = 0; i < 16; ++i)
+            weights[i] = Bc7Weights[indices[i]] / 64.0f;
+        if (!SolveEndpoints(block, 4, weights, endValue0, endValue1))
+            break;
+        Bc7Endpoint candidate0 = QuantizeBc7Endpoint(endValue0);
+        Bc7Endpoint candidate1 = QuantizeBc7Endpoint(endValue1);
+        UINT candidateIndices[16];
+        UINT candidateError = EvaluateBc7Endpoints(block, candidate0, candidate1, candidateIndices);
+        if (candidateError >= error)
+            break;
+        end0 = candidate0;
+        end1 = candidate1;
+        error = candidateError;
+        memcpy(indices, candidateIndices, sizeof(indices));
+    }
+
+    // The top bit of the first index is implied 0.
+    if (indices[0] & 8)
+    {
+        std::swap(end0, end1);
+        for (UINT& index : indices)
+            index = 15 - index;
+    }
+
+    BitWriter writer(out);
+    writer.Write(1 << 6, 7);
+    for (UINT c = 0; c < 4; ++c)
+    {
+        writer.Write(end0.Color[c], 7);
+        writer.Write(end1.Color[c], 7);
+    }
+    writer.Write(end0.PBit, 1);
+    writer.Write(end1.PBit, 1);
+    writer.Write(indices[0], 3);
+    for (UINT i = 1; i < 16; ++i)
+        writer.Write(indices[i], 4);
+}
+
+// Mode 6 only, the other modes decode as magenta.
+void DecodeBc7Block(const byte* in, Block& block)
+{
+    BitReader reader(in);
+    if (reader.Read(7) != (1 << 6))
+    {
+        for (UINT i = 0; i < 16; ++i)
+        {
+            block.Texels[i][0] = block.Texels[i][2] = block.Texels[i][3] = 255;
+            block.Texels[i][1] = 0;
+        }
+        return;
+    }
+    Bc7Endpoint end0;
+    Bc7Endpoint end1;
+    for (UINT c = 0; c < 4; ++c)
+    {
+        end0.Color[c] = reader.Read(7);
+        end1.Color[c] = reader.Read(7);
+    }
+    end0.PBit = reader.Read(1);
+    end1.PBit = reader.Read(1);
+    int palette[16][4];
+    BuildBc7Palette(end0, end1, palette);
+    for (UINT i = 0; i < 16; ++i)
+    {
+        UINT index = reader.Read(i == 0 ? 3 : 4);
+        for (UINT c = 0; c < 4; ++c)
+            block.Texels[i][c] = byte(palette[index][c]);
+    }
+}
+
+void EncodeBlock(const Block& block, BlockFormat format, byte* out)
+{
+    switch (format)
+    {
+    case BlockFormat::BC1:
+        EncodeColorBlock(block, out);
+        break;
+    case BlockFormat::BC3:
+        EncodeChannelBlock(block, 3, out);
+        EncodeColorBlock(block, out + 8);
+        break;
+    case BlockFormat::BC4:
+        EncodeChannelBlock(block, 0, out);
+        break;
+    case BlockFormat::BC5:
+        EncodeChannelBlock(block, 0, out);
+        EncodeChannelBlock(block, 1, out + 8);
+        break;
+    case BlockFormat::BC7:
+        EncodeBc7Block(block, out);
+        break;
+    }
+}
+
+void DecodeBlock(const byte* in, BlockFormat format, Block& block)
+{
+    memset(&block, 0, sizeof(block));
+    for (UINT i = 0; i < 16; ++i)
+        block.Texels[i][3] = 255;
+    switch (format)
+    {
+    case BlockFormat::BC1:
+        DecodeColorBlock(in, false, block);
+        break;
+    case BlockFormat::BC3:
+        DecodeColorBlock(in + 8, true, block);
+        DecodeScalarBlock(in, block, 3);
+        break;
+    case BlockFormat::BC4:
+        DecodeScalarBlock(in, block, 0);
+        break;
+    case BlockFormat::BC5:
+        DecodeScalarBlock(in, block, 0);
+        DecodeScalarBlock(in + 8, block, 1);
+        break;
+    case BlockFormat::BC7:
+        DecodeBc7Block(in, block);
+        break;
+    }
+}
+}
+
+UINT GetBlockBytes(BlockFormat format)
+{
+    return format == BlockFormat::BC1 || format == BlockFormat::BC4 ? 8 : 16;
+}
+
+size_t GetCompressedSize(UINT width, UINT height, BlockFormat format)
+{
+    return size_t((width + 3) / 4) * ((height + 3) / 4) * GetBlockBytes(format);
+}
+
+void CompressImage(const byte* rgba, UINT width, UINT height, BlockFormat format, byte* blocks, bool parallel /*= true*/)
+{
+    assert(width > 0 && height > 0);
+    UINT blocksX = (width + 3) / 4;
+    UINT blocksY = (height + 3) / 4;
+    size_t rowBytes = size_t(blocksX) * GetBlockBytes(format);
+
+    auto compressRow = [&](size_t blockY)
+    {
+        byte* out = blocks + blockY * rowBytes;
+        for (UINT blockX = 0; blockX < blocksX; ++blockX, out += GetBlockBytes(format))
+        {
+            Block block;
+            LoadBlock(rgba, width, height, blockX, UINT(blockY), block);
+            EncodeBlock(block, format, out);
+        }
+    };
+    if (parallel && blocksY > 1)
+        ThreadPool::Get().ParallelFor(blocksY, compressRow);
+    else
+        for (size_t blockY = 0; blockY < blocksY; ++blockY)
+            compressRow(blockY);
+}
+
+void DecompressImage(const byte* blocks, UINT width, UINT height, BlockFormat format, byte* rgba)
+{
+    UINT blocksX = (width + 3) / 4;
+    UINT blocksY = (height + 3) / 4;
+    for (UINT blockY = 0; blockY < blocksY; ++blockY)
+    {
+        for (UINT blockX = 0; blockX < blocksX; ++blockX, blocks += GetBlockBytes(format))
+        {
+            Block block;
+            DecodeBlock(blocks, format, block);
+            StoreBlock(block, width, height, blockX, blockY, rgba);
+        }
+    }
+}
+
+double ComputePsnr(const byte* rgbaA, const byte* rgbaB, UINT width, UINT height, UINT channelsCount /*= 4*/)
+{
+    assert(channelsCount >= 1 && channelsCount <= 4);
+    UINT64 errorSum = 0;
+    size_t texelsCount = size_t(width) * height;
+    for (size_t i = 0; i < texelsCount; ++i)
+    {
+        for (UINT c = 0; c < channelsCount; ++c)
+        {
+            int d = int(rgbaA[i * 4 + c]) - int(rgbaB[i * 4 + c]);
+            errorSum += UINT64(d * d);
+        }
+    }
+    if (errorSum == 0)
+        return 100.0;
+    double mse = double(errorSum) / (double(texelsCount) * channelsCount);
+    return 10.0 * std::log10(255.0 * 255.0 / mse);
+}
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <windows.h>
+
+namespace DirectxPlayground
+{
+enum class BlockFormat
+{
+    BC1, // RGB, 4 bits per texel. Two 565 endpoints and 4 colors per block, no alpha.
+    BC3, // BC1 color and BC4 alpha, 8 bits per texel.
+    BC4, // R only, 4 bits per texel. Two 8 bit endpoints and 8 values per block.
+    BC5, // R and G as two BC4 blocks, 8 bits per texel. Normal maps, z is reconstructed in the shader.
+    BC7 // RGBA, 8 bits per texel. Encoded in mode 6 only: one 7777 + p-bit endpoint pair and 16 levels per block.
+};
+
+// How the textures are compressed by their usage, see TextureManager::ChooseBlockFormat.
+enum class TextureCompression
+{
+    None,
+    Fast, // BC1 for the color (BC3 with alpha) and metallic roughness.
+    Quality, // BC7 for the color and metallic roughness.
+};
+
+UINT GetBlockBytes(BlockFormat format); // 8 or 16.
+size_t GetCompressedSize(UINT width, UINT height, BlockFormat format); // The partial blocks at the edges count as whole ones.
+
+// rgba is a tightly packed R8G8B8A8 image of any size, blocks gets ((width + 3) / 4) x ((height + 3) / 4) blocks row by row. The partial blocks
+// at the right and bottom edges repeat the last column and row. BC4 takes R, BC5 R and G. The block rows are handed out to the thread pool
+// in parallel, every block is encoded by the same code either way, so the output doesn't depend on it.
+void CompressImage(const byte* rgba, UINT width, UINT height, BlockFormat format, byte* blocks, bool parallel = true);
+// The reverse, for the error measurements. BC4 leaves G and B at 0 and A at 255, BC5 B at 0 and A at 255, BC1 A at 255.
+void DecompressImage(const byte* blocks, UINT width, UINT height, BlockFormat format, byte* rgba);
+
+// Over the first channelsCount components of every texel of two R8G8B8A8 images, in dB. 100 for identical ones.
+double ComputePsnr(const byte* rgbaA, const byte* rgbaB, UINT width, UINT height, UINT channelsCount = 4);
+}
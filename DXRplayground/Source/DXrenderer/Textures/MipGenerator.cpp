@@ -0,0 +1,372 @@
+#include "DXrenderer/Textures/MipGenerator.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+namespace DirectxPlayground
+{
+namespace
+{
+constexpr double Pi = 3.14159265358979323846;
+constexpr double KaiserAlpha = 4.0;
+constexpr UINT LinearToSrgbTableSize = 16384; // Fine enough for the darkest 8 bit sRGB steps.
+
+struct SrgbTables
+{
+    float ToLinear[256];
+    byte FromLinear[LinearToSrgbTableSize];
+};
+
+SrgbTables BuildSrgbTables()
+{
+    SrgbTables res;
+    for (UINT i = 0; i < 256; ++i)
+    {
+        double c = i / 255.0;
+        res.ToLinear[i] = float(c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4));
+    }
+    for (UINT i = 0; i < LinearToSrgbTableSize; ++i)
+    {
+        double l = double(i) / (LinearToSrgbTableSize - 1);
+        double c = l <= 0.0031308 ? l * 12.92 : 1.055 * std::pow(l, 1.0 / 2.4) - 0.055;
+        res.FromLinear[i] = byte(std::min(255.0, c * 255.0 + 0.5));
+    }
+    return res;
+}
+
+const SrgbTables& GetSrgbTables()
+{
+    static const SrgbTables tables = BuildSrgbTables();
+    return tables;
+}
+
+double Sinc(double x)
+{
+    if (std::abs(x) < 1e-9)
+        return 1.0;
+    x *= Pi;
+    return std::sin(x) / x;
+}
+
+double BesselI0(double x)
+{
+    // The power series converges fast for the small arguments of the window.
+    double sum = 1.0;
+    double term = 1.0;
+    double halfX = x * 0.5;
+    for (int k = 1; k < 64 && term > sum * 1e-12; ++k)
+    {
+        term *= (halfX / k) * (halfX / k);
+        sum += term;
+    }
+    return sum;
+}
+
+double GetFilterRadius(MipFilter filter)
+{
+    return filter == MipFilter::Box ? 0.5 : 3.0;
+}
+
+// t is in the destination texels.
+double EvaluateFilter(MipFilter filter, double t)
+{
+    double radius = GetFilterRadius(filter);
+    double absT = std::abs(t);
+    if (filter == MipFilter::Box)
+        return absT < radius ? 1.0 : (absT == radius ? 0.5 : 0.0);
+    if (absT >= radius)
+        return 0.0;
+    if (filter == MipFilter::Kaiser)
+    {
+        double r = t / radius;
+        return Sinc(t) * BesselI0(KaiserAlpha * std::sqrt(1.0 - r * r)) / BesselI0(KaiserAlpha);
+    }
+    return Sinc(t) * Sinc(t / radius);
+}
+
+// The source texels and the normalized weights of every destination texel along one axis, Count of them per texel.
+struct FilterTaps
+{
+    UINT Count = 0;
+    std::vector<UINT> Indices;
+    std::vector<float> Weights;
+};
+
+FilterTaps BuildTaps(MipFilter filter, UINT srcSize, UINT dstSize, bool wrap)
+{
+    double scale = double(srcSize) / double(dstSize);
+    double support = GetFilterRadius(filter) * scale;
+
+    FilterTaps res;
+    res.Count = UINT(std::ceil(support * 2.0)) + 1;
+    res.Indices.resize(size_t(res.Count) * dstSize);
+    res.Weights.resize(size_t(res.Count) * dstSize);
+    std::vector<double> weights(res.Count);
+    for (UINT x = 0; x < dstSize; ++x)
+    {
+        double center = (x + 0.5) * scale - 0.5; // In the source texel indices.
+        int first = int(std::ceil(center - support));
+        double sum = 0.0;
+        for (UINT k = 0; k < res.Count; ++k)
+        {
+            weights[k] = EvaluateFilter(filter, (first + int(k) - center) / scale);
+            sum += weights[k];
+        }
+        for (UINT k = 0; k < res.Count; ++k)
+        {
+            int index = first + int(k);
+            if (wrap)
+                index = ((index % int(srcSize)) + int(srcSize)) % int(srcSize);
+            else
+                index = std::clamp(index, 0, int(srcSize) - 1);
+            res.Indices[size_t(x) * res.Count + k] = UINT(index);
+            res.Weights[size_t(x) * res.Count + k] = float(weights[k] / sum);
+        }
+    }
+    return res;
+}
+
+void DecodeLevel(const byte* src, size_t pixelsCount, UINT channels, MipPixelType type, const MipSettings& settings, float* dst)
+{
+    if (type == MipPixelType::Float32)
+    {
+        memcpy(dst, src, pixelsCount * channels * sizeof(float));
+        return;
+    }
+    const SrgbTables& tables = GetSrgbTables();
+    float toFloat[4][256];
+    for (UINT channel = 0; channel < channels; ++channel)
+    {
+        for (UINT v = 0; v < 256; ++v)
+        {
+            if (settings.NormalMap && channel < 3)
+                toFloat[channel][v] = v / 255.0f * 2.0f - 1.0f;
+            else if (settings.Srgb && channel < 3)
+                toFloat[channel][v] = tables.ToLinear[v];
+            else
+                toFloat[channel][v] = v / 255.0f;
+        }
+    }
+    for (size_t p = 0; p < pixelsCount; ++p)
+    {
+        for (UINT channel = 0; channel < channels; ++channel)
+            dst[p * channels + channel] = toFloat[channel][src[p * channels + channel]];
+    }
+}
+
+// Clamps the filters overshoot and renormalizes the normals. The result is also the source of the next level.
+void ResolveLevel(float* pixels, size_t pixelsCount, UINT channels, MipPixelType type, const MipSettings& settings)
+{
+    for (size_t p = 0; p < pixelsCount; ++p)
+    {
+        float* pixel = pixels + p * channels;
+        UINT channel = 0;
+        if (settings.NormalMap)
+        {
+            float x = std::clamp(pixel[0], -1.0f, 1.0f);
+            float y = std::clamp(pixel[1], -1.0f, 1.0f);
+            float z = std::clamp(pixel[2], -1.0f, 1.0f);
+            float length = std::sqrt(x * x + y * y + z * z);
+            if (length > 1e-6f)
+            {
+                pixel[0] = x / length;
+                pixel[1] = y / length;
+                pixel[2] = z / length;
+            }
+            else
+            {
+                pixel[0] = 0.0f;
+                pixel[1] = 0.0f;
+                pixel[2] = 1.0f;
+            }
+            channel = 3;
+        }
+        for (; channel < channels; ++channel)
+            pixel[channel] = type == MipPixelType::UNorm8 ? std::clamp(pixel[channel], 0.0f, 1.0f) : std::max(pixel[channel], 0.0f);
+    }
+}
+
+void EncodeLevel(const float* src, size_t pixelsCount, UINT channels, MipPixelType type, const MipSettings& settings, byte* dst)
+{
+    if (type == MipPixelType::Float32)
+    {
+        memcpy(dst, src, pixelsCount * channels * sizeof(float));
+        return;
+    }
+    const SrgbTables& tables = GetSrgbTables();
+    for (UINT channel = 0; channel < channels; ++channel)
+    {
+        const float* in = src + channel;
+        byte* out = dst + channel;
+        if (settings.NormalMap && channel < 3)
+        {
+            for (size_t p = 0; p < pixelsCount; ++p)
+                out[p * channels] = byte((in[p * channels] * 0.5f + 0.5f) * 255.0f + 0.5f);
+        }
+        else if (settings.Srgb && channel < 3)
+        {
+            for (size_t p = 0; p < pixelsCount; ++p)
+                out[p * channels] = tables.FromLinear[UINT(in[p * channels] * (LinearToSrgbTableSize - 1) + 0.5f)];
+        }
+        else
+        {
+            for (size_t p = 0; p < pixelsCount; ++p)
+                out[p * channels] = byte(in[p * channels] * 255.0f + 0.5f);
+        }
+    }
+}
+
+void FilterPixelScalar(const float* row, UINT channels, const UINT* indices, const float* weights, UINT tapsCount, float* dst)
+{
+    for (UINT c = 0; c < channels; ++c)
+    {
+        float acc = 0.0f;
+        for (UINT k = 0; k < tapsCount; ++k)
+            acc = acc + weights[k] * row[size_t(indices[k]) * channels + c];
+        dst[c] = acc;
+    }
+}
+
+SIMD_TARGET_SSE41 void FilterPixelRgbaSSE(const float* row, const UINT* indices, const float* weights, UINT tapsCount, float* dst)
+{
+    __m128 acc = _mm_setzero_ps();
+    for (UINT k = 0; k < tapsCount; ++k)
+        acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(weights[k]), _mm_loadu_ps(row + size_t(indices[k]) * 4)));
+    _mm_storeu_ps(dst, acc);
+}
+
+// Every destination texel of a row gathers its own taps, RGBA texels are filtered as one SSE vector.
+void FilterHorizontal(const float* src, UINT srcWidth, UINT height, UINT channels, const FilterTaps& taps, UINT dstWidth, float* dst, SimdLevel level)
+{
+    bool rgbaSimd = channels == 4 && level != SimdLevel::Scalar;
+    for (UINT y = 0; y < height; ++y)
+    {
+        const float* row = src + size_t(y) * srcWidth * channels;
+        float* out = dst + size_t(y) * dstWidth * channels;
+        for (UINT x = 0; x < dstWidth; ++x)
+        {
+            const UINT* indices = &taps.Indices[size_t(x) * taps.Count];
+            const float* weights = &taps.Weights[size_t(x) * taps.Count];
+            if (rgbaSimd)
+                FilterPixelRgbaSSE(row, indices, weights, taps.Count, out + size_t(x) * 4);
+            else
+                FilterPixelScalar(row, channels, indices, weights, taps.Count, out + size_t(x) * channels);
+        }
+    }
+}
+
+void FilterRowScalar(const float* const* rows, const float* weights, UINT tapsCount, size_t begin, size_t end, float* dst)
+{
+    for (size_t i = begin; i < end; ++i)
+    {
+        float acc = 0.0f;
+        for (UINT k = 0; k < tapsCount; ++k)
+            acc = acc + weights[k] * rows[k][i];
+        dst[i] = acc;
+    }
+}
+
+SIMD_TARGET_SSE41 void FilterRowSSE(const float* const* rows, const float* weights, UINT tapsCount, size_t count, float* dst)
+{
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 acc = _mm_setzero_ps();
+        for (UINT k = 0; k < tapsCount; ++k)
+            acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(weights[k]), _mm_loadu_ps(rows[k] + i)));
+        _mm_storeu_ps(dst + i, acc);
+    }
+    FilterRowScalar(rows, weights, tapsCount, i, count, dst);
+}
+
+SIMD_TARGET_AVX2 void FilterRowAVX2(const float* const* rows, const float* weights, UINT tapsCount, size_t count, float* dst)
+{
+    // No FMA, so the result matches the other levels bit for bit.
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256 acc = _mm256_setzero_ps();
+        for (UINT k = 0; k < tapsCount; ++k)
+            acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_set1_ps(weights[k]), _mm256_loadu_ps(rows[k] + i)));
+        _mm256_storeu_ps(dst + i, acc);
+    }
+    FilterRowScalar(rows, weights, tapsCount, i, count, dst);
+}
+
+// Every destination row is a weighted sum of whole source rows, so it runs across the row with the widest SIMD.
+void FilterVertical(const float* src, size_t rowLength, const FilterTaps& taps, UINT dstHeight, float* dst, SimdLevel level)
+{
+    std::vector<const float*> rows(taps.Count);
+    for (UINT y = 0; y < dstHeight; ++y)
+    {
+        for (UINT k = 0; k < taps.Count; ++k)
+            rows[k] = src + size_t(taps.Indices[size_t(y) * taps.Count + k]) * rowLength;
+        const float* weights = &taps.Weights[size_t(y) * taps.Count];
+        float* out = dst + size_t(y) * rowLength;
+        switch (level)
+        {
+        case SimdLevel::AVX2:
+            FilterRowAVX2(rows.data(), weights, taps.Count, rowLength, out);
+            break;
+        case SimdLevel::SSE41:
+            FilterRowSSE(rows.data(), weights, taps.Count, rowLength, out);
+            break;
+        default:
+            FilterRowScalar(rows.data(), weights, taps.Count, 0, rowLength, out);
+            break;
+        }
+    }
+}
+}
+
+UINT GetMipLevelsCount(UINT width, UINT height)
+{
+    UINT count = 1;
+    for (UINT size = std::max(width, height); size > 1; size /= 2)
+        ++count;
+    return count;
+}
+
+void GenerateMips(std::vector<byte>& data, UINT width, UINT height, UINT channels, MipPixelType type, const MipSettings& settings,
+    std::vector<MipLevelDesc>& levels, SimdLevel level /*= GetSimdLevel()*/)
+{
+    assert(channels >= 1 && channels <= 4);
+    assert(!settings.NormalMap || channels >= 3);
+    UINT pixelSize = channels * (type == MipPixelType::UNorm8 ? 1 : sizeof(float));
+    assert(data.size() >= size_t(width) * height * pixelSize);
+
+    levels.clear();
+    size_t offset = 0;
+    for (UINT i = 0, w = width, h = height; i < GetMipLevelsCount(width, height); ++i, w = std::max(w / 2, 1U), h = std::max(h / 2, 1U))
+    {
+        levels.push_back({ offset, w, h, w * pixelSize });
+        offset += size_t(w) * h * pixelSize;
+    }
+    data.resize(offset);
+
+    std::vector<float> current(size_t(width) * height * channels);
+    std::vector<float> horizontal;
+    std::vector<float> next;
+    DecodeLevel(data.data(), size_t(width) * height, channels, type, settings, current.data());
+    for (size_t i = 1; i < levels.size(); ++i)
+    {
+        const MipLevelDesc& src = levels[i - 1];
+        const MipLevelDesc& dst = levels[i];
+        size_t pixelsCount = size_t(dst.Width) * dst.Height;
+
+        FilterTaps horizontalTaps = BuildTaps(settings.Filter, src.Width, dst.Width, settings.Wrap);
+        horizontal.resize(size_t(dst.Width) * src.Height * channels);
+        FilterHorizontal(current.data(), src.Width, src.Height, channels, horizontalTaps, dst.Width, horizontal.data(), level);
+
+        FilterTaps verticalTaps = BuildTaps(settings.Filter, src.Height, dst.Height, settings.Wrap);
+        next.resize(pixelsCount * channels);
+        FilterVertical(horizontal.data(), size_t(dst.Width) * channels, verticalTaps, dst.Height, next.data(), level);
+
+        ResolveLevel(next.data(), pixelsCount, channels, type, settings);
+        EncodeLevel(next.data(), pixelsCount, channels, type, settings, data.data() + dst.Offset);
+        current.swap(next);
+    }
+}
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <vector>
+#include <windows.h>
+
+#include "Utils/Simd.h"
+
+namespace DirectxPlayground
+{
+enum class MipFilter
+{
+    Box, // 2x2 average for the even sizes. Cheap and blurry.
+    Kaiser, // Kaiser windowed sinc, radius 3 and alpha 4. Sharp with little ringing.
+    Lanczos // Lanczos 3. The sharpest, rings the most on hard edges.
+};
+
+enum class MipPixelType
+{
+    UNorm8,
+    Float32
+};
+
+struct MipSettings
+{
+    MipFilter Filter = MipFilter::Kaiser;
+    bool Srgb = false; // UNorm8 RGB holds sRGB encoded color, it's filtered in the linear space and encoded back. Alpha is linear anyway.
+    bool NormalMap = false; // UNorm8 xyz maps [-1, 1] to [0, 1], every texel is renormalized after the filtering.
+    bool Wrap = true; // The filter wraps around the edges as a tiled texture does, clamps to them otherwise.
+};
+
+// Tightly packed, RowPitch is Width times the pixel size. For the block compressed formats it's a row of 4x4 blocks.
+struct MipLevelDesc
+{
+    size_t Offset = 0;
+    UINT Width = 0;
+    UINT Height = 0;
+    UINT RowPitch = 0;
+};
+
+UINT GetMipLevelsCount(UINT width, UINT height); // The full chain down to 1x1.
+
+// data holds the top level with channels (1 - 4) components of type per pixel, the other levels are appended to it one after another and
+// levels gets all of them, the top one included. Every level is filtered from the previous one in float, so nothing is quantized twice.
+// Separable, the vertical pass runs across whole rows with the SIMD level. All the levels do the same float operations in the same order,
+// so they give exactly the same result. Float data is color here, the negative lobes of the filters are clamped at 0 as with UNorm8.
+void GenerateMips(std::vector<byte>& data, UINT width, UINT height, UINT channels, MipPixelType type, const MipSettings& settings,
+    std::vector<MipLevelDesc>& levels, SimdLevel level = GetSimdLevel());
+}
@@ -0,0 +1,440 @@
+#include "DXrenderer/Textures/TextureCache.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+#include "DXrenderer/DXhelpers.h"
+#include "DXrenderer/Textures/TextureManager.h"
+#include "Utils/Logger.h"
+#include "Utils/ThreadPool.h"
+
+namespace DirectxPlayground
+{
+namespace
+{
+constexpr UINT DdsMagic = 0x20534444; // "DDS "
+constexpr UINT DdsFourCCDX10 = 0x30315844; // "DX10"
+constexpr UINT DdsFlagsCaps = 0x1;
+constexpr UINT DdsFlagsHeight = 0x2;
+constexpr UINT DdsFlagsWidth = 0x4;
+constexpr UINT DdsFlagsPitch = 0x8;
+constexpr UINT DdsFlagsPixelFormat = 0x1000;
+constexpr UINT DdsFlagsMipCount = 0x20000;
+constexpr UINT DdsFlagsLinearSize = 0x80000;
+constexpr UINT DdsPixelFormatFourCC = 0x4;
+constexpr UINT DdsCapsComplex = 0x8;
+constexpr UINT DdsCapsTexture = 0x1000;
+constexpr UINT DdsCapsMipmap = 0x400000;
+constexpr UINT DdsDimensionTexture2D = 3;
+
+constexpr UINT StampMagic = 0x43545844; // "DXTC"
+constexpr UINT StampVersion = 2; // Bump on any change of the stamp or of what's written.
+
+struct DdsPixelFormat
+{
+    UINT Size = sizeof(DdsPixelFormat);
+    UINT Flags = DdsPixelFormatFourCC;
+    UINT FourCC = DdsFourCCDX10;
+    UINT RGBBitCount = 0;
+    UINT RBitMask = 0;
+    UINT GBitMask = 0;
+    UINT BBitMask = 0;
+    UINT ABitMask = 0;
+};
+
+// Goes to DdsHeader::Reserved1, 6 of its 11 words.
+struct CacheStamp
+{
+    UINT Magic = StampMagic;
+    UINT Version = StampVersion;
+    UINT64 SourceHash = 0;
+    UINT64 ProcessingKey = 0;
+};
+
+struct DdsHeader
+{
+    UINT Size = sizeof(DdsHeader);
+    UINT Flags = 0;
+    UINT Height = 0;
+    UINT Width = 0;
+    UINT PitchOrLinearSize = 0;
+    UINT Depth = 0;
+    UINT MipMapCount = 0;
+    UINT Reserved1[11] = {};
+    DdsPixelFormat PixelFormat;
+    UINT Caps = 0;
+    UINT Caps2 = 0;
+    UINT Caps3 = 0;
+    UINT Caps4 = 0;
+    UINT Reserved2 = 0;
+};
+
+struct DdsHeaderDX10
+{
+    UINT DxgiFormat = DXGI_FORMAT_UNKNOWN;
+    UINT ResourceDimension = DdsDimensionTexture2D;
+    UINT MiscFlag = 0;
+    UINT ArraySize = 1;
+    UINT MiscFlags2 = 0;
+};
+
+struct DdsFile
+{
+    UINT Magic = DdsMagic;
+    DdsHeader Header;
+    DdsHeaderDX10 HeaderDX10;
+};
+
+static_assert(sizeof(DdsPixelFormat) == 32, "DDS pixel format is 32 bytes");
+static_assert(sizeof(DdsHeader) == 124, "DDS header is 124 bytes");
+static_assert(sizeof(CacheStamp) <= sizeof(DdsHeader::Reserved1), "The stamp doesn't fit the reserved words");
+
+// What the cache ever gets, TextureManager::DecodeImage and TextureManager::CompressImage outputs.
+bool IsCachedFormat(DXGI_FORMAT format)
+{
+    switch (format)
+    {
+    case DXGI_FORMAT_R8G8B8A8_UNORM:
+    case DXGI_FORMAT_R32G32B32A32_FLOAT:
+    case DXGI_FORMAT_R32G32B32_FLOAT:
+    case DXGI_FORMAT_BC1_UNORM:
+    case DXGI_FORMAT_BC3_UNORM:
+    case DXGI_FORMAT_BC4_UNORM:
+    case DXGI_FORMAT_BC5_UNORM:
+    case DXGI_FORMAT_BC7_UNORM:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// The DDS order, every level right after the previous one.
+size_t GetLevels(DXGI_FORMAT format, UINT width, UINT height, UINT levelsCount, std::vector<MipLevelDesc>& levels)
+{
+    levels.clear();
+    size_t offset = 0;
+    for (UINT i = 0; i < levelsCount; ++i)
+    {
+        MipLevelDesc level;
+        level.Offset = offset;
+        level.Width = std::max(width >> i, 1U);
+        level.Height = std::max(height >> i, 1U);
+        level.RowPitch = GetRowPitch(format, level.Width);
+        offset += size_t(level.RowPitch) * GetRowsCount(format, level.Height);
+        levels.push_back(level);
+    }
+    return offset;
+}
+
+struct CacheState
+{
+    std::mutex Mutex;
+    std::string Directory = ASSETS_DIR + std::string("Cache//Textures//");
+    std::condition_variable WritesDone;
+    size_t PendingWrites = 0;
+    std::atomic<UINT64> TmpIndex{ 0 };
+    std::atomic<UINT64> Lookups{ 0 };
+    std::atomic<UINT64> Hits{ 0 };
+    std::atomic<UINT64> Writes{ 0 };
+    std::atomic<UINT64> FailedWrites{ 0 };
+    std::atomic<UINT64> BytesRead{ 0 };
+    std::atomic<UINT64> BytesWritten{ 0 };
+};
+
+CacheState& GetState()
+{
+    static CacheState state;
+    return state;
+}
+
+size_t AlignUp(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// Where the levels go in the upload buffer. The payload is read to its start as is, levels keep their place while both their
+// offset and row pitch fit the copy alignment, the rest is moved after it with the aligned pitches.
+struct UploadLayout
+{
+    std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> Footprints;
+    size_t InPlaceBytes = 0; // The payload prefix that stays where it's read.
+    size_t Size = 0;
+};
+
+UploadLayout GetUploadLayout(DXGI_FORMAT format, const std::vector<MipLevelDesc>& levels, size_t payloadSize)
+{
+    UploadLayout layout;
+    layout.InPlaceBytes = payloadSize;
+    bool compressed = GetCompressedBlockSize(format) > 0;
+    size_t offset = 0;
+    for (const auto& level : levels)
+    {
+        D3D12_PLACED_SUBRESOURCE_FOOTPRINT footprint = {};
+        footprint.Footprint.Format = format;
+        // The block compressed footprints are in whole blocks.
+        footprint.Footprint.Width = compressed ? UINT(AlignUp(level.Width, 4)) : level.Width;
+        footprint.Footprint.Height = compressed ? UINT(AlignUp(level.Height, 4)) : level.Height;
+        footprint.Footprint.Depth = 1;
+        bool inPlace = layout.InPlaceBytes == payloadSize && level.Offset % D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT == 0
+            && level.RowPitch % D3D12_TEXTURE_DATA_PITCH_ALIGNMENT == 0;
+        if (inPlace)
+        {
+            footprint.Offset = level.Offset;
+            footprint.Footprint.RowPitch = level.RowPitch;
+        }
+        else
+        {
+            if (layout.InPlaceBytes == payloadSize)
+            {
+                layout.InPlaceBytes = level.Offset;
+                offset = AlignUp(payloadSize, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+            }
+            footprint.Offset = AlignUp(offset, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+            footprint.Footprint.RowPitch = UINT(AlignUp(level.RowPitch, D3D12_TEXTURE_DATA_PITCH_ALIGNMENT));
+            offset = footprint.Offset + size_t(footprint.Footprint.RowPitch) * GetRowsCount(format, level.Height);
+        }
+        layout.Footprints.push_back(footprint);
+    }
+    layout.Size = std::max(payloadSize, offset);
+    return layout;
+}
+
+bool ReadPayloadToUpload(std::ifstream& file, DXGI_FORMAT format, const std::vector<MipLevelDesc>& levels, size_t payloadSize, ID3D12Device* device,
+    DecodedImage& image)
+{
+    UploadLayout layout = GetUploadLayout(format, levels, payloadSize);
+
+    Microsoft::WRL::ComPtr<ID3D12Resource> upload;
+    CD3DX12_HEAP_PROPERTIES uploadHeapProps(D3D12_HEAP_TYPE_UPLOAD);
+    CD3DX12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(layout.Size);
+    if (FAILED(device->CreateCommittedResource(&uploadHeapProps, D3D12_HEAP_FLAG_NONE, &bufferDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&upload))))
+        return false;
+
+    byte* mapped = nullptr;
+    CD3DX12_RANGE readRange(0, 0);
+    if (FAILED(upload->Map(0, &readRange, reinterpret_cast<void**>(&mapped))))
+        return false;
+    file.read(reinterpret_cast<char*>(mapped), layout.InPlaceBytes);
+    // The moved levels are read to the CPU memory first, the upload heap is write combined and slow to read back.
+    std::vector<byte> rest(payloadSize - layout.InPlaceBytes);
+    file.read(reinterpret_cast<char*>(rest.data()), rest.size());
+    bool valid = bool(file);
+    for (size_t i = 0; i < levels.size() && valid; ++i)
+    {
+        const MipLevelDesc& level = levels[i];
+        const D3D12_PLACED_SUBRESOURCE_FOOTPRINT& footprint = layout.Footprints[i];
+        if (level.Offset < layout.InPlaceBytes)
+            continue;
+        const byte* src = rest.data() + (level.Offset - layout.InPlaceBytes);
+        for (UINT row = 0; row < GetRowsCount(format, level.Height); ++row)
+            memcpy(mapped + footprint.Offset + size_t(row) * footprint.Footprint.RowPitch, src + size_t(row) * level.RowPitch, level.RowPitch);
+    }
+    upload->Unmap(0, nullptr);
+    if (!valid)
+        return false;
+
+    image.Data.clear();
+    image.Upload = upload;
+    image.UploadFootprints = std::move(layout.Footprints);
+    return true;
+}
+}
+
+void TextureCache::SetDirectory(const std::string& directory)
+{
+    CacheState& state = GetState();
+    std::scoped_lock l(state.Mutex);
+    state.Directory = directory;
+}
+
+std::string TextureCache::GetCachePath(UINT64 sourceHash, UINT64 processingKey)
+{
+    CacheState& state = GetState();
+    std::stringstream ss;
+    {
+        std::scoped_lock l(state.Mutex);
+        ss << state.Directory;
+    }
+    ss << std::hex << std::setfill('0') << std::setw(16) << sourceHash << '_' << std::setw(16) << processingKey << ".dds";
+    return ss.str();
+}
+
+bool TextureCache::Read(UINT64 sourceHash, UINT64 processingKey, DecodedImage& image, ID3D12Device* uploadDevice /*= nullptr*/)
+{
+    CacheState& state = GetState();
+    ++state.Lookups;
+    std::string path = GetCachePath(sourceHash, processingKey);
+    std::error_code ec;
+    UINT64 fileSize = std::filesystem::file_size(path, ec);
+    if (ec || fileSize < sizeof(DdsFile))
+        return false;
+    std::ifstream file(path, std::ios::binary);
+    DdsFile header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+        return false;
+
+    CacheStamp stamp;
+    memcpy(&stamp, header.Header.Reserved1, sizeof(stamp));
+    DXGI_FORMAT format = DXGI_FORMAT(header.HeaderDX10.DxgiFormat);
+    if (header.Magic != DdsMagic || header.Header.Size != sizeof(DdsHeader) || header.Header.PixelFormat.FourCC != DdsFourCCDX10
+        || header.HeaderDX10.ResourceDimension != DdsDimensionTexture2D || header.HeaderDX10.ArraySize != 1 || !IsCachedFormat(format)
+        || stamp.Magic != StampMagic || stamp.Version != StampVersion || stamp.SourceHash != sourceHash || stamp.ProcessingKey != processingKey
+        || header.Header.MipMapCount == 0 || header.Header.MipMapCount > GetMipLevelsCount(header.Header.Width, header.Header.Height))
+    {
+        return false;
+    }
+
+    std::vector<MipLevelDesc> levels;
+    size_t payloadSize = GetLevels(format, header.Header.Width, header.Header.Height, header.Header.MipMapCount, levels);
+    if (payloadSize != fileSize - sizeof(DdsFile))
+    {
+        LOG("Texture cache entry ", path, " is corrupted");
+        return false;
+    }
+
+    if (uploadDevice != nullptr)
+    {
+        if (!ReadPayloadToUpload(file, format, levels, payloadSize, uploadDevice, image))
+            return false;
+    }
+    else
+    {
+        image.Data.resize(payloadSize);
+        if (!file.read(reinterpret_cast<char*>(image.Data.data()), payloadSize))
+            return false;
+    }
+    image.Width = header.Header.Width;
+    image.Height = header.Header.Height;
+    image.Format = format;
+    image.Levels = std::move(levels);
+    ++state.Hits;
+    state.BytesRead += fileSize;
+    return true;
+}
+
+bool TextureCache::Write(UINT64 sourceHash, UINT64 processingKey, const DecodedImage& image)
+{
+    CacheState& state = GetState();
+    auto fail = [&state]()
+    {
+        ++state.FailedWrites;
+        return false;
+    };
+
+    if (!IsCachedFormat(image.Format))
+        return fail();
+    UINT levelsCount = std::max(UINT(image.Levels.size()), 1U);
+    std::vector<MipLevelDesc> levels;
+    size_t dataSize = GetLevels(image.Format, image.Width, image.Height, levelsCount, levels);
+    if (dataSize != image.Data.size())
+        return fail();
+    for (size_t i = 0; i < image.Levels.size(); ++i)
+    {
+        if (image.Levels[i].Offset != levels[i].Offset || image.Levels[i].RowPitch != levels[i].RowPitch)
+            return fail();
+    }
+
+    CacheStamp stamp;
+    stamp.SourceHash = sourceHash;
+    stamp.ProcessingKey = processingKey;
+
+    bool compressed = GetCompressedBlockSize(image.Format) > 0;
+    DdsFile header;
+    header.Header.Flags = DdsFlagsCaps | DdsFlagsHeight | DdsFlagsWidth | DdsFlagsPixelFormat | DdsFlagsMipCount | (compressed ? DdsFlagsLinearSize : DdsFlagsPitch);
+    header.Header.Width = image.Width;
+    header.Header.Height = image.Height;
+    header.Header.PitchOrLinearSize = compressed ? UINT(levels.size() > 1 ? levels[1].Offset : dataSize) : levels[0].RowPitch;
+    header.Header.Depth = 1;
+    header.Header.MipMapCount = levelsCount;
+    header.Header.Caps = DdsCapsTexture | (levelsCount > 1 ? DdsCapsComplex | DdsCapsMipmap : 0);
+    memcpy(header.Header.Reserved1, &stamp, sizeof(stamp));
+    header.HeaderDX10.DxgiFormat = image.Format;
+
+    // The same content may be written by two loads at once, every writer has its own temporary file.
+    std::string cachePath = GetCachePath(sourceHash, processingKey);
+    std::string tmpPath = cachePath + "." + std::to_string(state.TmpIndex++) + ".tmp";
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(cachePath).parent_path(), ec);
+    {
+        std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!file)
+            return fail();
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(image.Data.data()), image.Data.size());
+        if (!file)
+        {
+            file.close();
+            std::filesystem::remove(tmpPath, ec);
+            return fail();
+        }
+    }
+    // Readers never see a half written entry.
+    std::filesystem::rename(tmpPath, cachePath, ec);
+    if (ec)
+    {
+        std::filesystem::remove(tmpPath, ec);
+        return fail();
+    }
+    ++state.Writes;
+    state.BytesWritten += sizeof(header) + image.Data.size();
+    return true;
+}
+
+void TextureCache::WriteAsync(UINT64 sourceHash, UINT64 processingKey, DecodedImage image)
+{
+    CacheState& state = GetState();
+    {
+        std::scoped_lock l(state.Mutex);
+        ++state.PendingWrites;
+    }
+    auto shared = std::make_shared<DecodedImage>(std::move(image));
+    ThreadPool::Get().Submit([sourceHash, processingKey, shared]()
+    {
+        Write(sourceHash, processingKey, *shared);
+        CacheState& state = GetState();
+        std::scoped_lock l(state.Mutex);
+        if (--state.PendingWrites == 0)
+            state.WritesDone.notify_all();
+    });
+}
+
+void TextureCache::WaitForWrites()
+{
+    CacheState& state = GetState();
+    std::unique_lock l(state.Mutex);
+    state.WritesDone.wait(l, [&state]() { return state.PendingWrites == 0; });
+}
+
+TextureCache::Counters TextureCache::GetCounters()
+{
+    CacheState& state = GetState();
+    Counters res;
+    res.Lookups = state.Lookups;
+    res.Hits = state.Hits;
+    res.Writes = state.Writes;
+    res.FailedWrites = state.FailedWrites;
+    res.BytesRead = state.BytesRead;
+    res.BytesWritten = state.BytesWritten;
+    return res;
+}
+
+void TextureCache::ResetCounters()
+{
+    CacheState& state = GetState();
+    state.Lookups = 0;
+    state.Hits = 0;
+    state.Writes = 0;
+    state.FailedWrites = 0;
+    state.BytesRead = 0;
+    state.BytesWritten = 0;
+}
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <string>
+#include <windows.h>
+
+struct ID3D12Device;
+
+namespace DirectxPlayground
+{
+struct DecodedImage;
+
+// Processed images (the final format, the mips, the block compression) as DDS files with the DX10 header, so an image is decoded
+// and encoded once per content and processing. Content addressed: a file is named by the hash of the source file and the processing
+// key, so a hit is up to date by definition, renamed or copied sources share the entry and nothing has to be validated against the
+// source. Both hashes are repeated in the reserved words of the DDS header, the files stay readable by the usual DDS tools.
+class TextureCache
+{
+public:
+    struct Counters
+    {
+        UINT64 Lookups = 0;
+        UINT64 Hits = 0;
+        UINT64 Writes = 0;
+        UINT64 FailedWrites = 0;
+        UINT64 BytesRead = 0; // By the hits.
+        UINT64 BytesWritten = 0;
+    };
+
+    static void SetDirectory(const std::string& directory); // ASSETS_DIR "Cache//Textures//" by default. Not while anything is loading.
+    static std::string GetCachePath(UINT64 sourceHash, UINT64 processingKey);
+
+    // With a device the payload is read straight into a new upload buffer, laid out for the copies, and the image gets the buffer and the
+    // footprints instead of Data. The levels whose tightly packed rows already fit the copy alignment (all but the smallest mips of
+    // the power of two textures) stay where the single sequential read put them, only the rest is moved.
+    static bool Read(UINT64 sourceHash, UINT64 processingKey, DecodedImage& image, ID3D12Device* uploadDevice = nullptr);
+    // Levels of the image must follow each other in Data, as GenerateMips and TextureManager::CompressImage leave them.
+    static bool Write(UINT64 sourceHash, UINT64 processingKey, const DecodedImage& image);
+    // Write as a thread pool task, so the load that missed doesn't wait for the disk. Move the image in when it's not needed after, see TextureManager::ReleaseDecodedImage.
+    static void WriteAsync(UINT64 sourceHash, UINT64 processingKey, DecodedImage image);
+    static void WaitForWrites();
+
+    static Counters GetCounters(); // Since the start or ResetCounters.
+    static void ResetCounters();
+};
+}
@@ -1,6 +1,8 @@
 #include "TextureManager.h"
 
+#include <algorithm>
 #include <filesystem>
+#include <numeric>
 #include <vector>
 #include <sstream>
 
@@ -13,15 +15,66 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include "External/stb/stb_image.h"
 
+#include "Utils/FileStamp.h"
+#include "Utils/Hash.h"
 #include "Utils/Logger.h"
+#include "Utils/ThreadPool.h"
+#include "Utils/Timer.h"
 
 #include "DXrenderer/DXhelpers.h"
+#include "DXrenderer/Textures/TextureCache.h"
 
 namespace DirectxPlayground
 {
 namespace
 {
 static constexpr UINT MaxImguiTexturesCount = 128;
+constexpr UINT64 ProcessingVersion = 1; // Bump on any change of the mips or the block compression output, the cached textures go stale.
+
+UINT64 GetProcessingKey(const ImageProcessing& processing)
+{
+    UINT64 key = HashCombine(ProcessingVersion, processing.GenerateMips ? 1 : 0);
+    if (processing.GenerateMips)
+    {
+        key = HashCombine(key, UINT64(processing.Mips.Filter));
+        key = HashCombine(key, (processing.Mips.Srgb ? 1 : 0) | (processing.Mips.NormalMap ? 2 : 0) | (processing.Mips.Wrap ? 4 : 0));
+    }
+    key = HashCombine(key, UINT64(processing.Compression));
+    if (processing.Compression != TextureCompression::None)
+        key = HashCombine(key, processing.Usage);
+    return key;
+}
+
+bool HasAlpha(const DecodedImage& image)
+{
+    if (image.Format != DXGI_FORMAT_R8G8B8A8_UNORM)
+        return false;
+    size_t texelsCount = size_t(image.Width) * image.Height;
+    for (size_t i = 0; i < texelsCount; ++i)
+    {
+        if (image.Data[i * 4 + 3] != 255)
+            return true;
+    }
+    return false;
+}
+
+DXGI_FORMAT GetDxgiFormat(BlockFormat format)
+{
+    switch (format)
+    {
+    case BlockFormat::BC1:
+        return DXGI_FORMAT_BC1_UNORM;
+    case BlockFormat::BC3:
+        return DXGI_FORMAT_BC3_UNORM;
+    case BlockFormat::BC4:
+        return DXGI_FORMAT_BC4_UNORM;
+    case BlockFormat::BC5:
+        return DXGI_FORMAT_BC5_UNORM;
+    case BlockFormat::BC7:
+        return DXGI_FORMAT_BC7_UNORM;
+    }
+    return DXGI_FORMAT_UNKNOWN;
+}
 }
 
 TextureManager::TextureManager(RenderContext& ctx)
@@ -33,35 +86,73 @@ TextureManager::TextureManager(RenderContext& ctx)
 
 RtvSrvUavResourceIdx TextureManager::CreateTexture(RenderContext& ctx, const std::string& filename, bool allowUAV /*= false*/)
 {
-    std::vector<byte> buffer;
-
-    std::wstring extension{ std::filesystem::path(filename.c_str()).extension().c_str() };
+    return CreateTextures(ctx, { filename })[0];
+}
 
-    UINT w = 0, h = 0;
-    DXGI_FORMAT textureFormat{};
+std::vector<RtvSrvUavResourceIdx> TextureManager::CreateTextures(RenderContext& ctx, const std::vector<std::string>& filenames, ImageDecodeStats* stats /*= nullptr*/)
+{
+    ImageProcessing processing;
+    processing.UseCache = true;
+    UINT64 processingKey = GetProcessingKey(processing);
 
-    if (extension == L".png" || extension == L".PNG") // let's hope there won't be "pNg" or "PnG" etc
+    // The files already loaded aren't decoded again, CreateTexture finds them by the path.
+    std::vector<std::string> toDecode;
+    for (const auto& filename : filenames)
     {
-        bool success = ParsePNG(filename, buffer, w, h, textureFormat);
+        if (m_texturesByPath.count({ filename, processingKey }) == 0 && std::find(toDecode.begin(), toDecode.end(), filename) == toDecode.end())
+            toDecode.push_back(filename);
     }
-    else if (extension == L".exr" || extension == L".EXR")
+    std::vector<DecodedImage> images;
+    DecodeImages(toDecode, images, stats, toDecode.size() > 1, std::vector<ImageProcessing>(toDecode.size(), processing), ctx.Device);
+
+    std::vector<RtvSrvUavResourceIdx> res;
+    res.reserve(filenames.size());
+    for (const auto& filename : filenames)
     {
-        bool success = ParseEXR(filename, buffer, w, h, textureFormat);
+        auto decodedFile = std::find(toDecode.begin(), toDecode.end(), filename);
+        if (decodedFile == toDecode.end())
+        {
+            ++m_sharingStats.PathHits;
+            res.push_back(AddReference(m_texturesByPath.at({ filename, processingKey }), filename, processingKey));
+            continue;
+        }
+        DecodedImage& image = images[decodedFile - toDecode.begin()];
+        image.ProcessingKey = processingKey; // Left at 0 by a failed decode.
+        res.push_back(CreateTexture(ctx, image, filename));
+        // The pixels are on their way to the GPU, a repeated filename is found by the path.
+        ReleaseDecodedImage(image);
     }
-    else if (extension == L".hdr" || extension == L".HDR")
+    return res;
+}
+
+RtvSrvUavResourceIdx TextureManager::CreateTexture(RenderContext& ctx, const DecodedImage& image, const std::string& name, bool share /*= true*/)
+{
+    if (auto found = m_texturesByPath.find({ name, image.ProcessingKey }); share && found != m_texturesByPath.end())
     {
-        bool success = ParseHDR(filename, buffer, w, h, textureFormat);
+        ++m_sharingStats.PathHits;
+        return AddReference(found->second, name, image.ProcessingKey);
     }
-    else
+    if (share && image.SourceHash != 0)
     {
-        assert("Unknown image format for parsing" && false);
+        if (auto found = m_texturesByContent.find({ image.SourceHash, image.ProcessingKey }); found != m_texturesByContent.end())
+        {
+            ++m_sharingStats.ContentHits;
+            return AddReference(found->second, name, image.ProcessingKey);
+        }
     }
 
+    const std::vector<byte>& buffer = image.Data;
+    UINT w = image.Width;
+    UINT h = image.Height;
+    DXGI_FORMAT textureFormat = image.Format;
+
     Microsoft::WRL::ComPtr<ID3D12Resource> resource;
     Microsoft::WRL::ComPtr<ID3D12Resource> uploadResource;
 
+    UINT mipLevels = std::max(UINT(image.Levels.size()), 1U);
+
     D3D12_RESOURCE_DESC texDesc = {};
-    texDesc.MipLevels = 1;
+    texDesc.MipLevels = mipLevels;
     texDesc.Format = textureFormat;
     texDesc.Width = w;
     texDesc.Height = h;
@@ -79,29 +170,47 @@ RtvSrvUavResourceIdx TextureManager::CreateTexture(RenderContext& ctx, const std
         IID_PPV_ARGS(&resource)));
 
 #if defined(_DEBUG)
-    std::wstring s{ filename.begin(), filename.end() };
+    std::wstring s{ name.begin(), name.end() };
     SetDXobjectName(resource.Get(), s.c_str());
 #endif
 
-    const UINT64 uploadBufferSize = GetRequiredIntermediateSize(resource.Get(), 0, 1);
-
-    size_t texSize = buffer.size() * sizeof(byte);
-    CD3DX12_HEAP_PROPERTIES uploadHeapProps(D3D12_HEAP_TYPE_UPLOAD);
-    CD3DX12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(uploadBufferSize);
-    ThrowIfFailed(ctx.Device->CreateCommittedResource(
-        &uploadHeapProps,
-        D3D12_HEAP_FLAG_NONE,
-        &bufferDesc,
-        D3D12_RESOURCE_STATE_GENERIC_READ,
-        nullptr,
-        IID_PPV_ARGS(&uploadResource)));
-
-    D3D12_SUBRESOURCE_DATA texData = {};
-    texData.pData = buffer.data();
-    texData.RowPitch = size_t(w) * GetPixelSize(textureFormat);
-    texData.SlicePitch = texData.RowPitch * h;
+    if (image.Upload != nullptr)
+    {
+        // A cache hit, the levels are in place already.
+        assert(image.UploadFootprints.size() == mipLevels);
+        uploadResource = image.Upload;
+        for (UINT i = 0; i < mipLevels; ++i)
+        {
+            CD3DX12_TEXTURE_COPY_LOCATION dst(resource.Get(), i);
+            CD3DX12_TEXTURE_COPY_LOCATION src(uploadResource.Get(), image.UploadFootprints[i]);
+            ctx.CommandList->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
+        }
+    }
+    else
+    {
+        const UINT64 uploadBufferSize = GetRequiredIntermediateSize(resource.Get(), 0, mipLevels);
+
+        CD3DX12_HEAP_PROPERTIES uploadHeapProps(D3D12_HEAP_TYPE_UPLOAD);
+        CD3DX12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(uploadBufferSize);
+        ThrowIfFailed(ctx.Device->CreateCommittedResource(
+            &uploadHeapProps,
+            D3D12_HEAP_FLAG_NONE,
+            &bufferDesc,
+            D3D12_RESOURCE_STATE_GENERIC_READ,
+            nullptr,
+            IID_PPV_ARGS(&uploadResource)));
+
+        std::vector<D3D12_SUBRESOURCE_DATA> texData(mipLevels);
+        for (UINT i = 0; i < mipLevels; ++i)
+        {
+            MipLevelDesc level = image.Levels.empty() ? MipLevelDesc{ 0, w, h, GetRowPitch(textureFormat, w) } : image.Levels[i];
+            texData[i].pData = buffer.data() + level.Offset;
+            texData[i].RowPitch = level.RowPitch;
+            texData[i].SlicePitch = size_t(level.RowPitch) * GetRowsCount(textureFormat, level.Height);
+        }
 
-    UpdateSubresources(ctx.CommandList, resource.Get(), uploadResource.Get(), 0, 0, 1, &texData);
+        UpdateSubresources(ctx.CommandList, resource.Get(), uploadResource.Get(), 0, 0, mipLevels, texData.data());
+    }
 
     CD3DX12_RESOURCE_BARRIER toDest = CD3DX12_RESOURCE_BARRIER::Transition(resource.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
     ctx.CommandList->ResourceBarrier(1, &toDest);
@@ -114,18 +223,119 @@ RtvSrvUavResourceIdx TextureManager::CreateTexture(RenderContext& ctx, const std
     viewDesc.Texture2D.MostDetailedMip = 0;
     viewDesc.Texture2D.ResourceMinLODClamp = 0.0f;
 
+    RtvSrvUavResourceIdx res{};
+    if (m_freeSrvOffsets.empty())
+    {
+        res.SRVOffset = m_currentTexCount++;
+    }
+    else
+    {
+        res.SRVOffset = m_freeSrvOffsets.back();
+        m_freeSrvOffsets.pop_back();
+    }
     CD3DX12_CPU_DESCRIPTOR_HANDLE handle(m_srvHeap->GetCPUDescriptorHandleForHeapStart());
-    handle.Offset(m_currentTexCount * ctx.CbvSrvUavDescriptorSize);
+    handle.Offset(res.SRVOffset * ctx.CbvSrvUavDescriptorSize);
     ctx.Device->CreateShaderResourceView(resource.Get(), &viewDesc, handle);
 
-    m_resources.push_back(resource);
-    m_uploadResources.push_back(uploadResource);
+    if (m_freeResourceIdxs.empty())
+    {
+        m_resources.push_back(resource);
+        res.ResourceIdx = static_cast<UINT>(m_resources.size()) - 1;
+    }
+    else
+    {
+        res.ResourceIdx = m_freeResourceIdxs.back();
+        m_freeResourceIdxs.pop_back();
+        m_resources[res.ResourceIdx] = resource;
+    }
+    m_uploads.push_back({ uploadResource });
 
-    RtvSrvUavResourceIdx res{};
-    res.SRVOffset = m_currentTexCount++;
-    res.ResourceIdx = static_cast<UINT>(m_resources.size()) - 1;
+    SharedTexture& shared = m_sharedTextures[res.SRVOffset];
+    shared.Texture = res;
+    shared.ProcessingKey = image.ProcessingKey;
+    if (share && image.SourceHash != 0)
+    {
+        shared.SourceHash = image.SourceHash;
+        m_texturesByContent[{ image.SourceHash, image.ProcessingKey }] = res.SRVOffset;
+    }
+    ++m_sharingStats.Created;
+    return AddReference(res.SRVOffset, share ? name : std::string(), image.ProcessingKey);
+}
 
-    return res;
+void TextureManager::ReleaseTexture(UINT srvOffset)
+{
+    auto found = m_sharedTextures.find(srvOffset);
+    assert(found != m_sharedTextures.end() && "Not a texture of a file or already released");
+    SharedTexture& shared = found->second;
+    if (--shared.RefCount > 0)
+        return;
+
+    for (const auto& path : shared.Paths)
+        m_texturesByPath.erase({ path, shared.ProcessingKey });
+    if (shared.SourceHash != 0)
+        m_texturesByContent.erase({ shared.SourceHash, shared.ProcessingKey });
+    m_releases.push_back({ shared.Texture });
+    m_sharedTextures.erase(found);
+    ++m_sharingStats.Released;
+}
+
+void TextureManager::ReleaseNow(const RtvSrvUavResourceIdx& texture)
+{
+    m_resources[texture.ResourceIdx] = nullptr;
+    m_freeResourceIdxs.push_back(texture.ResourceIdx);
+    m_freeSrvOffsets.push_back(texture.SRVOffset);
+}
+
+void TextureManager::ReleaseUploads()
+{
+    m_uploads.clear();
+    for (const auto& release : m_releases)
+        ReleaseNow(release.Texture);
+    m_releases.clear();
+}
+
+void TextureManager::RetireUploads(UINT64 fenceValue)
+{
+    for (auto& upload : m_uploads)
+    {
+        upload.FenceValue = fenceValue;
+        m_retiredUploads.push_back(std::move(upload));
+    }
+    m_uploads.clear();
+    for (auto& release : m_releases)
+    {
+        release.FenceValue = fenceValue;
+        m_retiredReleases.push_back(release);
+    }
+    m_releases.clear();
+}
+
+void TextureManager::ReleaseCompletedUploads(UINT64 completedFenceValue)
+{
+    size_t releasedCount = 0;
+    while (releasedCount < m_retiredUploads.size() && m_retiredUploads[releasedCount].FenceValue <= completedFenceValue)
+        ++releasedCount;
+    m_retiredUploads.erase(m_retiredUploads.begin(), m_retiredUploads.begin() + releasedCount);
+
+    size_t freedCount = 0;
+    while (freedCount < m_retiredReleases.size() && m_retiredReleases[freedCount].FenceValue <= completedFenceValue)
+        ReleaseNow(m_retiredReleases[freedCount++].Texture);
+    m_retiredReleases.erase(m_retiredReleases.begin(), m_retiredReleases.begin() + freedCount);
+}
+
+size_t TextureManager::GetUploadsCount() const
+{
+    return m_uploads.size() + m_retiredUploads.size();
+}
+
+RtvSrvUavResourceIdx TextureManager::AddReference(UINT srvOffset, const std::string& path, UINT64 processingKey)
+{
+    SharedTexture& shared = m_sharedTextures.at(srvOffset);
+    ++shared.RefCount;
+    // Found by the content under another name, the next load of that name is found by the path right away.
+    if (!path.empty() && m_texturesByPath.emplace(std::make_pair(path, processingKey), srvOffset).second)
+        shared.Paths.push_back(path);
+    return shared.Texture;
 }
 
 DirectxPlayground::RtvSrvUavResourceIdx TextureManager::CreateTexture(RenderContext& ctx, D3D12_RESOURCE_DESC desc, const std::wstring& name, D3D12_RESOURCE_STATES initialState)
@@ -167,7 +377,6 @@ DirectxPlayground::RtvSrvUavResourceIdx TextureManager::CreateTexture(RenderCont
 DirectxPlayground::RtvSrvUavResourceIdx TextureManager::CreateCubemap(RenderContext& ctx, UINT w, UINT h, DXGI_FORMAT format, bool allowUAV /*= false*/, const byte* data /*= nullptr*/)
 {
     Microsoft::WRL::ComPtr<ID3D12Resource> resource;
-    Microsoft::WRL::ComPtr<ID3D12Resource> uploadResource;
 
     D3D12_RESOURCE_FLAGS resourceFlags = allowUAV ? D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS : D3D12_RESOURCE_FLAG_NONE;
 
@@ -232,7 +441,6 @@ DirectxPlayground::RtvSrvUavResourceIdx TextureManager::CreateCubemap(RenderCont
     }
 
     m_resources.push_back(resource);
-    m_uploadResources.push_back(uploadResource);
 
     return res;
 }
@@ -282,6 +490,186 @@ UINT TextureManager::CreateDxrOutput(RenderContext& ctx, D3D12_RESOURCE_DESC des
     return m_currentTexCount++;
 }
 
+bool TextureManager::DecodeImage(const std::string& filename, DecodedImage& image)
+{
+    std::wstring extension{ std::filesystem::path(filename.c_str()).extension().c_str() };
+
+    if (extension == L".png" || extension == L".PNG") // let's hope there won't be "pNg" or "PnG" etc
+        return ParsePNG(filename, image.Data, image.Width, image.Height, image.Format);
+    if (extension == L".exr" || extension == L".EXR")
+        return ParseEXR(filename, image.Data, image.Width, image.Height, image.Format);
+    if (extension == L".hdr" || extension == L".HDR")
+        return ParseHDR(filename, image.Data, image.Width, image.Height, image.Format);
+
+    assert("Unknown image format for parsing" && false);
+    return false;
+}
+
+void TextureManager::DecodeImages(const std::vector<std::string>& filenames, std::vector<DecodedImage>& images, ImageDecodeStats* stats /*= nullptr*/, bool parallel /*= true*/,
+    const std::vector<ImageProcessing>& processing /*= {}*/, ID3D12Device* uploadDevice /*= nullptr*/)
+{
+    assert(processing.empty() || processing.size() == filenames.size());
+    Timer timer;
+    size_t count = filenames.size();
+    images.clear();
+    images.resize(count);
+    std::vector<double> fileMs(count, 0.0);
+    std::vector<double> fileMipsMs(count, 0.0);
+    std::vector<double> fileCompressMs(count, 0.0);
+    std::vector<byte> decoded(count, 0); // Not vector<bool>, the threads write to the neighbouring elements.
+    std::vector<byte> cacheHits(count, 0);
+
+    // The file size is a good enough guess for the decode time.
+    std::vector<size_t> order(count);
+    std::iota(order.begin(), order.end(), size_t(0));
+    if (parallel)
+    {
+        std::vector<UINT64> sizes(count, 0);
+        for (size_t i = 0; i < count; ++i)
+        {
+            std::error_code ec;
+            UINT64 size = std::filesystem::file_size(filenames[i], ec);
+            sizes[i] = ec ? 0 : size;
+        }
+        std::stable_sort(order.begin(), order.end(), [&sizes](size_t a, size_t b) { return sizes[a] > sizes[b]; });
+    }
+
+    // Every file writes only to its own slots.
+    auto decode = [&](size_t i)
+    {
+        size_t file = order[i];
+        Timer fileTimer;
+        const ImageProcessing* fileProcessing = processing.empty() ? nullptr : &processing[file];
+        UINT64 processingKey = fileProcessing != nullptr ? GetProcessingKey(*fileProcessing) : 0;
+        // The hash is what the textures are shared by, so it's taken with or without the cache.
+        UINT64 sourceHash = 0;
+        bool hashed = fileProcessing != nullptr && HashFile(filenames[file], sourceHash);
+        bool useCache = hashed && fileProcessing->UseCache;
+        if (useCache && TextureCache::Read(sourceHash, processingKey, images[file], uploadDevice))
+        {
+            decoded[file] = 1;
+            cacheHits[file] = 1;
+            images[file].SourceHash = sourceHash;
+            images[file].ProcessingKey = processingKey;
+            fileMs[file] = fileTimer.GetElapsedMs();
+            return;
+        }
+
+        decoded[file] = DecodeImage(filenames[file], images[file]) ? 1 : 0;
+        if (decoded[file] && fileProcessing != nullptr)
+        {
+            if (fileProcessing->GenerateMips)
+            {
+                Timer mipsTimer;
+                GenerateMips(images[file], fileProcessing->Mips);
+                fileMipsMs[file] = mipsTimer.GetElapsedMs();
+            }
+            if (fileProcessing->Compression != TextureCompression::None)
+            {
+                Timer compressTimer;
+                CompressImage(images[file], ChooseBlockFormat(fileProcessing->Usage, fileProcessing->Compression, HasAlpha(images[file])));
+                fileCompressMs[file] = compressTimer.GetElapsedMs();
+            }
+            images[file].PendingCacheWrite = useCache;
+            if (hashed)
+            {
+                images[file].SourceHash = sourceHash;
+                images[file].ProcessingKey = processingKey;
+            }
+        }
+        fileMs[file] = fileTimer.GetElapsedMs();
+    };
+    if (parallel)
+        ThreadPool::Get().ParallelFor(count, decode);
+    else
+        for (size_t i = 0; i < count; ++i)
+            decode(i);
+
+    if (stats != nullptr)
+    {
+        stats->FileMs = std::move(fileMs);
+        stats->FileMipsMs = std::move(fileMipsMs);
+        stats->FileCompressMs = std::move(fileCompressMs);
+        stats->TotalMs = timer.GetElapsedMs();
+        stats->FailedCount = UINT(std::count(decoded.begin(), decoded.end(), byte(0)));
+        stats->CacheHitsCount = UINT(std::count(cacheHits.begin(), cacheHits.end(), byte(1)));
+    }
+}
+
+void TextureManager::ReleaseDecodedImage(DecodedImage& image)
+{
+    if (image.PendingCacheWrite)
+        TextureCache::WriteAsync(image.SourceHash, image.ProcessingKey, std::move(image));
+    image = DecodedImage{};
+}
+
+bool TextureManager::GenerateMips(DecodedImage& image, const MipSettings& settings)
+{
+    UINT channels = 0;
+    MipPixelType type = MipPixelType::UNorm8;
+    switch (image.Format)
+    {
+    case DXGI_FORMAT_R8G8B8A8_UNORM:
+        channels = 4;
+        break;
+    case DXGI_FORMAT_R32G32B32A32_FLOAT:
+        channels = 4;
+        type = MipPixelType::Float32;
+        break;
+    case DXGI_FORMAT_R32G32B32_FLOAT:
+        channels = 3;
+        type = MipPixelType::Float32;
+        break;
+    default:
+        return false;
+    }
+    DirectxPlayground::GenerateMips(image.Data, image.Width, image.Height, channels, type, settings, image.Levels);
+    return true;
+}
+
+BlockFormat TextureManager::ChooseBlockFormat(UINT usage, TextureCompression compression, bool hasAlpha)
+{
+    assert(compression != TextureCompression::None);
+    if (usage == TextureUsageNormal)
+        return BlockFormat::BC5;
+    if (usage == TextureUsageOcclusion)
+        return BlockFormat::BC4;
+    if (compression == TextureCompression::Quality)
+        return BlockFormat::BC7;
+    // Metallic roughness has nothing in alpha, the color might.
+    bool color = (usage & TextureUsageBaseColor) != 0 || (usage & TextureUsageMetallicRoughness) == 0;
+    return color && hasAlpha ? BlockFormat::BC3 : BlockFormat::BC1;
+}
+
+bool TextureManager::CompressImage(DecodedImage& image, BlockFormat format)
+{
+    if (image.Format != DXGI_FORMAT_R8G8B8A8_UNORM || image.Width % 4 != 0 || image.Height % 4 != 0)
+        return false;
+
+    std::vector<MipLevelDesc> sourceLevels = image.Levels;
+    if (sourceLevels.empty())
+        sourceLevels.push_back({ 0, image.Width, image.Height, image.Width * 4 });
+
+    std::vector<MipLevelDesc> levels;
+    size_t size = 0;
+    for (const auto& sourceLevel : sourceLevels)
+    {
+        MipLevelDesc level = sourceLevel;
+        level.Offset = size;
+        level.RowPitch = ((level.Width + 3) / 4) * GetBlockBytes(format);
+        size += GetCompressedSize(level.Width, level.Height, format);
+        levels.push_back(level);
+    }
+
+    std::vector<byte> blocks(size);
+    for (size_t i = 0; i < levels.size(); ++i)
+        DirectxPlayground::CompressImage(image.Data.data() + sourceLevels[i].Offset, levels[i].Width, levels[i].Height, format, blocks.data() + levels[i].Offset);
+    image.Data.swap(blocks);
+    image.Levels = std::move(levels);
+    image.Format = GetDxgiFormat(format);
+    return true;
+}
+
 bool TextureManager::ParsePNG(const std::string& filename, std::vector<byte>& buffer, UINT& w, UINT& h, DXGI_FORMAT& textureFormat)
 {
     std::vector<byte> bufferInMemory;
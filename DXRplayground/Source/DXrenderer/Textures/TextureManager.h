@@ -3,10 +3,13 @@
 #include <cassert>
 #include <string>
 #include <map>
+#include <vector>
 
 #include <wrl.h>
 #include "External/Dx12Helpers/d3dx12.h"
 #include "DXrenderer/RenderContext.h"
+#include "DXrenderer/Textures/BlockCompression.h"
+#include "DXrenderer/Textures/MipGenerator.h"
 
 namespace DirectxPlayground
 {
@@ -22,11 +25,87 @@ struct RtvSrvUavResourceIdx
     UINT ResourceIdx = InvalidOffset;
 };
 
+// Pixels of an image file in the format its texture is created with, see TextureManager::DecodeImage.
+struct DecodedImage
+{
+    std::vector<byte> Data;
+    UINT Width = 0;
+    UINT Height = 0;
+    DXGI_FORMAT Format = DXGI_FORMAT_UNKNOWN;
+    std::vector<MipLevelDesc> Levels; // Of Data, see TextureManager::GenerateMips. Empty for a single level image straight from the decode.
+    // Set instead of Data by a TextureCache hit read straight to an upload buffer, the copy footprint of every level in it.
+    Microsoft::WRL::ComPtr<ID3D12Resource> Upload;
+    std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> UploadFootprints;
+    // Set by DecodeImages with the processing, what TextureManager::CreateTexture shares the textures by. 0 - the content is unknown.
+    UINT64 SourceHash = 0;
+    UINT64 ProcessingKey = 0;
+    // Set by DecodeImages on a TextureCache miss. The pixels are written to the cache only when they're done with, see TextureManager::ReleaseDecodedImage.
+    bool PendingCacheWrite = false;
+};
+
+// What the materials sample an image as, picks its block format. An image can be used several ways.
+enum TextureUsage : UINT
+{
+    TextureUsageBaseColor = 1 << 0,
+    TextureUsageNormal = 1 << 1,
+    TextureUsageMetallicRoughness = 1 << 2,
+    TextureUsageOcclusion = 1 << 3,
+};
+
+// What DecodeImages does to a file after the decode, in this order. Normal maps go to BC5 and occlusion only maps to BC4 either way.
+struct ImageProcessing
+{
+    bool GenerateMips = false;
+    MipSettings Mips;
+    TextureCompression Compression = TextureCompression::None;
+    UINT Usage = 0; // TextureUsage flags.
+    bool UseCache = false; // Take the processed image from the TextureCache by the source content if it's there, put it there in the background otherwise.
+};
+
+// The duplicates TextureManager::CreateTexture returned instead of creating the textures again.
+struct TextureSharingStats
+{
+    UINT PathHits = 0; // The same file with the same processing.
+    UINT ContentHits = 0; // Another file with the same content and processing.
+    UINT Created = 0;
+    UINT Released = 0; // Their last reference is gone, the SRV slot is free for the next one once the GPU is done with it.
+};
+
+struct ImageDecodeStats
+{
+    std::vector<double> FileMs; // Per file, in the order they were passed in.
+    std::vector<double> FileMipsMs; // The same for the mips generation, already included in FileMs.
+    std::vector<double> FileCompressMs; // The same for the block compression.
+    double TotalMs = 0.0; // Wall time of the whole batch.
+    UINT FailedCount = 0;
+    UINT CacheHitsCount = 0; // Files taken from the TextureCache, neither decoded nor processed.
+};
+
 class TextureManager
 {
 public:
     TextureManager(RenderContext& ctx);
+    // Shared as the one below, a file already loaded is neither decoded nor read from the cache again.
     RtvSrvUavResourceIdx CreateTexture(RenderContext& ctx, const std::string& filename, bool allowUAV = false);
+    // Only creates the resource and the SRV and records the copy, for the images decoded ahead, i.e. on a loader thread. All the mips go in one UpdateSubresources,
+    // or straight from the image's upload buffer if it has one.
+    // The textures of the files are shared: name is the source path, and the texture created from the same path or the same content with the same
+    // processing is returned with one more reference instead. A file changed on disk while its texture is alive still gets the old one by the path.
+    // Without share the texture is always created and is never returned for the others, it's released the same way.
+    RtvSrvUavResourceIdx CreateTexture(RenderContext& ctx, const DecodedImage& image, const std::string& name, bool share = true);
+    // A reference taken by the two above. After the last one the texture is never returned again, but the frames in flight may still sample it:
+    // the resource and the SRV slot are freed along with the uploads, as GeometryPool::FreeDeferred. Its upload buffer goes with its own copy.
+    void ReleaseTexture(UINT srvOffset);
+    const TextureSharingStats& GetSharingStats() const;
+    // The upload buffers of the copies recorded so far, the cache hits' included, and the textures released since. As GeometryPool::ReleaseStaging:
+    // ReleaseUploads once the command list is executed, or RetireUploads with the fence of the frame they were recorded into and ReleaseCompletedUploads
+    // once the GPU has passed it.
+    void ReleaseUploads();
+    void RetireUploads(UINT64 fenceValue);
+    void ReleaseCompletedUploads(UINT64 completedFenceValue);
+    size_t GetUploadsCount() const; // Not released yet, retired or not.
+    // Decodes all the files with DecodeImages first, then creates the textures in the order of filenames, so the SRV offsets don't depend on the decode order.
+    std::vector<RtvSrvUavResourceIdx> CreateTextures(RenderContext& ctx, const std::vector<std::string>& filenames, ImageDecodeStats* stats = nullptr);
     RtvSrvUavResourceIdx CreateTexture(RenderContext& ctx, D3D12_RESOURCE_DESC desc, const std::wstring& name, D3D12_RESOURCE_STATES initialState = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
     RtvSrvUavResourceIdx CreateRT(RenderContext& ctx, D3D12_RESOURCE_DESC desc, const std::wstring& name, D3D12_CLEAR_VALUE* clearValue = nullptr, bool createSRV = true, bool allowUAV = false);
 
@@ -55,17 +134,62 @@ public:
 
     UINT CreateDxrOutput(RenderContext& ctx, D3D12_RESOURCE_DESC desc);
 
+    UINT GetTexturesCount() const; // The SRV slots in use.
+
+    // Reads and decodes a png, exr or hdr file. Touches neither the device nor the manager, so it's safe on any thread.
+    static bool DecodeImage(const std::string& filename, DecodedImage& image);
+    // images[i] is filenames[i]. In parallel the files are handed out to the thread pool one by one, the largest first, so a big one doesn't start last.
+    // processing is either empty or has an entry for every file, the file is processed right after the decode by the same thread then.
+    // With an uploadDevice the cache hits are read straight to upload buffers, see TextureCache::Read.
+    static void DecodeImages(const std::vector<std::string>& filenames, std::vector<DecodedImage>& images, ImageDecodeStats* stats = nullptr, bool parallel = true,
+        const std::vector<ImageProcessing>& processing = {}, ID3D12Device* uploadDevice = nullptr);
+    // Once the image is uploaded or won't be: hands its pixels over to the pending TextureCache write without a copy and empties it.
+    static void ReleaseDecodedImage(DecodedImage& image);
+    // The full chain for R8G8B8A8_UNORM, R32G32B32A32_FLOAT and R32G32B32_FLOAT, returns false and leaves the image as is for the other formats.
+    static bool GenerateMips(DecodedImage& image, const MipSettings& settings);
+    static BlockFormat ChooseBlockFormat(UINT usage, TextureCompression compression, bool hasAlpha);
+    // Every level of an R8G8B8A8_UNORM image with the top one a multiple of 4 in both dimensions, as D3D12 wants for the block compressed
+    // textures. Returns false and leaves the image as is otherwise. The block rows of every level go to the thread pool.
+    static bool CompressImage(DecodedImage& image, BlockFormat format);
+
 private:
+    struct SharedTexture
+    {
+        RtvSrvUavResourceIdx Texture;
+        UINT RefCount = 0;
+        std::vector<std::string> Paths; // Every name it was created or found by, with ProcessingKey.
+        UINT64 SourceHash = 0;
+        UINT64 ProcessingKey = 0;
+    };
+
+    struct UploadBuffer
+    {
+        Microsoft::WRL::ComPtr<ID3D12Resource> Resource;
+        UINT64 FenceValue = 0; // Set when retired.
+    };
+
+    struct DeferredRelease
+    {
+        RtvSrvUavResourceIdx Texture;
+        UINT64 FenceValue = 0; // Set when retired.
+    };
+
+    RtvSrvUavResourceIdx AddReference(UINT srvOffset, const std::string& path, UINT64 processingKey);
+    void ReleaseNow(const RtvSrvUavResourceIdx& texture);
+
     void CreateSRVHeap(RenderContext& ctx);
     void CreateRTVHeap(RenderContext& ctx);
     void CreateUAVHeap(RenderContext& ctx);
 
-    bool ParsePNG(const std::string& filename, std::vector<byte>& buffer, UINT& w, UINT& h, DXGI_FORMAT& textureFormat);
-    bool ParseEXR(const std::string& filename, std::vector<byte>& buffer, UINT& w, UINT& h, DXGI_FORMAT& textureFormat);
-    bool ParseHDR(const std::string& filename, std::vector<byte>& buffer, UINT& w, UINT& h, DXGI_FORMAT& textureFormat);
+    static bool ParsePNG(const std::string& filename, std::vector<byte>& buffer, UINT& w, UINT& h, DXGI_FORMAT& textureFormat);
+    static bool ParseEXR(const std::string& filename, std::vector<byte>& buffer, UINT& w, UINT& h, DXGI_FORMAT& textureFormat);
+    static bool ParseHDR(const std::string& filename, std::vector<byte>& buffer, UINT& w, UINT& h, DXGI_FORMAT& textureFormat);
 
     std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>> m_resources;
-    std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>> m_uploadResources;
+    std::vector<UploadBuffer> m_uploads;
+    std::vector<UploadBuffer> m_retiredUploads; // In the fence order.
+    std::vector<DeferredRelease> m_releases;
+    std::vector<DeferredRelease> m_retiredReleases; // In the fence order.
     Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> m_srvHeap = nullptr;
     Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> m_rtvHeap = nullptr;
     Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> m_srvCubeHeap = nullptr;
@@ -77,6 +201,13 @@ private:
     Microsoft::WRL::ComPtr<ID3D12Resource> m_rtResource = nullptr;
     //
 
+    std::map<UINT, SharedTexture> m_sharedTextures; // By SRV offset.
+    std::map<std::pair<std::string, UINT64>, UINT> m_texturesByPath; // Path and processing key to the SRV offset.
+    std::map<std::pair<UINT64, UINT64>, UINT> m_texturesByContent; // Source hash and processing key to the SRV offset.
+    std::vector<UINT> m_freeSrvOffsets; // Of the released textures, taken before m_currentTexCount grows.
+    std::vector<UINT> m_freeResourceIdxs;
+    TextureSharingStats m_sharingStats;
+
     UINT m_currentTexCount = 0;
     UINT m_currentCubemapsCount = 0;
     UINT m_currentRTCount = 0;
@@ -110,6 +241,16 @@ inline ID3D12Resource* TextureManager::GetResource(UINT index) const
     return m_resources[index].Get();
 }
 
+inline const TextureSharingStats& TextureManager::GetSharingStats() const
+{
+    return m_sharingStats;
+}
+
+inline UINT TextureManager::GetTexturesCount() const
+{
+    return m_currentTexCount - UINT(m_freeSrvOffsets.size());
+}
+
 //////////////////////////////////////////////////////////////////////////
 /// Imgui Texture Manager
 //////////////////////////////////////////////////////////////////////////
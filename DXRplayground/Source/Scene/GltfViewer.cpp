@@ -24,7 +24,7 @@ GltfViewer::~GltfViewer()
     SafeDelete(m_cameraCb);
     SafeDelete(m_camera);
     SafeDelete(m_cameraController);
-    SafeDelete(m_objectCb);
+    SafeDelete(m_placeholder);
     SafeDelete(m_gltfMesh);
     SafeDelete(m_tonemapper);
     SafeDelete(m_lightManager);
@@ -37,7 +37,6 @@ void GltfViewer::InitResources(RenderContext& context)
 
     m_camera = new Camera(1.0472f, 1.77864583f, 0.001f, 1000.0f);
     m_cameraCb = new UploadBuffer(*context.Device, sizeof(CameraShaderData), true, context.FramesCount);
-    m_objectCb = new UploadBuffer(*context.Device, sizeof(XMFLOAT4X4), true, context.FramesCount);
     m_cameraController = new CameraController(m_camera);
     m_lightManager = new LightManager(context);
 
@@ -63,14 +62,21 @@ void GltfViewer::Render(RenderContext& context)
 
     UINT frameIndex = context.SwapChain->GetCurrentBackBufferIndex();
 
+    // The placeholder stays alive, the frames in flight may still draw it.
+    if (m_gltfMesh == nullptr && m_gltfMeshLoad.IsReady())
+        m_gltfMesh = m_gltfMeshLoad.Get();
+    Model* model = m_gltfMesh != nullptr ? m_gltfMesh : m_placeholder;
+
+    const XMFLOAT3 modelPosition = m_gltfMesh != nullptr ? XMFLOAT3{ 0.0f, 0.0f, 0.0f } : XMFLOAT3{ 0.0f, 0.0f, 3.0f };
     XMFLOAT4X4 toWorld;
-    XMStoreFloat4x4(&toWorld, XMMatrixTranspose(XMMatrixTranslation(0.0f, 0.0f, 3.0f)));
+    XMStoreFloat4x4(&toWorld, XMMatrixTranslation(modelPosition.x, modelPosition.y, modelPosition.z));
     m_cameraData.ViewProj = TransposeMatrix(m_camera->GetViewProjection());
     XMFLOAT4 camPos = m_camera->GetPosition();
     m_cameraData.Position = { camPos.x, camPos.y, camPos.z };
     m_cameraCb->UploadData(frameIndex, m_cameraData);
-    m_objectCb->UploadData(frameIndex, toWorld);
-    m_gltfMesh->UpdateMeshes(frameIndex);
+    model->SetTransform(toWorld);
+    model->UpdateMeshes(frameIndex);
+    CullMeshes(model);
 
     auto toRt = CD3DX12_RESOURCE_BARRIER::Transition(context.SwapChain->GetCurrentBackBuffer(), D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET);
     context.CommandList->ResourceBarrier(1, &toRt);
@@ -94,34 +100,93 @@ void GltfViewer::Render(RenderContext& context)
     context.CommandList->ClearDepthStencilView(context.SwapChain->GetDSCPUhandle(), D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
 
     context.CommandList->SetGraphicsRootSignature(m_commonRootSig.Get());
-    context.CommandList->SetPipelineState(context.PsoManager->GetPso(m_psoName));
     ID3D12DescriptorHeap* descHeap[] = { context.TexManager->GetDescriptorHeap() };
     context.CommandList->SetDescriptorHeaps(1, descHeap);
     context.CommandList->SetGraphicsRootConstantBufferView(GetCBRootParamIndex(0), m_cameraCb->GetFrameDataGpuAddress(frameIndex));
-    context.CommandList->SetGraphicsRootConstantBufferView(GetCBRootParamIndex(1), m_objectCb->GetFrameDataGpuAddress(frameIndex));
     context.CommandList->SetGraphicsRootConstantBufferView(GetCBRootParamIndex(3), m_lightManager->GetLightsBufferGpuAddress(frameIndex));
     context.CommandList->SetGraphicsRootDescriptorTable(TextureTableIndex, context.TexManager->GetDescriptorHeap()->GetGPUDescriptorHandleForHeapStart());
 
-    for (const auto mesh : m_gltfMesh->GetMeshes())
+    ImGui::Begin("LOD");
+    ImGui::SliderFloat("Max error (px)", &m_lodPixelError, 0.0f, 16.0f);
+    float lodProjectionScale = GetLodProjectionScale(m_camera->GetProjection(), float(context.Height));
+    if (m_gltfMesh == nullptr)
+        ImGui::Text("Streaming in the scene, drawing the placeholder");
+    else
+        ImGui::Text("Scene streamed in. CPU stage: %.1f ms, GPU handoff: %.1f ms", m_gltfMeshLoad.GetRequest()->CpuMs, m_gltfMeshLoad.GetRequest()->GpuMs);
+    ImGui::Text("Visible meshes: %u/%u", UINT(m_visibleMeshes.size()), UINT(model->GetMeshes().size()));
+    ID3D12PipelineState* pso = context.PsoManager->GetPso(m_psoName);
+    ID3D12PipelineState* quantizedPso = context.PsoManager->GetPso(m_quantizedPsoName);
+    m_lodHistogram.clear();
+    UINT64 trianglesCount = 0;
+    UINT64 fullTrianglesCount = 0;
+    for (UINT meshIndex : m_visibleMeshes)
     {
-        context.CommandList->SetGraphicsRootConstantBufferView(GetCBRootParamIndex(2), mesh->GetMaterialBufferGpuAddress(frameIndex));
-
-        context.CommandList->IASetVertexBuffers(0, 1, &mesh->GetVertexBufferView());
-        context.CommandList->IASetIndexBuffer(&mesh->GetIndexBufferView());
-
-        context.CommandList->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-        context.CommandList->DrawIndexedInstanced(mesh->GetIndexCount(), 1, 0, 0, 0);
+        const auto mesh = model->GetMeshes()[meshIndex];
+        // Per mesh from its world bounds centre, the depth sort uses the same distance.
+        XMVECTOR center = XMVectorSet(m_cullingBounds.CenterX[meshIndex], m_cullingBounds.CenterY[meshIndex], m_cullingBounds.CenterZ[meshIndex], 1.0f);
+        float distance = XMVectorGetX(XMVector3Length(center - XMLoadFloat4(&camPos)));
+        float meshScale = model->GetNodes().GetWorldScale(mesh->GetNodeIndex());
+        UINT lodIndex = mesh->SelectLod(distance, lodProjectionScale * meshScale, m_lodPixelError);
+        const MeshLod& lod = mesh->GetLod(lodIndex);
+        if (lodIndex >= m_lodHistogram.size())
+            m_lodHistogram.resize(lodIndex + 1, 0);
+        ++m_lodHistogram[lodIndex];
+        trianglesCount += lod.IndexCount / 3;
+        fullTrianglesCount += mesh->GetIndexCount() / 3;
+
+        DrawPacket packet;
+        packet.Pso = mesh->HasQuantizedVertices() ? quantizedPso : pso;
+        packet.AddCbv(GetCBRootParamIndex(1), mesh->GetTransformBufferGpuAddress(frameIndex));
+        packet.AddCbv(GetCBRootParamIndex(2), mesh->GetMaterialBufferGpuAddress(frameIndex));
+        if (mesh->HasQuantizedVertices())
+            packet.AddCbv(GetCBRootParamIndex(4), mesh->GetQuantizationBufferGpuAddress());
+        packet.VertexBuffer = mesh->GetVertexBufferView();
+        packet.IndexBuffer = mesh->GetIndexBufferView();
+        packet.IndexCount = lod.IndexCount;
+        packet.StartIndex = mesh->GetStartIndex() + lod.StartIndex;
+        packet.BaseVertex = mesh->GetBaseVertex();
+        packet.SortKey = DrawQueue::MakeSortKey(0, m_drawQueue.GetPsoId(packet.Pso), UINT(mesh->GetMaterialIndex() + 1), distance);
+        m_drawQueue.Submit(packet);
     }
+    // A line per level rather than per mesh, a scene has hundreds of them.
+    ImGui::Text("Triangles: %llu (%llu at LOD 0)", trianglesCount, fullTrianglesCount);
+    for (size_t i = 0; i < m_lodHistogram.size(); ++i)
+        ImGui::Text("LOD %u: %u meshes", UINT(i), m_lodHistogram[i]);
+    D3DDrawCommandList drawCommandList(context.CommandList);
+    m_drawQueue.Flush(drawCommandList);
+    const DrawStateStats& drawStats = m_drawQueue.GetLastFlushStats();
+    ImGui::Text("Draws: %u, PSO binds: %u (%u elided), CBV binds: %u (%u elided)", drawStats.Draws, drawStats.PsoBinds, drawStats.PsoElided, drawStats.CbvBinds, drawStats.CbvElided);
+    ImGui::Text("VB binds: %u (%u elided), IB binds: %u (%u elided)", drawStats.VertexBufferBinds, drawStats.VertexBufferElided, drawStats.IndexBufferBinds, drawStats.IndexBufferElided);
+    ImGui::End();
     m_tonemapper->Render(context);
 
     auto toPresent = CD3DX12_RESOURCE_BARRIER::Transition(context.SwapChain->GetCurrentBackBuffer(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT);
     context.CommandList->ResourceBarrier(1, &toPresent);
 }
 
+void GltfViewer::CullMeshes(const Model* model)
+{
+    m_cullingBounds.Clear();
+    for (const auto mesh : model->GetMeshes())
+    {
+        BoundingBox box;
+        float sphereRadius = 0.0f;
+        model->GetMeshWorldBounds(mesh, box, sphereRadius);
+        m_cullingBounds.Add(&box.Center.x, &box.Extents.x, sphereRadius);
+    }
+    m_visibleMeshes.resize(m_cullingBounds.Count);
+    size_t visibleCount = FrustumCull(ExtractFrustumPlanes(m_camera->GetViewProjection().m), m_cullingBounds, CullShape::Box, m_visibleMeshes.data());
+    m_visibleMeshes.resize(visibleCount);
+}
+
 void GltfViewer::LoadGeometry(RenderContext& context)
 {
-    auto path = ASSETS_DIR + std::string("Models//Avocado//glTF//Avocado.gltf");
-    m_gltfMesh = new Model(context, path);
+    ModelLoadSettings settings;
+    settings.LodErrors = { 0.002f, 0.01f, 0.04f };
+    settings.QuantizeVertices = true;
+    settings.CpuResidency = CpuMeshResidency::None;
+    m_gltfMeshLoad = context.ModelLoader->Load(ASSETS_DIR + std::string("Models//Sponza//glTF//Sponza.gltf"), settings);
+    m_placeholder = new Model(context, ASSETS_DIR + std::string("Models//Avocado//glTF//Avocado.gltf"), settings);
 }
 
 void GltfViewer::CreateRootSignature(RenderContext& context)
@@ -141,6 +206,11 @@ void GltfViewer::CreatePSOs(RenderContext& context)
 
     auto shaderPath = ASSETS_DIR_W + std::wstring(L"Shaders//PbrNonInstanced.hlsl");
     context.PsoManager->CreatePso(context, m_psoName, shaderPath, desc);
+
+    auto& quantizedInputLayout = GetInputLayoutQuantized();
+    desc.InputLayout = { quantizedInputLayout.data(), static_cast<UINT>(quantizedInputLayout.size()) };
+    auto quantizedShaderPath = ASSETS_DIR_W + std::wstring(L"Shaders//PbrNonInstancedQuantized.hlsl");
+    context.PsoManager->CreatePso(context, m_quantizedPsoName, quantizedShaderPath, desc);
 }
 
 void GltfViewer::UpdateLights(RenderContext& context)
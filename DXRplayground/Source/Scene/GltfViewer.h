@@ -7,7 +7,12 @@
 #include "CameraController.h"
 #include "Camera.h"
 
+#include "DXrenderer/Culling/FrustumCulling.h"
+#include "DXrenderer/DrawQueue.h"
+#include "DXrenderer/ModelLoader.h"
+
 #include <array>
+#include <vector>
 
 namespace DirectxPlayground
 {
@@ -31,12 +36,15 @@ private:
     void CreateRootSignature(RenderContext& context);
     void CreatePSOs(RenderContext& context);
     void UpdateLights(RenderContext& context);
+    void CullMeshes(const Model* model);
 
+    Model* m_placeholder = nullptr; // Drawn until m_gltfMesh streams in.
     Model* m_gltfMesh = nullptr;
+    ModelLoadHandle m_gltfMeshLoad;
     Microsoft::WRL::ComPtr<ID3D12RootSignature> m_commonRootSig; // Move to ctx. It's common after all
     UploadBuffer* m_cameraCb = nullptr;
-    UploadBuffer* m_objectCb = nullptr;
     const std::string m_psoName = "Opaque_PBR";
+    const std::string m_quantizedPsoName = "Opaque_PBR_Quantized";
 
     Camera* m_camera = nullptr;
     CameraController* m_cameraController = nullptr;
@@ -44,6 +52,11 @@ private:
     LightManager* m_lightManager = nullptr;
     EnvironmentMap* m_envMap = nullptr;
     UINT m_directionalLightInd = 0;
+    float m_lodPixelError = 1.0f;
+    CullingBounds m_cullingBounds; // Of the drawn model meshes, in the same order.
+    std::vector<UINT> m_visibleMeshes;
+    std::vector<UINT> m_lodHistogram; // Visible meshes per selected LOD, for the LOD window.
+    DrawQueue m_drawQueue;
     CameraShaderData m_cameraData{};
 };
 }
\ No newline at end of file
@@ -0,0 +1,86 @@
+#include "Scene/LoadingBenchmark.h"
+
+#include "DXrenderer/Swapchain.h"
+#include "DXrenderer/Model.h"
+
+#include "Utils/Logger.h"
+
+#include "External/IMGUI/imgui.h"
+
+namespace DirectxPlayground
+{
+LoadingBenchmark::~LoadingBenchmark()
+{
+    for (auto model : m_models)
+        SafeDelete(model);
+}
+
+void LoadingBenchmark::InitResources(RenderContext& context)
+{
+    const std::string sponza = ASSETS_DIR + std::string("Models//Sponza//glTF//Sponza.gltf");
+    const std::string flightHelmet = ASSETS_DIR + std::string("Models//FlightHelmet//glTF//FlightHelmet.gltf");
+    const std::string avocado = ASSETS_DIR + std::string("Models//Avocado//glTF//Avocado.gltf");
+    const std::string avocadoQuantized = ASSETS_DIR + std::string("Models//Avocado//glTF-Quantized//Avocado.gltf");
+
+    // A model is loaded again only for the settings the earlier loads didn't cover, the rest reads the results of those.
+    BenchmarkBufferMapping(context, sponza);
+    BenchmarkBufferMapping(context, flightHelmet);
+    for (const std::string& path : { flightHelmet, avocadoQuantized, sponza })
+        BenchmarkQuantization(path, BenchmarkModelStages(context, path));
+    BenchmarkWelding(context, flightHelmet);
+    BenchmarkWelding(context, sponza);
+    BenchmarkGeometryPool(context, sponza, BenchmarkMeshCache(context, sponza));
+    BenchmarkAsyncLoading(context, sponza);
+
+    BenchmarkTextureDecoding(flightHelmet);
+    BenchmarkTextureDecoding(sponza);
+    BenchmarkMipGeneration(2048, 16);
+    BenchmarkBlockCompression(ASSETS_DIR + std::string("Models//FlightHelmet//glTF//FlightHelmet_Materials_MetalPartsMat_BaseColor.png"));
+    BenchmarkBlockCompression(ASSETS_DIR + std::string("Models//FlightHelmet//glTF//FlightHelmet_Materials_MetalPartsMat_Normal.png"));
+    BenchmarkBlockCompression(ASSETS_DIR + std::string("Models//FlightHelmet//glTF//FlightHelmet_Materials_MetalPartsMat_OcclusionRoughMetal.png"));
+    BenchmarkTextureCompression(flightHelmet);
+    BenchmarkTextureCache(context, flightHelmet);
+    BenchmarkTextureCache(context, sponza);
+    BenchmarkTextureSharing(context, avocado, avocadoQuantized);
+
+    BenchmarkAccessorGather(4'000'000);
+    BenchmarkSparseAccessor(4'000'000, 1'000'000);
+    BenchmarkNodeTransforms(100'000);
+    BenchmarkOffsetAllocator(100'000);
+
+    BenchmarkFrustumCulling(100'000);
+    BenchmarkOcclusionCulling(1'000, 100'000);
+    BenchmarkDrawSorting(100'000);
+    BenchmarkInstancing(10'000);
+    BenchmarkInstancing(100'000);
+    BenchmarkInstancing(1'000'000);
+}
+
+void LoadingBenchmark::Render(RenderContext& context)
+{
+    auto toRt = CD3DX12_RESOURCE_BARRIER::Transition(context.SwapChain->GetCurrentBackBuffer(), D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET);
+    context.CommandList->ResourceBarrier(1, &toRt);
+
+    const float clearColor[] = { 0.1f, 0.1f, 0.1f, 1.0f };
+    context.CommandList->ClearRenderTargetView(context.SwapChain->GetCurrentBackBufferCPUhandle(context), clearColor, 0, nullptr);
+
+    ImGui::Begin("Loading benchmark");
+    for (const auto& m : m_measurements)
+        ImGui::Text("%-60s %10.3f %s", m.Name.c_str(), m.Value, m.Unit.c_str());
+    ImGui::End();
+
+    auto toPresent = CD3DX12_RESOURCE_BARRIER::Transition(context.SwapChain->GetCurrentBackBuffer(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT);
+    context.CommandList->ResourceBarrier(1, &toPresent);
+}
+
+void LoadingBenchmark::AddMeasurement(std::string name, double ms)
+{
+    AddMeasurement(std::move(name), ms, "ms");
+}
+
+void LoadingBenchmark::AddMeasurement(std::string name, double value, std::string unit)
+{
+    LOG(name, ": ", value, " ", unit);
+    m_measurements.push_back({ std::move(name), value, std::move(unit) });
+}
+}
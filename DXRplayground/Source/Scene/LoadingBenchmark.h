@@ -0,0 +1,64 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "Scene/Scene.h"
+
+namespace DirectxPlayground
+{
+class Model;
+
+// Not a real scene. Loads the bundled assets with different loader settings and shows the timings.
+class LoadingBenchmark : public Scene
+{
+public:
+    ~LoadingBenchmark() override;
+
+    void InitResources(RenderContext& context) override;
+    void Render(RenderContext& context) override;
+
+private:
+    struct Measurement
+    {
+        std::string Name;
+        double Value = 0.0;
+        std::string Unit;
+    };
+
+    // LoadingBenchmarkModels.cpp. The ones returning a model keep it alive for the others to read the results from.
+    const Model& BenchmarkModelStages(RenderContext& context, const std::string& path);
+    void BenchmarkBufferMapping(RenderContext& context, const std::string& path);
+    void BenchmarkWelding(RenderContext& context, const std::string& path);
+    void BenchmarkQuantization(const std::string& path, const Model& model);
+    const Model& BenchmarkMeshCache(RenderContext& context, const std::string& path);
+    void BenchmarkAsyncLoading(RenderContext& context, const std::string& path);
+    void BenchmarkGeometryPool(RenderContext& context, const std::string& path, const Model& pooledModel);
+
+    // LoadingBenchmarkTextures.cpp
+    void BenchmarkTextureDecoding(const std::string& path);
+    void BenchmarkMipGeneration(UINT size, size_t texturesCount);
+    void BenchmarkBlockCompression(const std::string& imagePath);
+    void BenchmarkTextureCompression(const std::string& path);
+    void BenchmarkTextureCache(RenderContext& context, const std::string& path);
+    void BenchmarkTextureSharing(RenderContext& context, const std::string& path, const std::string& copyPath);
+
+    // LoadingBenchmarkKernels.cpp
+    void BenchmarkAccessorGather(size_t vertexCount);
+    void BenchmarkSparseAccessor(size_t vertexCount, size_t sparseCount);
+    void BenchmarkNodeTransforms(size_t nodeCount);
+    void BenchmarkOffsetAllocator(size_t allocationCount);
+
+    // LoadingBenchmarkCulling.cpp
+    void BenchmarkFrustumCulling(size_t boundsCount);
+    void BenchmarkOcclusionCulling(size_t occluderCount, size_t boundsCount);
+    void BenchmarkDrawSorting(size_t packetCount);
+    void BenchmarkInstancing(size_t instanceCount);
+
+    void AddMeasurement(std::string name, double ms);
+    void AddMeasurement(std::string name, double value, std::string unit);
+
+    std::vector<Measurement> m_measurements;
+    std::vector<Model*> m_models;
+};
+}
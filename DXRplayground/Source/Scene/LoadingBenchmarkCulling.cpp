@@ -0,0 +1,269 @@
+#include "Scene/LoadingBenchmark.h"
+
+#include "DXrenderer/DrawQueue.h"
+#include "DXrenderer/InstanceBatcher.h"
+#include "DXrenderer/Culling/FrustumCulling.h"
+#include "DXrenderer/Culling/OcclusionBuffer.h"
+
+#include "Utils/RadixSort.h"
+#include "Utils/Timer.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <DirectXMath.h>
+#include <random>
+
+using namespace DirectX;
+
+namespace DirectxPlayground
+{
+namespace
+{
+// Swallows the calls, the flush timing is the queue's own work. Tests/DrawQueueTests.cpp checks what it records.
+class NullCommandList : public IDrawCommandList
+{
+public:
+    void SetPipelineState(ID3D12PipelineState*) override {}
+    void SetGraphicsRootConstantBufferView(UINT, D3D12_GPU_VIRTUAL_ADDRESS) override {}
+    void SetGraphicsRootShaderResourceView(UINT, D3D12_GPU_VIRTUAL_ADDRESS) override {}
+    void IASetVertexBuffers(const D3D12_VERTEX_BUFFER_VIEW&) override {}
+    void IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW&) override {}
+    void IASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY) override {}
+    void DrawIndexedInstanced(UINT, UINT, UINT, INT, UINT) override {}
+};
+}
+
+void LoadingBenchmark::BenchmarkFrustumCulling(size_t boundsCount)
+{
+    // Boxes scattered around the camera, roughly a sixth of them ends up in the frustum.
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> position(-200.0f, 200.0f);
+    std::uniform_real_distribution<float> size(0.1f, 5.0f);
+    CullingBounds bounds;
+    bounds.Reserve(boundsCount);
+    for (size_t i = 0; i < boundsCount; ++i)
+    {
+        float center[3] = { position(rng), position(rng), position(rng) };
+        float extents[3] = { size(rng), size(rng), size(rng) };
+        bounds.Add(center, extents, std::sqrt(extents[0] * extents[0] + extents[1] * extents[1] + extents[2] * extents[2]));
+    }
+
+    XMFLOAT4X4 viewProjection;
+    XMMATRIX view = XMMatrixLookAtLH(XMVectorSet(0.0f, 10.0f, -20.0f, 1.0f), XMVectorSet(0.0f, 0.0f, 50.0f, 1.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+    XMStoreFloat4x4(&viewProjection, view * XMMatrixPerspectiveFovLH(1.0472f, 1.77864583f, 0.1f, 300.0f));
+    FrustumPlanes planes = ExtractFrustumPlanes(viewProjection.m);
+
+    std::string countStr = std::to_string(boundsCount / 1000) + "k";
+    std::vector<UINT> visible(boundsCount);
+    for (CullShape shape : { CullShape::Box, CullShape::Sphere })
+    {
+        std::string prefix = "Frustum culling " + countStr + (shape == CullShape::Box ? " boxes" : " spheres");
+        AddMeasurement(prefix + " visible", double(FrustumCull(planes, bounds, shape, visible.data(), SimdLevel::Scalar)), "");
+
+        for (SimdLevel level : { SimdLevel::Scalar, SimdLevel::SSE41, SimdLevel::AVX2 })
+        {
+            if (level > GetSimdLevel())
+                continue;
+            static const char* levelNames[] = { "scalar", "sse4.1", "avx2" };
+            // A single pass is well under a millisecond, the best of a few runs is less noisy.
+            double bestMs = DBL_MAX;
+            for (UINT run = 0; run < 10; ++run)
+            {
+                Timer timer;
+                FrustumCull(planes, bounds, shape, visible.data(), level);
+                bestMs = std::min(bestMs, timer.GetElapsedMs());
+            }
+            AddMeasurement(prefix + " " + levelNames[UINT(level)], bestMs);
+        }
+    }
+}
+
+void LoadingBenchmark::BenchmarkOcclusionCulling(size_t occluderCount, size_t boundsCount)
+{
+    // Random wall quads in front of the camera as occluders and small boxes scattered behind them.
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> position(-60.0f, 60.0f);
+    std::uniform_real_distribution<float> occluderDepth(10.0f, 80.0f);
+    std::uniform_real_distribution<float> occluderSize(1.0f, 6.0f);
+    std::vector<XMFLOAT3> occluderVertices;
+    std::vector<UINT> occluderIndices;
+    for (size_t i = 0; i < occluderCount; ++i)
+    {
+        float x = position(rng) * 0.5f;
+        float y = position(rng) * 0.3f;
+        float z = occluderDepth(rng);
+        float halfWidth = occluderSize(rng);
+        float halfHeight = occluderSize(rng);
+        UINT base = UINT(occluderVertices.size());
+        occluderVertices.push_back({ x - halfWidth, y - halfHeight, z });
+        occluderVertices.push_back({ x + halfWidth, y - halfHeight, z });
+        occluderVertices.push_back({ x + halfWidth, y + halfHeight, z });
+        occluderVertices.push_back({ x - halfWidth, y + halfHeight, z });
+        for (UINT index : { 0, 1, 2, 0, 2, 3 })
+            occluderIndices.push_back(base + index);
+    }
+    CullingBounds bounds;
+    bounds.Reserve(boundsCount);
+    std::uniform_real_distribution<float> boundsDepth(20.0f, 150.0f);
+    std::uniform_real_distribution<float> size(0.1f, 2.0f);
+    for (size_t i = 0; i < boundsCount; ++i)
+    {
+        float center[3] = { position(rng), position(rng) * 0.5f, boundsDepth(rng) };
+        float extents[3] = { size(rng), size(rng), size(rng) };
+        bounds.Add(center, extents, std::sqrt(extents[0] * extents[0] + extents[1] * extents[1] + extents[2] * extents[2]));
+    }
+
+    XMFLOAT4X4 viewProjection;
+    XMStoreFloat4x4(&viewProjection, XMMatrixPerspectiveFovLH(1.0472f, 1.77864583f, 0.1f, 300.0f));
+    std::string prefix = "Occlusion " + std::to_string(occluderCount * 2) + " triangles";
+    const byte* positions = reinterpret_cast<const byte*>(occluderVertices.data());
+
+    OcclusionBuffer buffer(320, 180);
+    for (SimdLevel level : { SimdLevel::Scalar, SimdLevel::SSE41, SimdLevel::AVX2 })
+    {
+        if (level > GetSimdLevel())
+            continue;
+        static const char* levelNames[] = { "scalar", "sse4.1", "avx2" };
+        for (bool parallel : { false, true })
+        {
+            buffer.Clear();
+            Timer timer;
+            buffer.AddOccluder(positions, sizeof(XMFLOAT3), occluderVertices.size(), occluderIndices.data(), occluderIndices.size(), viewProjection.m);
+            buffer.Rasterize(level, parallel);
+            AddMeasurement(prefix + " " + levelNames[UINT(level)] + (parallel ? " tiles on the pool" : " serial"), timer.GetElapsedMs());
+        }
+    }
+
+    std::vector<UINT> visible(boundsCount);
+    size_t frustumVisible = FrustumCull(ExtractFrustumPlanes(viewProjection.m), bounds, CullShape::Box, visible.data());
+    Timer timer;
+    size_t unoccluded = buffer.FilterVisible(bounds, visible.data(), frustumVisible, viewProjection.m);
+    std::string countStr = std::to_string(boundsCount / 1000) + "k";
+    AddMeasurement("Occlusion test of " + countStr + " boxes (" + std::to_string(frustumVisible) + " in the frustum)", timer.GetElapsedMs());
+    AddMeasurement("Occlusion " + countStr + " boxes occluded", double(frustumVisible - unoccluded), "");
+    buffer.SaveDebugImage("OcclusionBenchmarkDepth.png");
+}
+
+void LoadingBenchmark::BenchmarkDrawSorting(size_t packetCount)
+{
+    // A scene-like mix: a few PSOs, a few hundred materials and meshes in a handful of pooled buffers, a transform per draw.
+    constexpr UINT PsoCount = 8;
+    constexpr UINT MaterialCount = 256;
+    constexpr UINT MeshCount = 1024;
+    constexpr UINT PoolBlockCount = 4;
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<UINT> psoDist(0, PsoCount - 1);
+    std::uniform_int_distribution<UINT> materialDist(0, MaterialCount - 1);
+    std::uniform_int_distribution<UINT> meshDist(0, MeshCount - 1);
+    std::uniform_real_distribution<float> depthDist(0.1f, 500.0f);
+
+    DrawQueue queue;
+    std::vector<DrawPacket> packets(packetCount);
+    for (size_t i = 0; i < packetCount; ++i)
+    {
+        DrawPacket& packet = packets[i];
+        // Never dereferenced, only compared.
+        packet.Pso = reinterpret_cast<ID3D12PipelineState*>(uintptr_t(psoDist(rng) + 1) * 0x100);
+        UINT material = materialDist(rng);
+        UINT mesh = meshDist(rng);
+        UINT block = mesh % PoolBlockCount;
+        packet.AddCbv(1, 0x10000000ull + i * 256);
+        packet.AddCbv(2, 0x20000000ull + material * 256);
+        packet.VertexBuffer = { 0x30000000ull + block * 0x1000000ull, 0x1000000, 48 };
+        packet.IndexBuffer = { 0x40000000ull + block * 0x1000000ull, 0x1000000, DXGI_FORMAT_R32_UINT };
+        packet.IndexCount = 3 * (mesh + 1);
+        packet.StartIndex = mesh * 4096;
+        packet.BaseVertex = INT(mesh * 1024);
+        packet.SortKey = DrawQueue::MakeSortKey(0, queue.GetPsoId(packet.Pso), material, depthDist(rng));
+    }
+
+    std::string countStr = std::to_string(packetCount / 1000) + "k";
+    std::vector<UINT64> keys(packetCount);
+    std::vector<UINT> order(packetCount);
+    std::vector<UINT64> keysScratch(packetCount);
+    std::vector<UINT> orderScratch(packetCount);
+    double bestRadixMs = DBL_MAX;
+    for (UINT run = 0; run < 10; ++run)
+    {
+        for (UINT i = 0; i < packetCount; ++i)
+        {
+            keys[i] = packets[i].SortKey;
+            order[i] = i;
+        }
+        Timer timer;
+        RadixSort(keys.data(), order.data(), packetCount, keysScratch.data(), orderScratch.data());
+        bestRadixMs = std::min(bestRadixMs, timer.GetElapsedMs());
+    }
+    AddMeasurement("Draw sort " + countStr + " keys radix", bestRadixMs);
+
+    std::vector<UINT> referenceOrder(packetCount);
+    double bestStdMs = DBL_MAX;
+    for (UINT run = 0; run < 10; ++run)
+    {
+        for (UINT i = 0; i < packetCount; ++i)
+            referenceOrder[i] = i;
+        Timer timer;
+        std::stable_sort(referenceOrder.begin(), referenceOrder.end(), [&packets](UINT a, UINT b) { return packets[a].SortKey < packets[b].SortKey; });
+        bestStdMs = std::min(bestStdMs, timer.GetElapsedMs());
+    }
+    AddMeasurement("Draw sort " + countStr + " keys std::stable_sort", bestStdMs);
+
+    NullCommandList commandList;
+    Timer timer;
+    for (const DrawPacket& packet : packets)
+        queue.Submit(packet);
+    queue.Flush(commandList);
+    AddMeasurement("Draw queue " + countStr + " packets submit, sort and record", timer.GetElapsedMs());
+
+    const DrawStateStats& stats = queue.GetLastFlushStats();
+    const UINT binds = stats.PsoBinds + stats.CbvBinds + stats.SrvBinds + stats.VertexBufferBinds + stats.IndexBufferBinds + stats.TopologyBinds;
+    const UINT elided = stats.PsoElided + stats.CbvElided + stats.SrvElided + stats.VertexBufferElided + stats.IndexBufferElided + stats.TopologyElided;
+    AddMeasurement("Draw queue " + countStr + " command list calls unfiltered", double(stats.Draws + binds + elided), "");
+    AddMeasurement("Draw queue " + countStr + " command list calls filtered", double(stats.Draws + binds), "");
+    AddMeasurement("Draw queue " + countStr + " PSO binds elided", double(stats.PsoElided), "");
+    AddMeasurement("Draw queue " + countStr + " CBV binds elided", double(stats.CbvElided), "");
+    AddMeasurement("Draw queue " + countStr + " VB binds elided", double(stats.VertexBufferElided), "");
+    AddMeasurement("Draw queue " + countStr + " IB binds elided", double(stats.IndexBufferElided), "");
+}
+
+void LoadingBenchmark::BenchmarkInstancing(size_t instanceCount)
+{
+    // A few hundred meshes with a few materials each, added in random order. Tests/InstanceBatcherTests.cpp checks the groups.
+    constexpr UINT MeshCount = 500;
+    constexpr UINT MaterialCount = 4;
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<UINT> meshDist(0, MeshCount - 1);
+    std::uniform_int_distribution<UINT> materialDist(0, MaterialCount - 1);
+    std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+    std::vector<UINT> meshes(instanceCount);
+    std::vector<UINT> materials(instanceCount);
+    std::vector<XMFLOAT4X4> transforms(instanceCount);
+    for (size_t i = 0; i < instanceCount; ++i)
+    {
+        meshes[i] = meshDist(rng);
+        materials[i] = materialDist(rng);
+        XMStoreFloat4x4(&transforms[i], XMMatrixRotationY(position(rng)) * XMMatrixTranslation(position(rng), position(rng), position(rng)));
+    }
+
+    std::string prefix = "Instancing " + std::to_string(instanceCount / 1000) + "k";
+    InstanceBatcher batcher;
+    for (bool parallel : { false, true })
+    {
+        batcher.Clear();
+        batcher.Reserve(instanceCount);
+        Timer timer;
+        for (size_t i = 0; i < instanceCount; ++i)
+            batcher.Add(meshes[i], materials[i], transforms[i].m, UINT(i));
+        double addMs = timer.GetElapsedMs();
+        timer.Reset();
+        batcher.Build(parallel);
+        double buildMs = timer.GetElapsedMs();
+        if (!parallel)
+            AddMeasurement(prefix + " add", addMs);
+        AddMeasurement(prefix + " group and pack" + (parallel ? " on the pool" : " serial"), buildMs);
+    }
+
+    AddMeasurement(prefix + " groups (draws)", double(batcher.GetGroups().size()), "");
+}
+}
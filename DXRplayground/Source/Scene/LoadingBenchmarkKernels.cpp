@@ -0,0 +1,174 @@
+#include "Scene/LoadingBenchmark.h"
+
+#include "DXrenderer/Model.h"
+#include "DXrenderer/NodeHierarchy.h"
+#include "DXrenderer/Geometry/AccessorGather.h"
+
+#include "Utils/OffsetAllocator.h"
+#include "Utils/Timer.h"
+
+#include <algorithm>
+#include <random>
+
+namespace DirectxPlayground
+{
+void LoadingBenchmark::BenchmarkAccessorGather(size_t vertexCount)
+{
+    constexpr UINT tightStride = sizeof(float) * 3;
+    constexpr UINT interleavedStride = sizeof(float) * 8; // pos + normal + uv, the usual exporter layout
+    const float scale[3] = { 0.008f, 0.008f, 0.008f };
+
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> dist(-100.0f, 100.0f);
+    std::vector<float> source(vertexCount * interleavedStride / sizeof(float));
+    for (auto& f : source)
+        f = dist(rng);
+    std::vector<Vertex> vertices(vertexCount);
+
+    std::string countStr = std::to_string(vertexCount / 1'000'000) + "M";
+    for (UINT stride : { tightStride, interleavedStride })
+    {
+        std::string layout = stride == tightStride ? " packed float3 " : " strided float3 ";
+        const byte* src = reinterpret_cast<const byte*>(source.data());
+
+        // The scalar level is the per element loop, Tests/AccessorGatherTests.cpp checks the others against it.
+        for (SimdLevel level : { SimdLevel::Scalar, SimdLevel::SSE41, SimdLevel::AVX2 })
+        {
+            if (level > GetSimdLevel())
+                continue;
+            static const char* levelNames[] = { "scalar", "sse4.1", "avx2" };
+            Timer timer;
+            GatherFloatElements(src, stride, reinterpret_cast<byte*>(vertices.data()) + offsetof(Vertex, Pos), sizeof(Vertex), vertexCount, 3, scale, level);
+            AddMeasurement("Gather" + layout + countStr + " " + levelNames[UINT(level)], timer.GetElapsedMs());
+        }
+    }
+
+    // KHR_mesh_quantization style positions: normalized shorts padded to 8 bytes.
+    std::vector<SHORT> quantized(vertexCount * 4);
+    for (auto& q : quantized)
+        q = SHORT(rng());
+    const byte* src = reinterpret_cast<const byte*>(quantized.data());
+    for (SimdLevel level : { SimdLevel::Scalar, SimdLevel::SSE41 })
+    {
+        if (level > GetSimdLevel())
+            continue;
+        Timer timer;
+        GatherElements(src, sizeof(SHORT) * 4, ComponentType::Short, true, reinterpret_cast<byte*>(vertices.data()) + offsetof(Vertex, Pos), sizeof(Vertex), vertexCount, 3, scale, nullptr, level);
+        AddMeasurement("Gather snorm16 " + countStr + (level == SimdLevel::Scalar ? " scalar" : " sse4.1"), timer.GetElapsedMs());
+    }
+}
+
+void LoadingBenchmark::BenchmarkSparseAccessor(size_t vertexCount, size_t sparseCount)
+{
+    // Morph target style: float3 deltas for a sorted random subset of the vertices, 32 bit indices.
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    std::vector<UINT> indices(vertexCount);
+    for (UINT i = 0; i < vertexCount; ++i)
+        indices[i] = i;
+    std::shuffle(indices.begin(), indices.end(), rng);
+    indices.resize(sparseCount);
+    std::sort(indices.begin(), indices.end());
+    std::vector<float> values(sparseCount * 3);
+    for (auto& v : values)
+        v = dist(rng);
+
+    std::string countStr = std::to_string(sparseCount / 1000) + "k of " + std::to_string(vertexCount / 1'000'000) + "M";
+    std::vector<Vertex> reference(vertexCount);
+    Timer timer;
+    for (size_t i = 0; i < sparseCount; ++i)
+        reference[indices[i]].Pos = { values[i * 3 + 0], values[i * 3 + 1], values[i * 3 + 2] };
+    AddMeasurement("Sparse scatter " + countStr + " reference loop", timer.GetElapsedMs());
+
+    std::vector<Vertex> vertices(vertexCount);
+    for (SimdLevel level : { SimdLevel::Scalar, SimdLevel::SSE41 })
+    {
+        if (level > GetSimdLevel())
+            continue;
+        timer.Reset();
+        ScatterElements(reinterpret_cast<const byte*>(indices.data()), ComponentType::UnsignedInt, reinterpret_cast<const byte*>(values.data()), ComponentType::Float, false,
+            reinterpret_cast<byte*>(vertices.data()) + offsetof(Vertex, Pos), sizeof(Vertex), vertexCount, sparseCount, 3, nullptr, nullptr, level);
+        AddMeasurement("Sparse scatter " + countStr + (level == SimdLevel::Scalar ? " scalar" : " sse4.1"), timer.GetElapsedMs());
+    }
+}
+
+void LoadingBenchmark::BenchmarkNodeTransforms(size_t nodeCount)
+{
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    NodeHierarchy nodes;
+    nodes.Reserve(nodeCount);
+    for (size_t i = 0; i < nodeCount; ++i)
+    {
+        UINT parent = i == 0 ? NodeHierarchy::NoParent : UINT(rng() % i);
+        XMFLOAT4 rotation;
+        XMStoreFloat4(&rotation, XMQuaternionRotationRollPitchYaw(dist(rng), dist(rng), dist(rng)));
+        float scale = 1.0f + dist(rng) * 0.1f;
+        nodes.AddNode(parent, { dist(rng), dist(rng), dist(rng) }, rotation, { scale, scale, scale });
+    }
+    std::string countStr = std::to_string(nodeCount / 1000) + "k";
+
+    // What a pointer tree without the cached parent transforms costs: every node walks up to the root.
+    Timer timer;
+    std::vector<XMFLOAT4X4> reference(nodeCount);
+    for (UINT i = 0; i < nodeCount; ++i)
+    {
+        XMMATRIX world = XMMatrixIdentity();
+        for (UINT n = i; n != NodeHierarchy::NoParent; n = nodes.GetParent(n))
+        {
+            XMMATRIX local = XMMatrixAffineTransformation(XMLoadFloat3(&nodes.GetScale(n)), XMVectorZero(), XMLoadFloat4(&nodes.GetRotation(n)), XMLoadFloat3(&nodes.GetTranslation(n)));
+            world = XMMatrixMultiply(world, local);
+        }
+        XMStoreFloat4x4(&reference[i], world);
+    }
+    AddMeasurement("Node transforms " + countStr + " walk to the root (reference)", timer.GetElapsedMs());
+
+    timer.Reset();
+    nodes.UpdateWorldTransforms();
+    AddMeasurement("Node transforms " + countStr + " linear pass", timer.GetElapsedMs());
+
+    // Only the nodes after the changed one are recomputed.
+    UINT changed = UINT(nodeCount * 9 / 10);
+    nodes.SetTranslation(changed, { 0.0f, 1.0f, 0.0f });
+    timer.Reset();
+    nodes.UpdateWorldTransforms();
+    AddMeasurement("Node transforms " + countStr + " update after changing node " + std::to_string(changed), timer.GetElapsedMs());
+}
+
+void LoadingBenchmark::BenchmarkOffsetAllocator(size_t allocationCount)
+{
+    // Random sizes, then every other allocation freed and allocated again, which is the fragmenting pattern of streaming meshes in and out.
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<UINT64> sizes(64, 64 * 1024);
+    std::vector<UINT64> requested(allocationCount);
+    UINT64 total = 0;
+    for (auto& size : requested)
+    {
+        size = sizes(rng);
+        total += size;
+    }
+
+    OffsetAllocator allocator(total + total / 4);
+    std::vector<OffsetAllocator::Allocation> allocations(allocationCount);
+    std::string countStr = std::to_string(allocationCount);
+
+    Timer timer;
+    for (size_t i = 0; i < allocationCount; ++i)
+        allocations[i] = allocator.Allocate(requested[i]);
+    AddMeasurement("Offset allocator " + countStr + " allocations", timer.GetElapsedMs());
+
+    timer.Reset();
+    for (size_t i = 0; i < allocationCount; i += 2)
+        allocator.Free(allocations[i]);
+    for (size_t i = 0; i < allocationCount; i += 2)
+        allocations[i] = allocator.Allocate(requested[(i + 1) % allocationCount]);
+    AddMeasurement("Offset allocator " + countStr + " churn", timer.GetElapsedMs());
+
+    AddMeasurement("Offset allocator free ranges", double(allocator.GetFreeRangesCount()), "");
+
+    timer.Reset();
+    for (const auto& allocation : allocations)
+        allocator.Free(allocation);
+    AddMeasurement("Offset allocator " + countStr + " frees", timer.GetElapsedMs());
+}
+}
@@ -0,0 +1,341 @@
+#include "Scene/LoadingBenchmark.h"
+
+#include "DXrenderer/Model.h"
+#include "DXrenderer/ModelLoader.h"
+#include "DXrenderer/RenderContext.h"
+#include "DXrenderer/Buffers/GeometryPool.h"
+#include "DXrenderer/Geometry/MeshCache.h"
+
+#include "Utils/Timer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <psapi.h>
+#include <set>
+#include <thread>
+
+namespace DirectxPlayground
+{
+namespace
+{
+// The OS peak counters can't be reset between the runs, so the memory is sampled from a helper thread while the work is running.
+class MemoryPeakSampler
+{
+public:
+    MemoryPeakSampler()
+    {
+        Sample(m_baselinePrivate, m_baselineWorkingSet);
+        m_peakPrivate = m_baselinePrivate;
+        m_peakWorkingSet = m_baselineWorkingSet;
+        m_thread = std::thread([this]()
+        {
+            while (!m_stop)
+            {
+                Update();
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        });
+    }
+    ~MemoryPeakSampler()
+    {
+        Stop();
+    }
+
+    void Stop()
+    {
+        if (!m_thread.joinable())
+            return;
+        m_stop = true;
+        m_thread.join();
+        Update();
+    }
+
+    double GetPeakPrivateMb() const
+    {
+        return double(m_peakPrivate - m_baselinePrivate) / (1024.0 * 1024.0);
+    }
+    double GetPeakWorkingSetMb() const
+    {
+        return double(m_peakWorkingSet - m_baselineWorkingSet) / (1024.0 * 1024.0);
+    }
+
+private:
+    static void Sample(size_t& privateBytes, size_t& workingSet)
+    {
+        PROCESS_MEMORY_COUNTERS_EX counters{};
+        GetProcessMemoryInfo(GetCurrentProcess(), reinterpret_cast<PROCESS_MEMORY_COUNTERS*>(&counters), sizeof(counters));
+        privateBytes = counters.PrivateUsage;
+        workingSet = counters.WorkingSetSize;
+    }
+
+    void Update()
+    {
+        size_t privateBytes = 0;
+        size_t workingSet = 0;
+        Sample(privateBytes, workingSet);
+        m_peakPrivate = std::max(m_peakPrivate, privateBytes);
+        m_peakWorkingSet = std::max(m_peakWorkingSet, workingSet);
+    }
+
+    std::thread m_thread;
+    std::atomic<bool> m_stop{ false };
+    size_t m_baselinePrivate = 0;
+    size_t m_baselineWorkingSet = 0;
+    size_t m_peakPrivate = 0;
+    size_t m_peakWorkingSet = 0;
+};
+}
+
+const Model& LoadingBenchmark::BenchmarkModelStages(RenderContext& context, const std::string& path)
+{
+    std::string name = path.substr(path.find_last_of("/\\") + 1);
+
+    // Every optional stage at once, the stats split the time between them. Serial and then parallel, the last one is returned for the benchmarks reading the results.
+    ModelLoadSettings settings;
+    settings.UseMeshCache = false; // The stage stats are gathered only when the stages actually run.
+    settings.OptimizeMeshes = true; // Meshlet seeds follow the index order, the optimized one gives tighter meshlets.
+    settings.BuildMeshlets = true;
+    settings.LodErrors = { 0.002f, 0.01f, 0.04f };
+    settings.QuantizeVertices = true;
+    settings.ShareTextures = false; // Both create all their textures, so the totals compare the same work.
+    Model* model = nullptr;
+    for (bool parallel : { false, true })
+    {
+        settings.ParallelDecode = parallel;
+        Timer timer;
+        model = new Model(context, path, settings);
+        double totalMs = timer.GetElapsedMs();
+        m_models.push_back(model); // Upload heaps are referenced by the init command list, keep the models alive.
+
+        const ModelLoadStats& stats = model->GetLoadStats();
+        std::string prefix = name + (parallel ? " parallel" : " serial");
+        AddMeasurement(prefix + " decode (" + std::to_string(stats.PrimitivesCount) + " primitives)", stats.DecodeMs);
+        AddMeasurement(prefix + " total", totalMs);
+        AddMeasurement(prefix + " weld (CPU time)", stats.WeldMs);
+        AddMeasurement(prefix + " tangents (" + std::to_string(stats.TangentsGeneratedCount) + " primitives, CPU time)", stats.TangentsMs);
+        AddMeasurement(prefix + " optimize (CPU time)", stats.OptimizeMs);
+        AddMeasurement(prefix + " meshlets build (" + std::to_string(stats.MeshletsCount) + " meshlets)", stats.MeshletsMs);
+        AddMeasurement(prefix + " LODs", stats.LodsMs);
+    }
+
+    // The results don't depend on the decode order.
+    const ModelLoadStats& stats = model->GetLoadStats();
+    AddMeasurement(name + " weld exact vertices before", double(stats.VerticesBeforeWeld), "");
+    AddMeasurement(name + " weld exact vertices after", double(stats.VerticesAfterWeld), "");
+    AddMeasurement(name + " ACMR before", stats.VertexCacheBefore.GetAcmr(), "");
+    AddMeasurement(name + " ACMR after", stats.VertexCacheAfter.GetAcmr(), "");
+    AddMeasurement(name + " ATVR before", stats.VertexCacheBefore.GetAtvr(), "");
+    AddMeasurement(name + " ATVR after", stats.VertexCacheAfter.GetAtvr(), "");
+
+    UINT64 meshletTriangles = 0;
+    UINT64 meshletVertices = 0;
+    UINT64 cones = 0;
+    std::vector<UINT64> lodTriangles(settings.LodErrors.size() + 1, 0);
+    for (const auto mesh : model->GetMeshes())
+    {
+        const MeshletData& meshlets = mesh->GetMeshlets();
+        for (const auto& meshlet : meshlets.Meshlets)
+        {
+            meshletTriangles += meshlet.TriangleCount;
+            meshletVertices += meshlet.VertexCount;
+        }
+        for (const auto& bounds : meshlets.Bounds)
+            cones += bounds.ConeCutoff < 1.0f ? 1 : 0;
+        // Meshes that can't be simplified further keep drawing their last LOD.
+        for (UINT lod = 0; lod < lodTriangles.size(); ++lod)
+            lodTriangles[lod] += mesh->GetLod(std::min(lod, mesh->GetLodCount() - 1)).IndexCount / 3;
+    }
+    double meshletsCount = std::max(1.0, double(stats.MeshletsCount));
+    AddMeasurement(name + " meshlet avg triangles", double(meshletTriangles) / meshletsCount, "");
+    AddMeasurement(name + " meshlet avg vertices", double(meshletVertices) / meshletsCount, "");
+    AddMeasurement(name + " meshlets with a normal cone", 100.0 * double(cones) / meshletsCount, "%");
+    for (UINT lod = 0; lod < lodTriangles.size(); ++lod)
+        AddMeasurement(name + " LOD " + std::to_string(lod) + " triangles", double(lodTriangles[lod]), "");
+    return *model;
+}
+
+void LoadingBenchmark::BenchmarkBufferMapping(RenderContext& context, const std::string& path)
+{
+    std::string name = path.substr(path.find_last_of("/\\") + 1);
+    for (bool mapped : { false, true })
+    {
+        ModelLoadSettings settings;
+        settings.MapBuffers = mapped;
+        settings.UseMeshCache = false;
+
+        MemoryPeakSampler memory;
+        Timer timer;
+        Model* model = new Model(context, path, settings);
+        double totalMs = timer.GetElapsedMs();
+        memory.Stop();
+        m_models.push_back(model);
+
+        const ModelLoadStats& stats = model->GetLoadStats();
+        std::string prefix = name + (stats.MappedBuffers ? " mapped buffers" : " tinygltf buffers");
+        AddMeasurement(prefix + " parse", stats.ParseMs);
+        AddMeasurement(prefix + " total", totalMs);
+        AddMeasurement(prefix + " peak private bytes", memory.GetPeakPrivateMb(), "MB");
+        AddMeasurement(prefix + " peak working set", memory.GetPeakWorkingSetMb(), "MB");
+    }
+}
+
+void LoadingBenchmark::BenchmarkWelding(RenderContext& context, const std::string& path)
+{
+    // The exact weld is a part of every load, see BenchmarkModelStages.
+    std::string name = path.substr(path.find_last_of("/\\") + 1);
+    ModelLoadSettings settings;
+    settings.UseMeshCache = false;
+    settings.WeldEpsilon = 1e-4f;
+    Model* model = new Model(context, path, settings);
+    m_models.push_back(model);
+
+    const ModelLoadStats& stats = model->GetLoadStats();
+    AddMeasurement(name + " weld epsilon", stats.WeldMs);
+    AddMeasurement(name + " weld epsilon vertices before", double(stats.VerticesBeforeWeld), "");
+    AddMeasurement(name + " weld epsilon vertices after", double(stats.VerticesAfterWeld), "");
+}
+
+void LoadingBenchmark::BenchmarkQuantization(const std::string& path, const Model& model)
+{
+    std::string name = path.substr(path.find_last_of("/\\") + 1);
+    const ModelLoadStats& stats = model.GetLoadStats();
+    AddMeasurement(name + " geometry full precision", double(stats.FullPrecisionGeometryBytes) / (1024.0 * 1024.0), "MB");
+    AddMeasurement(name + " geometry quantized", double(stats.GpuGeometryBytes) / (1024.0 * 1024.0), "MB");
+    AddMeasurement(name + " geometry saved", 100.0 * (1.0 - double(stats.GpuGeometryBytes) / std::max(1.0, double(stats.FullPrecisionGeometryBytes))), "%");
+
+    // The GPU copy isn't readable back, quantize the CPU vertices again with the same bounds and measure the round trip.
+    QuantizationError maxError;
+    double extent = 0.0;
+    std::vector<QuantizedVertex> quantized;
+    for (const auto mesh : model.GetMeshes())
+    {
+        const std::vector<Vertex>& vertices = mesh->GetVertices();
+        const QuantizationBounds& bounds = mesh->GetQuantizationBounds();
+        VertexStreams streams = GetVertexStreams(vertices.data());
+        quantized.resize(vertices.size());
+        QuantizeVertices(quantized.data(), streams, quantized.size(), bounds);
+        QuantizationError error = MeasureQuantizationError(quantized.data(), streams, quantized.size(), bounds);
+
+        maxError.Position = std::max(maxError.Position, error.Position);
+        maxError.Uv = std::max(maxError.Uv, error.Uv);
+        maxError.NormalDegrees = std::max(maxError.NormalDegrees, error.NormalDegrees);
+        maxError.TangentDegrees = std::max(maxError.TangentDegrees, error.TangentDegrees);
+        extent = std::max({ extent, double(bounds.Extent[0]), double(bounds.Extent[1]), double(bounds.Extent[2]) });
+    }
+    AddMeasurement(name + " max position error (of the largest mesh extent)", 100.0 * maxError.Position / std::max(extent, 1e-6), "%");
+    AddMeasurement(name + " max uv error", maxError.Uv, "");
+    AddMeasurement(name + " max normal error", maxError.NormalDegrees, "deg");
+    AddMeasurement(name + " max tangent error", maxError.TangentDegrees, "deg");
+}
+
+const Model& LoadingBenchmark::BenchmarkMeshCache(RenderContext& context, const std::string& path)
+{
+    std::string name = path.substr(path.find_last_of("/\\") + 1);
+    std::error_code ec;
+    std::filesystem::remove(MeshCache::GetCachePath(path), ec);
+
+    // Textures are created the same way on every path, so compare only the geometry part of the load.
+    auto geometryMs = [](const ModelLoadStats& stats) { return stats.ParseMs + stats.DecodeMs + stats.CacheWriteMs; };
+
+    ModelLoadSettings settings;
+    Model* cold = new Model(context, path, settings);
+    m_models.push_back(cold);
+    AddMeasurement(name + " cold (parse + decode + cache write)", geometryMs(cold->GetLoadStats()));
+    AddMeasurement(name + " cold cache write", cold->GetLoadStats().CacheWriteMs);
+
+    // The warm loads keep as much of the mapped cache as the residency asks for. Tests/ModelTests.cpp checks they come from the cache.
+    const char* policyNames[] = { "full", "positions and indices", "none" };
+    Model* warmFull = nullptr;
+    for (CpuMeshResidency residency : { CpuMeshResidency::Full, CpuMeshResidency::PositionsAndIndices, CpuMeshResidency::None })
+    {
+        settings.CpuResidency = residency;
+        Model* warm = new Model(context, path, settings);
+        m_models.push_back(warm);
+        std::string policy = policyNames[UINT(residency)];
+        AddMeasurement(name + " warm (mapped cache), " + policy + " CPU residency", geometryMs(warm->GetLoadStats()));
+        AddMeasurement(name + " resident CPU geometry (" + policy + ")", double(warm->GetLoadStats().ResidentCpuGeometryBytes) / (1024.0 * 1024.0), "MB");
+        if (residency == CpuMeshResidency::Full)
+            warmFull = warm;
+    }
+    return *warmFull;
+}
+
+void LoadingBenchmark::BenchmarkAsyncLoading(RenderContext& context, const std::string& path)
+{
+    std::string name = path.substr(path.find_last_of("/\\") + 1);
+
+    // The render thread time is what the frames lose to the load. With the blocking constructor a single frame stalls for all of it.
+    ModelLoadSettings settings;
+    settings.ShareTextures = false; // Both create all their textures, as the first load of the model does.
+    Timer timer;
+    m_models.push_back(new Model(context, path, settings));
+    AddMeasurement(name + " blocking load (render thread)", timer.GetElapsedMs());
+
+    ModelLoader loader;
+    Timer wallTimer;
+    timer.Reset();
+    ModelLoadHandle handle = loader.Load(path, settings);
+    double renderThreadMs = timer.GetElapsedMs();
+    UINT polls = 0;
+    while (!handle.IsReady() && !handle.IsFailed())
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1)); // Stands in for a frame, every one polls the loader once.
+        timer.Reset();
+        loader.Update(context);
+        renderThreadMs += timer.GetElapsedMs();
+        ++polls;
+    }
+    if (handle.IsFailed())
+        return;
+    AddMeasurement(name + " async load wall time", wallTimer.GetElapsedMs());
+    AddMeasurement(name + " async load (render thread)", renderThreadMs);
+    AddMeasurement(name + " async CPU stage (worker)", handle.GetRequest()->CpuMs);
+    AddMeasurement(name + " async GPU handoff (render thread)", handle.GetRequest()->GpuMs);
+    AddMeasurement(name + " async loader polls", polls, "");
+    m_models.push_back(handle.Get());
+}
+
+void LoadingBenchmark::BenchmarkGeometryPool(RenderContext& context, const std::string& path, const Model& pooledModel)
+{
+    // pooledModel is loaded with the default settings, so it only differs from this load by the pool.
+    std::string name = path.substr(path.find_last_of("/\\") + 1);
+    ModelLoadSettings settings;
+    settings.UseGeometryPool = false;
+    Model* model = new Model(context, path, settings);
+    m_models.push_back(model);
+
+    for (const Model* measured : { static_cast<const Model*>(model), &pooledModel })
+    {
+        // What a draw loop in the mesh order has to bind, the same as GltfViewer::Render does.
+        UINT vertexBinds = 0;
+        UINT indexBinds = 0;
+        const D3D12_VERTEX_BUFFER_VIEW* boundVertices = nullptr;
+        const D3D12_INDEX_BUFFER_VIEW* boundIndices = nullptr;
+        std::set<D3D12_GPU_VIRTUAL_ADDRESS> buffers;
+        for (const auto mesh : measured->GetMeshes())
+        {
+            if (boundVertices != &mesh->GetVertexBufferView())
+            {
+                boundVertices = &mesh->GetVertexBufferView();
+                ++vertexBinds;
+            }
+            if (boundIndices != &mesh->GetIndexBufferView())
+            {
+                boundIndices = &mesh->GetIndexBufferView();
+                ++indexBinds;
+            }
+            buffers.insert(mesh->GetVertexBufferView().BufferLocation);
+            buffers.insert(mesh->GetIndexBufferView().BufferLocation);
+        }
+
+        std::string prefix = name + (measured == model ? " geometry per mesh buffers" : " geometry pool");
+        AddMeasurement(prefix + " upload", measured->GetLoadStats().UploadMs);
+        AddMeasurement(prefix + " buffers", double(buffers.size()), "");
+        AddMeasurement(prefix + " vertex buffer binds", double(vertexBinds), "");
+        AddMeasurement(prefix + " index buffer binds", double(indexBinds), "");
+    }
+    AddMeasurement("Geometry pool allocated", double(context.GeoPool->GetAllocatedBytes()) / (1024.0 * 1024.0), "MB");
+}
+}
@@ -0,0 +1,237 @@
+#include "Scene/LoadingBenchmark.h"
+
+#include "DXrenderer/Model.h"
+#include "DXrenderer/RenderContext.h"
+#include "DXrenderer/Textures/BlockCompression.h"
+#include "DXrenderer/Textures/MipGenerator.h"
+#include "DXrenderer/Textures/TextureCache.h"
+#include "DXrenderer/Textures/TextureManager.h"
+
+#include "Utils/ThreadPool.h"
+#include "Utils/Timer.h"
+
+#include <filesystem>
+#include <random>
+#include <tuple>
+
+namespace DirectxPlayground
+{
+void LoadingBenchmark::BenchmarkTextureDecoding(const std::string& path)
+{
+    std::string name = path.substr(path.find_last_of("/\\") + 1);
+
+    // Only the CPU stage of the load, so nothing ends up in the descriptor heap. The decode itself, see BenchmarkTextureCompression for the rest.
+    ModelLoadSettings settings;
+    settings.TextureBlockCompression = TextureCompression::None;
+    settings.UseTextureCache = false;
+    for (bool parallel : { false, true })
+    {
+        settings.ParallelTextureDecode = parallel;
+        Model model(path, settings);
+        const ModelLoadStats& stats = model.GetLoadStats();
+        std::string mode = parallel ? " parallel" : " serial";
+        AddMeasurement(name + mode + " texture decode", stats.TexturesMs);
+        AddMeasurement(name + mode + " texture decode, summed over the files", stats.TexturesCpuMs);
+        AddMeasurement(name + mode + " texture decode, slowest file", stats.SlowestTextureMs);
+    }
+}
+
+void LoadingBenchmark::BenchmarkMipGeneration(UINT size, size_t texturesCount)
+{
+    std::string name = "Mips " + std::to_string(size) + "x" + std::to_string(size);
+
+    std::mt19937 rng(7);
+    std::vector<byte> rgba(size_t(size) * size * 4);
+    for (auto& value : rgba)
+        value = byte(rng() & 0xFF);
+    std::vector<byte> rgbaFloat(size_t(size) * size * 4 * sizeof(float));
+    float* floats = reinterpret_cast<float*>(rgbaFloat.data());
+    for (size_t i = 0; i < size_t(size) * size * 4; ++i)
+        floats[i] = float(rng() % 4096) / 256.0f;
+
+    const std::pair<MipFilter, const char*> filters[] = { { MipFilter::Box, "box" }, { MipFilter::Kaiser, "kaiser" }, { MipFilter::Lanczos, "lanczos" } };
+    const std::pair<SimdLevel, const char*> simdLevels[] = { { SimdLevel::Scalar, "scalar" }, { SimdLevel::SSE41, "SSE4.1" }, { SimdLevel::AVX2, "AVX2" } };
+    for (const auto& [filter, filterName] : filters)
+    {
+        MipSettings settings;
+        settings.Filter = filter;
+        settings.Srgb = true;
+        std::vector<MipLevelDesc> levels;
+        for (const auto& [simd, simdName] : simdLevels)
+        {
+            if (simd > GetSimdLevel())
+                continue;
+            std::vector<byte> data = rgba;
+            Timer timer;
+            GenerateMips(data, size, size, 4, MipPixelType::UNorm8, settings, levels, simd);
+            AddMeasurement(name + " RGBA8 sRGB " + filterName + " " + simdName, timer.GetElapsedMs());
+        }
+    }
+
+    MipSettings settings;
+    std::vector<MipLevelDesc> levels;
+    std::vector<byte> data = rgba;
+    Timer timer;
+    settings.NormalMap = true;
+    GenerateMips(data, size, size, 4, MipPixelType::UNorm8, settings, levels);
+    AddMeasurement(name + " RGBA8 normal map kaiser", timer.GetElapsedMs());
+    settings.NormalMap = false;
+    data = rgbaFloat;
+    timer.Reset();
+    GenerateMips(data, size, size, 4, MipPixelType::Float32, settings, levels);
+    AddMeasurement(name + " RGBA32F kaiser", timer.GetElapsedMs());
+
+    // Across the textures as the loader does it, every one on its own thread.
+    std::vector<std::vector<byte>> textures(texturesCount, rgba);
+    settings.Srgb = true;
+    auto generate = [&](size_t i)
+    {
+        std::vector<MipLevelDesc> textureLevels;
+        GenerateMips(textures[i], size, size, 4, MipPixelType::UNorm8, settings, textureLevels);
+    };
+    timer.Reset();
+    for (size_t i = 0; i < texturesCount; ++i)
+        generate(i);
+    AddMeasurement(name + " x" + std::to_string(texturesCount) + " serial", timer.GetElapsedMs());
+    for (auto& texture : textures)
+        texture.resize(rgba.size());
+    timer.Reset();
+    ThreadPool::Get().ParallelFor(texturesCount, generate);
+    AddMeasurement(name + " x" + std::to_string(texturesCount) + " parallel", timer.GetElapsedMs());
+}
+
+void LoadingBenchmark::BenchmarkBlockCompression(const std::string& imagePath)
+{
+    std::string name = imagePath.substr(imagePath.find_last_of("/\\") + 1);
+    DecodedImage image;
+    if (!TextureManager::DecodeImage(imagePath, image) || image.Format != DXGI_FORMAT_R8G8B8A8_UNORM)
+    {
+        AddMeasurement(name + " can't be decoded to RGBA8!", 1.0, "");
+        return;
+    }
+
+    // The PSNR is over the channels the format keeps. It's reported for this image, Tests/BlockCompressionTests.cpp holds the bounds.
+    const std::tuple<BlockFormat, const char*, UINT> formats[] = { { BlockFormat::BC1, "BC1", 3 }, { BlockFormat::BC3, "BC3", 4 }, { BlockFormat::BC4, "BC4", 1 },
+        { BlockFormat::BC5, "BC5", 2 }, { BlockFormat::BC7, "BC7", 4 } };
+    double megaTexels = double(image.Width) * image.Height / 1'000'000.0;
+    std::vector<byte> decompressed(image.Data.size());
+    for (const auto& [format, formatName, channels] : formats)
+    {
+        std::vector<byte> serialBlocks(GetCompressedSize(image.Width, image.Height, format));
+        std::vector<byte> parallelBlocks(serialBlocks.size());
+        Timer timer;
+        CompressImage(image.Data.data(), image.Width, image.Height, format, serialBlocks.data(), false);
+        double serialMs = timer.GetElapsedMs();
+        timer.Reset();
+        CompressImage(image.Data.data(), image.Width, image.Height, format, parallelBlocks.data(), true);
+        double parallelMs = timer.GetElapsedMs();
+        DecompressImage(parallelBlocks.data(), image.Width, image.Height, format, decompressed.data());
+
+        std::string prefix = name + " " + formatName;
+        AddMeasurement(prefix + " encode serial", megaTexels * 1000.0 / serialMs, "MTexel/s");
+        AddMeasurement(prefix + " encode parallel", megaTexels * 1000.0 / parallelMs, "MTexel/s");
+        AddMeasurement(prefix + " PSNR", ComputePsnr(image.Data.data(), decompressed.data(), image.Width, image.Height, channels), "dB");
+    }
+}
+
+void LoadingBenchmark::BenchmarkTextureCompression(const std::string& path)
+{
+    std::string name = path.substr(path.find_last_of("/\\") + 1);
+
+    // Only the CPU stage of the load, as in BenchmarkTextureDecoding.
+    ModelLoadSettings settings;
+    settings.UseTextureCache = false;
+    const std::pair<TextureCompression, const char*> modes[] = { { TextureCompression::None, "uncompressed" }, { TextureCompression::Fast, "fast" },
+        { TextureCompression::Quality, "quality" } };
+    for (const auto& [compression, modeName] : modes)
+    {
+        settings.TextureBlockCompression = compression;
+        Model model(path, settings);
+        const ModelLoadStats& stats = model.GetLoadStats();
+        std::string prefix = name + " textures " + modeName;
+        AddMeasurement(prefix, stats.TexturesMs);
+        AddMeasurement(prefix + " compression, summed over the files", stats.CompressCpuMs);
+    }
+
+    // The first load fills the cache unless an earlier run did, the second one has to hit it for every image.
+    settings.TextureBlockCompression = TextureCompression::Quality;
+    settings.UseTextureCache = true;
+    for (const char* run : { " first", " second" })
+    {
+        TextureCache::WaitForWrites();
+        Model model(path, settings);
+        const ModelLoadStats& stats = model.GetLoadStats();
+        std::string prefix = name + " textures quality, cached," + run + " load";
+        AddMeasurement(prefix, stats.TexturesMs);
+        AddMeasurement(prefix + " cache hits", stats.TextureCacheHits, "");
+    }
+}
+
+void LoadingBenchmark::BenchmarkTextureCache(RenderContext& context, const std::string& path)
+{
+    std::string name = path.substr(path.find_last_of("/\\") + 1);
+    // A directory of its own, so the cold load is cold whatever the earlier runs left in the default one.
+    std::string directory = ASSETS_DIR + std::string("Cache//TexturesBenchmark//");
+    std::error_code ec;
+    std::filesystem::remove_all(directory, ec);
+    TextureCache::SetDirectory(directory);
+
+    ModelLoadSettings settings;
+    settings.ShareTextures = false; // The earlier loads of the model would give the warm ones their textures.
+    // The whole startup of the model: the textures, then creating them and recording the copies.
+    auto load = [&](const std::string& prefix, bool readToUpload)
+    {
+        TextureCache::ResetCounters();
+        Timer timer;
+        Model* model = readToUpload ? new Model(context, path, settings) : new Model(path, settings);
+        if (!readToUpload)
+            model->CreateGpuResources(context);
+        double wallMs = timer.GetElapsedMs();
+        const ModelLoadStats& stats = model->GetLoadStats();
+        TextureCache::Counters counters = TextureCache::GetCounters();
+        AddMeasurement(name + prefix + " load", wallMs);
+        AddMeasurement(name + prefix + " textures", stats.TexturesMs);
+        AddMeasurement(name + prefix + " upload", stats.UploadMs);
+        AddMeasurement(name + prefix + " cache hits", double(counters.Hits), "");
+        AddMeasurement(name + prefix + " cache lookups", double(counters.Lookups), "");
+        AddMeasurement(name + prefix + " cache read", double(counters.BytesRead) / (1024.0 * 1024.0), "MB");
+        m_models.push_back(model);
+    };
+
+    load(" texture cache cold", true);
+    // The cold load doesn't wait for its writes, they go on in the background.
+    Timer writesTimer;
+    TextureCache::WaitForWrites();
+    TextureCache::Counters counters = TextureCache::GetCounters();
+    AddMeasurement(name + " texture cache cold, writes left after the load", writesTimer.GetElapsedMs());
+    AddMeasurement(name + " texture cache cold, written", double(counters.BytesWritten) / (1024.0 * 1024.0), "MB");
+    AddMeasurement(name + " texture cache cold, failed writes", double(counters.FailedWrites), "");
+
+    load(" texture cache warm", true);
+    load(" texture cache warm, read to memory", false);
+
+    TextureCache::SetDirectory(ASSETS_DIR + std::string("Cache//Textures//"));
+}
+
+void LoadingBenchmark::BenchmarkTextureSharing(RenderContext& context, const std::string& path, const std::string& copyPath)
+{
+    // The same model twice shares by the path, copyPath has the same image files in another directory and shares by the content.
+    std::string name = path.substr(path.find_last_of("/\\") + 1);
+    TextureManager* textures = context.TexManager;
+    auto load = [&](const std::string& modelPath, const std::string& prefix)
+    {
+        UINT texturesBefore = textures->GetTexturesCount();
+        TextureSharingStats before = textures->GetSharingStats();
+        Timer timer;
+        Model* model = new Model(context, modelPath);
+        AddMeasurement(name + prefix + " load", timer.GetElapsedMs());
+        AddMeasurement(name + prefix + " new SRVs", textures->GetTexturesCount() - texturesBefore, "");
+        AddMeasurement(name + prefix + " shared by the path", textures->GetSharingStats().PathHits - before.PathHits, "");
+        AddMeasurement(name + prefix + " shared by the content", textures->GetSharingStats().ContentHits - before.ContentHits, "");
+        m_models.push_back(model); // Released with the scene, the copies of this frame still use the textures.
+    };
+    load(path, " textures first load");
+    load(path, " textures second load");
+    load(copyPath, " textures copy load");
+}
+}
@@ -23,7 +23,7 @@ PbrTester::~PbrTester()
     SafeDelete(m_cameraCb);
     SafeDelete(m_camera);
     SafeDelete(m_cameraController);
-    SafeDelete(m_objectCbs);
+    SafeDelete(m_instanceBuffer);
     SafeDelete(m_materials);
     SafeDelete(m_gltfMesh);
     SafeDelete(m_tonemapper);
@@ -36,7 +36,6 @@ void PbrTester::InitResources(RenderContext& context)
 
     m_camera = new Camera(1.0472f, 1.77864583f, 0.001f, 1000.0f);
     m_cameraCb = new UploadBuffer(*context.Device, sizeof(CameraShaderData), true, context.FramesCount);
-    m_objectCbs = new UploadBuffer(*context.Device, sizeof(InstanceBuffers), true, context.FramesCount);
     m_materials = new UploadBuffer(*context.Device, sizeof(InstanceMaterials), true, context.FramesCount);
     m_cameraController = new CameraController(m_camera, 1.0f, 12.0f);
     m_lightManager = new LightManager(context);
@@ -49,7 +48,10 @@ void PbrTester::InitResources(RenderContext& context)
     l.Direction = { -5.0f, -5.0f, 5.0f };
     m_lightManager->AddLight(l);
 
-    InstanceBuffers transforms;
+    LoadGeometry(context);
+
+    UINT meshesCount = UINT(m_gltfMesh->GetMeshes().size());
+    m_instances.Reserve(m_instanceCount * meshesCount);
     for (UINT i = 0; i < 10; ++i)
     {
         for (UINT j = 0; j < 10; ++j)
@@ -65,14 +67,15 @@ void PbrTester::InitResources(RenderContext& context)
             float z = 10.0f;
 
             XMFLOAT4X4 toWorld;
-            XMStoreFloat4x4(&toWorld, XMMatrixTranspose(XMMatrixTranslation(x, y, z)));
-            transforms.ToWorld[index] = toWorld;
+            XMStoreFloat4x4(&toWorld, XMMatrixTranslation(x, y, z));
+            for (UINT mesh = 0; mesh < meshesCount; ++mesh)
+                m_instances.Add(mesh, 0, toWorld.m, index);
         }
     }
-    m_objectCbs->UploadData(0, transforms.ToWorld);
+    m_instances.Build();
+    m_instanceBuffer = new UploadBuffer(*context.Device, UINT(m_instances.GetInstanceDataSize()), false, context.FramesCount);
     m_materials->UploadData(0, m_instanceMaterials.Materials);
 
-    LoadGeometry(context);
     CreateRootSignature(context);
 
     m_tonemapper = new Tonemapper();
@@ -93,6 +96,7 @@ void PbrTester::Render(RenderContext& context)
     m_cameraData.Position = { camPos.x, camPos.y, camPos.z };
     m_cameraCb->UploadData(frameIndex, m_cameraData);
     m_materials->UploadData(frameIndex, m_instanceMaterials.Materials);
+    m_instanceBuffer->UploadData(frameIndex, reinterpret_cast<const byte*>(m_instances.GetInstanceData()), m_instances.GetInstanceDataSize());
 
     auto toRt = CD3DX12_RESOURCE_BARRIER::Transition(context.SwapChain->GetCurrentBackBuffer(), D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET);
     context.CommandList->ResourceBarrier(1, &toRt);
@@ -120,18 +124,20 @@ void PbrTester::Render(RenderContext& context)
     ID3D12DescriptorHeap* descHeap[] = { context.TexManager->GetDescriptorHeap() };
     context.CommandList->SetDescriptorHeaps(1, descHeap);
     context.CommandList->SetGraphicsRootConstantBufferView(GetCBRootParamIndex(0), m_cameraCb->GetFrameDataGpuAddress(frameIndex));
-    context.CommandList->SetGraphicsRootConstantBufferView(GetCBRootParamIndex(1), m_objectCbs->GetFrameDataGpuAddress(0));
     context.CommandList->SetGraphicsRootConstantBufferView(GetCBRootParamIndex(2), m_materials->GetFrameDataGpuAddress(frameIndex));
     context.CommandList->SetGraphicsRootConstantBufferView(GetCBRootParamIndex(3), m_lightManager->GetLightsBufferGpuAddress(frameIndex));
     context.CommandList->SetGraphicsRootDescriptorTable(TextureTableIndex, context.TexManager->GetDescriptorHeap()->GetGPUDescriptorHandleForHeapStart());
 
-    for (const auto mesh : m_gltfMesh->GetMeshes())
+    for (const InstanceGroup& group : m_instances.GetGroups())
     {
+        const auto mesh = m_gltfMesh->GetMeshes()[group.Mesh];
+        D3D12_GPU_VIRTUAL_ADDRESS instances = m_instanceBuffer->GetFrameDataGpuAddress(frameIndex) + group.FirstInstance * sizeof(InstanceData);
+        context.CommandList->SetGraphicsRootShaderResourceView(InstanceDataRootIndex, instances);
         context.CommandList->IASetVertexBuffers(0, 1, &mesh->GetVertexBufferView());
         context.CommandList->IASetIndexBuffer(&mesh->GetIndexBufferView());
 
         context.CommandList->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-        context.CommandList->DrawIndexedInstanced(mesh->GetIndexCount(), m_instanceCount, 0, 0, 0);
+        context.CommandList->DrawIndexedInstanced(mesh->GetIndexCount(), group.InstanceCount, mesh->GetStartIndex(), mesh->GetBaseVertex(), 0);
     }
     m_tonemapper->Render(context);
 
@@ -8,6 +8,8 @@
 #include "CameraController.h"
 #include "Camera.h"
 
+#include "DXrenderer/InstanceBatcher.h"
+
 #include <array>
 
 namespace DirectxPlayground
@@ -28,10 +30,6 @@ public:
 
 private:
     inline static constexpr UINT m_instanceCount = 100;
-    struct InstanceBuffers
-    {
-        XMFLOAT4X4 ToWorld[m_instanceCount];
-    };
     struct Material
     {
         XMFLOAT4 Albedo{};
@@ -53,7 +51,7 @@ private:
     Model* m_gltfMesh = nullptr;
     Microsoft::WRL::ComPtr<ID3D12RootSignature> m_commonRootSig; // Move to ctx. It's common after all
     UploadBuffer* m_cameraCb = nullptr;
-    UploadBuffer* m_objectCbs = nullptr;
+    UploadBuffer* m_instanceBuffer = nullptr; // Per frame InstanceData of m_instances.
     UploadBuffer* m_materials = nullptr;
 
     const std::string m_psoName = "Opaque_PBR";
@@ -65,5 +63,6 @@ private:
     CameraShaderData m_cameraData{};
 
     InstanceMaterials m_instanceMaterials;
+    InstanceBatcher m_instances; // Every sphere mesh at every grid cell, the user data is the index into m_instanceMaterials.
 };
 }
\ No newline at end of file
@@ -1,6 +1,8 @@
 #include "Scene/RtTester.h"
 
+#include <algorithm>
 #include <array>
+#include <cfloat>
 
 #include "DXrenderer/Swapchain.h"
 
@@ -15,6 +17,7 @@
 #include "DXrenderer/Textures/EnvironmentMap.h"
 #include "DXrenderer/RenderPipeline.h"
 #include "DXrenderer/DXR/AccelerationStructure.h"
+#include "DXrenderer/Culling/OcclusionBuffer.h"
 
 #include "External/IMGUI/imgui.h"
 
@@ -35,13 +38,14 @@ RtTester::~RtTester()
     SafeDelete(m_cameraCb);
     SafeDelete(m_camera);
     SafeDelete(m_cameraController);
-    SafeDelete(m_objectCb);
+    SafeDelete(m_instanceBuffer);
     SafeDelete(m_suzanne);
     SafeDelete(m_tonemapper);
     SafeDelete(m_lightManager);
     SafeDelete(m_floor);
     SafeDelete(m_floorMaterialCb);
     SafeDelete(m_floorTransformCb);
+    SafeDelete(m_occlusionBuffer);
 
     // dxr
     SafeDelete(m_tlas);
@@ -65,13 +69,11 @@ void RtTester::InitResources(RenderContext& context)
     m_camera = new Camera(1.0472f, 1.77864583f, 0.001f, 1000.0f);
     m_camera->SetWorldPosition({ 0.0f, 2.0f, -2.0f });
     m_cameraCb = new UploadBuffer(*context.Device, sizeof(CameraShaderData), true, context.FramesCount);
-    m_objectCb = new UploadBuffer(*context.Device, sizeof(XMFLOAT4X4) * 2, true, 1);
 
-    XMFLOAT4X4 toWorld[2];
-    XMStoreFloat4x4(&toWorld[0], XMMatrixTranspose(XMMatrixTranslation(0.0f, 2.0f, 3.0f)));
-    XMStoreFloat4x4(&toWorld[1], XMMatrixTranspose(XMMatrixTranslation(5.0f, 2.0f, 3.0f)));
-    m_objectCb->UploadData(0, toWorld);
+    XMStoreFloat4x4(&m_suzanneInstances[0], XMMatrixTranslation(0.0f, 2.0f, 3.0f));
+    XMStoreFloat4x4(&m_suzanneInstances[1], XMMatrixTranslation(5.0f, 2.0f, 3.0f));
 
+    XMFLOAT4X4 toWorld[1];
     m_floorTransformCb = new UploadBuffer(*context.Device, sizeof(XMFLOAT4X4), true, context.FramesCount);
     XMStoreFloat4x4(&toWorld[0], XMMatrixTranspose(XMMatrixTranslation(0.0f, 0.0f, 0.0f)));
     for (UINT i = 0; i < context.FramesCount; ++i)
@@ -92,6 +94,9 @@ void RtTester::InitResources(RenderContext& context)
     m_directionalLightInd = m_lightManager->AddLight(l);
 
     LoadGeometry(context);
+    m_occlusionBuffer = new OcclusionBuffer(320, 180);
+    UINT maxInstances = UINT(m_suzanne->GetMeshes().size()) * SuzanneInstancesCount + 1;
+    m_instanceBuffer = new UploadBuffer(*context.Device, maxInstances * sizeof(InstanceData), false, context.FramesCount);
     CreateRootSignature(context);
 
     m_tonemapper = new Tonemapper();
@@ -114,6 +119,8 @@ void RtTester::Render(RenderContext& context)
     m_cameraData.Position = { camPos.x, camPos.y, camPos.z };
     m_cameraCb->UploadData(frameIndex, m_cameraData);
     m_suzanne->UpdateMeshes(frameIndex);
+    CullDraws();
+    m_instanceBuffer->UploadData(frameIndex, reinterpret_cast<const byte*>(m_instances.GetInstanceData()), m_instances.GetInstanceDataSize());
 
     auto toRt = CD3DX12_RESOURCE_BARRIER::Transition(context.SwapChain->GetCurrentBackBuffer(), D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET);
     context.CommandList->ResourceBarrier(1, &toRt);
@@ -154,32 +161,22 @@ void RtTester::DepthPrepass(RenderContext& context)
     context.CommandList->ClearDepthStencilView(context.SwapChain->GetDSCPUhandle(), D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
 
     context.CommandList->SetGraphicsRootSignature(m_commonRootSig.Get());
-    context.CommandList->SetPipelineState(context.PsoManager->GetPso(m_depthPrepassPsoName));
     ID3D12DescriptorHeap* descHeap[] = { context.TexManager->GetDescriptorHeap() };
     context.CommandList->SetDescriptorHeaps(1, descHeap);
     context.CommandList->SetGraphicsRootConstantBufferView(GetCBRootParamIndex(0), m_cameraCb->GetFrameDataGpuAddress(frameIndex));
-    context.CommandList->SetGraphicsRootConstantBufferView(GetCBRootParamIndex(1), m_objectCb->GetFrameDataGpuAddress(0));
 
-    if (m_drawSuzanne)
+    ID3D12PipelineState* pso = context.PsoManager->GetPso(m_depthPrepassPsoName);
+    for (const InstanceGroup& group : m_instances.GetGroups())
     {
-        for (const auto mesh : m_suzanne->GetMeshes())
-        {
-            context.CommandList->IASetVertexBuffers(0, 1, &mesh->GetVertexBufferView());
-            context.CommandList->IASetIndexBuffer(&mesh->GetIndexBufferView());
-
-            context.CommandList->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-            context.CommandList->DrawIndexedInstanced(mesh->GetIndexCount(), 2, 0, 0, 0);
-        }
+        DrawPacket packet = GetGroupPacket(group, pso, frameIndex);
+        if (group.Mesh == GetFloorMeshId())
+            packet.AddCbv(GetCBRootParamIndex(4), m_shadowMapCB->GetFrameDataGpuAddress(0));
+        packet.SortKey = DrawQueue::MakeSortKey(DepthPrepassPass, m_drawQueue.GetPsoId(pso), 0, GetGroupDistance(group));
+        m_drawQueue.Submit(packet);
     }
 
-    if (m_drawFloor)
-    {
-        context.CommandList->SetGraphicsRootConstantBufferView(GetCBRootParamIndex(1), m_floorTransformCb->GetFrameDataGpuAddress(frameIndex));
-        context.CommandList->SetGraphicsRootConstantBufferView(GetCBRootParamIndex(4), m_shadowMapCB->GetFrameDataGpuAddress(0));
-        context.CommandList->IASetVertexBuffers(0, 1, &m_floor->GetVertexBufferView());
-        context.CommandList->IASetIndexBuffer(&m_floor->GetIndexBufferView());
-        context.CommandList->DrawIndexedInstanced(m_floor->GetIndexCount(), 1, 0, 0, 0);
-    }
+    D3DDrawCommandList drawCommandList(context.CommandList);
+    m_drawQueue.Flush(drawCommandList);
 }
 
 void RtTester::RenderForwardObjects(RenderContext& context)
@@ -191,43 +188,170 @@ void RtTester::RenderForwardObjects(RenderContext& context)
     context.CommandList->ClearRenderTargetView(rtCpuHandle, m_tonemapper->GetClearColor(), 0, nullptr);
 
     context.CommandList->SetGraphicsRootSignature(m_commonRootSig.Get());
-    context.CommandList->SetPipelineState(context.PsoManager->GetPso(m_psoName));
     ID3D12DescriptorHeap* descHeap[] = { context.TexManager->GetDescriptorHeap() };
     context.CommandList->SetDescriptorHeaps(1, descHeap);
     context.CommandList->SetGraphicsRootConstantBufferView(GetCBRootParamIndex(0), m_cameraCb->GetFrameDataGpuAddress(frameIndex));
-    context.CommandList->SetGraphicsRootConstantBufferView(GetCBRootParamIndex(1), m_objectCb->GetFrameDataGpuAddress(0));
     context.CommandList->SetGraphicsRootConstantBufferView(GetCBRootParamIndex(3), m_lightManager->GetLightsBufferGpuAddress(frameIndex));
     context.CommandList->SetGraphicsRootDescriptorTable(TextureTableIndex, context.TexManager->GetDescriptorHeap()->GetGPUDescriptorHandleForHeapStart());
 
-    if (m_drawSuzanne)
+    ID3D12PipelineState* pso = context.PsoManager->GetPso(m_psoName);
+    ID3D12PipelineState* floorPso = context.PsoManager->GetPso(m_floorPsoName);
+    for (const InstanceGroup& group : m_instances.GetGroups())
     {
-        for (const auto mesh : m_suzanne->GetMeshes())
+        bool isFloor = group.Mesh == GetFloorMeshId();
+        DrawPacket packet = GetGroupPacket(group, isFloor ? floorPso : pso, frameIndex);
+        if (isFloor)
+        {
+            // The floor shader isn't instanced, it takes the transform from the constant buffer.
+            packet.AddCbv(GetCBRootParamIndex(1), m_floorTransformCb->GetFrameDataGpuAddress(frameIndex));
+            packet.AddCbv(GetCBRootParamIndex(2), m_floorMaterialCb->GetFrameDataGpuAddress(frameIndex));
+        }
+        else
         {
-            context.CommandList->SetGraphicsRootConstantBufferView(GetCBRootParamIndex(2), mesh->GetMaterialBufferGpuAddress(frameIndex));
+            packet.AddCbv(GetCBRootParamIndex(2), m_suzanne->GetMeshes()[group.Mesh]->GetMaterialBufferGpuAddress(frameIndex));
+        }
+        packet.SortKey = DrawQueue::MakeSortKey(ForwardPass, m_drawQueue.GetPsoId(packet.Pso), group.Material, GetGroupDistance(group));
+        m_drawQueue.Submit(packet);
+    }
+
+    D3DDrawCommandList drawCommandList(context.CommandList);
+    m_drawQueue.Flush(drawCommandList);
+}
+
+DrawPacket RtTester::GetGroupPacket(const InstanceGroup& group, ID3D12PipelineState* pso, UINT frameIndex) const
+{
+    DrawPacket packet;
+    packet.Pso = pso;
+    if (group.Mesh == GetFloorMeshId())
+    {
+        packet.VertexBuffer = m_floor->GetVertexBufferView();
+        packet.IndexBuffer = m_floor->GetIndexBufferView();
+        packet.IndexCount = m_floor->GetIndexCount();
+    }
+    else
+    {
+        const auto mesh = m_suzanne->GetMeshes()[group.Mesh];
+        packet.VertexBuffer = mesh->GetVertexBufferView();
+        packet.IndexBuffer = mesh->GetIndexBufferView();
+        packet.IndexCount = mesh->GetIndexCount();
+        packet.StartIndex = mesh->GetStartIndex();
+        packet.BaseVertex = mesh->GetBaseVertex();
+    }
+    packet.InstanceCount = group.InstanceCount;
+    packet.AddSrv(InstanceDataRootIndex, m_instanceBuffer->GetFrameDataGpuAddress(frameIndex) + group.FirstInstance * sizeof(InstanceData));
+    return packet;
+}
 
-            context.CommandList->IASetVertexBuffers(0, 1, &mesh->GetVertexBufferView());
-            context.CommandList->IASetIndexBuffer(&mesh->GetIndexBufferView());
+float RtTester::GetGroupDistance(const InstanceGroup& group) const
+{
+    // To the nearest instance origin, the records are transposed so the translation is the last column.
+    XMFLOAT4 cameraPosition = m_camera->GetPosition();
+    XMVECTOR camPos = XMLoadFloat4(&cameraPosition);
+    float distance = FLT_MAX;
+    for (UINT i = group.FirstInstance; i < group.FirstInstance + group.InstanceCount; ++i)
+    {
+        const InstanceData& instance = m_instances.GetInstanceData()[i];
+        XMVECTOR position = XMVectorSet(instance.ToWorld[0][3], instance.ToWorld[1][3], instance.ToWorld[2][3], 1.0f);
+        distance = std::min(distance, XMVectorGetX(XMVector3Length(position - camPos)));
+    }
+    return distance;
+}
+
+UINT RtTester::GetFloorMeshId() const
+{
+    return UINT(m_suzanne->GetMeshes().size());
+}
 
-            context.CommandList->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-            context.CommandList->DrawIndexedInstanced(mesh->GetIndexCount(), 2, 0, 0, 0);
+XMMATRIX RtTester::GetSuzanneMeshToWorld(UINT meshIndex, UINT instance) const
+{
+    const auto mesh = m_suzanne->GetMeshes()[meshIndex];
+    XMMATRIX meshToModel = XMLoadFloat4x4(&m_suzanne->GetNodes().GetWorldTransform(mesh->GetNodeIndex())) * XMLoadFloat4x4(&m_suzanne->GetTransform());
+    return meshToModel * XMLoadFloat4x4(&m_suzanneInstances[instance]);
+}
+
+void RtTester::CullDraws()
+{
+    // A draw per Suzanne mesh instance, mesh by mesh, then the floor. The visible ones go to the batcher, which groups them back by mesh.
+    m_cullingBounds.Clear();
+    for (UINT meshIndex = 0; meshIndex < m_suzanne->GetMeshes().size(); ++meshIndex)
+    {
+        const BoundingBox& meshBox = m_suzanne->GetMeshes()[meshIndex]->GetBounds();
+        for (UINT instance = 0; instance < SuzanneInstancesCount; ++instance)
+        {
+            BoundingBox box;
+            meshBox.Transform(box, GetSuzanneMeshToWorld(meshIndex, instance));
+            m_cullingBounds.Add(&box.Center.x, &box.Extents.x, XMVectorGetX(XMVector3Length(XMLoadFloat3(&box.Extents))));
         }
     }
+    BoundingBox floorBox;
+    float floorRadius = 0.0f;
+    m_floor->GetMeshWorldBounds(m_floor->GetMeshes()[0], floorBox, floorRadius);
+    UINT floorDraw = m_cullingBounds.Add(&floorBox.Center.x, &floorBox.Extents.x, floorRadius);
+
+    const XMFLOAT4X4& viewProjection = m_camera->GetViewProjection();
+    m_visibleDraws.resize(m_cullingBounds.Count);
+    size_t visibleCount = FrustumCull(ExtractFrustumPlanes(viewProjection.m), m_cullingBounds, CullShape::Box, m_visibleDraws.data());
+    m_occludedDraws = 0;
+    if (m_useOcclusionCulling)
+    {
+        RasterizeOccluders(viewProjection);
+        size_t unoccludedCount = m_occlusionBuffer->FilterVisible(m_cullingBounds, m_visibleDraws.data(), visibleCount, viewProjection.m);
+        m_occludedDraws = UINT(visibleCount - unoccludedCount);
+        visibleCount = unoccludedCount;
+    }
+    m_visibleDraws.resize(visibleCount);
 
-    if (m_drawFloor)
+    m_instances.Clear();
+    XMFLOAT4X4 floorToWorld;
+    XMStoreFloat4x4(&floorToWorld, XMMatrixIdentity());
+    for (UINT draw : m_visibleDraws)
     {
-        context.CommandList->SetPipelineState(context.PsoManager->GetPso(m_floorPsoName));
-        context.CommandList->SetGraphicsRootConstantBufferView(GetCBRootParamIndex(1), m_floorTransformCb->GetFrameDataGpuAddress(frameIndex));
-        context.CommandList->SetGraphicsRootConstantBufferView(GetCBRootParamIndex(2), m_floorMaterialCb->GetFrameDataGpuAddress(frameIndex));
-        context.CommandList->IASetVertexBuffers(0, 1, &m_floor->GetVertexBufferView());
-        context.CommandList->IASetIndexBuffer(&m_floor->GetIndexBufferView());
-        context.CommandList->DrawIndexedInstanced(m_floor->GetIndexCount(), 1, 0, 0, 0);
+        if (draw == floorDraw)
+        {
+            if (m_drawFloor)
+                m_instances.Add(GetFloorMeshId(), 0, floorToWorld.m);
+        }
+        else if (m_drawSuzanne)
+        {
+            UINT meshIndex = draw / SuzanneInstancesCount;
+            UINT material = UINT(m_suzanne->GetMeshes()[meshIndex]->GetMaterialIndex() + 1);
+            XMFLOAT4X4 toWorld;
+            XMStoreFloat4x4(&toWorld, GetSuzanneMeshToWorld(meshIndex, draw % SuzanneInstancesCount));
+            m_instances.Add(meshIndex, material, toWorld.m);
+        }
     }
+    m_instances.Build(false);
+}
+
+void RtTester::RasterizeOccluders(const XMFLOAT4X4& viewProjection)
+{
+    // The coarsest LOD is plenty for an occluder. Meshes are tested against the buffer they are in, it's fine since the box is never behind its own surface.
+    m_occlusionBuffer->Clear();
+    XMMATRIX vp = XMLoadFloat4x4(&viewProjection);
+    XMFLOAT4X4 toClip;
+    for (UINT meshIndex = 0; meshIndex < m_suzanne->GetMeshes().size(); ++meshIndex)
+    {
+        const auto mesh = m_suzanne->GetMeshes()[meshIndex];
+        const MeshLod& lod = mesh->GetLod(mesh->GetLodCount() - 1);
+        for (UINT instance = 0; instance < SuzanneInstancesCount; ++instance)
+        {
+            XMStoreFloat4x4(&toClip, GetSuzanneMeshToWorld(meshIndex, instance) * vp);
+            m_occlusionBuffer->AddOccluder(mesh->GetPositionData(), mesh->GetPositionStride(), mesh->GetVertexCount(), mesh->GetIndices().data() + lod.StartIndex,
+                lod.IndexCount, toClip.m);
+        }
+    }
+    const auto floor = m_floor->GetMeshes()[0];
+    XMStoreFloat4x4(&toClip, vp);
+    m_occlusionBuffer->AddOccluder(floor->GetPositionData(), floor->GetPositionStride(), floor->GetVertexCount(), floor->GetIndices().data(), floor->GetIndexCount(), toClip.m);
+    m_occlusionBuffer->Rasterize();
 }
 
 void RtTester::LoadGeometry(RenderContext& context)
 {
     auto path = ASSETS_DIR + std::string("Models//Suzanne//glTF//Suzanne.gltf");
-    m_suzanne = new Model(context, path);
+    ModelLoadSettings settings;
+    settings.LodErrors = { 0.02f }; // The occluder level, the draws stay on LOD 0.
+    m_suzanne = new Model(context, path, settings);
 
     std::vector<Vertex> verts;
     verts.resize(4);
@@ -284,6 +408,15 @@ void RtTester::UpdateGui(RenderContext& context)
     ImGui::Checkbox("Use Rasterizer", &m_useRasterizer);
     ImGui::Checkbox("Draw Suzanne", &m_drawSuzanne);
     ImGui::Checkbox("Draw Floor", &m_drawFloor);
+    ImGui::Text("");
+    ImGui::Text("Culling");
+    ImGui::Checkbox("Occlusion culling", &m_useOcclusionCulling);
+    ImGui::Text("Visible draws: %u, occluded: %u", UINT(m_visibleDraws.size()), m_occludedDraws);
+    const DrawStateStats& drawStats = m_drawQueue.GetLastFlushStats();
+    ImGui::Text("Forward PSO binds: %u (%u elided), CBV binds: %u (%u elided)", drawStats.PsoBinds, drawStats.PsoElided, drawStats.CbvBinds, drawStats.CbvElided);
+    ImGui::Text("Forward VB binds: %u (%u elided), IB binds: %u (%u elided)", drawStats.VertexBufferBinds, drawStats.VertexBufferElided, drawStats.IndexBufferBinds, drawStats.IndexBufferElided);
+    if (ImGui::Button("Save occlusion depth"))
+        m_occlusionBuffer->SaveDebugImage("OcclusionDepth.png");
     ImGui::End();
 
     m_lightManager->UpdateLights(context.SwapChain->GetCurrentBackBufferIndex());
@@ -369,14 +502,14 @@ void RtTester::BuildAccelerationStructures(RenderContext& context)
 
     m_tlas->AddDescriptor(*m_floorBlas, transform, 2);
 
-    transform._24 = 2.0f;
-    transform._34 = 3.0f;
-
-    m_tlas->AddDescriptor(*m_modelBlas, transform, 1);
-
-    transform._14 = 5.0f;
-    m_tlas->AddDescriptor(*m_modelBlas, transform, 1);
+    // The BLAS has the node transforms in its geometry, the instances add the model transform and the placement, as the draws do.
+    for (const auto& instance : m_suzanneInstances)
+    {
+        XMStoreFloat4x4(&transform, XMMatrixTranspose(XMLoadFloat4x4(&m_suzanne->GetTransform()) * XMLoadFloat4x4(&instance)));
+        m_tlas->AddDescriptor(*m_modelBlas, transform, 1);
+    }
 
+    transform = IdentityMatrix;
     transform._14 = -6.0f;
     transform._24 = 2.0f;
     transform._34 = 3.0f;
@@ -9,7 +9,12 @@
 #include "CameraController.h"
 #include "Camera.h"
 
+#include "DXrenderer/Culling/FrustumCulling.h"
+#include "DXrenderer/DrawQueue.h"
+#include "DXrenderer/InstanceBatcher.h"
+
 #include <array>
+#include <vector>
 
 namespace DirectxPlayground
 {
@@ -20,6 +25,7 @@ class Tonemapper;
 class LightManager;
 class EnvironmentMap;
 class UnorderedAccessBuffer;
+class OcclusionBuffer;
 
 namespace DXR
 {
@@ -36,6 +42,11 @@ public:
     void Render(RenderContext& context) override;
 
 private:
+    // Sort key passes, each is flushed on its own but the ids keep them apart in one queue anyway.
+    static constexpr UINT DepthPrepassPass = 0;
+    static constexpr UINT ForwardPass = 1;
+    static constexpr UINT SuzanneInstancesCount = 2;
+
     struct NonTexturedMaterial
     {
         XMFLOAT4 Albedo{};
@@ -51,6 +62,12 @@ private:
     void CreateRootSignature(RenderContext& context);
     void CreatePSOs(RenderContext& context);
     void UpdateGui(RenderContext& context);
+    void CullDraws();
+    void RasterizeOccluders(const XMFLOAT4X4& viewProjection);
+    DrawPacket GetGroupPacket(const InstanceGroup& group, ID3D12PipelineState* pso, UINT frameIndex) const; // Geometry and instances, the CBVs and the key are up to the pass.
+    float GetGroupDistance(const InstanceGroup& group) const;
+    UINT GetFloorMeshId() const; // The batcher mesh id of the floor, the Suzanne meshes are their indices.
+    XMMATRIX GetSuzanneMeshToWorld(UINT meshIndex, UINT instance) const; // Node, model and instance transforms, what the draws, the culling and the TLAS use.
 
     // rt
 
@@ -66,7 +83,7 @@ private:
     Model* m_floor = nullptr;
     Microsoft::WRL::ComPtr<ID3D12RootSignature> m_commonRootSig; // Move to ctx. It's common after all
     UploadBuffer* m_cameraCb = nullptr;
-    UploadBuffer* m_objectCb = nullptr;
+    UploadBuffer* m_instanceBuffer = nullptr; // Per frame InstanceData of m_instances.
     UploadBuffer* m_floorTransformCb = nullptr;
     UploadBuffer* m_floorMaterialCb = nullptr;
     const std::string m_psoName = "Opaque_PBR";
@@ -82,6 +99,15 @@ private:
 
     bool m_drawFloor = true;
     bool m_drawSuzanne = true;
+
+    XMFLOAT4X4 m_suzanneInstances[SuzanneInstancesCount]; // Placement of the whole model, applied after its own transform.
+    CullingBounds m_cullingBounds; // Every instance of every Suzanne mesh, then the floor.
+    std::vector<UINT> m_visibleDraws;
+    InstanceBatcher m_instances; // The visible draws of this frame.
+    OcclusionBuffer* m_occlusionBuffer = nullptr;
+    bool m_useOcclusionCulling = true;
+    UINT m_occludedDraws = 0;
+    DrawQueue m_drawQueue;
     bool m_useRasterizer = true;
 
     // rt
@@ -0,0 +1,152 @@
+#include "Tests/TestFramework.h"
+
+#include "DXrenderer/Geometry/AccessorGather.h"
+
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#endif
+
+using namespace DirectxPlayground;
+
+namespace
+{
+// Bytes that end right at an inaccessible page, so a kernel reading past the accessor crashes the test instead of passing by luck.
+class GuardedBuffer
+{
+public:
+    explicit GuardedBuffer(size_t size)
+    {
+        const size_t pageSize = 4096;
+        m_dataPages = (size + pageSize - 1) / pageSize * pageSize;
+#if defined(_WIN32)
+        m_base = static_cast<byte*>(VirtualAlloc(nullptr, m_dataPages + pageSize, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+        DWORD oldProtection;
+        VirtualProtect(m_base + m_dataPages, pageSize, PAGE_NOACCESS, &oldProtection);
+#else
+        m_base = static_cast<byte*>(mmap(nullptr, m_dataPages + pageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+        mprotect(m_base + m_dataPages, pageSize, PROT_NONE);
+#endif
+        m_data = m_base + m_dataPages - size;
+    }
+    ~GuardedBuffer()
+    {
+#if defined(_WIN32)
+        VirtualFree(m_base, 0, MEM_RELEASE);
+#else
+        munmap(m_base, m_dataPages + 4096);
+#endif
+    }
+
+    byte* GetData() const
+    {
+        return m_data;
+    }
+
+private:
+    byte* m_base = nullptr;
+    byte* m_data = nullptr;
+    size_t m_dataPages = 0;
+};
+
+const SimdLevel Levels[] = { SimdLevel::SSE41, SimdLevel::AVX2 };
+}
+
+TEST(GatherFloatElementsLevelsMatchScalar)
+{
+    // Every stride a float accessor can have for the components, counts around the 8 element AVX2 blocks, and no reads past the last element.
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> dist(-100.0f, 100.0f);
+    const float scale[4] = { 0.5f, 2.0f, -1.0f, 0.25f };
+    for (UINT components = 2; components <= 4; ++components)
+    {
+        for (size_t stride = components * sizeof(float); stride <= 48; stride += sizeof(float))
+        {
+            for (size_t count : { 1, 2, 7, 8, 9, 16, 17, 1000 })
+            {
+                const size_t sourceSize = stride * (count - 1) + components * sizeof(float);
+                GuardedBuffer source(sourceSize);
+                for (size_t b = 0; b < sourceSize; b += sizeof(float))
+                {
+                    float v = dist(rng);
+                    memcpy(source.GetData() + b, &v, sizeof(v));
+                }
+
+                // The destination is interleaved with a sentinel field after the gathered one, which must stay untouched.
+                constexpr size_t dstStride = 5 * sizeof(float);
+                std::vector<float> reference(count * 5, 123.0f);
+                GatherFloatElements(source.GetData(), stride, reinterpret_cast<byte*>(reference.data()), dstStride, count, components, scale, SimdLevel::Scalar);
+                for (SimdLevel level : Levels)
+                {
+                    if (level > GetSimdLevel())
+                        continue;
+                    std::vector<float> result(count * 5, 123.0f);
+                    GatherFloatElements(source.GetData(), stride, reinterpret_cast<byte*>(result.data()), dstStride, count, components, scale, level);
+                    CHECK(result == reference);
+                }
+            }
+        }
+    }
+}
+
+TEST(GatherFloatElementsZeroStride)
+{
+    // A broadcast of a single element, what accessors without a buffer view decode as.
+    const float value[2] = { 3.0f, 4.0f };
+    GuardedBuffer source(sizeof(value));
+    memcpy(source.GetData(), value, sizeof(value));
+    for (SimdLevel level : { SimdLevel::Scalar, SimdLevel::SSE41, SimdLevel::AVX2 })
+    {
+        if (level > GetSimdLevel())
+            continue;
+        std::vector<float> result(20 * 2);
+        GatherFloatElements(source.GetData(), 0, reinterpret_cast<byte*>(result.data()), sizeof(value), 20, 2, nullptr, level);
+        for (size_t i = 0; i < 20; ++i)
+            CHECK(result[i * 2] == 3.0f && result[i * 2 + 1] == 4.0f);
+    }
+}
+
+TEST(GatherElementsConvertsIntegers)
+{
+    std::mt19937 rng(7);
+    const float scale[4] = { 2.0f, 3.0f, 4.0f, 5.0f };
+    const float offset[4] = { 1.0f, -1.0f, 0.5f, 0.25f };
+    const ComponentType types[] = { ComponentType::Byte, ComponentType::UnsignedByte, ComponentType::Short, ComponentType::UnsignedShort };
+    for (ComponentType type : types)
+    {
+        const size_t componentSize = type == ComponentType::Byte || type == ComponentType::UnsignedByte ? 1 : 2;
+        for (bool normalized : { false, true })
+        {
+            for (UINT components = 1; components <= 4; ++components)
+            {
+                // Vertex attribute strides are 4 byte aligned.
+                const size_t stride = (componentSize * components + 3) / 4 * 4;
+                const size_t count = 37;
+                const size_t sourceSize = stride * (count - 1) + componentSize * components;
+                GuardedBuffer source(sourceSize);
+                for (size_t b = 0; b < sourceSize; ++b)
+                    source.GetData()[b] = byte(rng());
+
+                std::vector<float> reference(count * 4, -7.0f);
+                std::vector<float> result(count * 4, -7.0f);
+                GatherElements(source.GetData(), stride, type, normalized, reinterpret_cast<byte*>(reference.data()), 16, count, components, scale, offset, SimdLevel::Scalar);
+                if (GetSimdLevel() >= SimdLevel::SSE41)
+                {
+                    GatherElements(source.GetData(), stride, type, normalized, reinterpret_cast<byte*>(result.data()), 16, count, components, scale, offset, SimdLevel::SSE41);
+                    for (size_t i = 0; i < reference.size(); ++i)
+                        CHECK_NEAR(result[i], reference[i], 1e-5f * std::abs(reference[i]) + 1e-6f);
+                }
+            }
+        }
+    }
+
+    // The most negative normalized values clamp to -1.
+    const signed char snorm[4] = { -128, 127, 0, -127 };
+    float decoded[4];
+    GatherElements(reinterpret_cast<const byte*>(snorm), 4, ComponentType::Byte, true, reinterpret_cast<byte*>(decoded), 16, 1, 4);
+    CHECK(decoded[0] == -1.0f && decoded[1] == 1.0f && decoded[2] == 0.0f && decoded[3] == -1.0f);
+}
@@ -0,0 +1,166 @@
+#include "Tests/TestFramework.h"
+
+#include "DXrenderer/Textures/BlockCompression.h"
+#include "DXrenderer/Textures/MipGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace DirectxPlayground;
+
+namespace
+{
+struct FormatInfo
+{
+    BlockFormat Format;
+    UINT Channels; // The ones the format keeps, the PSNR is over them.
+    double MinLargePsnr; // Levels of 64 texels across and more.
+    double MinPsnr; // Any level, the small ones have a whole gradient in a block.
+};
+
+const FormatInfo Formats[] = {
+    { BlockFormat::BC1, 3, 33.0, 15.0 },
+    { BlockFormat::BC3, 4, 34.0, 16.0 },
+    { BlockFormat::BC4, 1, 48.0, 36.0 },
+    { BlockFormat::BC5, 2, 47.0, 36.0 },
+    { BlockFormat::BC7, 4, 32.0, 15.0 },
+};
+
+// Smooth gradients in every channel, alpha included, with a little noise on top as photographed textures have.
+std::vector<byte> GradientImage(UINT width, UINT height, UINT seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> noise(-6, 6);
+    std::vector<byte> rgba(size_t(width) * height * 4);
+    for (UINT y = 0; y < height; ++y)
+    {
+        for (UINT x = 0; x < width; ++x)
+        {
+            const float u = float(x) / width;
+            const float v = float(y) / height;
+            const float values[4] = { 255.0f * u, 255.0f * v, 127.5f + 100.0f * std::sin(6.28f * (u + v)), 255.0f * (0.5f + 0.5f * std::cos(9.0f * u)) };
+            byte* texel = rgba.data() + (size_t(y) * width + x) * 4;
+            for (UINT c = 0; c < 4; ++c)
+                texel[c] = byte(std::clamp(int(values[c]) + noise(rng), 0, 255));
+        }
+    }
+    return rgba;
+}
+
+std::vector<byte> Compress(const byte* rgba, UINT width, UINT height, BlockFormat format, bool parallel = false)
+{
+    std::vector<byte> blocks(GetCompressedSize(width, height, format));
+    CompressImage(rgba, width, height, format, blocks.data(), parallel);
+    return blocks;
+}
+
+std::vector<byte> RoundTrip(const byte* rgba, UINT width, UINT height, BlockFormat format)
+{
+    std::vector<byte> decompressed(size_t(width) * height * 4);
+    DecompressImage(Compress(rgba, width, height, format).data(), width, height, format, decompressed.data());
+    return decompressed;
+}
+}
+
+TEST(BlockCompressionSizes)
+{
+    CHECK_EQ(GetBlockBytes(BlockFormat::BC1), UINT(8));
+    CHECK_EQ(GetBlockBytes(BlockFormat::BC4), UINT(8));
+    CHECK_EQ(GetBlockBytes(BlockFormat::BC3), UINT(16));
+    CHECK_EQ(GetBlockBytes(BlockFormat::BC5), UINT(16));
+    CHECK_EQ(GetBlockBytes(BlockFormat::BC7), UINT(16));
+    CHECK_EQ(GetCompressedSize(1, 1, BlockFormat::BC1), size_t(8));
+    CHECK_EQ(GetCompressedSize(37, 21, BlockFormat::BC7), size_t(10 * 6 * 16));
+    CHECK_EQ(GetCompressedSize(256, 4, BlockFormat::BC4), size_t(64 * 8));
+}
+
+TEST(BlockCompressionMipChainPsnr)
+{
+    // A full chain as the loader compresses it: sizes that aren't multiples of 4 and levels smaller than a block.
+    std::vector<byte> chain = GradientImage(148, 84, 1);
+    std::vector<MipLevelDesc> levels;
+    GenerateMips(chain, 148, 84, 4, MipPixelType::UNorm8, {}, levels);
+    REQUIRE(levels.size() == 8);
+    for (const MipLevelDesc& level : levels)
+    {
+        const byte* rgba = chain.data() + level.Offset;
+        for (const FormatInfo& info : Formats)
+        {
+            std::vector<byte> decompressed = RoundTrip(rgba, level.Width, level.Height, info.Format);
+            double psnr = ComputePsnr(rgba, decompressed.data(), level.Width, level.Height, info.Channels);
+            CHECK(psnr >= (level.Width >= 64 ? info.MinLargePsnr : info.MinPsnr));
+        }
+    }
+}
+
+TEST(BlockCompressionPartialBlocksRepeatTheEdge)
+{
+    // An image that isn't whole blocks must encode as if its last column and row were repeated to the block size.
+    for (const auto& size : { std::pair<UINT, UINT>{ 1, 1 }, { 2, 1 }, { 3, 3 }, { 5, 7 }, { 9, 6 } })
+    {
+        const UINT width = size.first;
+        const UINT height = size.second;
+        const UINT paddedWidth = (width + 3) & ~3u;
+        const UINT paddedHeight = (height + 3) & ~3u;
+        std::vector<byte> rgba = GradientImage(width, height, width * 16 + height);
+        std::vector<byte> padded(size_t(paddedWidth) * paddedHeight * 4);
+        for (UINT y = 0; y < paddedHeight; ++y)
+        {
+            for (UINT x = 0; x < paddedWidth; ++x)
+            {
+                const byte* src = rgba.data() + (size_t(std::min(y, height - 1)) * width + std::min(x, width - 1)) * 4;
+                std::copy(src, src + 4, padded.data() + (size_t(y) * paddedWidth + x) * 4);
+            }
+        }
+        for (const FormatInfo& info : Formats)
+        {
+            CHECK(Compress(rgba.data(), width, height, info.Format) == Compress(padded.data(), paddedWidth, paddedHeight, info.Format));
+
+            // And the decompression writes only the texels inside the image.
+            std::vector<byte> decompressed(rgba.size() + 4, 0xCD);
+            DecompressImage(Compress(rgba.data(), width, height, info.Format).data(), width, height, info.Format, decompressed.data());
+            CHECK(std::all_of(decompressed.end() - 4, decompressed.end(), [](byte value) { return value == 0xCD; }));
+        }
+    }
+}
+
+TEST(BlockCompressionParallelMatchesSerial)
+{
+    const std::vector<byte> rgba = GradientImage(256, 130, 5);
+    for (const FormatInfo& info : Formats)
+        CHECK(Compress(rgba.data(), 256, 130, info.Format, true) == Compress(rgba.data(), 256, 130, info.Format, false));
+}
+
+TEST(BlockCompressionFlatColor)
+{
+    // A flat block is exact in the single channel formats and within the endpoint precision in the others.
+    std::vector<byte> rgba(8 * 8 * 4);
+    for (size_t i = 0; i < rgba.size(); i += 4)
+    {
+        rgba[i] = 77;
+        rgba[i + 1] = 140;
+        rgba[i + 2] = 201;
+        rgba[i + 3] = 90;
+    }
+    for (const FormatInfo& info : Formats)
+    {
+        std::vector<byte> decompressed = RoundTrip(rgba.data(), 8, 8, info.Format);
+        double psnr = ComputePsnr(rgba.data(), decompressed.data(), 8, 8, info.Channels);
+        if (info.Format == BlockFormat::BC4 || info.Format == BlockFormat::BC5)
+            CHECK_EQ(psnr, 100.0);
+        else
+            CHECK(psnr >= 38.0);
+        // The channels the format doesn't keep decode to the defaults.
+        const byte* texel = decompressed.data();
+        if (info.Format == BlockFormat::BC4)
+            CHECK(texel[1] == 0 && texel[2] == 0 && texel[3] == 255);
+        if (info.Format == BlockFormat::BC5)
+            CHECK(texel[2] == 0 && texel[3] == 255);
+        if (info.Format == BlockFormat::BC1)
+            CHECK_EQ(int(texel[3]), 255);
+        if (info.Format == BlockFormat::BC3 || info.Format == BlockFormat::BC7)
+            CHECK_NEAR(int(texel[3]), 90, 2);
+    }
+}
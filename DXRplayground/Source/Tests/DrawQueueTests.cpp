@@ -0,0 +1,247 @@
+#include "Tests/TestFramework.h"
+
+#include "DXrenderer/DrawQueue.h"
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace DirectxPlayground;
+
+namespace
+{
+// Stands in for the command list: tracks what is bound and snapshots it at every draw, so a filtered stream can be checked against the unfiltered one.
+class RecordingCommandList : public IDrawCommandList
+{
+public:
+    struct DrawState
+    {
+        ID3D12PipelineState* Pso = nullptr;
+        D3D12_GPU_VIRTUAL_ADDRESS RootDescriptors[RedundantStateFilter::MaxRootParameters]{};
+        D3D12_VERTEX_BUFFER_VIEW VertexBuffer{};
+        D3D12_INDEX_BUFFER_VIEW IndexBuffer{};
+        D3D12_PRIMITIVE_TOPOLOGY Topology = D3D_PRIMITIVE_TOPOLOGY_UNDEFINED;
+        UINT IndexCount = 0;
+        UINT InstanceCount = 0;
+        UINT StartIndex = 0;
+        INT BaseVertex = 0;
+        UINT StartInstance = 0;
+
+        bool operator==(const DrawState& other) const
+        {
+            return Pso == other.Pso && memcmp(RootDescriptors, other.RootDescriptors, sizeof(RootDescriptors)) == 0 &&
+                memcmp(&VertexBuffer, &other.VertexBuffer, sizeof(VertexBuffer)) == 0 && memcmp(&IndexBuffer, &other.IndexBuffer, sizeof(IndexBuffer)) == 0 &&
+                Topology == other.Topology && IndexCount == other.IndexCount && InstanceCount == other.InstanceCount && StartIndex == other.StartIndex &&
+                BaseVertex == other.BaseVertex && StartInstance == other.StartInstance;
+        }
+    };
+
+    void SetPipelineState(ID3D12PipelineState* pso) override
+    {
+        m_current.Pso = pso;
+        ++m_calls;
+    }
+    void SetGraphicsRootConstantBufferView(UINT rootIndex, D3D12_GPU_VIRTUAL_ADDRESS address) override
+    {
+        m_current.RootDescriptors[rootIndex] = address;
+        ++m_calls;
+    }
+    void SetGraphicsRootShaderResourceView(UINT rootIndex, D3D12_GPU_VIRTUAL_ADDRESS address) override
+    {
+        m_current.RootDescriptors[rootIndex] = address;
+        ++m_calls;
+    }
+    void IASetVertexBuffers(const D3D12_VERTEX_BUFFER_VIEW& view) override
+    {
+        m_current.VertexBuffer = view;
+        ++m_calls;
+    }
+    void IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW& view) override
+    {
+        m_current.IndexBuffer = view;
+        ++m_calls;
+    }
+    void IASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY topology) override
+    {
+        m_current.Topology = topology;
+        ++m_calls;
+    }
+    void DrawIndexedInstanced(UINT indexCount, UINT instanceCount, UINT startIndex, INT baseVertex, UINT startInstance) override
+    {
+        m_current.IndexCount = indexCount;
+        m_current.InstanceCount = instanceCount;
+        m_current.StartIndex = startIndex;
+        m_current.BaseVertex = baseVertex;
+        m_current.StartInstance = startInstance;
+        m_draws.push_back(m_current);
+        ++m_calls;
+    }
+
+    const std::vector<DrawState>& GetDraws() const
+    {
+        return m_draws;
+    }
+    size_t GetCallsCount() const
+    {
+        return m_calls;
+    }
+
+private:
+    DrawState m_current;
+    std::vector<DrawState> m_draws;
+    size_t m_calls = 0;
+};
+
+// A scene-like mix: a few PSOs, a few hundred materials and meshes in a handful of pooled buffers, a transform per draw.
+// StartInstance is the packet index, so every recorded draw can be traced back to its packet.
+std::vector<DrawPacket> MakePackets(DrawQueue& queue, size_t count, UINT seed)
+{
+    constexpr UINT PsoCount = 8;
+    constexpr UINT MaterialCount = 256;
+    constexpr UINT MeshCount = 1024;
+    constexpr UINT PoolBlockCount = 4;
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<UINT> psoDist(0, PsoCount - 1);
+    std::uniform_int_distribution<UINT> materialDist(0, MaterialCount - 1);
+    std::uniform_int_distribution<UINT> meshDist(0, MeshCount - 1);
+    std::uniform_real_distribution<float> depthDist(0.1f, 500.0f);
+
+    std::vector<DrawPacket> packets(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        DrawPacket& packet = packets[i];
+        // Never dereferenced, only compared.
+        packet.Pso = reinterpret_cast<ID3D12PipelineState*>(uintptr_t(psoDist(rng) + 1) * 0x100);
+        UINT material = materialDist(rng);
+        UINT mesh = meshDist(rng);
+        UINT block = mesh % PoolBlockCount;
+        packet.AddCbv(1, 0x10000000ull + i * 256);
+        packet.AddCbv(2, 0x20000000ull + material * 256);
+        if (material % 4 == 0)
+            packet.AddSrv(3, 0x50000000ull + material * 0x10000);
+        packet.VertexBuffer = { 0x30000000ull + block * 0x1000000ull, 0x1000000, 48 };
+        packet.IndexBuffer = { 0x40000000ull + block * 0x1000000ull, 0x1000000, mesh % 3 == 0 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT };
+        packet.IndexCount = 3 * (mesh + 1);
+        packet.StartIndex = mesh * 4096;
+        packet.BaseVertex = INT(mesh * 1024);
+        packet.StartInstance = UINT(i);
+        // Coarse depths, so there are equal keys and the order among them shows.
+        packet.SortKey = DrawQueue::MakeSortKey(0, queue.GetPsoId(packet.Pso), material, float(UINT(depthDist(rng)) / 50));
+    }
+    return packets;
+}
+
+// Every bind as it is, in the given order.
+void RecordUnfiltered(const std::vector<DrawPacket>& packets, const std::vector<UINT>& order, IDrawCommandList& commandList)
+{
+    for (UINT index : order)
+    {
+        const DrawPacket& packet = packets[index];
+        commandList.SetPipelineState(packet.Pso);
+        for (UINT i = 0; i < packet.CbvCount; ++i)
+            commandList.SetGraphicsRootConstantBufferView(packet.Cbvs[i].RootIndex, packet.Cbvs[i].Address);
+        for (UINT i = 0; i < packet.SrvCount; ++i)
+            commandList.SetGraphicsRootShaderResourceView(packet.Srvs[i].RootIndex, packet.Srvs[i].Address);
+        commandList.IASetVertexBuffers(packet.VertexBuffer);
+        commandList.IASetIndexBuffer(packet.IndexBuffer);
+        commandList.IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+        commandList.DrawIndexedInstanced(packet.IndexCount, packet.InstanceCount, packet.StartIndex, packet.BaseVertex, packet.StartInstance);
+    }
+}
+}
+
+TEST(DrawQueueSortKeyOrder)
+{
+    // Pass first, then the PSO, the material, and front to back last.
+    CHECK(DrawQueue::MakeSortKey(0, 5, 1000, 400.0f) < DrawQueue::MakeSortKey(1, 0, 0, 0.0f));
+    CHECK(DrawQueue::MakeSortKey(0, 1, 1000, 400.0f) < DrawQueue::MakeSortKey(0, 2, 0, 0.0f));
+    CHECK(DrawQueue::MakeSortKey(0, 1, 3, 400.0f) < DrawQueue::MakeSortKey(0, 1, 4, 0.0f));
+    CHECK(DrawQueue::MakeSortKey(0, 1, 3, 1.5f) < DrawQueue::MakeSortKey(0, 1, 3, 2.0f));
+    CHECK(DrawQueue::MakeSortKey(0, 1, 3, 10.0f) < DrawQueue::MakeSortKey(0, 1, 3, 1000.0f));
+    // Negative depths clamp to the front.
+    CHECK_EQ(DrawQueue::MakeSortKey(0, 1, 3, -5.0f), DrawQueue::MakeSortKey(0, 1, 3, 0.0f));
+}
+
+TEST(DrawQueueFlushesInKeyOrder)
+{
+    DrawQueue queue;
+    std::vector<DrawPacket> packets = MakePackets(queue, 20'000, 42);
+    for (const DrawPacket& packet : packets)
+        queue.Submit(packet);
+    RecordingCommandList commandList;
+    queue.Flush(commandList);
+    CHECK_EQ(queue.GetSize(), size_t(0));
+    REQUIRE(commandList.GetDraws().size() == packets.size());
+
+    // Sorted by the key, and stable: equal keys keep the submission order.
+    std::vector<UINT> order(packets.size());
+    for (UINT i = 0; i < order.size(); ++i)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&packets](UINT a, UINT b) { return packets[a].SortKey < packets[b].SortKey; });
+    size_t outOfOrder = 0;
+    for (size_t i = 0; i < order.size(); ++i)
+        outOfOrder += commandList.GetDraws()[i].StartInstance == order[i] ? 0 : 1;
+    CHECK_EQ(outOfOrder, size_t(0));
+}
+
+TEST(DrawQueueFilteredStateMatchesUnfiltered)
+{
+    // At every draw the filtered stream must have bound exactly what binding everything every time binds.
+    DrawQueue queue;
+    std::vector<DrawPacket> packets = MakePackets(queue, 20'000, 7);
+    std::vector<UINT> order(packets.size());
+    for (UINT i = 0; i < order.size(); ++i)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&packets](UINT a, UINT b) { return packets[a].SortKey < packets[b].SortKey; });
+    RecordingCommandList unfiltered;
+    RecordUnfiltered(packets, order, unfiltered);
+
+    for (const DrawPacket& packet : packets)
+        queue.Submit(packet);
+    RecordingCommandList filtered;
+    queue.Flush(filtered);
+
+    REQUIRE(filtered.GetDraws().size() == unfiltered.GetDraws().size());
+    size_t mismatches = 0;
+    for (size_t i = 0; i < filtered.GetDraws().size(); ++i)
+        mismatches += filtered.GetDraws()[i] == unfiltered.GetDraws()[i] ? 0 : 1;
+    CHECK_EQ(mismatches, size_t(0));
+
+    const DrawStateStats& stats = queue.GetLastFlushStats();
+    CHECK_EQ(stats.Draws, UINT(packets.size()));
+    CHECK(filtered.GetCallsCount() < unfiltered.GetCallsCount());
+    CHECK_EQ(stats.TopologyBinds, UINT(1));
+    CHECK(stats.PsoBinds <= 8);
+    const size_t elided = stats.PsoElided + stats.CbvElided + stats.SrvElided + stats.VertexBufferElided + stats.IndexBufferElided + stats.TopologyElided;
+    CHECK_EQ(filtered.GetCallsCount() + elided, unfiltered.GetCallsCount());
+}
+
+TEST(RedundantStateFilterReset)
+{
+    RecordingCommandList commandList;
+    RedundantStateFilter filter(commandList);
+    ID3D12PipelineState* pso = reinterpret_cast<ID3D12PipelineState*>(uintptr_t(0x100));
+    const D3D12_VERTEX_BUFFER_VIEW vertexBuffer = { 0x1000, 256, 16 };
+    filter.SetPipelineState(pso);
+    filter.SetGraphicsRootConstantBufferView(0, 0x2000);
+    filter.IASetVertexBuffers(vertexBuffer);
+    filter.SetPipelineState(pso);
+    filter.SetGraphicsRootConstantBufferView(0, 0x2000);
+    filter.IASetVertexBuffers(vertexBuffer);
+    CHECK_EQ(commandList.GetCallsCount(), size_t(3));
+
+    // A different address on the same root parameter, or the same view with another stride, is a bind.
+    filter.SetGraphicsRootConstantBufferView(0, 0x2100);
+    filter.IASetVertexBuffers({ 0x1000, 256, 32 });
+    CHECK_EQ(commandList.GetCallsCount(), size_t(5));
+
+    // After a reset nothing is assumed bound.
+    filter.Reset();
+    filter.SetPipelineState(pso);
+    filter.SetGraphicsRootConstantBufferView(0, 0x2100);
+    CHECK_EQ(commandList.GetCallsCount(), size_t(7));
+    CHECK_EQ(filter.GetStats().PsoElided, UINT(1));
+    CHECK_EQ(filter.GetStats().CbvElided, UINT(1));
+    CHECK_EQ(filter.GetStats().VertexBufferElided, UINT(1));
+}
@@ -0,0 +1,142 @@
+#include "Tests/TestFramework.h"
+
+#include "DXrenderer/Culling/FrustumCulling.h"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace DirectxPlayground;
+
+namespace
+{
+// The camera at (0, 0, -5) looking down +z, 60 degrees vertical fov, LH with the D3D clip depth. Row vectors, as XMMatrixPerspectiveFovLH.
+struct TestCamera
+{
+    TestCamera(float nearZ, float farZ)
+    {
+        float fy = 1.0f / std::tan(0.5236f);
+        float fx = fy / 1.77f;
+        float zScale = std::isinf(farZ) ? 1.0f : farZ / (farZ - nearZ);
+        const float projection[4][4] = { { fx, 0, 0, 0 }, { 0, fy, 0, 0 }, { 0, 0, zScale, 1 }, { 0, 0, -nearZ * zScale, 0 } };
+        const float view[4][4] = { { 1, 0, 0, 0 }, { 0, 1, 0, 0 }, { 0, 0, 1, 0 }, { 0, 0, 5, 1 } };
+        for (UINT r = 0; r < 4; ++r)
+        {
+            for (UINT c = 0; c < 4; ++c)
+            {
+                for (UINT k = 0; k < 4; ++k)
+                    ViewProjection[r][c] += view[r][k] * projection[k][c];
+            }
+        }
+        Planes = ExtractFrustumPlanes(ViewProjection);
+    }
+
+    bool IsInside(const float p[3]) const
+    {
+        float clip[4] = {};
+        for (UINT c = 0; c < 4; ++c)
+            clip[c] = p[0] * ViewProjection[0][c] + p[1] * ViewProjection[1][c] + p[2] * ViewProjection[2][c] + ViewProjection[3][c];
+        return std::abs(clip[0]) <= clip[3] && std::abs(clip[1]) <= clip[3] && clip[2] >= 0.0f && clip[2] <= clip[3];
+    }
+
+    float ViewProjection[4][4] = {};
+    FrustumPlanes Planes;
+};
+
+CullingBounds RandomBounds(size_t count, std::mt19937& rng)
+{
+    std::uniform_real_distribution<float> position(-60.0f, 60.0f);
+    std::uniform_real_distribution<float> size(0.01f, 3.0f);
+    CullingBounds bounds;
+    for (size_t i = 0; i < count; ++i)
+    {
+        float center[3] = { position(rng), position(rng), position(rng) + 40.0f };
+        float extents[3] = { size(rng), size(rng), size(rng) };
+        bounds.Add(center, extents, std::sqrt(extents[0] * extents[0] + extents[1] * extents[1] + extents[2] * extents[2]));
+    }
+    return bounds;
+}
+
+std::vector<UINT> Cull(const TestCamera& camera, const CullingBounds& bounds, CullShape shape, SimdLevel level = SimdLevel::Scalar)
+{
+    std::vector<UINT> visible(bounds.Count + 1);
+    visible.resize(FrustumCull(camera.Planes, bounds, shape, visible.data(), level));
+    return visible;
+}
+}
+
+TEST(FrustumCullLevelsMatchScalar)
+{
+    // Counts around the 4 and 8 wide blocks and the padding, the result must be exactly the scalar one.
+    std::mt19937 rng(1);
+    const TestCamera camera(0.1f, 100.0f);
+    for (size_t count : { 0, 1, 3, 4, 7, 8, 9, 17, 100'003 })
+    {
+        CullingBounds bounds = RandomBounds(count, rng);
+        for (CullShape shape : { CullShape::Box, CullShape::Sphere })
+        {
+            std::vector<UINT> reference = Cull(camera, bounds, shape);
+            for (SimdLevel level : { SimdLevel::SSE41, SimdLevel::AVX2 })
+            {
+                if (level > GetSimdLevel())
+                    continue;
+                CHECK(Cull(camera, bounds, shape, level) == reference);
+            }
+        }
+    }
+}
+
+TEST(FrustumCullKeepsBoundsWithAPointInside)
+{
+    // Conservative: a box with any corner or its center inside the frustum is never culled, a sphere with the center inside neither.
+    std::mt19937 rng(2);
+    for (float farZ : { 100.0f, INFINITY })
+    {
+        const TestCamera camera(0.1f, farZ);
+        CullingBounds bounds = RandomBounds(20'000, rng);
+        for (CullShape shape : { CullShape::Box, CullShape::Sphere })
+        {
+            std::vector<bool> isVisible(bounds.Count, false);
+            for (UINT i : Cull(camera, bounds, shape))
+                isVisible[i] = true;
+            size_t wronglyCulled = 0;
+            for (size_t i = 0; i < bounds.Count; ++i)
+            {
+                const float center[3] = { bounds.CenterX[i], bounds.CenterY[i], bounds.CenterZ[i] };
+                bool inside = camera.IsInside(center);
+                for (UINT k = 0; k < 8 && shape == CullShape::Box; ++k)
+                {
+                    const float corner[3] = { center[0] + (k & 1 ? 1.0f : -1.0f) * bounds.ExtentX[i], center[1] + (k & 2 ? 1.0f : -1.0f) * bounds.ExtentY[i],
+                        center[2] + (k & 4 ? 1.0f : -1.0f) * bounds.ExtentZ[i] };
+                    inside = inside || camera.IsInside(corner);
+                }
+                wronglyCulled += inside && !isVisible[i] ? 1 : 0;
+            }
+            CHECK_EQ(wronglyCulled, size_t(0));
+        }
+    }
+}
+
+TEST(FrustumCullKnownBounds)
+{
+    const TestCamera camera(0.1f, 100.0f);
+    CullingBounds bounds;
+    const float extents[3] = { 1.0f, 1.0f, 1.0f };
+    const float radius = std::sqrt(3.0f);
+    const float centers[][3] = {
+        { 0.0f, 0.0f, 10.0f }, // In front of the camera.
+        { 0.0f, 0.0f, -20.0f }, // Behind it.
+        { 0.0f, 0.0f, 200.0f }, // Past the far plane.
+        { 0.0f, 0.0f, 95.5f }, // Crossing the far plane.
+        { 200.0f, 0.0f, 10.0f }, // Far to the right.
+        { 0.0f, 0.0f, -5.5f }, // Around the camera, crossing the near plane.
+    };
+    for (const auto& center : centers)
+        bounds.Add(center, extents, radius);
+    for (CullShape shape : { CullShape::Box, CullShape::Sphere })
+        CHECK(Cull(camera, bounds, shape) == std::vector<UINT>({ 0, 3, 5 }));
+
+    // Without the far plane the distant one is visible too.
+    const TestCamera infinite(0.1f, INFINITY);
+    CHECK(Cull(infinite, bounds, CullShape::Box) == std::vector<UINT>({ 0, 2, 3, 5 }));
+}
@@ -0,0 +1,41 @@
+#include "Tests/TestFramework.h"
+
+#include "DXrenderer/Buffers/GeometryPool.h"
+
+using namespace DirectxPlayground;
+
+TEST(GeometryPoolDeferredFreesWaitForTheFence)
+{
+    ID3D12Device* device = Tests::GetTestDevice();
+    if (device == nullptr)
+        SKIP("no D3D12 device");
+
+    GeometryPool pool(device, 1024 * 1024);
+    GeometryPool::VertexRange vertices = pool.AllocateVertices(32, 1000);
+    GeometryPool::IndexRange indices = pool.AllocateIndices(DXGI_FORMAT_R32_UINT, 3000);
+    const UINT64 allocated = pool.GetAllocatedBytes();
+    CHECK_EQ(allocated, UINT64(32 * 1000 + 4 * 3000));
+
+    // Still allocated until the GPU has passed the fence of the frame they were freed in.
+    pool.FreeDeferred(vertices);
+    pool.FreeDeferred(indices);
+    CHECK_EQ(pool.GetAllocatedBytes(), allocated);
+    pool.RetireStaging(5);
+    pool.ReleaseCompletedStaging(4);
+    CHECK_EQ(pool.GetAllocatedBytes(), allocated);
+
+    // A later frame frees another range, the first ones go with their own fence.
+    GeometryPool::VertexRange later = pool.AllocateVertices(32, 10);
+    pool.FreeDeferred(later);
+    pool.RetireStaging(6);
+    pool.ReleaseCompletedStaging(5);
+    CHECK_EQ(pool.GetAllocatedBytes(), UINT64(32 * 10));
+    pool.ReleaseCompletedStaging(6);
+    CHECK_EQ(pool.GetAllocatedBytes(), UINT64(0));
+
+    // ReleaseStaging is for after a flush, the GPU is idle then.
+    GeometryPool::IndexRange flushed = pool.AllocateIndices(DXGI_FORMAT_R16_UINT, 100);
+    pool.FreeDeferred(flushed);
+    pool.ReleaseStaging();
+    CHECK_EQ(pool.GetAllocatedBytes(), UINT64(0));
+}
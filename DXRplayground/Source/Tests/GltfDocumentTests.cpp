@@ -0,0 +1,223 @@
+#include "Tests/TestFramework.h"
+
+#include "DXrenderer/GltfDocument.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace DirectxPlayground;
+
+namespace
+{
+void WriteFile(const std::string& path, const void* data, size_t size)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(static_cast<const char*>(data), std::streamsize(size));
+}
+
+// One float3 accessor over the whole buffer.
+std::string PositionsGltf(const std::string& bufferUri, size_t count)
+{
+    size_t byteLength = count * 3 * sizeof(float);
+    return R"({"asset":{"version":"2.0"},"buffers":[{"uri":")" + bufferUri + R"(","byteLength":)" + std::to_string(byteLength) + R"(}],)"
+        R"("bufferViews":[{"buffer":0,"byteLength":)" + std::to_string(byteLength) + R"(}],)"
+        R"("accessors":[{"bufferView":0,"componentType":5126,"count":)" + std::to_string(count) + R"(,"type":"VEC3"}]})";
+}
+}
+
+TEST(GltfDocumentDecodesEscapedBufferUris)
+{
+    const float positions[6] = { 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f };
+    const std::string dir = Tests::GetTempDirectory();
+    WriteFile(dir + "escaped buffer+.bin", positions, sizeof(positions));
+    std::string gltf = PositionsGltf("escaped%20buffer%2b.bin", 2);
+    WriteFile(dir + "escaped.gltf", gltf.c_str(), gltf.size());
+
+    GltfDocument document;
+    REQUIRE(document.Load(dir + "escaped.gltf", true));
+    CHECK(document.IsMapped());
+    const tinygltf::BufferView& view = document.GetModel().bufferViews[0];
+    CHECK(memcmp(document.GetBufferData(view.buffer) + view.byteOffset, positions, sizeof(positions)) == 0);
+}
+
+TEST(GltfDocumentRejectsMalformedBufferUris)
+{
+    // A '%' not followed by two hex digits must not throw, the mapped load rejects the document.
+    const float positions[3] = { 1.0f, 2.0f, 3.0f };
+    const std::string dir = Tests::GetTempDirectory();
+    for (const char* uri : { "bad%zzbuffer.bin", "bad%2", "bad%", "bad%%41.bin" })
+    {
+        WriteFile(dir + "malformed.bin", positions, sizeof(positions));
+        std::string gltf = PositionsGltf(uri, 1);
+        WriteFile(dir + "malformed.gltf", gltf.c_str(), gltf.size());
+        GltfDocument document;
+        document.Load(dir + "malformed.gltf", true);
+        CHECK(!document.IsMapped());
+    }
+}
+
+namespace
+{
+// A .gltf with one .bin. The views are 4 byte aligned in the buffer, the accessor JSON refers to them by the AddView order.
+class SparseFixture
+{
+public:
+    int AddView(const void* data, size_t size, size_t byteStride = 0)
+    {
+        m_bin.resize((m_bin.size() + 3) / 4 * 4);
+        std::string view = R"({"buffer":0,"byteOffset":)" + std::to_string(m_bin.size()) + R"(,"byteLength":)" + std::to_string(size);
+        if (byteStride != 0)
+            view += R"(,"byteStride":)" + std::to_string(byteStride);
+        m_views.push_back(view + "}");
+        m_bin.insert(m_bin.end(), static_cast<const byte*>(data), static_cast<const byte*>(data) + size);
+        return int(m_views.size() - 1);
+    }
+
+    // VEC3 accessor of count elements, over baseView unless it's negative, with sparseCount substitutions.
+    void SetAccessor(UINT componentType, bool normalized, size_t count, int baseView, size_t sparseCount, UINT indexType, int indicesView, int valuesView)
+    {
+        m_accessor = R"({"componentType":)" + std::to_string(componentType) + R"(,"normalized":)" + (normalized ? "true" : "false") +
+            R"(,"count":)" + std::to_string(count) + R"(,"type":"VEC3")";
+        if (baseView >= 0)
+            m_accessor += R"(,"bufferView":)" + std::to_string(baseView);
+        m_accessor += R"(,"sparse":{"count":)" + std::to_string(sparseCount) + R"(,"indices":{"bufferView":)" + std::to_string(indicesView) +
+            R"(,"componentType":)" + std::to_string(indexType) + R"(},"values":{"bufferView":)" + std::to_string(valuesView) + "}}}";
+    }
+
+    // The accessor through both load paths, as float4 per element.
+    void Check(const std::string& name, const std::vector<float>& expected) const
+    {
+        const std::string dir = Tests::GetTempDirectory();
+        std::string json = R"({"asset":{"version":"2.0"},"buffers":[{"uri":")" + name + R"(.bin","byteLength":)" + std::to_string(m_bin.size()) + R"(}],"bufferViews":[)";
+        for (size_t i = 0; i < m_views.size(); ++i)
+            json += (i > 0 ? "," : "") + m_views[i];
+        json += R"(],"accessors":[)" + m_accessor + "]}";
+        WriteFile(dir + name + ".bin", m_bin.data(), m_bin.size());
+        WriteFile(dir + name + ".gltf", json.c_str(), json.size());
+
+        for (bool mapBuffers : { true, false })
+        {
+            GltfDocument document;
+            REQUIRE(document.Load(dir + name + ".gltf", mapBuffers));
+            CHECK_EQ(document.IsMapped(), mapBuffers);
+            REQUIRE(document.GetModel().accessors.size() == 1);
+            std::vector<float> result(expected.size(), -1234.0f);
+            GatherAccessor(document, document.GetModel().accessors[0], reinterpret_cast<byte*>(result.data()), 4 * sizeof(float), 3);
+            for (size_t i = 0; i < expected.size(); ++i)
+                CHECK_NEAR(result[i], expected[i], 1e-6f);
+        }
+    }
+
+private:
+    std::vector<byte> m_bin;
+    std::vector<std::string> m_views;
+    std::string m_accessor;
+};
+
+constexpr UINT GltfByte = 5120;
+constexpr UINT GltfUnsignedByte = 5121;
+constexpr UINT GltfUnsignedShort = 5123;
+constexpr UINT GltfUnsignedInt = 5125;
+constexpr UINT GltfFloat = 5126;
+
+// float4 per element, w untouched by the 3 component gather.
+std::vector<float> ExpectedElements(size_t count)
+{
+    std::vector<float> res(count * 4, 0.0f);
+    for (size_t i = 0; i < count; ++i)
+        res[i * 4 + 3] = -1234.0f;
+    return res;
+}
+
+void SetElement(std::vector<float>& elements, size_t index, float x, float y, float z)
+{
+    elements[index * 4 + 0] = x;
+    elements[index * 4 + 1] = y;
+    elements[index * 4 + 2] = z;
+}
+}
+
+TEST(GltfSparseAccessorWithoutBufferView)
+{
+    // No base view: zeros with the substitutions on top. UNSIGNED_BYTE indices.
+    SparseFixture fixture;
+    const byte indices[2] = { 1, 4 };
+    const float values[6] = { 1.0f, 2.0f, 3.0f, -4.0f, -5.0f, -6.0f };
+    int indicesView = fixture.AddView(indices, sizeof(indices));
+    int valuesView = fixture.AddView(values, sizeof(values));
+    fixture.SetAccessor(GltfFloat, false, 6, -1, 2, GltfUnsignedByte, indicesView, valuesView);
+
+    std::vector<float> expected = ExpectedElements(6);
+    SetElement(expected, 1, 1.0f, 2.0f, 3.0f);
+    SetElement(expected, 4, -4.0f, -5.0f, -6.0f);
+    fixture.Check("sparse_no_view", expected);
+}
+
+TEST(GltfSparseAccessorOverBaseView)
+{
+    // Strided float base view, UNSIGNED_SHORT and UNSIGNED_INT indices, the first and the last element replaced.
+    for (UINT indexType : { GltfUnsignedShort, GltfUnsignedInt })
+    {
+        SparseFixture fixture;
+        std::vector<float> base(7 * 5);
+        for (size_t i = 0; i < base.size(); ++i)
+            base[i] = float(i) * 0.5f;
+        int baseView = fixture.AddView(base.data(), base.size() * sizeof(float), 5 * sizeof(float));
+        const USHORT shortIndices[2] = { 0, 6 };
+        const UINT intIndices[2] = { 0, 6 };
+        int indicesView = indexType == GltfUnsignedShort ? fixture.AddView(shortIndices, sizeof(shortIndices)) : fixture.AddView(intIndices, sizeof(intIndices));
+        const float values[6] = { 10.0f, 11.0f, 12.0f, 13.0f, 14.0f, 15.0f };
+        int valuesView = fixture.AddView(values, sizeof(values));
+        fixture.SetAccessor(GltfFloat, false, 7, baseView, 2, indexType, indicesView, valuesView);
+
+        std::vector<float> expected = ExpectedElements(7);
+        for (size_t i = 0; i < 7; ++i)
+            SetElement(expected, i, base[i * 5], base[i * 5 + 1], base[i * 5 + 2]);
+        SetElement(expected, 0, 10.0f, 11.0f, 12.0f);
+        SetElement(expected, 6, 13.0f, 14.0f, 15.0f);
+        fixture.Check(indexType == GltfUnsignedShort ? "sparse_base_ushort" : "sparse_base_uint", expected);
+    }
+}
+
+TEST(GltfSparseAccessorNormalizedBytes)
+{
+    // Normalized BYTE base with the 4 byte vertex attribute stride, the values are decoded the same way, -128 clamps to -1.
+    SparseFixture fixture;
+    const signed char base[5 * 4] = { 127, -127, 0, 0, 64, -64, 1, 0, -128, 127, -1, 0, 10, 20, 30, 0, -10, -20, -30, 0 };
+    int baseView = fixture.AddView(base, sizeof(base), 4);
+    const byte indices[2] = { 2, 3 };
+    const signed char values[6] = { -128, 0, 127, 5, -5, 50 };
+    int indicesView = fixture.AddView(indices, sizeof(indices));
+    int valuesView = fixture.AddView(values, sizeof(values));
+    fixture.SetAccessor(GltfByte, true, 5, baseView, 2, GltfUnsignedByte, indicesView, valuesView);
+
+    auto snorm = [](int v) { return std::max(float(v) / 127.0f, -1.0f); };
+    std::vector<float> expected = ExpectedElements(5);
+    for (size_t i = 0; i < 5; ++i)
+        SetElement(expected, i, snorm(base[i * 4]), snorm(base[i * 4 + 1]), snorm(base[i * 4 + 2]));
+    SetElement(expected, 2, -1.0f, 0.0f, 1.0f);
+    SetElement(expected, 3, snorm(5), snorm(-5), snorm(50));
+    fixture.Check("sparse_snorm8", expected);
+}
+
+TEST(GltfSparseAccessorQuantizedShorts)
+{
+    // KHR_mesh_quantization style positions: UNSIGNED_SHORT, not normalized, converted as is.
+    SparseFixture fixture;
+    const USHORT base[4 * 4] = { 0, 1, 2, 0, 1000, 2000, 3000, 0, 65535, 0, 65535, 0, 7, 8, 9, 0 };
+    int baseView = fixture.AddView(base, sizeof(base), 8);
+    const USHORT indices[1] = { 1 };
+    const USHORT values[3] = { 40000, 50000, 60000 };
+    int indicesView = fixture.AddView(indices, sizeof(indices));
+    int valuesView = fixture.AddView(values, sizeof(values));
+    fixture.SetAccessor(GltfUnsignedShort, false, 4, baseView, 1, GltfUnsignedShort, indicesView, valuesView);
+
+    std::vector<float> expected = ExpectedElements(4);
+    for (size_t i = 0; i < 4; ++i)
+        SetElement(expected, i, float(base[i * 4]), float(base[i * 4 + 1]), float(base[i * 4 + 2]));
+    SetElement(expected, 1, 40000.0f, 50000.0f, 60000.0f);
+    fixture.Check("sparse_ushort", expected);
+}
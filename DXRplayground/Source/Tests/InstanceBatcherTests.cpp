@@ -0,0 +1,124 @@
+#include "Tests/TestFramework.h"
+
+#include "DXrenderer/InstanceBatcher.h"
+
+#include <map>
+#include <random>
+#include <vector>
+
+using namespace DirectxPlayground;
+
+namespace
+{
+struct Entry
+{
+    UINT Mesh = 0;
+    UINT Material = 0;
+    float ToWorld[4][4] = {};
+};
+
+// Random meshes, materials and matrices, in random order.
+std::vector<Entry> RandomEntries(size_t count, UINT meshCount, UINT materialCount, std::mt19937& rng)
+{
+    std::uniform_int_distribution<UINT> meshDist(0, meshCount - 1);
+    std::uniform_int_distribution<UINT> materialDist(0, materialCount - 1);
+    std::uniform_real_distribution<float> value(-500.0f, 500.0f);
+    std::vector<Entry> entries(count);
+    for (Entry& entry : entries)
+    {
+        entry.Mesh = meshDist(rng);
+        entry.Material = materialDist(rng);
+        for (auto& row : entry.ToWorld)
+        {
+            for (float& v : row)
+                v = value(rng);
+        }
+    }
+    return entries;
+}
+
+// The reference groups with a map: the batcher must give the same groups in the same order, with the instances in the order they were added
+// and their transforms transposed. The user data is the entry index to trace the records back.
+size_t CountMismatches(const InstanceBatcher& batcher, const std::vector<Entry>& entries)
+{
+    std::map<std::pair<UINT, UINT>, std::vector<UINT>> reference;
+    for (size_t i = 0; i < entries.size(); ++i)
+        reference[{ entries[i].Mesh, entries[i].Material }].push_back(UINT(i));
+
+    const std::vector<InstanceGroup>& groups = batcher.GetGroups();
+    size_t mismatches = groups.size() != reference.size() || batcher.GetInstanceCount() != entries.size() ? 1 : 0;
+    UINT nextInstance = 0;
+    auto expected = reference.begin();
+    for (size_t g = 0; g < groups.size() && expected != reference.end(); ++g, ++expected)
+    {
+        const InstanceGroup& group = groups[g];
+        if (group.Mesh != expected->first.first || group.Material != expected->first.second || group.InstanceCount != expected->second.size() ||
+            group.FirstInstance != nextInstance)
+        {
+            ++mismatches;
+            continue;
+        }
+        nextInstance += group.InstanceCount;
+        for (UINT i = 0; i < group.InstanceCount; ++i)
+        {
+            const InstanceData& instance = batcher.GetInstanceData()[group.FirstInstance + i];
+            UINT source = expected->second[i];
+            bool transposed = true;
+            for (UINT row = 0; row < 4; ++row)
+            {
+                for (UINT column = 0; column < 4; ++column)
+                    transposed &= instance.ToWorld[row][column] == entries[source].ToWorld[column][row];
+            }
+            mismatches += instance.UserData != source || !transposed ? 1 : 0;
+        }
+    }
+    return mismatches;
+}
+}
+
+TEST(InstanceBatcherMatchesReferenceGroups)
+{
+    // Counts below and above a gather chunk, so the pool path runs too.
+    std::mt19937 rng(42);
+    for (size_t count : { 1, 7, 1000, 100'000 })
+    {
+        std::vector<Entry> entries = RandomEntries(count, 500, 4, rng);
+        for (bool parallel : { false, true })
+        {
+            InstanceBatcher batcher;
+            batcher.Reserve(count);
+            for (size_t i = 0; i < count; ++i)
+                batcher.Add(entries[i].Mesh, entries[i].Material, entries[i].ToWorld, UINT(i));
+            batcher.Build(parallel);
+            CHECK_EQ(CountMismatches(batcher, entries), size_t(0));
+            CHECK_EQ(batcher.GetInstanceDataSize(), count * sizeof(InstanceData));
+        }
+    }
+}
+
+TEST(InstanceBatcherRebuildAndClear)
+{
+    std::mt19937 rng(7);
+    std::vector<Entry> entries = RandomEntries(3000, 20, 3, rng);
+    InstanceBatcher batcher;
+    batcher.Build();
+    CHECK(batcher.GetGroups().empty());
+    CHECK_EQ(batcher.GetInstanceCount(), size_t(0));
+
+    // Adding after a Build regroups everything on the next one.
+    for (size_t i = 0; i < 1000; ++i)
+        batcher.Add(entries[i].Mesh, entries[i].Material, entries[i].ToWorld, UINT(i));
+    batcher.Build();
+    for (size_t i = 1000; i < entries.size(); ++i)
+        batcher.Add(entries[i].Mesh, entries[i].Material, entries[i].ToWorld, UINT(i));
+    batcher.Build();
+    CHECK_EQ(CountMismatches(batcher, entries), size_t(0));
+
+    // A frame after a Clear starts from nothing.
+    batcher.Clear();
+    std::vector<Entry> nextFrame(entries.begin() + 500, entries.begin() + 600);
+    for (size_t i = 0; i < nextFrame.size(); ++i)
+        batcher.Add(nextFrame[i].Mesh, nextFrame[i].Material, nextFrame[i].ToWorld, UINT(i));
+    batcher.Build();
+    CHECK_EQ(CountMismatches(batcher, nextFrame), size_t(0));
+}
@@ -0,0 +1,148 @@
+#include "Tests/TestFramework.h"
+
+#include "DXrenderer/Geometry/MeshCache.h"
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+using namespace DirectxPlayground;
+
+namespace
+{
+// The cache only reads the source for its stamp and hash, so any bytes do.
+std::string MakeSource(const std::string& name, const std::string& content)
+{
+    std::string path = Tests::GetTempDirectory() + name;
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << content;
+    std::error_code ec;
+    std::filesystem::remove(MeshCache::GetCachePath(path), ec);
+    return path;
+}
+
+void Touch(const std::string& path)
+{
+    std::filesystem::last_write_time(path, std::filesystem::last_write_time(path) + std::chrono::seconds(10));
+}
+
+struct TestModel
+{
+    std::vector<Vertex> Vertices;
+    std::vector<UINT> Indices;
+    MeshCache::ModelData Data;
+
+    TestModel()
+    {
+        Vertices.resize(4);
+        for (size_t i = 0; i < Vertices.size(); ++i)
+            Vertices[i].Pos = { float(i), float(i * 2), float(i * 3) };
+        Indices = { 0, 1, 2, 2, 1, 3 };
+
+        Data.ProcessingFlags = 5;
+        Data.Images = { "albedo.png" };
+        Data.Textures = { 0 };
+        Data.Materials.resize(2);
+        Data.Materials[1].BaseColorFactor[0] = 0.5f;
+        Data.Nodes.resize(2);
+        Data.Nodes[1].Parent = 0;
+        Data.Nodes[1].Translation = { 1.0f, 2.0f, 3.0f };
+        Data.Meshes.push_back({ 1, 1, Vertices.data(), UINT(Vertices.size()), Indices.data(), UINT(Indices.size()) });
+    }
+};
+}
+
+TEST(MeshCacheRoundTrip)
+{
+    const std::string source = MakeSource("MeshCacheRoundTrip.gltf", "source");
+    TestModel model;
+    REQUIRE(MeshCache::Write(source, model.Data));
+
+    MeshCache cache;
+    REQUIRE(cache.Open(source, model.Data.ProcessingFlags));
+    const MeshCache::ModelData& data = cache.GetData();
+    CHECK_EQ(data.ProcessingFlags, model.Data.ProcessingFlags);
+    REQUIRE(data.Images.size() == 1 && data.Textures.size() == 1 && data.Materials.size() == 2 && data.Nodes.size() == 2 && data.Meshes.size() == 1);
+    CHECK(data.Images[0] == "albedo.png");
+    CHECK_EQ(data.Materials[1].BaseColorFactor[0], 0.5f);
+    CHECK_EQ(data.Nodes[1].Parent, UINT(0));
+    CHECK_EQ(data.Nodes[1].Translation.z, 3.0f);
+
+    // The arrays point into the mapping, 16 byte aligned for the upload.
+    const MeshCache::MeshData& mesh = data.Meshes[0];
+    CHECK_EQ(mesh.MaterialIndex, 1);
+    CHECK_EQ(mesh.NodeIndex, UINT(1));
+    REQUIRE(mesh.VertexCount == model.Vertices.size() && mesh.IndexCount == model.Indices.size());
+    CHECK(mesh.Vertices != model.Vertices.data());
+    CHECK_EQ(reinterpret_cast<uintptr_t>(mesh.Vertices) % 16, uintptr_t(0));
+    CHECK_EQ(reinterpret_cast<uintptr_t>(mesh.Indices) % 16, uintptr_t(0));
+    CHECK(memcmp(mesh.Vertices, model.Vertices.data(), sizeof(Vertex) * mesh.VertexCount) == 0);
+    CHECK(memcmp(mesh.Indices, model.Indices.data(), sizeof(UINT) * mesh.IndexCount) == 0);
+}
+
+TEST(MeshCacheRejectsOtherProcessingFlags)
+{
+    const std::string source = MakeSource("MeshCacheFlags.gltf", "source");
+    TestModel model;
+    REQUIRE(MeshCache::Write(source, model.Data));
+
+    MeshCache cache;
+    CHECK(!cache.Open(source, model.Data.ProcessingFlags ^ 1));
+    CHECK(cache.GetData().Meshes.empty());
+    CHECK(cache.Open(source, model.Data.ProcessingFlags));
+}
+
+TEST(MeshCacheRejectsOtherHeaders)
+{
+    const std::string source = MakeSource("MeshCacheHeader.gltf", "source");
+    TestModel model;
+    REQUIRE(MeshCache::Write(source, model.Data));
+
+    // The version follows the magic, an older build's cache must not be read.
+    const std::string cachePath = MeshCache::GetCachePath(source);
+    {
+        std::fstream file(cachePath, std::ios::binary | std::ios::in | std::ios::out);
+        REQUIRE(file.good());
+        file.seekp(sizeof(UINT));
+        const UINT version = 0xFFFF;
+        file.write(reinterpret_cast<const char*>(&version), sizeof(version));
+    }
+    MeshCache cache;
+    CHECK(!cache.Open(source, model.Data.ProcessingFlags));
+
+    // So is a truncated one.
+    REQUIRE(MeshCache::Write(source, model.Data));
+    std::filesystem::resize_file(cachePath, std::filesystem::file_size(cachePath) - 4);
+    CHECK(!cache.Open(source, model.Data.ProcessingFlags));
+}
+
+TEST(MeshCacheFollowsTheSourceStamp)
+{
+    const std::string source = MakeSource("MeshCacheStamp.gltf", "source");
+    TestModel model;
+    REQUIRE(MeshCache::Write(source, model.Data));
+
+    // Touched only, the content hash still matches.
+    Touch(source);
+    {
+        MeshCache cache;
+        CHECK(cache.Open(source, model.Data.ProcessingFlags));
+    }
+
+    // Same size, other bytes.
+    std::ofstream(source, std::ios::binary | std::ios::trunc) << "SOURCE";
+    Touch(source);
+    {
+        MeshCache cache;
+        CHECK(!cache.Open(source, model.Data.ProcessingFlags));
+    }
+
+    // Other size.
+    REQUIRE(MeshCache::Write(source, model.Data));
+    std::ofstream(source, std::ios::binary | std::ios::app) << "more";
+    {
+        MeshCache cache;
+        CHECK(!cache.Open(source, model.Data.ProcessingFlags));
+    }
+}
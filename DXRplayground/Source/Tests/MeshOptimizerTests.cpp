@@ -0,0 +1,113 @@
+#include "Tests/TestFramework.h"
+
+#include "DXrenderer/Geometry/MeshOptimizer.h"
+
+#include <algorithm>
+#include <array>
+#include <random>
+#include <vector>
+
+using namespace DirectxPlayground;
+
+namespace
+{
+struct TestMesh
+{
+    std::vector<float> Positions; // xyz per vertex.
+    std::vector<UINT> Indices;
+};
+
+TestMesh MakeGrid(UINT size)
+{
+    TestMesh mesh;
+    for (UINT y = 0; y <= size; ++y)
+    {
+        for (UINT x = 0; x <= size; ++x)
+            mesh.Positions.insert(mesh.Positions.end(), { float(x), float(y), 0.0f });
+    }
+    for (UINT y = 0; y < size; ++y)
+    {
+        for (UINT x = 0; x < size; ++x)
+        {
+            UINT v = y * (size + 1) + x;
+            mesh.Indices.insert(mesh.Indices.end(), { v, v + 1, v + size + 1, v + 1, v + size + 2, v + size + 1 });
+        }
+    }
+    return mesh;
+}
+
+void ShuffleTriangles(std::vector<UINT>& indices, UINT seed)
+{
+    std::vector<std::array<UINT, 3>> triangles(indices.size() / 3);
+    for (size_t t = 0; t < triangles.size(); ++t)
+        triangles[t] = { indices[t * 3 + 0], indices[t * 3 + 1], indices[t * 3 + 2] };
+    std::shuffle(triangles.begin(), triangles.end(), std::mt19937(seed));
+    for (size_t t = 0; t < triangles.size(); ++t)
+        std::copy(triangles[t].begin(), triangles[t].end(), indices.begin() + t * 3);
+}
+
+// Rotated so the smallest index goes first, which keeps the winding, then sorted.
+std::vector<std::array<UINT, 3>> GetTriangles(const std::vector<UINT>& indices)
+{
+    std::vector<std::array<UINT, 3>> triangles(indices.size() / 3);
+    for (size_t t = 0; t < triangles.size(); ++t)
+    {
+        std::array<UINT, 3> tri = { indices[t * 3 + 0], indices[t * 3 + 1], indices[t * 3 + 2] };
+        std::rotate(tri.begin(), std::min_element(tri.begin(), tri.end()), tri.end());
+        triangles[t] = tri;
+    }
+    std::sort(triangles.begin(), triangles.end());
+    return triangles;
+}
+}
+
+TEST(OptimizeVertexCacheKeepsTheTriangles)
+{
+    TestMesh mesh = MakeGrid(40);
+    ShuffleTriangles(mesh.Indices, 7);
+    const size_t vertexCount = mesh.Positions.size() / 3;
+
+    std::vector<UINT> optimized(mesh.Indices.size());
+    OptimizeVertexCache(optimized.data(), mesh.Indices.data(), mesh.Indices.size(), vertexCount);
+    CHECK(GetTriangles(optimized) == GetTriangles(mesh.Indices));
+
+    VertexCacheStats before = AnalyzeVertexCache(mesh.Indices.data(), mesh.Indices.size(), vertexCount);
+    VertexCacheStats after = AnalyzeVertexCache(optimized.data(), optimized.size(), vertexCount);
+    CHECK_EQ(after.TrianglesCount, before.TrianglesCount);
+    CHECK_EQ(after.VerticesCount, UINT64(vertexCount));
+    CHECK(after.GetAcmr() < before.GetAcmr());
+    CHECK(after.GetAcmr() < 1.0f);
+}
+
+TEST(OptimizeVertexCacheNeverHurtsAGoodOrder)
+{
+    // Row by row is already close to the best a 16 entry FIFO can do on a narrow grid.
+    for (UINT size : { 4U, 8U, 32U })
+    {
+        TestMesh mesh = MakeGrid(size);
+        const size_t vertexCount = mesh.Positions.size() / 3;
+        std::vector<UINT> optimized(mesh.Indices.size());
+        OptimizeVertexCache(optimized.data(), mesh.Indices.data(), mesh.Indices.size(), vertexCount);
+        CHECK(GetTriangles(optimized) == GetTriangles(mesh.Indices));
+        CHECK(AnalyzeVertexCache(optimized.data(), optimized.size(), vertexCount).GetAcmr()
+            <= AnalyzeVertexCache(mesh.Indices.data(), mesh.Indices.size(), vertexCount).GetAcmr() + 0.01f);
+    }
+}
+
+TEST(OptimizeOverdrawKeepsTheTriangles)
+{
+    TestMesh mesh = MakeGrid(24);
+    ShuffleTriangles(mesh.Indices, 11);
+    const size_t vertexCount = mesh.Positions.size() / 3;
+
+    std::vector<UINT> optimized(mesh.Indices.size());
+    std::vector<UINT> clusters;
+    OptimizeVertexCache(optimized.data(), mesh.Indices.data(), mesh.Indices.size(), vertexCount, DefaultVertexCacheSize, &clusters);
+    REQUIRE(!clusters.empty());
+    CHECK_EQ(clusters[0], UINT(0));
+    CHECK(std::is_sorted(clusters.begin(), clusters.end()));
+
+    std::vector<UINT> sorted(optimized.size());
+    OptimizeOverdraw(sorted.data(), optimized.data(), optimized.size(), reinterpret_cast<const byte*>(mesh.Positions.data()), 3 * sizeof(float), clusters);
+    CHECK(GetTriangles(sorted) == GetTriangles(mesh.Indices));
+}
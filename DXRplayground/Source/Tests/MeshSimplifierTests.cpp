@@ -0,0 +1,143 @@
+#include "Tests/TestFramework.h"
+
+#include "DXrenderer/Geometry/MeshSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using namespace DirectxPlayground;
+
+namespace
+{
+struct TestMesh
+{
+    std::vector<float> Positions; // xyz per vertex.
+    std::vector<UINT> Indices;
+
+    const byte* GetPositions() const
+    {
+        return reinterpret_cast<const byte*>(Positions.data());
+    }
+    size_t GetVertexCount() const
+    {
+        return Positions.size() / 3;
+    }
+};
+
+// A unit square grid with a smooth bump of the given height.
+TestMesh MakeHeightField(UINT size, float height)
+{
+    TestMesh mesh;
+    for (UINT y = 0; y <= size; ++y)
+    {
+        for (UINT x = 0; x <= size; ++x)
+        {
+            float u = float(x) / size;
+            float v = float(y) / size;
+            mesh.Positions.insert(mesh.Positions.end(), { u, v, height * std::sin(u * 3.14159265f) * std::sin(v * 3.14159265f) });
+        }
+    }
+    for (UINT y = 0; y < size; ++y)
+    {
+        for (UINT x = 0; x < size; ++x)
+        {
+            UINT i = y * (size + 1) + x;
+            mesh.Indices.insert(mesh.Indices.end(), { i, i + 1, i + size + 1, i + 1, i + size + 2, i + size + 1 });
+        }
+    }
+    return mesh;
+}
+
+float GetHeightError(const TestMesh& mesh, const std::vector<UINT>& lod)
+{
+    // The LOD keeps the square and only moves vertices within it, so the vertical distance from every original vertex
+    // to the simplified triangle above or below it bounds the deviation.
+    float maxError = 0.0f;
+    for (size_t v = 0; v < mesh.GetVertexCount(); ++v)
+    {
+        const float* p = &mesh.Positions[v * 3];
+        float error = -1.0f;
+        for (size_t t = 0; t < lod.size() && error < 0.0f; t += 3)
+        {
+            const float* a = &mesh.Positions[lod[t + 0] * 3];
+            const float* b = &mesh.Positions[lod[t + 1] * 3];
+            const float* c = &mesh.Positions[lod[t + 2] * 3];
+            float area = (b[0] - a[0]) * (c[1] - a[1]) - (c[0] - a[0]) * (b[1] - a[1]);
+            if (std::abs(area) < 1e-12f)
+                continue;
+            float wb = ((p[0] - a[0]) * (c[1] - a[1]) - (c[0] - a[0]) * (p[1] - a[1])) / area;
+            float wc = ((b[0] - a[0]) * (p[1] - a[1]) - (p[0] - a[0]) * (b[1] - a[1])) / area;
+            float wa = 1.0f - wb - wc;
+            const float eps = -1e-5f;
+            if (wa >= eps && wb >= eps && wc >= eps)
+                error = std::abs(wa * a[2] + wb * b[2] + wc * c[2] - p[2]);
+        }
+        if (error < 0.0f)
+            return 1e30f; // A hole.
+        maxError = std::max(maxError, error);
+    }
+    return maxError;
+}
+}
+
+TEST(SimplifyMeshLodsShrinkWithinTheError)
+{
+    const TestMesh mesh = MakeHeightField(32, 0.1f);
+    const float scale = GetSimplificationScale(mesh.GetPositions(), 3 * sizeof(float), mesh.GetVertexCount());
+    CHECK_NEAR(scale, 1.0f, 1e-5f);
+
+    // Chained like Model::BuildMeshLods, each level from the previous one with what's left of the budget.
+    std::vector<UINT> source = mesh.Indices;
+    float error = 0.0f;
+    for (float targetError : { 0.002f, 0.01f, 0.04f })
+    {
+        std::vector<UINT> lod(source.size());
+        float reachedError = -1.0f;
+        size_t indexCount = SimplifyMesh(lod.data(), source.data(), source.size(), mesh.GetPositions(), 3 * sizeof(float), mesh.GetVertexCount(),
+            source.size() / 6 * 3, targetError - error, &reachedError);
+        REQUIRE(indexCount > 0);
+        CHECK_EQ(indexCount % 3, size_t(0));
+        CHECK(indexCount < source.size());
+        CHECK(reachedError >= 0.0f && reachedError <= targetError - error);
+        lod.resize(indexCount);
+        for (size_t t = 0; t < lod.size(); t += 3)
+        {
+            CHECK(lod[t] < mesh.GetVertexCount() && lod[t + 1] < mesh.GetVertexCount() && lod[t + 2] < mesh.GetVertexCount());
+            CHECK(lod[t] != lod[t + 1] && lod[t + 1] != lod[t + 2] && lod[t] != lod[t + 2]);
+        }
+
+        error += reachedError;
+        CHECK(GetHeightError(mesh, lod) <= targetError * scale);
+        source.swap(lod);
+    }
+}
+
+TEST(SimplifyMeshStopsAtTheTargetCount)
+{
+    const TestMesh mesh = MakeHeightField(16, 0.0f);
+    const size_t targetIndexCount = mesh.Indices.size() / 4 / 3 * 3;
+    std::vector<UINT> lod(mesh.Indices.size());
+    float reachedError = -1.0f;
+    size_t indexCount = SimplifyMesh(lod.data(), mesh.Indices.data(), mesh.Indices.size(), mesh.GetPositions(), 3 * sizeof(float), mesh.GetVertexCount(),
+        targetIndexCount, 1.0f, &reachedError);
+    CHECK(indexCount <= targetIndexCount);
+    CHECK(indexCount > 0);
+    lod.resize(indexCount);
+    CHECK(GetHeightError(mesh, lod) < 1e-5f); // Flat, nothing moves off the plane.
+    CHECK(reachedError < 1e-3f);
+}
+
+TEST(SimplifyMeshWithoutABudgetKeepsTheSurface)
+{
+    // Only the free collapses, along the straight borders.
+    const TestMesh mesh = MakeHeightField(16, 0.3f);
+    std::vector<UINT> lod(mesh.Indices.size());
+    float reachedError = -1.0f;
+    size_t indexCount = SimplifyMesh(lod.data(), mesh.Indices.data(), mesh.Indices.size(), mesh.GetPositions(), 3 * sizeof(float), mesh.GetVertexCount(),
+        0, 0.0f, &reachedError);
+    CHECK(indexCount > mesh.Indices.size() * 9 / 10);
+    CHECK_EQ(reachedError, 0.0f);
+    lod.resize(indexCount);
+    CHECK(GetHeightError(mesh, lod) < 1e-5f);
+}
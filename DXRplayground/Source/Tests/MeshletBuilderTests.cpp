@@ -0,0 +1,131 @@
+#include "Tests/TestFramework.h"
+
+#include "DXrenderer/Geometry/MeshletBuilder.h"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace DirectxPlayground;
+
+namespace
+{
+struct TestMesh
+{
+    std::vector<float> Positions; // xyz per vertex.
+    std::vector<UINT> Indices;
+};
+
+void AddGrid(TestMesh& mesh, UINT size, float originX)
+{
+    UINT base = UINT(mesh.Positions.size() / 3);
+    for (UINT y = 0; y <= size; ++y)
+    {
+        for (UINT x = 0; x <= size; ++x)
+            mesh.Positions.insert(mesh.Positions.end(), { originX + float(x), float(y), 0.0f });
+    }
+    for (UINT y = 0; y < size; ++y)
+    {
+        for (UINT x = 0; x < size; ++x)
+        {
+            UINT v = base + y * (size + 1) + x;
+            mesh.Indices.insert(mesh.Indices.end(), { v, v + 1, v + size + 1, v + 1, v + size + 2, v + size + 1 });
+        }
+    }
+}
+
+void AddScatteredTriangles(TestMesh& mesh, UINT count, UINT seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> dist(-50.0f, 50.0f);
+    for (UINT t = 0; t < count; ++t)
+    {
+        UINT base = UINT(mesh.Positions.size() / 3);
+        float x = dist(rng), y = dist(rng), z = dist(rng);
+        mesh.Positions.insert(mesh.Positions.end(), { x, y, z, x + 0.1f, y, z, x, y + 0.1f, z });
+        mesh.Indices.insert(mesh.Indices.end(), { base, base + 1, base + 2 });
+    }
+}
+
+MeshletData Build(const TestMesh& mesh)
+{
+    MeshletData meshlets;
+    BuildMeshlets(meshlets, mesh.Indices.data(), mesh.Indices.size(), reinterpret_cast<const byte*>(mesh.Positions.data()), 3 * sizeof(float), mesh.Positions.size() / 3);
+    return meshlets;
+}
+
+// Every input triangle exactly once, the limits, and a meshlet closing only when it is full.
+void CheckMeshlets(const TestMesh& mesh, const MeshletData& meshlets)
+{
+    std::vector<UINT> seen(mesh.Indices.size() / 3, 0);
+    size_t notFull = 0;
+    size_t outsideBounds = 0;
+    for (size_t m = 0; m < meshlets.Meshlets.size(); ++m)
+    {
+        const Meshlet& meshlet = meshlets.Meshlets[m];
+        CHECK(meshlet.VertexCount <= MaxMeshletVertices);
+        CHECK(meshlet.TriangleCount <= MaxMeshletTriangles);
+        if (m + 1 < meshlets.Meshlets.size() && meshlet.TriangleCount < MaxMeshletTriangles && meshlet.VertexCount + 3 <= MaxMeshletVertices)
+            ++notFull;
+
+        for (UINT t = 0; t < meshlet.TriangleCount; ++t)
+        {
+            UINT v[3];
+            for (UINT i = 0; i < 3; ++i)
+                v[i] = meshlets.VertexIndices[meshlet.VertexOffset + meshlets.Triangles[meshlet.TriangleOffset + t * 3 + i]];
+            // The builder keeps the winding and the vertex order, and the test meshes have no duplicate triangles.
+            for (size_t it = 0; it < mesh.Indices.size(); it += 3)
+            {
+                if (mesh.Indices[it] == v[0] && mesh.Indices[it + 1] == v[1] && mesh.Indices[it + 2] == v[2])
+                {
+                    ++seen[it / 3];
+                    break;
+                }
+            }
+        }
+
+        const MeshletBounds& bounds = meshlets.Bounds[m];
+        for (UINT i = 0; i < meshlet.VertexCount; ++i)
+        {
+            const float* p = &mesh.Positions[meshlets.VertexIndices[meshlet.VertexOffset + i] * 3];
+            float dx = p[0] - bounds.Center[0], dy = p[1] - bounds.Center[1], dz = p[2] - bounds.Center[2];
+            outsideBounds += std::sqrt(dx * dx + dy * dy + dz * dz) <= bounds.Radius * 1.0001f + 1e-5f ? 0 : 1;
+        }
+    }
+    size_t wrongCount = 0;
+    for (UINT s : seen)
+        wrongCount += s == 1 ? 0 : 1;
+    CHECK_EQ(wrongCount, size_t(0));
+    CHECK_EQ(notFull, size_t(0));
+    CHECK_EQ(outsideBounds, size_t(0));
+    CHECK_EQ(meshlets.Bounds.size(), meshlets.Meshlets.size());
+}
+}
+
+TEST(MeshletsOfDisconnectedTrianglesAreFull)
+{
+    // No triangle has a neighbour, every meshlet takes 21 of them (63 vertices) instead of closing after the first one.
+    TestMesh mesh;
+    AddScatteredTriangles(mesh, 1000, 3);
+    MeshletData meshlets = Build(mesh);
+    CHECK_EQ(meshlets.Meshlets.size(), size_t((1000 + 20) / 21));
+    for (size_t m = 0; m + 1 < meshlets.Meshlets.size(); ++m)
+        CHECK_EQ(meshlets.Meshlets[m].TriangleCount, UINT(21));
+    CheckMeshlets(mesh, meshlets);
+}
+
+TEST(MeshletsOfGridsAndScatteredTriangles)
+{
+    TestMesh mesh;
+    AddGrid(mesh, 30, 0.0f);
+    AddScatteredTriangles(mesh, 200, 11);
+    AddGrid(mesh, 7, 100.0f);
+    AddGrid(mesh, 1, 200.0f);
+    MeshletData meshlets = Build(mesh);
+    CheckMeshlets(mesh, meshlets);
+
+    // The same input gives the same meshlets.
+    MeshletData again = Build(mesh);
+    CHECK(again.VertexIndices == meshlets.VertexIndices);
+    CHECK(again.Triangles == meshlets.Triangles);
+}
@@ -0,0 +1,153 @@
+#include "Tests/TestFramework.h"
+
+#include "DXrenderer/Textures/MipGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace DirectxPlayground;
+
+namespace
+{
+std::vector<byte> RandomImage(UINT width, UINT height, UINT channels, MipPixelType type, std::mt19937& rng)
+{
+    const size_t components = size_t(width) * height * channels;
+    std::vector<byte> data(components * (type == MipPixelType::UNorm8 ? 1 : sizeof(float)));
+    if (type == MipPixelType::UNorm8)
+    {
+        for (byte& value : data)
+            value = byte(rng() & 0xFF);
+        return data;
+    }
+    float* floats = reinterpret_cast<float*>(data.data());
+    for (size_t i = 0; i < components; ++i)
+        floats[i] = float(rng() % 4096) / 256.0f;
+    return data;
+}
+}
+
+TEST(MipGenerationLevelsMatchScalar)
+{
+    // Every filter and pixel type, sizes that aren't powers of two or are a single column. The SIMD levels must give the scalar bytes.
+    std::mt19937 rng(7);
+    const UINT sizes[][2] = { { 37, 20 }, { 64, 64 }, { 1, 9 }, { 130, 3 } };
+    for (const auto& size : sizes)
+    {
+        for (MipFilter filter : { MipFilter::Box, MipFilter::Kaiser, MipFilter::Lanczos })
+        {
+            for (UINT channels : { 1, 3, 4 })
+            {
+                for (MipPixelType type : { MipPixelType::UNorm8, MipPixelType::Float32 })
+                {
+                    MipSettings settings;
+                    settings.Filter = filter;
+                    settings.Srgb = type == MipPixelType::UNorm8 && channels >= 3;
+                    const std::vector<byte> image = RandomImage(size[0], size[1], channels, type, rng);
+                    std::vector<byte> reference = image;
+                    std::vector<MipLevelDesc> levels;
+                    GenerateMips(reference, size[0], size[1], channels, type, settings, levels, SimdLevel::Scalar);
+                    for (SimdLevel level : { SimdLevel::SSE41, SimdLevel::AVX2 })
+                    {
+                        if (level > GetSimdLevel())
+                            continue;
+                        std::vector<byte> data = image;
+                        GenerateMips(data, size[0], size[1], channels, type, settings, levels, level);
+                        CHECK(data == reference);
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST(MipGenerationLevelLayout)
+{
+    CHECK_EQ(GetMipLevelsCount(1, 1), UINT(1));
+    CHECK_EQ(GetMipLevelsCount(37, 20), UINT(6));
+    CHECK_EQ(GetMipLevelsCount(256, 1), UINT(9));
+
+    std::mt19937 rng(1);
+    const std::vector<byte> image = RandomImage(37, 20, 4, MipPixelType::UNorm8, rng);
+    std::vector<byte> data = image;
+    std::vector<MipLevelDesc> levels;
+    GenerateMips(data, 37, 20, 4, MipPixelType::UNorm8, {}, levels);
+    REQUIRE(levels.size() == 6);
+    // Halved and rounded down, packed one after another with the top level untouched.
+    size_t offset = 0;
+    UINT width = 37;
+    UINT height = 20;
+    for (const MipLevelDesc& level : levels)
+    {
+        CHECK_EQ(level.Offset, offset);
+        CHECK_EQ(level.Width, width);
+        CHECK_EQ(level.Height, height);
+        CHECK_EQ(level.RowPitch, width * 4);
+        offset += size_t(level.RowPitch) * level.Height;
+        width = std::max(width / 2, 1U);
+        height = std::max(height / 2, 1U);
+    }
+    CHECK_EQ(data.size(), offset);
+    CHECK(memcmp(data.data(), image.data(), image.size()) == 0);
+}
+
+TEST(MipGenerationConstantAndNormals)
+{
+    // A flat color stays the same at every level, whatever the filter and its negative lobes.
+    for (MipFilter filter : { MipFilter::Box, MipFilter::Kaiser, MipFilter::Lanczos })
+    {
+        for (bool srgb : { false, true })
+        {
+            std::vector<byte> data(64 * 48 * 4, 77);
+            std::vector<MipLevelDesc> levels;
+            MipSettings settings;
+            settings.Filter = filter;
+            settings.Srgb = srgb;
+            GenerateMips(data, 64, 48, 4, MipPixelType::UNorm8, settings, levels);
+            size_t different = 0;
+            for (size_t i = levels[1].Offset; i < data.size(); ++i)
+                different += data[i] == 77 ? 0 : 1;
+            CHECK_EQ(different, size_t(0));
+        }
+    }
+
+    // sRGB is averaged in the linear space: black and white give ~188, not 128. Alpha is linear.
+    std::vector<byte> checker(4 * 4 * 4);
+    for (UINT y = 0; y < 4; ++y)
+    {
+        for (UINT x = 0; x < 4; ++x)
+        {
+            for (UINT c = 0; c < 4; ++c)
+                checker[(y * 4 + x) * 4 + c] = (x + y) % 2 == 1 ? 255 : 0;
+        }
+    }
+    std::vector<MipLevelDesc> levels;
+    MipSettings settings;
+    settings.Filter = MipFilter::Box;
+    settings.Srgb = true;
+    GenerateMips(checker, 4, 4, 4, MipPixelType::UNorm8, settings, levels);
+    CHECK_NEAR(int(checker[levels[1].Offset]), 188, 1);
+    CHECK_NEAR(int(checker[levels[1].Offset + 3]), 128, 1);
+
+    // Normal maps are renormalized at every level.
+    std::mt19937 rng(3);
+    std::vector<byte> normals = RandomImage(32, 32, 4, MipPixelType::UNorm8, rng);
+    settings = {};
+    settings.NormalMap = true;
+    GenerateMips(normals, 32, 32, 4, MipPixelType::UNorm8, settings, levels);
+    size_t notUnit = 0;
+    for (size_t l = 1; l < levels.size(); ++l)
+    {
+        for (size_t p = 0; p < size_t(levels[l].Width) * levels[l].Height; ++p)
+        {
+            const byte* texel = normals.data() + levels[l].Offset + p * 4;
+            float x = texel[0] / 127.5f - 1.0f;
+            float y = texel[1] / 127.5f - 1.0f;
+            float z = texel[2] / 127.5f - 1.0f;
+            notUnit += std::abs(std::sqrt(x * x + y * y + z * z) - 1.0f) > 0.02f ? 1 : 0;
+        }
+    }
+    CHECK_EQ(notUnit, size_t(0));
+}
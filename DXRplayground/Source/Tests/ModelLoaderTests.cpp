@@ -0,0 +1,40 @@
+#include "Tests/TestFramework.h"
+
+#include "DXrenderer/ModelLoader.h"
+#include "DXrenderer/RenderContext.h"
+
+#include <chrono>
+#include <fstream>
+#include <thread>
+
+using namespace DirectxPlayground;
+
+TEST(ModelLoaderReportsFailedLoads)
+{
+    // A missing file and one that isn't glTF. Their CPU stages throw on the worker, the handles fail instead of never getting ready.
+    const std::string garbagePath = Tests::GetTempDirectory() + "garbage.gltf";
+    std::ofstream(garbagePath) << "{ not json";
+
+    ModelLoader loader;
+    ModelLoadHandle missing = loader.Load(Tests::GetTempDirectory() + "missing.gltf");
+    ModelLoadHandle garbage = loader.Load(garbagePath);
+    CHECK(missing.IsValid() && garbage.IsValid());
+    CHECK_EQ(loader.GetPendingCount(), size_t(2));
+
+    // Nothing reaches the GPU handoff, so an empty context is enough.
+    RenderContext context;
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+    while ((!missing.IsFailed() || !garbage.IsFailed()) && std::chrono::steady_clock::now() < deadline)
+    {
+        loader.Update(context, 0);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    for (const ModelLoadHandle* handle : { &missing, &garbage })
+    {
+        CHECK(handle->IsFailed());
+        CHECK(!handle->IsReady());
+        CHECK(handle->Get() == nullptr);
+        CHECK(!handle->GetRequest()->Error.empty());
+    }
+    CHECK_EQ(loader.GetPendingCount(), size_t(0));
+}
@@ -0,0 +1,166 @@
+#include "Tests/TestFramework.h"
+
+#include "DXrenderer/Geometry/MeshCache.h"
+#include "DXrenderer/Model.h"
+#include "DXrenderer/Textures/TextureManager.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+using namespace DirectxPlayground;
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+// The copies are only recorded, the command list is never executed.
+struct TestContext
+{
+    ComPtr<ID3D12Device5> Device;
+    ComPtr<ID3D12CommandAllocator> Allocator;
+    ComPtr<ID3D12GraphicsCommandList5> CommandList;
+    RenderContext Context;
+    TextureManager* TexManager = nullptr;
+
+    ~TestContext()
+    {
+        SafeDelete(TexManager);
+    }
+
+    bool Create(ID3D12Device* device)
+    {
+        ComPtr<ID3D12GraphicsCommandList> commandList;
+        if (FAILED(device->QueryInterface(IID_PPV_ARGS(&Device))) ||
+            FAILED(device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&Allocator))) ||
+            FAILED(device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, Allocator.Get(), nullptr, IID_PPV_ARGS(&commandList))) ||
+            FAILED(commandList.As(&CommandList)))
+            return false;
+        Context.Device = Device.Get();
+        Context.CommandList = CommandList.Get();
+        Context.CbvSrvUavDescriptorSize = device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+        Context.RtvDescriptorSize = device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
+        TexManager = new TextureManager(Context);
+        Context.TexManager = TexManager;
+        return true;
+    }
+};
+
+// A quad in the z = 1 plane with normals and uvs, one material and one node, the buffer in a .bin next to it.
+std::string WriteQuadGltf(const std::string& name, bool withMaterial = true)
+{
+    const float positions[12] = { -1.0f, -2.0f, 1.0f, 3.0f, -2.0f, 1.0f, -1.0f, 4.0f, 1.0f, 3.0f, 4.0f, 1.0f };
+    const float normals[12] = { 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f };
+    const float uvs[8] = { 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f };
+    const USHORT indices[6] = { 0, 1, 2, 2, 1, 3 };
+    const std::string dir = Tests::GetTempDirectory();
+    {
+        std::ofstream bin(dir + name + ".bin", std::ios::binary | std::ios::trunc);
+        bin.write(reinterpret_cast<const char*>(positions), sizeof(positions));
+        bin.write(reinterpret_cast<const char*>(normals), sizeof(normals));
+        bin.write(reinterpret_cast<const char*>(uvs), sizeof(uvs));
+        bin.write(reinterpret_cast<const char*>(indices), sizeof(indices));
+    }
+    std::ofstream(dir + name + ".gltf", std::ios::trunc) << R"({"asset":{"version":"2.0"},"scene":0,"scenes":[{"nodes":[0]}],"nodes":[{"mesh":0}],)"
+        + std::string(withMaterial ? R"("materials":[{}],)" : "")
+        + R"("meshes":[{"primitives":[{"attributes":{"POSITION":0,"NORMAL":1,"TEXCOORD_0":2},"indices":3)" + (withMaterial ? R"(,"material":0)" : "") + "}]}],"
+        R"("buffers":[{"uri":")" + name + R"(.bin","byteLength":140}],)"
+        R"("bufferViews":[{"buffer":0,"byteOffset":0,"byteLength":48},{"buffer":0,"byteOffset":48,"byteLength":48},)"
+        R"({"buffer":0,"byteOffset":96,"byteLength":32},{"buffer":0,"byteOffset":128,"byteLength":12}],)"
+        R"("accessors":[{"bufferView":0,"componentType":5126,"count":4,"type":"VEC3","min":[-1,-2,1],"max":[3,4,1]},)"
+        R"({"bufferView":1,"componentType":5126,"count":4,"type":"VEC3"},{"bufferView":2,"componentType":5126,"count":4,"type":"VEC2"},)"
+        R"({"bufferView":3,"componentType":5123,"count":6,"type":"SCALAR"}]})";
+    return dir + name + ".gltf";
+}
+
+void CheckResidency(RenderContext& context, const std::string& path, bool fromCache)
+{
+    for (CpuMeshResidency residency : { CpuMeshResidency::Full, CpuMeshResidency::PositionsAndIndices, CpuMeshResidency::None })
+    {
+        ModelLoadSettings settings;
+        settings.UseMeshCache = fromCache;
+        settings.UseGeometryPool = false;
+        settings.CpuResidency = residency;
+        Model model(context, path, settings);
+        CHECK_EQ(model.GetLoadStats().FromCache, fromCache);
+        REQUIRE(model.GetMeshes().size() == 1);
+        const Model::Mesh* mesh = model.GetMeshes()[0];
+
+        // The counts and the bounds are cached before the release.
+        CHECK_EQ(mesh->GetVertexCount(), UINT(4));
+        CHECK_EQ(mesh->GetIndexCount(), UINT(6));
+        CHECK_NEAR(mesh->GetBounds().Center.x, 1.0f, 1e-5f);
+        CHECK_NEAR(mesh->GetBounds().Center.y, 1.0f, 1e-5f);
+        CHECK_NEAR(mesh->GetBounds().Extents.x, 2.0f, 1e-5f);
+        CHECK_NEAR(mesh->GetBounds().Extents.y, 3.0f, 1e-5f);
+        CHECK(mesh->GetBoundingSphere().Radius > 0.0f);
+
+        const bool keepsIndices = residency != CpuMeshResidency::None;
+        CHECK_EQ(mesh->GetVertices().size(), size_t(residency == CpuMeshResidency::Full ? 4 : 0));
+        CHECK_EQ(mesh->GetIndices().size(), size_t(keepsIndices ? 6 : 0));
+        if (!keepsIndices)
+        {
+            CHECK(mesh->GetPositionData() == nullptr);
+            CHECK_EQ(mesh->GetResidentCpuBytes(), size_t(0));
+            continue;
+        }
+        const byte* positions = mesh->GetPositionData();
+        REQUIRE(positions != nullptr);
+        CHECK_EQ(mesh->GetPositionStride(), UINT(residency == CpuMeshResidency::Full ? sizeof(Vertex) : sizeof(XMFLOAT3)));
+        XMFLOAT3 last;
+        memcpy(&last, positions + 3 * mesh->GetPositionStride(), sizeof(last));
+        CHECK(last.x == 3.0f && last.y == 4.0f && last.z == 1.0f);
+        CHECK(mesh->GetResidentCpuBytes() > 0);
+    }
+}
+}
+
+TEST(ModelReleasesCpuDataByResidency)
+{
+    ID3D12Device* device = Tests::GetTestDevice();
+    if (device == nullptr)
+        SKIP("no D3D12 device");
+    TestContext test;
+    REQUIRE(test.Create(device));
+    const std::string path = WriteQuadGltf("ModelResidency");
+    CheckResidency(test.Context, path, false);
+}
+
+TEST(ModelReleasesCpuDataByResidencyFromTheMeshCache)
+{
+    ID3D12Device* device = Tests::GetTestDevice();
+    if (device == nullptr)
+        SKIP("no D3D12 device");
+    TestContext test;
+    REQUIRE(test.Create(device));
+    const std::string path = WriteQuadGltf("ModelResidencyCached");
+    std::error_code ec;
+    std::filesystem::remove(MeshCache::GetCachePath(path), ec);
+
+    // The first load writes the cache, the meshes of the next ones point into the mapped file until the release copies what stays.
+    ModelLoadSettings settings;
+    settings.UseGeometryPool = false;
+    {
+        Model model(test.Context, path, settings);
+        CHECK(!model.GetLoadStats().FromCache);
+    }
+    CheckResidency(test.Context, path, true);
+}
+
+TEST(ModelUsesTheDefaultMaterialWithoutOne)
+{
+    ID3D12Device* device = Tests::GetTestDevice();
+    if (device == nullptr)
+        SKIP("no D3D12 device");
+    TestContext test;
+    REQUIRE(test.Create(device));
+    const std::string path = WriteQuadGltf("ModelNoMaterial", false);
+
+    ModelLoadSettings settings;
+    settings.UseMeshCache = false;
+    settings.UseGeometryPool = false;
+    Model model(test.Context, path, settings);
+    REQUIRE(model.GetMeshes().size() == 1);
+    CHECK_EQ(model.GetMeshes()[0]->GetMaterialIndex(), -1);
+    CHECK(model.GetMeshes()[0]->GetMaterialBufferGpuAddress(0) != 0);
+}
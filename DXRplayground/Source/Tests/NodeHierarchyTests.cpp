@@ -0,0 +1,64 @@
+#include "Tests/TestFramework.h"
+
+#include "DXrenderer/NodeHierarchy.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+using namespace DirectxPlayground;
+
+namespace
+{
+// What a pointer tree without the cached parent transforms does: every node walks up to the root.
+XMFLOAT4X4 WalkToRoot(const NodeHierarchy& nodes, UINT node)
+{
+    XMMATRIX world = XMMatrixIdentity();
+    for (UINT n = node; n != NodeHierarchy::NoParent; n = nodes.GetParent(n))
+    {
+        XMMATRIX local = XMMatrixAffineTransformation(XMLoadFloat3(&nodes.GetScale(n)), XMVectorZero(), XMLoadFloat4(&nodes.GetRotation(n)), XMLoadFloat3(&nodes.GetTranslation(n)));
+        world = XMMatrixMultiply(world, local);
+    }
+    XMFLOAT4X4 res;
+    XMStoreFloat4x4(&res, world);
+    return res;
+}
+
+float MaxDifference(const NodeHierarchy& nodes)
+{
+    float maxDiff = 0.0f;
+    for (UINT i = 0; i < nodes.GetCount(); ++i)
+    {
+        XMFLOAT4X4 reference = WalkToRoot(nodes, i);
+        for (UINT c = 0; c < 16; ++c)
+            maxDiff = std::max(maxDiff, std::abs(nodes.GetWorldTransform(i).m[c / 4][c % 4] - reference.m[c / 4][c % 4]));
+    }
+    return maxDiff;
+}
+}
+
+TEST(NodeHierarchyMatchesWalkToRoot)
+{
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    NodeHierarchy nodes;
+    constexpr UINT NodeCount = 2000;
+    for (UINT i = 0; i < NodeCount; ++i)
+    {
+        UINT parent = i == 0 ? NodeHierarchy::NoParent : UINT(rng() % i);
+        XMFLOAT4 rotation;
+        XMStoreFloat4(&rotation, XMQuaternionRotationRollPitchYaw(dist(rng), dist(rng), dist(rng)));
+        float scale = 1.0f + dist(rng) * 0.1f;
+        nodes.AddNode(parent, { dist(rng), dist(rng), dist(rng) }, rotation, { scale, scale, scale });
+    }
+    nodes.UpdateWorldTransforms();
+    CHECK(MaxDifference(nodes) < 1e-3f);
+
+    // Only the nodes after the changed one are recomputed, the ones before can't depend on it.
+    nodes.SetTranslation(NodeCount * 9 / 10, { 0.0f, 1.0f, 0.0f });
+    nodes.SetRotation(NodeCount / 2, { 0.0f, 0.0f, 0.0f, 1.0f });
+    CHECK(nodes.IsDirty());
+    nodes.UpdateWorldTransforms();
+    CHECK(!nodes.IsDirty());
+    CHECK(MaxDifference(nodes) < 1e-3f);
+}
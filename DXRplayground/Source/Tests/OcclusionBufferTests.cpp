@@ -0,0 +1,188 @@
+#include "Tests/TestFramework.h"
+
+#include "DXrenderer/Culling/FrustumCulling.h"
+#include "DXrenderer/Culling/OcclusionBuffer.h"
+
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace DirectxPlayground;
+
+namespace
+{
+// The camera at the origin looking down +z, 60 degrees vertical fov, LH with the D3D clip depth. Row vectors, as XMMatrixPerspectiveFovLH.
+struct TestProjection
+{
+    TestProjection()
+    {
+        const float fy = 1.0f / std::tan(0.5236f);
+        const float nearZ = 0.1f;
+        const float farZ = 100.0f;
+        const float m[4][4] = { { fy / 1.77f, 0, 0, 0 }, { 0, fy, 0, 0 }, { 0, 0, farZ / (farZ - nearZ), 1 }, { 0, 0, -nearZ * farZ / (farZ - nearZ), 0 } };
+        memcpy(ViewProjection, m, sizeof(m));
+    }
+
+    float ViewProjection[4][4] = {};
+};
+
+const UINT QuadIndices[6] = { 0, 1, 2, 0, 2, 3 };
+// A 6x6 wall at z = 10 and a ground plane at y = -1 that starts behind the camera, so it crosses the near plane.
+const float Wall[12] = { -3, -3, 10, 3, -3, 10, 3, 3, 10, -3, 3, 10 };
+const float Ground[12] = { -50, -1, -5, 50, -1, -5, 50, -1, 50, -50, -1, 50 };
+
+void AddWallAndGround(OcclusionBuffer& buffer, const TestProjection& projection)
+{
+    buffer.AddOccluder(reinterpret_cast<const byte*>(Wall), 3 * sizeof(float), 4, QuadIndices, 6, projection.ViewProjection);
+    buffer.AddOccluder(reinterpret_cast<const byte*>(Ground), 3 * sizeof(float), 4, QuadIndices, 6, projection.ViewProjection);
+}
+
+std::vector<float> GetDepth(const OcclusionBuffer& buffer)
+{
+    std::vector<float> depth;
+    for (UINT y = 0; y < buffer.GetHeight(); ++y)
+    {
+        for (UINT x = 0; x < buffer.GetWidth(); ++x)
+            depth.push_back(buffer.GetDepth(x, y));
+    }
+    return depth;
+}
+}
+
+TEST(OcclusionRasterizationLevelsMatchScalar)
+{
+    // The wall and the clipped ground, then random triangles, some of them crossing the near plane. Every level, serial or on the pool,
+    // must write exactly the scalar depth.
+    const TestProjection projection;
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> xy(-20.0f, 20.0f);
+    std::uniform_real_distribution<float> z(-4.0f, 55.0f);
+    std::vector<float> positions;
+    std::vector<UINT> indices;
+    for (UINT i = 0; i < 3000; ++i)
+    {
+        positions.insert(positions.end(), { xy(rng), xy(rng), z(rng) });
+        indices.push_back(i);
+    }
+
+    std::vector<float> reference[2];
+    for (SimdLevel level : { SimdLevel::Scalar, SimdLevel::SSE41, SimdLevel::AVX2 })
+    {
+        if (level > GetSimdLevel())
+            continue;
+        for (bool parallel : { false, true })
+        {
+            OcclusionBuffer walls(250, 140); // Not whole tiles.
+            AddWallAndGround(walls, projection);
+            walls.Rasterize(level, parallel);
+            OcclusionBuffer random(320, 180);
+            random.AddOccluder(reinterpret_cast<const byte*>(positions.data()), 3 * sizeof(float), positions.size() / 3, indices.data(), indices.size(), projection.ViewProjection);
+            random.Rasterize(level, parallel);
+
+            if (reference[0].empty())
+            {
+                reference[0] = GetDepth(walls);
+                reference[1] = GetDepth(random);
+                continue;
+            }
+            CHECK(GetDepth(walls) == reference[0]);
+            CHECK(GetDepth(random) == reference[1]);
+        }
+    }
+}
+
+TEST(OcclusionFullyHidden)
+{
+    const TestProjection projection;
+    OcclusionBuffer buffer(320, 180);
+    AddWallAndGround(buffer, projection);
+    buffer.Rasterize();
+
+    const float extents[3] = { 1.0f, 1.0f, 1.0f };
+    const float behindWall[3] = { 0.0f, 0.5f, 20.0f };
+    CHECK(!buffer.IsVisible(behindWall, extents, projection.ViewProjection));
+    const float underGround[3] = { 8.0f, -4.0f, 20.0f };
+    CHECK(!buffer.IsVisible(underGround, extents, projection.ViewProjection));
+
+    // The wall covers the middle of the screen at its depth, nothing is written above it.
+    CHECK(buffer.GetDepth(buffer.GetWidth() / 2, buffer.GetHeight() / 2) < 1.0f);
+    CHECK_EQ(buffer.GetDepth(0, 0), 1.0f);
+}
+
+TEST(OcclusionPartlyVisible)
+{
+    const TestProjection projection;
+    OcclusionBuffer buffer(320, 180);
+    AddWallAndGround(buffer, projection);
+    buffer.Rasterize();
+
+    const float extents[3] = { 1.0f, 1.0f, 1.0f };
+    // Behind the wall but sticking out past its right edge.
+    const float pastTheEdge[3] = { 6.0f, 0.5f, 20.0f };
+    CHECK(buffer.IsVisible(pastTheEdge, extents, projection.ViewProjection));
+    // Half above the ground.
+    const float onTheGround[3] = { 8.0f, -1.0f, 20.0f };
+    CHECK(buffer.IsVisible(onTheGround, extents, projection.ViewProjection));
+    // In front of the wall.
+    const float inFront[3] = { 0.0f, 0.5f, 5.0f };
+    CHECK(buffer.IsVisible(inFront, extents, projection.ViewProjection));
+    // Off the wall entirely.
+    const float aside[3] = { 15.0f, 5.0f, 20.0f };
+    CHECK(buffer.IsVisible(aside, extents, projection.ViewProjection));
+}
+
+TEST(OcclusionNearPlaneCrossing)
+{
+    const TestProjection projection;
+    OcclusionBuffer buffer(320, 180);
+    AddWallAndGround(buffer, projection);
+    buffer.Rasterize();
+
+    // The ground crosses the near plane, its clipped part still covers the bottom of the screen.
+    CHECK(buffer.GetDepth(buffer.GetWidth() / 2, buffer.GetHeight() - 1) < 1.0f);
+    const float extents[3] = { 1.0f, 1.0f, 1.0f };
+    const float underGroundClose[3] = { 0.0f, -3.0f, 6.0f };
+    CHECK(!buffer.IsVisible(underGroundClose, extents, projection.ViewProjection));
+
+    // Occludees crossing the near plane, or all behind the camera, are always visible.
+    const float aroundTheCamera[3] = { 0.0f, 0.0f, 0.05f };
+    CHECK(buffer.IsVisible(aroundTheCamera, extents, projection.ViewProjection));
+    const float behindTheCamera[3] = { 0.0f, 0.0f, -20.0f };
+    CHECK(buffer.IsVisible(behindTheCamera, extents, projection.ViewProjection));
+}
+
+TEST(OcclusionFilterVisibleMatchesIsVisible)
+{
+    const TestProjection projection;
+    OcclusionBuffer buffer(320, 180);
+    AddWallAndGround(buffer, projection);
+    buffer.Rasterize();
+
+    std::mt19937 rng(5);
+    std::uniform_real_distribution<float> xy(-15.0f, 15.0f);
+    std::uniform_real_distribution<float> z(-2.0f, 60.0f);
+    std::uniform_real_distribution<float> size(0.1f, 2.0f);
+    CullingBounds bounds;
+    for (UINT i = 0; i < 5000; ++i)
+    {
+        float center[3] = { xy(rng), xy(rng) * 0.5f, z(rng) };
+        float extents[3] = { size(rng), size(rng), size(rng) };
+        bounds.Add(center, extents, std::sqrt(extents[0] * extents[0] + extents[1] * extents[1] + extents[2] * extents[2]));
+    }
+    std::vector<UINT> indices(bounds.Count);
+    for (UINT i = 0; i < bounds.Count; ++i)
+        indices[i] = i;
+    indices.resize(buffer.FilterVisible(bounds, indices.data(), indices.size(), projection.ViewProjection));
+
+    std::vector<UINT> expected;
+    for (UINT i = 0; i < bounds.Count; ++i)
+    {
+        const float center[3] = { bounds.CenterX[i], bounds.CenterY[i], bounds.CenterZ[i] };
+        const float extents[3] = { bounds.ExtentX[i], bounds.ExtentY[i], bounds.ExtentZ[i] };
+        if (buffer.IsVisible(center, extents, projection.ViewProjection))
+            expected.push_back(i);
+    }
+    CHECK(indices == expected);
+    CHECK(expected.size() < bounds.Count); // The occluders do hide some.
+}
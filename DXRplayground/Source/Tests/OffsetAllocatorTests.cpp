@@ -0,0 +1,140 @@
+#include "Tests/TestFramework.h"
+
+#include "Utils/OffsetAllocator.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace DirectxPlayground;
+
+namespace
+{
+bool Overlap(const OffsetAllocator::Allocation& a, const OffsetAllocator::Allocation& b)
+{
+    return a.Offset < b.Offset + b.Size && b.Offset < a.Offset + a.Size;
+}
+}
+
+TEST(OffsetAllocatorAllocateFreeCoalesce)
+{
+    OffsetAllocator allocator(100);
+    OffsetAllocator::Allocation a = allocator.Allocate(10);
+    OffsetAllocator::Allocation b = allocator.Allocate(20);
+    OffsetAllocator::Allocation c = allocator.Allocate(30);
+    REQUIRE(a.IsValid() && b.IsValid() && c.IsValid());
+    CHECK(!Overlap(a, b) && !Overlap(b, c) && !Overlap(a, c));
+    CHECK_EQ(allocator.GetFreeSize(), UINT64(40));
+    CHECK(!allocator.Allocate(0).IsValid());
+
+    // Freeing the middle one leaves a hole, its neighbours merge with it as they are freed, in any order.
+    allocator.Free(b);
+    CHECK_EQ(allocator.GetFreeRangesCount(), size_t(2));
+    allocator.Free(c);
+    CHECK_EQ(allocator.GetFreeRangesCount(), size_t(1)); // The hole, c and the tail are one range now.
+    allocator.Free(a);
+    CHECK_EQ(allocator.GetFreeRangesCount(), size_t(1));
+    CHECK_EQ(allocator.GetFreeSize(), UINT64(100));
+    CHECK_EQ(allocator.GetLargestFreeRange(), UINT64(100));
+
+    // Best fit: the 5 unit request goes into the 5 unit hole, not into the big tail.
+    OffsetAllocator::Allocation first = allocator.Allocate(10);
+    OffsetAllocator::Allocation small = allocator.Allocate(5);
+    OffsetAllocator::Allocation rest = allocator.Allocate(10);
+    allocator.Free(small);
+    OffsetAllocator::Allocation refill = allocator.Allocate(5);
+    CHECK_EQ(refill.Offset, small.Offset);
+    allocator.Free(first);
+    allocator.Free(rest);
+    allocator.Free(refill);
+    allocator.Free({}); // Invalid allocations are ignored.
+    CHECK_EQ(allocator.GetFreeRangesCount(), size_t(1));
+}
+
+TEST(OffsetAllocatorFullCapacity)
+{
+    OffsetAllocator allocator(64);
+    OffsetAllocator::Allocation whole = allocator.Allocate(64);
+    REQUIRE(whole.IsValid());
+    CHECK_EQ(whole.Offset, UINT64(0));
+    CHECK_EQ(allocator.GetFreeSize(), UINT64(0));
+    CHECK_EQ(allocator.GetFreeRangesCount(), size_t(0));
+    CHECK(!allocator.Allocate(1).IsValid());
+    allocator.Free(whole);
+    CHECK(!allocator.Allocate(65).IsValid());
+
+    // Filled up by units, then one more fails, then everything comes back as one range.
+    std::vector<OffsetAllocator::Allocation> units;
+    for (UINT i = 0; i < 64; ++i)
+        units.push_back(allocator.Allocate(1));
+    CHECK(std::all_of(units.begin(), units.end(), [](const auto& u) { return u.IsValid(); }));
+    CHECK(!allocator.Allocate(1).IsValid());
+    for (size_t i = 0; i < units.size(); i += 2)
+        allocator.Free(units[i]);
+    CHECK(!allocator.Allocate(2).IsValid()); // 32 free units, none adjacent.
+    for (size_t i = 1; i < units.size(); i += 2)
+        allocator.Free(units[i]);
+    CHECK_EQ(allocator.GetFreeRangesCount(), size_t(1));
+    CHECK_EQ(allocator.GetLargestFreeRange(), UINT64(64));
+}
+
+TEST(OffsetAllocatorAlignment)
+{
+    OffsetAllocator allocator(64);
+    OffsetAllocator::Allocation odd = allocator.Allocate(3);
+    OffsetAllocator::Allocation aligned = allocator.Allocate(8, 16);
+    REQUIRE(aligned.IsValid());
+    CHECK_EQ(aligned.Offset % 16, UINT64(0));
+    CHECK(!Overlap(odd, aligned));
+    // The padding before the aligned range is still free and usable.
+    CHECK_EQ(allocator.GetFreeSize(), UINT64(64 - 3 - 8));
+    OffsetAllocator::Allocation padding = allocator.Allocate(aligned.Offset - 3);
+    CHECK_EQ(padding.Offset, UINT64(3));
+
+    // No range can hold the size at the alignment even though there is enough free space.
+    OffsetAllocator small(20);
+    OffsetAllocator::Allocation head = small.Allocate(1);
+    CHECK(!small.Allocate(16, 16).IsValid());
+    small.Free(head);
+    CHECK_EQ(small.Allocate(16, 16).Offset, UINT64(0));
+}
+
+TEST(OffsetAllocatorRandomChurn)
+{
+    // The fragmenting pattern of streaming meshes in and out: no overlaps, and everything coalesces back at the end.
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<UINT64> sizes(1, 300);
+    std::uniform_int_distribution<UINT64> alignments(0, 2);
+    const UINT64 capacity = 100'000;
+    OffsetAllocator allocator(capacity);
+    std::vector<OffsetAllocator::Allocation> live;
+    UINT64 liveSize = 0;
+    size_t overlaps = 0;
+    for (UINT step = 0; step < 20'000; ++step)
+    {
+        if (!live.empty() && rng() % 3 == 0)
+        {
+            size_t i = rng() % live.size();
+            allocator.Free(live[i]);
+            liveSize -= live[i].Size;
+            live[i] = live.back();
+            live.pop_back();
+            continue;
+        }
+        UINT64 alignment = UINT64(1) << alignments(rng);
+        OffsetAllocator::Allocation allocation = allocator.Allocate(sizes(rng), alignment);
+        if (!allocation.IsValid())
+            continue;
+        CHECK_EQ(allocation.Offset % alignment, UINT64(0));
+        for (const auto& other : live)
+            overlaps += Overlap(allocation, other) ? 1 : 0;
+        live.push_back(allocation);
+        liveSize += allocation.Size;
+    }
+    CHECK_EQ(overlaps, size_t(0));
+    CHECK_EQ(allocator.GetFreeSize(), capacity - liveSize);
+    for (const auto& allocation : live)
+        allocator.Free(allocation);
+    CHECK_EQ(allocator.GetFreeRangesCount(), size_t(1));
+    CHECK_EQ(allocator.GetFreeSize(), capacity);
+}
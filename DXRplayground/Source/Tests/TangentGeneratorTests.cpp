@@ -0,0 +1,161 @@
+#include "Tests/TestFramework.h"
+
+#include "DXrenderer/Geometry/TangentGenerator.h"
+
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+using namespace DirectxPlayground;
+
+namespace
+{
+struct TestVertex
+{
+    float Pos[3];
+    float Norm[3];
+    float Uv[2];
+};
+
+struct TestMesh
+{
+    std::vector<TestVertex> Vertices;
+    std::vector<UINT> Indices;
+
+    TangentInput GetInput() const
+    {
+        const byte* base = reinterpret_cast<const byte*>(Vertices.data());
+        TangentInput input;
+        input.Positions = base + offsetof(TestVertex, Pos);
+        input.Normals = base + offsetof(TestVertex, Norm);
+        input.Uvs = base + offsetof(TestVertex, Uv);
+        input.Stride = sizeof(TestVertex);
+        input.VertexCount = Vertices.size();
+        return input;
+    }
+};
+
+// A wavy grid facing +z with analytic normals. The uvs follow x and y, right of mirrorX the u runs backwards as on a mirrored half of a model.
+TestMesh MakeGrid(UINT size, UINT mirrorX)
+{
+    TestMesh mesh;
+    for (UINT y = 0; y <= size; ++y)
+    {
+        for (UINT x = 0; x <= size; ++x)
+        {
+            float slope = 0.3f * std::cos(float(x) * 0.5f) * 0.5f;
+            float invLen = 1.0f / std::sqrt(slope * slope + 1.0f);
+            float u = x <= mirrorX ? float(x) : float(2 * mirrorX - x);
+            mesh.Vertices.push_back({ { float(x), float(y), 0.3f * std::sin(float(x) * 0.5f) }, { -slope * invLen, 0.0f, invLen }, { u, float(y) } });
+        }
+    }
+    for (UINT y = 0; y < size; ++y)
+    {
+        for (UINT x = 0; x < size; ++x)
+        {
+            UINT v = y * (size + 1) + x;
+            mesh.Indices.insert(mesh.Indices.end(), { v, v + 1, v + size + 2, v, v + size + 2, v + size + 1 });
+        }
+    }
+    return mesh;
+}
+
+void Cross(const float a[3], const float b[3], float res[3])
+{
+    res[0] = a[1] * b[2] - a[2] * b[1];
+    res[1] = a[2] * b[0] - a[0] * b[2];
+    res[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+float Dot(const float a[3], const float b[3])
+{
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+// Unit tangents orthogonal to the normals, and cross(N, T) * w pointing along dP/dv of every triangle using the vertex.
+void CheckTangents(const TestMesh& mesh, const std::vector<UINT>& indices, const std::vector<float>& tangents, const std::vector<UINT>& splitVertices)
+{
+    auto getSource = [&](UINT v)
+    {
+        return v < mesh.Vertices.size() ? v : splitVertices[v - mesh.Vertices.size()];
+    };
+    REQUIRE(tangents.size() == (mesh.Vertices.size() + splitVertices.size()) * 4);
+    for (size_t v = 0; v < tangents.size() / 4; ++v)
+    {
+        const float* t = &tangents[v * 4];
+        CHECK_NEAR(Dot(t, t), 1.0f, 1e-4f);
+        CHECK_NEAR(Dot(t, mesh.Vertices[getSource(UINT(v))].Norm), 0.0f, 1e-4f);
+        CHECK(t[3] == 1.0f || t[3] == -1.0f);
+    }
+
+    for (size_t i = 0; i < indices.size(); i += 3)
+    {
+        const TestVertex& a = mesh.Vertices[getSource(indices[i + 0])];
+        const TestVertex& b = mesh.Vertices[getSource(indices[i + 1])];
+        const TestVertex& c = mesh.Vertices[getSource(indices[i + 2])];
+        float s1 = b.Uv[0] - a.Uv[0], t1 = b.Uv[1] - a.Uv[1];
+        float s2 = c.Uv[0] - a.Uv[0], t2 = c.Uv[1] - a.Uv[1];
+        float area = s1 * t2 - s2 * t1;
+        float dPdv[3];
+        for (UINT k = 0; k < 3; ++k)
+            dPdv[k] = (s1 * (c.Pos[k] - a.Pos[k]) - s2 * (b.Pos[k] - a.Pos[k])) / area;
+        for (UINT k = 0; k < 3; ++k)
+        {
+            UINT v = indices[i + k];
+            const float* t = &tangents[size_t(v) * 4];
+            float bitangent[3];
+            Cross(mesh.Vertices[getSource(v)].Norm, t, bitangent);
+            CHECK(Dot(bitangent, dPdv) * t[3] > 0.0f);
+        }
+    }
+}
+
+std::vector<SimdLevel> GetLevels()
+{
+    std::vector<SimdLevel> levels = { SimdLevel::Scalar };
+    if (GetSimdLevel() != SimdLevel::Scalar)
+        levels.push_back(SimdLevel::SSE41);
+    return levels;
+}
+}
+
+TEST(TangentsAreOrthogonalToTheNormals)
+{
+    const TestMesh mesh = MakeGrid(16, 16);
+    for (SimdLevel level : GetLevels())
+    {
+        std::vector<UINT> indices = mesh.Indices;
+        std::vector<float> tangents;
+        std::vector<UINT> splitVertices;
+        GenerateTangents(tangents, splitVertices, indices.data(), indices.size(), mesh.GetInput(), level);
+        CHECK(splitVertices.empty());
+        CHECK(indices == mesh.Indices);
+        CheckTangents(mesh, indices, tangents, splitVertices);
+        for (size_t v = 0; v < tangents.size() / 4; ++v)
+            CHECK_EQ(tangents[v * 4 + 3], 1.0f);
+    }
+}
+
+TEST(TangentsKeepTheHandednessOfMirroredUvs)
+{
+    // The quad is two cells wide, the right cell has the u mirrored.
+    const TestMesh mesh = MakeGrid(2, 1);
+    for (SimdLevel level : GetLevels())
+    {
+        std::vector<UINT> indices = mesh.Indices;
+        std::vector<float> tangents;
+        std::vector<UINT> splitVertices;
+        GenerateTangents(tangents, splitVertices, indices.data(), indices.size(), mesh.GetInput(), level);
+        CheckTangents(mesh, indices, tangents, splitVertices);
+
+        // The middle column is used by both sides and gets split, the left side keeps w = 1 and the right one gets -1.
+        CHECK_EQ(splitVertices.size(), size_t(3));
+        for (UINT source : splitVertices)
+            CHECK_EQ(source % 3, UINT(1));
+        for (size_t i = 0; i < indices.size(); ++i)
+        {
+            bool right = (i / 6) % 2 == 1; // Six indices per cell, row by row.
+            CHECK_EQ(tangents[size_t(indices[i]) * 4 + 3], right ? -1.0f : 1.0f);
+        }
+    }
+}
@@ -0,0 +1,38 @@
+#include "Tests/TestFramework.h"
+
+#include <d3d12.h>
+#include <dxgi1_6.h>
+#include <mutex>
+#include <wrl.h>
+
+namespace DirectxPlayground::Tests
+{
+using Microsoft::WRL::ComPtr;
+
+// No debug layer, the tests only create resources and map the upload ones.
+ID3D12Device* GetTestDevice()
+{
+    static ComPtr<ID3D12Device> device;
+    static std::once_flag created;
+    std::call_once(created, []()
+    {
+        ComPtr<IDXGIFactory4> factory;
+        if (FAILED(CreateDXGIFactory2(0, IID_PPV_ARGS(&factory))))
+            return;
+
+        ComPtr<IDXGIAdapter1> adapter;
+        for (UINT i = 0; factory->EnumAdapters1(i, &adapter) != DXGI_ERROR_NOT_FOUND; ++i)
+        {
+            DXGI_ADAPTER_DESC1 desc;
+            adapter->GetDesc1(&desc);
+            if ((desc.Flags & DXGI_ADAPTER_FLAG_SOFTWARE) == 0 && SUCCEEDED(D3D12CreateDevice(adapter.Get(), D3D_FEATURE_LEVEL_11_0, IID_PPV_ARGS(&device))))
+                return;
+        }
+
+        ComPtr<IDXGIAdapter> warpAdapter;
+        if (SUCCEEDED(factory->EnumWarpAdapter(IID_PPV_ARGS(&warpAdapter))))
+            D3D12CreateDevice(warpAdapter.Get(), D3D_FEATURE_LEVEL_11_0, IID_PPV_ARGS(&device));
+    });
+    return device.Get();
+}
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cmath>
+#include <sstream>
+#include <string>
+#include <vector>
+
+struct ID3D12Device;
+
+namespace DirectxPlayground::Tests
+{
+struct TestCase
+{
+    const char* Name = nullptr;
+    void (*Func)() = nullptr;
+};
+
+std::vector<TestCase>& GetTests();
+void ReportFailure(const char* file, int line, const std::string& message);
+void ReportSkip(const std::string& reason);
+
+// Hardware device if there is one, WARP otherwise. Created by the first test that asks for it, nullptr if neither works.
+ID3D12Device* GetTestDevice();
+// A directory of its own under the system temp one, emptied before the first use in the run.
+std::string GetTempDirectory();
+
+struct TestRegistrar
+{
+    TestRegistrar(const char* name, void (*func)())
+    {
+        GetTests().push_back({ name, func });
+    }
+};
+
+template <typename A, typename B>
+std::string FormatComparison(const char* expression, const A& a, const B& b)
+{
+    std::stringstream ss;
+    ss << expression << " (" << a << " vs " << b << ")";
+    return ss.str();
+}
+}
+
+// A test is a function registered by its name, run by TestMain in the registration order. The checks report and go on,
+// REQUIRE returns from the test, so it's for the conditions the rest of the test can't run without.
+#define TEST(name) \
+    static void name(); \
+    static ::DirectxPlayground::Tests::TestRegistrar name##Registrar(#name, name); \
+    static void name()
+
+#define CHECK(condition) \
+    do { if (!(condition)) ::DirectxPlayground::Tests::ReportFailure(__FILE__, __LINE__, #condition); } while (false)
+
+#define CHECK_EQ(a, b) \
+    do { if (!((a) == (b))) ::DirectxPlayground::Tests::ReportFailure(__FILE__, __LINE__, ::DirectxPlayground::Tests::FormatComparison(#a " == " #b, (a), (b))); } while (false)
+
+#define CHECK_NEAR(a, b, tolerance) \
+    do { if (!(std::abs(double(a) - double(b)) <= double(tolerance))) ::DirectxPlayground::Tests::ReportFailure(__FILE__, __LINE__, ::DirectxPlayground::Tests::FormatComparison(#a " ~= " #b, (a), (b))); } while (false)
+
+#define REQUIRE(condition) \
+    do { if (!(condition)) { ::DirectxPlayground::Tests::ReportFailure(__FILE__, __LINE__, #condition); return; } } while (false)
+
+#define SKIP(reason) \
+    do { ::DirectxPlayground::Tests::ReportSkip(reason); return; } while (false)
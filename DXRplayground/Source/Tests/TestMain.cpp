@@ -0,0 +1,83 @@
+#include "Tests/TestFramework.h"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+
+namespace DirectxPlayground::Tests
+{
+namespace
+{
+std::mutex FailuresMutex;
+size_t CurrentFailures = 0;
+bool CurrentSkipped = false;
+}
+
+std::vector<TestCase>& GetTests()
+{
+    static std::vector<TestCase> tests;
+    return tests;
+}
+
+// The checks may run on the pool threads of the code under test.
+void ReportFailure(const char* file, int line, const std::string& message)
+{
+    std::scoped_lock l(FailuresMutex);
+    printf("%s(%d): check failed: %s\n", file, line, message.c_str());
+    ++CurrentFailures;
+}
+
+void ReportSkip(const std::string& reason)
+{
+    std::scoped_lock l(FailuresMutex);
+    printf("  skipped: %s\n", reason.c_str());
+    CurrentSkipped = true;
+}
+
+std::string GetTempDirectory()
+{
+    static const std::string directory = []()
+    {
+        std::filesystem::path path = std::filesystem::temp_directory_path() / "DXRplaygroundTests";
+        std::error_code ec;
+        std::filesystem::remove_all(path, ec);
+        std::filesystem::create_directories(path, ec);
+        return path.string() + "/";
+    }();
+    return directory;
+}
+}
+
+// DXRplaygroundTests [name filter]. Returns non zero if any test failed, so the build or CI can run it as is.
+int main(int argc, char** argv)
+{
+    using namespace DirectxPlayground::Tests;
+    setvbuf(stdout, nullptr, _IONBF, 0); // A crashing test still shows up as the last one run.
+    const char* filter = argc > 1 ? argv[1] : nullptr;
+    size_t failed = 0;
+    size_t skipped = 0;
+    size_t run = 0;
+    for (const TestCase& test : GetTests())
+    {
+        if (filter != nullptr && strstr(test.Name, filter) == nullptr)
+            continue;
+        printf("[ RUN    ] %s\n", test.Name);
+        CurrentFailures = 0;
+        CurrentSkipped = false;
+        try
+        {
+            test.Func();
+        }
+        catch (const std::exception& e)
+        {
+            ReportFailure(test.Name, 0, std::string("unexpected exception: ") + e.what());
+        }
+        ++run;
+        failed += CurrentFailures > 0 ? 1 : 0;
+        skipped += CurrentSkipped && CurrentFailures == 0 ? 1 : 0;
+        printf("%s %s\n", CurrentFailures > 0 ? "[ FAILED ]" : CurrentSkipped ? "[ SKIP   ]" : "[     OK ]", test.Name);
+    }
+    printf("%zu tests run, %zu failed, %zu skipped\n", run, failed, skipped);
+    return failed > 0 ? 1 : 0;
+}
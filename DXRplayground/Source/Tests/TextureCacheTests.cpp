@@ -0,0 +1,276 @@
+#include "Tests/TestFramework.h"
+
+#include "DXrenderer/Textures/TextureCache.h"
+#include "DXrenderer/Textures/TextureManager.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+using namespace DirectxPlayground;
+
+namespace
+{
+// A directory of its own per test, so the entries of one never hit in another.
+void UseCacheDirectory(const std::string& name)
+{
+    std::string directory = Tests::GetTempDirectory() + "TextureCache" + name + "/";
+    std::error_code ec;
+    std::filesystem::remove_all(directory, ec);
+    TextureCache::SetDirectory(directory);
+}
+
+// The full chain packed as GenerateMips leaves it, with bytes that tell the levels and rows apart.
+DecodedImage MakeImage(UINT width, UINT height, DXGI_FORMAT format)
+{
+    DecodedImage image;
+    image.Width = width;
+    image.Height = height;
+    image.Format = format;
+    size_t offset = 0;
+    for (UINT i = 0; i < GetMipLevelsCount(width, height); ++i)
+    {
+        MipLevelDesc level;
+        level.Offset = offset;
+        level.Width = std::max(width >> i, 1U);
+        level.Height = std::max(height >> i, 1U);
+        level.RowPitch = GetRowPitch(format, level.Width);
+        image.Levels.push_back(level);
+        offset += size_t(level.RowPitch) * GetRowsCount(format, level.Height);
+    }
+    image.Data.resize(offset);
+    for (size_t i = 0; i < offset; ++i)
+        image.Data[i] = byte(i * 31 + i / 251);
+    return image;
+}
+
+bool SameLevels(const std::vector<MipLevelDesc>& a, const std::vector<MipLevelDesc>& b)
+{
+    return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](const MipLevelDesc& x, const MipLevelDesc& y)
+    {
+        return x.Offset == y.Offset && x.Width == y.Width && x.Height == y.Height && x.RowPitch == y.RowPitch;
+    });
+}
+
+void Truncate(const std::string& path, UINT64 size)
+{
+    std::filesystem::resize_file(path, size);
+}
+
+void Patch(const std::string& path, size_t offset, const void* data, size_t size)
+{
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+    file.seekp(offset);
+    file.write(reinterpret_cast<const char*>(data), size);
+}
+}
+
+TEST(TextureCacheRoundTrip)
+{
+    UseCacheDirectory("RoundTrip");
+    const DXGI_FORMAT formats[] = { DXGI_FORMAT_R8G8B8A8_UNORM, DXGI_FORMAT_R32G32B32_FLOAT, DXGI_FORMAT_BC1_UNORM, DXGI_FORMAT_BC7_UNORM };
+    UINT64 sourceHash = 1;
+    for (DXGI_FORMAT format : formats)
+    {
+        DecodedImage image = MakeImage(100, 60, format);
+        REQUIRE(TextureCache::Write(sourceHash, 7, image));
+        DecodedImage read;
+        REQUIRE(TextureCache::Read(sourceHash, 7, read));
+        CHECK(read.Data == image.Data);
+        CHECK(SameLevels(read.Levels, image.Levels));
+        CHECK(read.Width == image.Width && read.Height == image.Height && read.Format == format);
+
+        // Another processing of the same source, or another source, is a miss.
+        DecodedImage miss;
+        CHECK(!TextureCache::Read(sourceHash, 8, miss));
+        CHECK(!TextureCache::Read(sourceHash + 100, 7, miss));
+        ++sourceHash;
+    }
+
+    // The levels must be packed as the DDS has them.
+    DecodedImage gapped = MakeImage(64, 64, DXGI_FORMAT_R8G8B8A8_UNORM);
+    gapped.Data.resize(gapped.Data.size() + 16);
+    CHECK(!TextureCache::Write(50, 7, gapped));
+}
+
+TEST(TextureCacheRejectsCorruptEntries)
+{
+    UseCacheDirectory("Corrupt");
+    const DecodedImage image = MakeImage(64, 32, DXGI_FORMAT_BC3_UNORM);
+    const std::string path = TextureCache::GetCachePath(3, 9);
+    DecodedImage read;
+    auto rewrite = [&image]()
+    {
+        return TextureCache::Write(3, 9, image);
+    };
+
+    // Truncated anywhere: in the header, in the payload, by the last byte.
+    const UINT64 fileSize = 4 + 124 + 20 + image.Data.size();
+    for (UINT64 size : { UINT64(0), UINT64(100), UINT64(4 + 124 + 20), fileSize - image.Data.size() / 2, fileSize - 1 })
+    {
+        REQUIRE(rewrite());
+        REQUIRE(std::filesystem::file_size(path) == fileSize);
+        Truncate(path, size);
+        CHECK(!TextureCache::Read(3, 9, read));
+    }
+
+    // A longer payload than the header says.
+    REQUIRE(rewrite());
+    Truncate(path, fileSize + 1);
+    CHECK(!TextureCache::Read(3, 9, read));
+
+    // Not a DDS, or one with a format the cache never writes.
+    REQUIRE(rewrite());
+    const UINT notMagic = 0x12345678;
+    Patch(path, 0, &notMagic, sizeof(notMagic));
+    CHECK(!TextureCache::Read(3, 9, read));
+    REQUIRE(rewrite());
+    const UINT unknownFormat = 1; // DXGI_FORMAT_R32G32B32A32_TYPELESS
+    Patch(path, 4 + 124, &unknownFormat, sizeof(unknownFormat));
+    CHECK(!TextureCache::Read(3, 9, read));
+
+    // More mips than the size has.
+    REQUIRE(rewrite());
+    const UINT tooManyMips = 20;
+    Patch(path, 4 + 6 * sizeof(UINT), &tooManyMips, sizeof(tooManyMips));
+    CHECK(!TextureCache::Read(3, 9, read));
+
+    REQUIRE(rewrite());
+    CHECK(TextureCache::Read(3, 9, read));
+    CHECK(read.Data == image.Data);
+}
+
+TEST(TextureCacheStampMismatch)
+{
+    // The file name is the lookup, the stamp in the header has to agree with it. A renamed or stale entry is a miss.
+    UseCacheDirectory("Stamp");
+    const DecodedImage image = MakeImage(32, 32, DXGI_FORMAT_R8G8B8A8_UNORM);
+    REQUIRE(TextureCache::Write(10, 20, image));
+    std::filesystem::copy_file(TextureCache::GetCachePath(10, 20), TextureCache::GetCachePath(11, 20));
+    std::filesystem::copy_file(TextureCache::GetCachePath(10, 20), TextureCache::GetCachePath(10, 21));
+    DecodedImage read;
+    CHECK(!TextureCache::Read(11, 20, read));
+    CHECK(!TextureCache::Read(10, 21, read));
+    CHECK(TextureCache::Read(10, 20, read));
+
+    // An entry of an older stamp version. The stamp is at the start of the reserved words, the version follows the magic.
+    const size_t stampOffset = 4 + 7 * sizeof(UINT);
+    UINT version = 0;
+    {
+        std::ifstream file(TextureCache::GetCachePath(10, 20), std::ios::binary);
+        file.seekg(stampOffset + sizeof(UINT));
+        file.read(reinterpret_cast<char*>(&version), sizeof(version));
+    }
+    --version;
+    Patch(TextureCache::GetCachePath(10, 20), stampOffset + sizeof(UINT), &version, sizeof(version));
+    CHECK(!TextureCache::Read(10, 20, read));
+}
+
+TEST(TextureCacheWritesReleasedImages)
+{
+    // A miss is written once the image is done with, its pixels are moved to the write instead of copied.
+    UseCacheDirectory("Released");
+    const DecodedImage source = MakeImage(64, 32, DXGI_FORMAT_R8G8B8A8_UNORM);
+    DecodedImage image = source;
+    image.SourceHash = 77;
+    image.ProcessingKey = 3;
+    TextureManager::ReleaseDecodedImage(image);
+    CHECK(image.Data.empty() && image.Levels.empty());
+    CHECK(!image.PendingCacheWrite);
+    TextureCache::WaitForWrites();
+    DecodedImage read;
+    CHECK(!TextureCache::Read(77, 3, read));
+
+    image = source;
+    image.SourceHash = 77;
+    image.ProcessingKey = 3;
+    image.PendingCacheWrite = true;
+    TextureManager::ReleaseDecodedImage(image);
+    CHECK(image.Data.empty() && image.Levels.empty());
+    CHECK(!image.PendingCacheWrite);
+    TextureCache::WaitForWrites();
+    REQUIRE(TextureCache::Read(77, 3, read));
+    CHECK(read.Data == source.Data);
+    CHECK(SameLevels(read.Levels, source.Levels));
+}
+
+TEST(TextureCacheConcurrentWritesOfTheSameKey)
+{
+    // Two loads of the same content write the same entry at once. The last rename wins, a reader never sees a partial file
+    // and no temporary file is left behind.
+    UseCacheDirectory("Concurrent");
+    const DecodedImage image = MakeImage(256, 128, DXGI_FORMAT_BC1_UNORM);
+    TextureCache::ResetCounters();
+    for (UINT i = 0; i < 16; ++i)
+        TextureCache::WriteAsync(99, 1, image);
+    TextureCache::WaitForWrites();
+    TextureCache::Counters counters = TextureCache::GetCounters();
+    CHECK_EQ(counters.Writes + counters.FailedWrites, UINT64(16));
+    CHECK(counters.Writes >= 1);
+
+    DecodedImage read;
+    REQUIRE(TextureCache::Read(99, 1, read));
+    CHECK(read.Data == image.Data);
+    size_t entries = 0;
+    size_t temporaries = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(std::filesystem::path(TextureCache::GetCachePath(99, 1)).parent_path()))
+        ++(entry.path().extension() == ".tmp" ? temporaries : entries);
+    CHECK_EQ(entries, size_t(1));
+    CHECK_EQ(temporaries, size_t(0));
+}
+
+TEST(TextureCacheUploadLayout)
+{
+    // Straight to an upload buffer: the levels with aligned offsets and pitches stay where the read put them, the rest is moved
+    // after the payload with aligned pitches. Either way every row must be where its footprint says.
+    ID3D12Device* device = Tests::GetTestDevice();
+    if (device == nullptr)
+        SKIP("no D3D12 device");
+
+    UseCacheDirectory("Upload");
+    struct Case
+    {
+        UINT Width;
+        UINT Height;
+        DXGI_FORMAT Format;
+        size_t InPlaceLevels;
+    };
+    // 256x256 RGBA8: the levels down to 64 wide have 256 byte aligned pitches. 100x60 has none, so all of them are moved.
+    // 2048x2048 BC1: the pitches down to 128 wide (32 blocks, 256 bytes a row) are aligned.
+    const Case cases[] = { { 256, 256, DXGI_FORMAT_R8G8B8A8_UNORM, 3 }, { 100, 60, DXGI_FORMAT_R8G8B8A8_UNORM, 0 }, { 2048, 2048, DXGI_FORMAT_BC1_UNORM, 5 } };
+    UINT64 sourceHash = 1;
+    for (const Case& c : cases)
+    {
+        const DecodedImage image = MakeImage(c.Width, c.Height, c.Format);
+        REQUIRE(TextureCache::Write(sourceHash, 7, image));
+        DecodedImage read;
+        REQUIRE(TextureCache::Read(sourceHash, 7, read, device));
+        ++sourceHash;
+        CHECK(read.Data.empty());
+        REQUIRE(read.Upload != nullptr);
+        REQUIRE(read.UploadFootprints.size() == image.Levels.size());
+
+        byte* mapped = nullptr;
+        REQUIRE(SUCCEEDED(read.Upload->Map(0, nullptr, reinterpret_cast<void**>(&mapped))));
+        size_t inPlace = 0;
+        size_t misplacedRows = 0;
+        for (size_t i = 0; i < image.Levels.size(); ++i)
+        {
+            const MipLevelDesc& level = image.Levels[i];
+            const D3D12_PLACED_SUBRESOURCE_FOOTPRINT& footprint = read.UploadFootprints[i];
+            CHECK_EQ(footprint.Offset % D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT, UINT64(0));
+            CHECK_EQ(footprint.Footprint.RowPitch % D3D12_TEXTURE_DATA_PITCH_ALIGNMENT, UINT(0));
+            inPlace += footprint.Offset == level.Offset && footprint.Footprint.RowPitch == level.RowPitch ? 1 : 0;
+            for (UINT row = 0; row < GetRowsCount(c.Format, level.Height); ++row)
+            {
+                const byte* expected = image.Data.data() + level.Offset + size_t(row) * level.RowPitch;
+                misplacedRows += memcmp(mapped + footprint.Offset + size_t(row) * footprint.Footprint.RowPitch, expected, level.RowPitch) == 0 ? 0 : 1;
+            }
+        }
+        read.Upload->Unmap(0, nullptr);
+        CHECK_EQ(inPlace, c.InPlaceLevels);
+        CHECK_EQ(misplacedRows, size_t(0));
+    }
+}
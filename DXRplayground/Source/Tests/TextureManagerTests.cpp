@@ -0,0 +1,237 @@
+#include "Tests/TestFramework.h"
+
+#include "DXrenderer/Textures/TextureCache.h"
+#include "DXrenderer/Textures/TextureManager.h"
+
+using namespace DirectxPlayground;
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+// The copies are only recorded, the command list is never executed.
+struct TestContext
+{
+    ComPtr<ID3D12Device5> Device;
+    ComPtr<ID3D12CommandAllocator> Allocator;
+    ComPtr<ID3D12GraphicsCommandList5> CommandList;
+    RenderContext Context;
+
+    bool Create(ID3D12Device* device)
+    {
+        ComPtr<ID3D12GraphicsCommandList> commandList;
+        if (FAILED(device->QueryInterface(IID_PPV_ARGS(&Device))) ||
+            FAILED(device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&Allocator))) ||
+            FAILED(device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, Allocator.Get(), nullptr, IID_PPV_ARGS(&commandList))) ||
+            FAILED(commandList.As(&CommandList)))
+            return false;
+        Context.Device = Device.Get();
+        Context.CommandList = CommandList.Get();
+        Context.CbvSrvUavDescriptorSize = device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+        Context.RtvDescriptorSize = device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
+        return true;
+    }
+};
+
+DecodedImage MakeImage(UINT width, UINT height)
+{
+    DecodedImage image;
+    image.Width = width;
+    image.Height = height;
+    image.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    image.Data.assign(size_t(width) * height * 4, 0x80);
+    return image;
+}
+}
+
+TEST(TextureManagerUploadsWaitForTheFence)
+{
+    ID3D12Device* device = Tests::GetTestDevice();
+    if (device == nullptr)
+        SKIP("no D3D12 device");
+    TestContext test;
+    REQUIRE(test.Create(device));
+    TextureManager manager(test.Context);
+
+    // Decoded pixels and a cache hit read straight to an upload buffer, both stay until the GPU has passed the fence of their frame.
+    TextureCache::SetDirectory(Tests::GetTempDirectory() + "TextureManagerUploads/");
+    REQUIRE(TextureCache::Write(1, 1, MakeImage(64, 64)));
+    DecodedImage hit;
+    REQUIRE(TextureCache::Read(1, 1, hit, device));
+    REQUIRE(hit.Upload != nullptr);
+    manager.CreateTexture(test.Context, MakeImage(32, 32), "decoded", false);
+    manager.CreateTexture(test.Context, hit, "hit", false);
+    hit.Upload = nullptr;
+    CHECK_EQ(manager.GetUploadsCount(), size_t(2));
+    manager.RetireUploads(5);
+    manager.ReleaseCompletedUploads(4);
+    CHECK_EQ(manager.GetUploadsCount(), size_t(2));
+
+    // A later frame's upload goes with its own fence.
+    manager.CreateTexture(test.Context, MakeImage(16, 16), "later", false);
+    manager.RetireUploads(6);
+    manager.ReleaseCompletedUploads(5);
+    CHECK_EQ(manager.GetUploadsCount(), size_t(1));
+    manager.ReleaseCompletedUploads(6);
+    CHECK_EQ(manager.GetUploadsCount(), size_t(0));
+
+    // ReleaseUploads is for after a flush, the GPU is idle then.
+    manager.CreateTexture(test.Context, MakeImage(8, 8), "flushed", false);
+    manager.ReleaseUploads();
+    CHECK_EQ(manager.GetUploadsCount(), size_t(0));
+}
+
+TEST(TextureManagerReleasesWaitForTheFence)
+{
+    ID3D12Device* device = Tests::GetTestDevice();
+    if (device == nullptr)
+        SKIP("no D3D12 device");
+    TestContext test;
+    REQUIRE(test.Create(device));
+    TextureManager manager(test.Context);
+
+    const RtvSrvUavResourceIdx first = manager.CreateTexture(test.Context, MakeImage(32, 32), "first");
+    const RtvSrvUavResourceIdx second = manager.CreateTexture(test.Context, MakeImage(32, 32), "second");
+    manager.ReleaseUploads();
+    CHECK_EQ(manager.GetTexturesCount(), UINT(2));
+
+    // Not found by the name any more, but the slot and the resource stay for the frames in flight.
+    manager.ReleaseTexture(first.SRVOffset);
+    CHECK_EQ(manager.GetSharingStats().Released, UINT(1));
+    CHECK(manager.GetResource(first.ResourceIdx) != nullptr);
+    manager.RetireUploads(5);
+    manager.ReleaseCompletedUploads(4);
+    const RtvSrvUavResourceIdx third = manager.CreateTexture(test.Context, MakeImage(16, 16), "first");
+    CHECK(third.SRVOffset != first.SRVOffset && third.ResourceIdx != first.ResourceIdx);
+    CHECK_EQ(manager.GetSharingStats().PathHits, UINT(0));
+    CHECK_EQ(manager.GetTexturesCount(), UINT(3));
+
+    // Recycled once the GPU has passed the fence.
+    manager.ReleaseCompletedUploads(5);
+    CHECK_EQ(manager.GetTexturesCount(), UINT(2));
+    CHECK(manager.GetResource(first.ResourceIdx) == nullptr);
+    const RtvSrvUavResourceIdx fourth = manager.CreateTexture(test.Context, MakeImage(16, 16), "fourth");
+    CHECK_EQ(fourth.SRVOffset, first.SRVOffset);
+    CHECK_EQ(fourth.ResourceIdx, first.ResourceIdx);
+
+    // After a flush nothing waits.
+    manager.ReleaseTexture(second.SRVOffset);
+    manager.ReleaseUploads();
+    CHECK_EQ(manager.GetTexturesCount(), UINT(2));
+}
+
+TEST(TextureManagerSharesByPath)
+{
+    ID3D12Device* device = Tests::GetTestDevice();
+    if (device == nullptr)
+        SKIP("no D3D12 device");
+    TestContext test;
+    REQUIRE(test.Create(device));
+    TextureManager manager(test.Context);
+
+    const RtvSrvUavResourceIdx first = manager.CreateTexture(test.Context, MakeImage(32, 32), "albedo.png");
+    const RtvSrvUavResourceIdx again = manager.CreateTexture(test.Context, MakeImage(32, 32), "albedo.png");
+    CHECK_EQ(again.SRVOffset, first.SRVOffset);
+    CHECK_EQ(again.ResourceIdx, first.ResourceIdx);
+    CHECK_EQ(manager.GetSharingStats().PathHits, UINT(1));
+    CHECK_EQ(manager.GetSharingStats().Created, UINT(1));
+    CHECK_EQ(manager.GetTexturesCount(), UINT(1));
+
+    // The same name with another processing is another texture.
+    DecodedImage other = MakeImage(32, 32);
+    other.ProcessingKey = 7;
+    CHECK(manager.CreateTexture(test.Context, other, "albedo.png").SRVOffset != first.SRVOffset);
+    CHECK_EQ(manager.GetSharingStats().Created, UINT(2));
+    manager.ReleaseUploads();
+}
+
+TEST(TextureManagerSharesByContent)
+{
+    ID3D12Device* device = Tests::GetTestDevice();
+    if (device == nullptr)
+        SKIP("no D3D12 device");
+    TestContext test;
+    REQUIRE(test.Create(device));
+    TextureManager manager(test.Context);
+
+    // A copy of the file under another name, known by the source hash.
+    DecodedImage image = MakeImage(32, 32);
+    image.SourceHash = 42;
+    const RtvSrvUavResourceIdx first = manager.CreateTexture(test.Context, image, "textures/albedo.png");
+    const RtvSrvUavResourceIdx copy = manager.CreateTexture(test.Context, image, "copies/albedo_copy.png");
+    CHECK_EQ(copy.SRVOffset, first.SRVOffset);
+    CHECK_EQ(manager.GetSharingStats().ContentHits, UINT(1));
+    CHECK_EQ(manager.GetSharingStats().PathHits, UINT(0));
+
+    // The new name is known from now on too.
+    manager.CreateTexture(test.Context, MakeImage(32, 32), "copies/albedo_copy.png");
+    CHECK_EQ(manager.GetSharingStats().PathHits, UINT(1));
+    CHECK_EQ(manager.GetSharingStats().Created, UINT(1));
+
+    // Without a hash the content is unknown and nothing is shared by it.
+    CHECK(manager.CreateTexture(test.Context, MakeImage(32, 32), "unhashed.png").SRVOffset != first.SRVOffset);
+    CHECK_EQ(manager.GetSharingStats().ContentHits, UINT(1));
+    manager.ReleaseUploads();
+}
+
+TEST(TextureManagerKeepsSharedTexturesUntilTheLastRelease)
+{
+    ID3D12Device* device = Tests::GetTestDevice();
+    if (device == nullptr)
+        SKIP("no D3D12 device");
+    TestContext test;
+    REQUIRE(test.Create(device));
+    TextureManager manager(test.Context);
+
+    DecodedImage image = MakeImage(32, 32);
+    image.SourceHash = 42;
+    const RtvSrvUavResourceIdx texture = manager.CreateTexture(test.Context, image, "a.png");
+    manager.CreateTexture(test.Context, image, "a.png");
+    manager.CreateTexture(test.Context, image, "b.png");
+    manager.ReleaseUploads();
+
+    // Three references, the texture stays and is still found until the last one goes.
+    manager.ReleaseTexture(texture.SRVOffset);
+    manager.ReleaseTexture(texture.SRVOffset);
+    manager.ReleaseUploads();
+    CHECK_EQ(manager.GetSharingStats().Released, UINT(0));
+    CHECK(manager.GetResource(texture.ResourceIdx) != nullptr);
+    CHECK_EQ(manager.CreateTexture(test.Context, image, "b.png").SRVOffset, texture.SRVOffset);
+    manager.ReleaseTexture(texture.SRVOffset);
+
+    manager.ReleaseTexture(texture.SRVOffset);
+    CHECK_EQ(manager.GetSharingStats().Released, UINT(1));
+    manager.ReleaseUploads();
+    CHECK(manager.GetResource(texture.ResourceIdx) == nullptr);
+    CHECK_EQ(manager.GetTexturesCount(), UINT(0));
+
+    // Neither the paths nor the content find it any more.
+    manager.CreateTexture(test.Context, image, "a.png");
+    CHECK_EQ(manager.GetSharingStats().Created, UINT(2));
+    manager.ReleaseUploads();
+}
+
+TEST(TextureManagerNeverHandsOutUnsharedTextures)
+{
+    ID3D12Device* device = Tests::GetTestDevice();
+    if (device == nullptr)
+        SKIP("no D3D12 device");
+    TestContext test;
+    REQUIRE(test.Create(device));
+    TextureManager manager(test.Context);
+
+    // Created with share = false, e.g. to be written to, neither its name nor its content is registered.
+    DecodedImage image = MakeImage(32, 32);
+    image.SourceHash = 42;
+    const RtvSrvUavResourceIdx unshared = manager.CreateTexture(test.Context, image, "a.png", false);
+    const RtvSrvUavResourceIdx byPath = manager.CreateTexture(test.Context, image, "a.png");
+    const RtvSrvUavResourceIdx byContent = manager.CreateTexture(test.Context, image, "b.png");
+    CHECK(byPath.SRVOffset != unshared.SRVOffset);
+    CHECK(byContent.SRVOffset != unshared.SRVOffset);
+    CHECK_EQ(byContent.SRVOffset, byPath.SRVOffset);
+
+    // Nor does it take another texture when asked not to share.
+    CHECK(manager.CreateTexture(test.Context, image, "a.png", false).SRVOffset != byPath.SRVOffset);
+    CHECK_EQ(manager.GetSharingStats().Created, UINT(3));
+    CHECK_EQ(manager.GetSharingStats().PathHits + manager.GetSharingStats().ContentHits, UINT(1));
+    manager.ReleaseUploads();
+}
@@ -0,0 +1,69 @@
+#include "Tests/TestFramework.h"
+
+#include "Utils/ThreadPool.h"
+
+#include <atomic>
+#include <stdexcept>
+
+using namespace DirectxPlayground;
+
+TEST(ThreadPoolParallelForRunsEveryItemOnce)
+{
+    ThreadPool pool(4);
+    for (size_t count : { 0, 1, 2, 3, 100, 10'000 })
+    {
+        std::vector<std::atomic<size_t>> runs(count);
+        pool.ParallelFor(count, [&runs](size_t i) { ++runs[i]; });
+        size_t wrong = 0;
+        for (const auto& r : runs)
+            wrong += r == 1 ? 0 : 1;
+        CHECK_EQ(wrong, size_t(0));
+    }
+}
+
+TEST(ThreadPoolNestedParallelFor)
+{
+    // The inner loops run on the workers of the outer one, they must not wait for the workers busy with the outer items.
+    ThreadPool pool(2);
+    std::atomic<size_t> sum{ 0 };
+    pool.ParallelFor(8, [&pool, &sum](size_t i)
+    {
+        pool.ParallelFor(100, [&sum, i](size_t j) { sum += i * 100 + j; });
+    });
+    CHECK_EQ(sum.load(), size_t(800 * 799 / 2));
+}
+
+TEST(ThreadPoolSubmitReturnsTheResult)
+{
+    ThreadPool pool(2);
+    std::future<int> result = pool.Submit([]() { return 42; });
+    CHECK_EQ(result.get(), 42);
+}
+
+TEST(ThreadPoolParallelForRethrowsOnTheCaller)
+{
+    // Whichever thread gets the throwing item, the caller must wake up and get the exception.
+    ThreadPool pool(4);
+    for (size_t throwing : { 0, 1, 500, 999 })
+    {
+        bool caught = false;
+        try
+        {
+            pool.ParallelFor(1000, [throwing](size_t i)
+            {
+                if (i == throwing)
+                    throw std::runtime_error("item failed");
+            });
+        }
+        catch (const std::runtime_error&)
+        {
+            caught = true;
+        }
+        CHECK(caught);
+    }
+
+    // And the pool is still usable after that.
+    std::atomic<size_t> count{ 0 };
+    pool.ParallelFor(100, [&count](size_t) { ++count; });
+    CHECK_EQ(count.load(), size_t(100));
+}
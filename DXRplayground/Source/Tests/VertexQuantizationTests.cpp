@@ -0,0 +1,79 @@
+#include "Tests/TestFramework.h"
+
+#include "DXrenderer/Geometry/VertexQuantization.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+using namespace DirectxPlayground;
+
+namespace
+{
+// The Vertex layout without DirectXMath.
+struct TestVertex
+{
+    float Pos[3];
+    float Uv[2];
+    float Norm[3];
+    float Tangent[4];
+};
+
+void Normalize(float* v)
+{
+    float length = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+    for (UINT c = 0; c < 3; ++c)
+        v[c] /= length;
+}
+}
+
+TEST(VertexQuantizationRoundTrip)
+{
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> position(-50.0f, 150.0f);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> uv(0.0f, 1.0f);
+    std::vector<TestVertex> vertices(10'000);
+    for (size_t i = 0; i < vertices.size(); ++i)
+    {
+        TestVertex& v = vertices[i];
+        v = { { position(rng), position(rng) * 0.1f, position(rng) }, { uv(rng), uv(rng) }, { unit(rng), unit(rng), unit(rng) },
+            { unit(rng), unit(rng), unit(rng), i % 2 == 0 ? 1.0f : -1.0f } };
+        Normalize(v.Norm);
+        Normalize(v.Tangent);
+    }
+    // The axis aligned directions are the octahedron vertices and edges, where the encoding folds.
+    vertices[0].Norm[0] = 0.0f; vertices[0].Norm[1] = 0.0f; vertices[0].Norm[2] = -1.0f;
+    vertices[1].Norm[0] = -1.0f; vertices[1].Norm[1] = 0.0f; vertices[1].Norm[2] = 0.0f;
+
+    const byte* base = reinterpret_cast<const byte*>(vertices.data());
+    VertexStreams streams;
+    streams.Positions = base + offsetof(TestVertex, Pos);
+    streams.Uvs = base + offsetof(TestVertex, Uv);
+    streams.Normals = base + offsetof(TestVertex, Norm);
+    streams.Tangents = base + offsetof(TestVertex, Tangent);
+    streams.Stride = sizeof(TestVertex);
+
+    QuantizationBounds bounds = ComputeQuantizationBounds(streams.Positions, streams.Stride, vertices.size());
+    std::vector<QuantizedVertex> quantized(vertices.size());
+    QuantizeVertices(quantized.data(), streams, quantized.size(), bounds);
+    QuantizationError error = MeasureQuantizationError(quantized.data(), streams, quantized.size(), bounds);
+
+    // Half a UNORM16 step of the largest extent, a half float ulp at 1 and SNORM16 octahedral precision, over the float acos resolution near 0.
+    float maxExtent = std::max({ bounds.Extent[0], bounds.Extent[1], bounds.Extent[2] });
+    CHECK(error.Position <= maxExtent / 65535.0f);
+    CHECK(error.Uv <= 1.0f / 1024.0f);
+    CHECK(error.NormalDegrees < 0.1f);
+    CHECK(error.TangentDegrees < 0.1f);
+    CHECK(error.HandednessPreserved);
+}
+
+TEST(HalfFloatConversion)
+{
+    for (float value : { 0.0f, 1.0f, -2.5f, 0.333f, 65504.0f, 6.1e-5f, 1e-7f })
+    {
+        float roundTrip = HalfToFloat(FloatToHalf(value));
+        CHECK_NEAR(roundTrip, value, std::abs(value) / 1024.0f + 6e-8f);
+    }
+    CHECK_EQ(FloatToHalf(1e6f), USHORT(0x7C00));
+}
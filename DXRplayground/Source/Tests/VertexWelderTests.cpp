@@ -0,0 +1,118 @@
+#include "Tests/TestFramework.h"
+
+#include "DXrenderer/Geometry/VertexWelder.h"
+
+#include <cstring>
+#include <vector>
+
+using namespace DirectxPlayground;
+
+namespace
+{
+struct TestVertex
+{
+    float Pos[3];
+    float Norm[3];
+    float Uv[2];
+};
+
+TestVertex MakeVertex(float x, float y, float u, float v, float nz = 1.0f)
+{
+    return { { x, y, 0.0f }, { 0.0f, 0.0f, nz }, { u, v } };
+}
+
+struct WeldResult
+{
+    std::vector<UINT> Remap;
+    std::vector<TestVertex> Vertices;
+};
+
+WeldResult Weld(const std::vector<TestVertex>& vertices, float epsilon)
+{
+    WeldResult result;
+    result.Remap.resize(vertices.size());
+    size_t uniqueCount = GenerateVertexRemap(result.Remap.data(), reinterpret_cast<const byte*>(vertices.data()), vertices.size(), sizeof(TestVertex), epsilon);
+    result.Vertices.resize(uniqueCount);
+    RemapVertices(reinterpret_cast<byte*>(result.Vertices.data()), reinterpret_cast<const byte*>(vertices.data()), vertices.size(), sizeof(TestVertex), result.Remap.data());
+    return result;
+}
+
+bool SameVertex(const TestVertex& a, const TestVertex& b)
+{
+    return memcmp(&a, &b, sizeof(TestVertex)) == 0;
+}
+}
+
+TEST(WeldMergesExactDuplicates)
+{
+    // A quad as two unindexed triangles, the shared edge is duplicated.
+    std::vector<TestVertex> vertices = {
+        MakeVertex(0, 0, 0, 0), MakeVertex(1, 0, 1, 0), MakeVertex(0, 1, 0, 1),
+        MakeVertex(1, 0, 1, 0), MakeVertex(1, 1, 1, 1), MakeVertex(0, 1, 0, 1),
+    };
+    WeldResult weld = Weld(vertices, 0.0f);
+    REQUIRE(weld.Vertices.size() == 4);
+    const std::vector<UINT> expectedRemap = { 0, 1, 2, 1, 3, 2 };
+    CHECK(weld.Remap == expectedRemap);
+    for (size_t v = 0; v < vertices.size(); ++v)
+        CHECK(SameVertex(weld.Vertices[weld.Remap[v]], vertices[v]));
+
+    std::vector<UINT> indices = { 0, 1, 2, 3, 4, 5 };
+    RemapIndices(indices.data(), indices.data(), indices.size(), weld.Remap.data());
+    CHECK(indices == expectedRemap);
+}
+
+TEST(WeldMergesWithinEpsilon)
+{
+    // Far from the cell borders of a 1e-3 grid, so the snapping can't split them.
+    std::vector<TestVertex> vertices = {
+        MakeVertex(0.2503f, 0.7501f, 0.1f, 0.9f),
+        MakeVertex(0.25031f, 0.75012f, 0.10002f, 0.90001f),
+        MakeVertex(0.2603f, 0.7501f, 0.1f, 0.9f),
+    };
+    CHECK_EQ(Weld(vertices, 0.0f).Vertices.size(), size_t(3));
+
+    WeldResult weld = Weld(vertices, 1e-3f);
+    REQUIRE(weld.Vertices.size() == 2);
+    CHECK_EQ(weld.Remap[0], UINT(0));
+    CHECK_EQ(weld.Remap[1], UINT(0));
+    CHECK_EQ(weld.Remap[2], UINT(1));
+    CHECK(SameVertex(weld.Vertices[0], vertices[0])); // The first occurrence is kept as is, not snapped.
+}
+
+TEST(WeldKeepsAttributeSeams)
+{
+    // The same position with another uv (a texture seam) or another normal (a hard edge) is another vertex.
+    std::vector<TestVertex> vertices = {
+        MakeVertex(0.5f, 0.5f, 0.0f, 0.0f),
+        MakeVertex(0.5f, 0.5f, 1.0f, 0.0f),
+        MakeVertex(0.5f, 0.5f, 0.0f, 0.0f, -1.0f),
+        MakeVertex(0.5f, 0.5f, 0.0f, 0.0f),
+    };
+    for (float epsilon : { 0.0f, 1e-3f })
+    {
+        WeldResult weld = Weld(vertices, epsilon);
+        CHECK_EQ(weld.Vertices.size(), size_t(3));
+        CHECK_EQ(weld.Remap[3], weld.Remap[0]);
+        CHECK(weld.Remap[0] != weld.Remap[1] && weld.Remap[0] != weld.Remap[2] && weld.Remap[1] != weld.Remap[2]);
+    }
+}
+
+TEST(WeldHandlesManyVertices)
+{
+    // Enough to grow the table well past its first size, every vertex twice.
+    const UINT count = 100000;
+    std::vector<TestVertex> vertices;
+    vertices.reserve(count * 2);
+    for (UINT pass = 0; pass < 2; ++pass)
+    {
+        for (UINT i = 0; i < count; ++i)
+            vertices.push_back(MakeVertex(float(i % 317), float(i / 317), float(i) * 0.5f, 0.0f));
+    }
+    WeldResult weld = Weld(vertices, 0.0f);
+    REQUIRE(weld.Vertices.size() == count);
+    bool ok = true;
+    for (UINT i = 0; i < count; ++i)
+        ok = ok && weld.Remap[i] == i && weld.Remap[count + i] == i;
+    CHECK(ok);
+}
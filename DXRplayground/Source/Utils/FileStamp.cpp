@@ -0,0 +1,26 @@
+#include "Utils/FileStamp.h"
+
+#include "Utils/Hash.h"
+#include "Utils/MappedFile.h"
+
+namespace DirectxPlayground
+{
+bool GetFileStamp(const std::filesystem::path& path, FileStamp& stamp)
+{
+    std::error_code ec;
+    stamp.Size = std::filesystem::file_size(path, ec);
+    if (ec)
+        return false;
+    stamp.Time = static_cast<INT64>(std::filesystem::last_write_time(path, ec).time_since_epoch().count());
+    return !ec;
+}
+
+bool HashFile(const std::string& path, UINT64& hash)
+{
+    MappedFile file;
+    if (!file.Open(path))
+        return false;
+    hash = HashBytes(file.GetData(), file.GetSize());
+    return true;
+}
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <windows.h>
+
+namespace DirectxPlayground
+{
+// What the caches check a source file against. A matching stamp is trusted, a mismatching one falls back to HashFile.
+struct FileStamp
+{
+    UINT64 Size = 0;
+    INT64 Time = 0;
+};
+
+bool GetFileStamp(const std::filesystem::path& path, FileStamp& stamp);
+bool HashFile(const std::string& path, UINT64& hash); // HashBytes of the whole file, read through a mapping.
+}
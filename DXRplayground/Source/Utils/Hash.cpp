@@ -0,0 +1,107 @@
+#include "Utils/Hash.h"
+
+#include <cstring>
+
+namespace DirectxPlayground
+{
+namespace
+{
+constexpr UINT64 Prime1 = 0x9E3779B185EBCA87ULL;
+constexpr UINT64 Prime2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr UINT64 Prime3 = 0x165667B19E3779F9ULL;
+constexpr UINT64 Prime4 = 0x85EBCA77C2B2AE63ULL;
+constexpr UINT64 Prime5 = 0x27D4EB2F165667C5ULL;
+
+inline UINT64 RotateLeft(UINT64 x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+inline UINT64 Read64(const byte* p)
+{
+    UINT64 v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline UINT Read32(const byte* p)
+{
+    UINT v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline UINT64 Round(UINT64 acc, UINT64 input)
+{
+    acc += input * Prime2;
+    acc = RotateLeft(acc, 31);
+    return acc * Prime1;
+}
+
+inline UINT64 MergeRound(UINT64 acc, UINT64 val)
+{
+    acc ^= Round(0, val);
+    return acc * Prime1 + Prime4;
+}
+}
+
+UINT64 HashBytes(const void* data, size_t size, UINT64 seed /*= 0*/)
+{
+    const byte* p = static_cast<const byte*>(data);
+    const byte* end = p + size;
+    UINT64 hash = 0;
+
+    if (size >= 32)
+    {
+        UINT64 v1 = seed + Prime1 + Prime2;
+        UINT64 v2 = seed + Prime2;
+        UINT64 v3 = seed;
+        UINT64 v4 = seed - Prime1;
+        const byte* limit = end - 32;
+        do
+        {
+            v1 = Round(v1, Read64(p));
+            v2 = Round(v2, Read64(p + 8));
+            v3 = Round(v3, Read64(p + 16));
+            v4 = Round(v4, Read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+
+        hash = RotateLeft(v1, 1) + RotateLeft(v2, 7) + RotateLeft(v3, 12) + RotateLeft(v4, 18);
+        hash = MergeRound(hash, v1);
+        hash = MergeRound(hash, v2);
+        hash = MergeRound(hash, v3);
+        hash = MergeRound(hash, v4);
+    }
+    else
+    {
+        hash = seed + Prime5;
+    }
+
+    hash += static_cast<UINT64>(size);
+
+    for (; p + 8 <= end; p += 8)
+    {
+        hash ^= Round(0, Read64(p));
+        hash = RotateLeft(hash, 27) * Prime1 + Prime4;
+    }
+    if (p + 4 <= end)
+    {
+        hash ^= static_cast<UINT64>(Read32(p)) * Prime1;
+        hash = RotateLeft(hash, 23) * Prime2 + Prime3;
+        p += 4;
+    }
+    for (; p < end; ++p)
+    {
+        hash ^= (*p) * Prime5;
+        hash = RotateLeft(hash, 11) * Prime1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= Prime2;
+    hash ^= hash >> 29;
+    hash *= Prime3;
+    hash ^= hash >> 32;
+    return hash;
+}
+}
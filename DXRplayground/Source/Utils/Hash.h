@@ -0,0 +1,20 @@
+#pragma once
+
+#include <string>
+#include <windows.h>
+
+namespace DirectxPlayground
+{
+// XXH64. Fast enough to hash whole asset files on load.
+UINT64 HashBytes(const void* data, size_t size, UINT64 seed = 0);
+
+inline UINT64 HashString(const std::string& str, UINT64 seed = 0)
+{
+    return HashBytes(str.data(), str.size(), seed);
+}
+
+inline UINT64 HashCombine(UINT64 hash, UINT64 value)
+{
+    return hash ^ (value + 0x9E3779B97F4A7C15ULL + (hash << 6) + (hash >> 2));
+}
+}
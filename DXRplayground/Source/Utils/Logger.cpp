@@ -11,6 +11,7 @@ ImguiLogger::ImguiLogger()
 
 void ImguiLogger::Draw(const char* title, bool* p_open /*= NULL*/)
 {
+    std::scoped_lock l(m_mutex);
     if (!ImGui::Begin(title, p_open))
     {
         ImGui::End();
@@ -6,6 +6,7 @@
 #include <string>
 #include <sstream>
 #include <locale>
+#include <mutex>
 // See from imgui_demo.cpp
 
 namespace DirectxPlayground
@@ -29,10 +30,12 @@ private:
     ImVector<int> m_lineOffsets; // Index to lines offset. We maintain this with AddLog() calls, allowing us to have a random access on lines
     bool m_autoScroll = true;
     bool m_scrollToBottom = false;
+    std::recursive_mutex m_mutex; // LOG can be called from worker threads.
 };
 
 inline void ImguiLogger::Clear()
 {
+    std::scoped_lock l(m_mutex);
     m_textBuffer.clear();
     m_lineOffsets.clear();
     m_lineOffsets.push_back(0);
@@ -40,6 +43,7 @@ inline void ImguiLogger::Clear()
 
 inline void ImguiLogger::AddLog(const std::string& msg)
 {
+    std::scoped_lock l(m_mutex);
     AddLogInternal("%s \n", msg.c_str());
 }
 
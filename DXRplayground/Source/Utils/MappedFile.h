@@ -0,0 +1,52 @@
+#pragma once
+
+#include <string>
+#include <windows.h>
+
+namespace DirectxPlayground
+{
+// Read only memory mapped view of a whole file.
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile(MappedFile&&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile& operator=(MappedFile&&) = delete;
+    ~MappedFile();
+
+    bool Open(const std::string& path);
+    void Close();
+
+    bool IsOpen() const;
+    const byte* GetData() const;
+    size_t GetSize() const;
+
+private:
+    HANDLE m_file = INVALID_HANDLE_VALUE;
+    HANDLE m_mapping = nullptr;
+    const byte* m_data = nullptr;
+    size_t m_size = 0;
+};
+
+inline MappedFile::~MappedFile()
+{
+    Close();
+}
+
+inline bool MappedFile::IsOpen() const
+{
+    return m_data != nullptr;
+}
+
+inline const byte* MappedFile::GetData() const
+{
+    return m_data;
+}
+
+inline size_t MappedFile::GetSize() const
+{
+    return m_size;
+}
+}
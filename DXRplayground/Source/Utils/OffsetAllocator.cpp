@@ -0,0 +1,92 @@
+#include "Utils/OffsetAllocator.h"
+
+#include <cassert>
+#include <iterator>
+
+namespace DirectxPlayground
+{
+OffsetAllocator::OffsetAllocator(UINT64 capacity)
+    : m_capacity(capacity)
+    , m_freeSize(capacity)
+{
+    if (capacity > 0)
+        AddFreeRange(0, capacity);
+}
+
+OffsetAllocator::Allocation OffsetAllocator::Allocate(UINT64 size, UINT64 alignment /*= 1*/)
+{
+    assert(alignment > 0);
+    if (size == 0)
+        return {};
+
+    // The smallest range that fits. With alignment the padding may not fit in it, then try the next bigger one.
+    for (auto it = m_freeBySize.lower_bound(size); it != m_freeBySize.end(); ++it)
+    {
+        UINT64 rangeOffset = it->second;
+        UINT64 rangeSize = it->first;
+        UINT64 offset = (rangeOffset + alignment - 1) / alignment * alignment;
+        UINT64 padding = offset - rangeOffset;
+        if (padding + size > rangeSize)
+            continue;
+
+        RemoveFreeRange(m_freeByOffset.find(rangeOffset));
+        if (padding > 0)
+            AddFreeRange(rangeOffset, padding);
+        if (padding + size < rangeSize)
+            AddFreeRange(offset + size, rangeSize - padding - size);
+        m_freeSize -= size;
+        return { offset, size };
+    }
+    return {};
+}
+
+void OffsetAllocator::Free(const Allocation& allocation)
+{
+    if (!allocation.IsValid())
+        return;
+    assert(allocation.Offset + allocation.Size <= m_capacity);
+
+    UINT64 offset = allocation.Offset;
+    UINT64 size = allocation.Size;
+    auto next = m_freeByOffset.lower_bound(offset);
+    assert((next == m_freeByOffset.end() || next->first >= offset + size) && "Double free or a foreign allocation");
+    if (next != m_freeByOffset.end() && next->first == offset + size)
+    {
+        size += next->second;
+        RemoveFreeRange(next++);
+    }
+    if (next != m_freeByOffset.begin())
+    {
+        auto prev = std::prev(next);
+        assert(prev->first + prev->second <= offset && "Double free or a foreign allocation");
+        if (prev->first + prev->second == offset)
+        {
+            offset = prev->first;
+            size += prev->second;
+            RemoveFreeRange(prev);
+        }
+    }
+    AddFreeRange(offset, size);
+    m_freeSize += allocation.Size;
+}
+
+void OffsetAllocator::AddFreeRange(UINT64 offset, UINT64 size)
+{
+    m_freeByOffset.emplace(offset, size);
+    m_freeBySize.emplace(size, offset);
+}
+
+void OffsetAllocator::RemoveFreeRange(FreeRanges::iterator range)
+{
+    auto bySize = m_freeBySize.equal_range(range->second);
+    for (auto it = bySize.first; it != bySize.second; ++it)
+    {
+        if (it->second == range->first)
+        {
+            m_freeBySize.erase(it);
+            break;
+        }
+    }
+    m_freeByOffset.erase(range);
+}
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <map>
+#include <windows.h>
+
+namespace DirectxPlayground
+{
+// Sub-allocates ranges of something linear in whatever units the owner uses, e.g. vertices of a big vertex buffer.
+// Best fit over the free ranges with the neighbours coalesced on free, both O(log n). There is no memory behind it,
+// so it works without a device.
+class OffsetAllocator
+{
+public:
+    static constexpr UINT64 InvalidOffset = UINT64(-1);
+
+    struct Allocation
+    {
+        UINT64 Offset = InvalidOffset;
+        UINT64 Size = 0;
+
+        bool IsValid() const
+        {
+            return Offset != InvalidOffset;
+        }
+    };
+
+    explicit OffsetAllocator(UINT64 capacity);
+
+    Allocation Allocate(UINT64 size, UINT64 alignment = 1); // Invalid allocation if there is no free range big enough.
+    void Free(const Allocation& allocation);
+
+    UINT64 GetCapacity() const;
+    UINT64 GetFreeSize() const;
+    UINT64 GetLargestFreeRange() const;
+    size_t GetFreeRangesCount() const; // 1 when nothing is allocated, more means fragmentation.
+
+private:
+    using FreeRanges = std::map<UINT64, UINT64>; // Offset to size.
+
+    void AddFreeRange(UINT64 offset, UINT64 size);
+    void RemoveFreeRange(FreeRanges::iterator range);
+
+    FreeRanges m_freeByOffset;
+    std::multimap<UINT64, UINT64> m_freeBySize; // Size to offset.
+    UINT64 m_capacity = 0;
+    UINT64 m_freeSize = 0;
+};
+
+inline UINT64 OffsetAllocator::GetCapacity() const
+{
+    return m_capacity;
+}
+
+inline UINT64 OffsetAllocator::GetFreeSize() const
+{
+    return m_freeSize;
+}
+
+inline UINT64 OffsetAllocator::GetLargestFreeRange() const
+{
+    return m_freeBySize.empty() ? 0 : m_freeBySize.rbegin()->first;
+}
+
+inline size_t OffsetAllocator::GetFreeRangesCount() const
+{
+    return m_freeByOffset.size();
+}
+}
@@ -0,0 +1,59 @@
+#include "Utils/RadixSort.h"
+
+#include <cstring>
+#include <utility>
+
+namespace DirectxPlayground
+{
+namespace
+{
+constexpr UINT DigitBits = 8;
+constexpr UINT DigitsCount = 64 / DigitBits;
+constexpr UINT BucketsCount = 1 << DigitBits;
+}
+
+void RadixSort(UINT64* keys, UINT* values, size_t count, UINT64* keysScratch, UINT* valuesScratch)
+{
+    size_t histograms[DigitsCount][BucketsCount] = {};
+    for (size_t i = 0; i < count; ++i)
+    {
+        UINT64 key = keys[i];
+        for (UINT digit = 0; digit < DigitsCount; ++digit)
+            ++histograms[digit][(key >> (digit * DigitBits)) & (BucketsCount - 1)];
+    }
+
+    UINT64* srcKeys = keys;
+    UINT* srcValues = values;
+    UINT64* dstKeys = keysScratch;
+    UINT* dstValues = valuesScratch;
+    for (UINT digit = 0; digit < DigitsCount; ++digit)
+    {
+        size_t* histogram = histograms[digit];
+        UINT shift = digit * DigitBits;
+        if (count == 0 || histogram[(srcKeys[0] >> shift) & (BucketsCount - 1)] == count)
+            continue; // The same digit everywhere, the order wouldn't change.
+
+        size_t offset = 0;
+        for (UINT bucket = 0; bucket < BucketsCount; ++bucket)
+        {
+            size_t bucketCount = histogram[bucket];
+            histogram[bucket] = offset;
+            offset += bucketCount;
+        }
+        for (size_t i = 0; i < count; ++i)
+        {
+            size_t dst = histogram[(srcKeys[i] >> shift) & (BucketsCount - 1)]++;
+            dstKeys[dst] = srcKeys[i];
+            dstValues[dst] = srcValues[i];
+        }
+        std::swap(srcKeys, dstKeys);
+        std::swap(srcValues, dstValues);
+    }
+
+    if (srcKeys != keys)
+    {
+        memcpy(keys, srcKeys, sizeof(UINT64) * count);
+        memcpy(values, srcValues, sizeof(UINT) * count);
+    }
+}
+}
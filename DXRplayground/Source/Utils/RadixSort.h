@@ -0,0 +1,11 @@
+#pragma once
+
+#include <windows.h>
+
+namespace DirectxPlayground
+{
+// Stable LSD radix sort of 64 bit keys with a 32 bit payload, 8 bit digits. All the digit histograms are built in one pass,
+// and the passes where every key has the same digit are skipped, so keys that use a few bits cost a few passes.
+// The scratch arrays need count elements, the result ends up in keys and values.
+void RadixSort(UINT64* keys, UINT* values, size_t count, UINT64* keysScratch, UINT* valuesScratch);
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+namespace DirectxPlayground
+{
+
+enum class SimdLevel
+{
+    Scalar = 0,
+    SSE41,
+    AVX2
+};
+
+// MSVC allows intrinsics of any level in any function, gcc/clang need the target to be spelled out.
+// No fma: gcc would contract the mul + add pairs into it and the levels would no longer match the scalar code bit for bit.
+#if defined(_MSC_VER)
+#define SIMD_TARGET_AVX2
+#define SIMD_TARGET_SSE41
+#else
+#define SIMD_TARGET_AVX2 __attribute__((target("avx2")))
+#define SIMD_TARGET_SSE41 __attribute__((target("sse4.1")))
+#endif
+
+namespace Internal
+{
+inline void CpuId(int info[4], int leaf, int subleaf = 0)
+{
+#if defined(_MSC_VER)
+    __cpuidex(info, leaf, subleaf);
+#else
+    __cpuid_count(leaf, subleaf, info[0], info[1], info[2], info[3]);
+#endif
+}
+
+inline unsigned long long GetXcr0()
+{
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    unsigned int eax = 0, edx = 0;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return (static_cast<unsigned long long>(edx) << 32) | eax;
+#endif
+}
+
+inline SimdLevel DetectSimdLevel()
+{
+    int info[4] = {};
+    CpuId(info, 0);
+    int maxLeaf = info[0];
+
+    CpuId(info, 1);
+    bool sse41 = (info[2] & (1 << 19)) != 0;
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    bool fma = (info[2] & (1 << 12)) != 0;
+    if (!sse41)
+        return SimdLevel::Scalar;
+
+    bool ymmEnabled = osxsave && (GetXcr0() & 0x6) == 0x6; // OS saves xmm and ymm state.
+    if (avx && fma && ymmEnabled && maxLeaf >= 7)
+    {
+        CpuId(info, 7);
+        if (info[1] & (1 << 5))
+            return SimdLevel::AVX2;
+    }
+    return SimdLevel::SSE41;
+}
+}
+
+inline SimdLevel GetSimdLevel()
+{
+    static const SimdLevel level = Internal::DetectSimdLevel();
+    return level;
+}
+}
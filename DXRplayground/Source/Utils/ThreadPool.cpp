@@ -0,0 +1,132 @@
+#include "Utils/ThreadPool.h"
+
+#include <algorithm>
+#include <exception>
+
+namespace DirectxPlayground
+{
+namespace
+{
+struct ParallelForState
+{
+    std::function<void(size_t)> Func;
+    size_t Count = 0;
+    std::atomic<size_t> NextIndex{ 0 };
+    std::atomic<size_t> Done{ 0 };
+    std::atomic<bool> Failed{ false };
+    std::exception_ptr Error; // The first one thrown, under Mutex.
+    std::mutex Mutex;
+    std::condition_variable Finished;
+};
+
+void RunParallelForItems(ParallelForState& state)
+{
+    // A throwing item still counts as done, otherwise the caller never wakes up. The items left after a failure are skipped.
+    size_t processed = 0;
+    for (size_t i = state.NextIndex++; i < state.Count; i = state.NextIndex++)
+    {
+        if (!state.Failed)
+        {
+            try
+            {
+                state.Func(i);
+            }
+            catch (...)
+            {
+                std::scoped_lock l(state.Mutex);
+                if (!state.Error)
+                    state.Error = std::current_exception();
+                state.Failed = true;
+            }
+        }
+        ++processed;
+    }
+    if (processed > 0 && (state.Done += processed) == state.Count)
+    {
+        std::scoped_lock l(state.Mutex);
+        state.Finished.notify_all();
+    }
+}
+}
+
+ThreadPool& ThreadPool::Get()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+ThreadPool::ThreadPool(size_t threadsCount /*= 0*/)
+{
+    if (threadsCount == 0)
+        threadsCount = std::max(1U, std::thread::hardware_concurrency()) - 1;
+    threadsCount = std::max<size_t>(threadsCount, 1);
+
+    m_workers.reserve(threadsCount);
+    for (size_t i = 0; i < threadsCount; ++i)
+        m_workers.emplace_back(&ThreadPool::WorkerLoop, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::scoped_lock l(m_mutex);
+        m_shutdown = true;
+    }
+    m_condition.notify_all();
+    for (auto& worker : m_workers)
+        worker.join();
+}
+
+void ThreadPool::ParallelFor(size_t count, const std::function<void(size_t)>& func)
+{
+    if (count == 0)
+        return;
+    if (count == 1)
+    {
+        func(0);
+        return;
+    }
+
+    // Helpers may start after the loop is already finished by other threads, so the state must outlive this call.
+    auto state = std::make_shared<ParallelForState>();
+    state->Func = func;
+    state->Count = count;
+
+    size_t helpersCount = std::min(count - 1, m_workers.size());
+    for (size_t i = 0; i < helpersCount; ++i)
+        Enqueue([state]() { RunParallelForItems(*state); });
+
+    RunParallelForItems(*state);
+
+    std::unique_lock l(state->Mutex);
+    state->Finished.wait(l, [&state]() { return state->Done == state->Count; });
+    if (state->Error)
+        std::rethrow_exception(state->Error);
+}
+
+void ThreadPool::Enqueue(std::function<void()> task)
+{
+    {
+        std::scoped_lock l(m_mutex);
+        m_tasks.push(std::move(task));
+    }
+    m_condition.notify_one();
+}
+
+void ThreadPool::WorkerLoop()
+{
+    while (true)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock l(m_mutex);
+            m_condition.wait(l, [this]() { return m_shutdown || !m_tasks.empty(); });
+            if (m_shutdown && m_tasks.empty())
+                return;
+            task = std::move(m_tasks.front());
+            m_tasks.pop();
+        }
+        task();
+    }
+}
+}
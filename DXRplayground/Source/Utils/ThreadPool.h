@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace DirectxPlayground
+{
+
+class ThreadPool
+{
+public:
+    static ThreadPool& Get();
+
+    explicit ThreadPool(size_t threadsCount = 0); // 0 - hardware concurrency minus the calling thread.
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool(ThreadPool&&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    ThreadPool& operator=(ThreadPool&&) = delete;
+    ~ThreadPool();
+
+    template <typename F>
+    auto Submit(F&& func) -> std::future<decltype(func())>;
+
+    // Runs func(i) for i in [0, count). The calling thread takes part in the work, so it's safe to call from a worker.
+    // If func throws, the items not started yet are skipped and the first exception is rethrown here once the others finish.
+    void ParallelFor(size_t count, const std::function<void(size_t)>& func);
+
+    size_t GetThreadsCount() const;
+
+private:
+    void Enqueue(std::function<void()> task);
+    void WorkerLoop();
+
+    std::vector<std::thread> m_workers;
+    std::queue<std::function<void()>> m_tasks;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    bool m_shutdown = false;
+};
+
+template <typename F>
+auto ThreadPool::Submit(F&& func) -> std::future<decltype(func())>
+{
+    using ResultType = decltype(func());
+    auto task = std::make_shared<std::packaged_task<ResultType()>>(std::forward<F>(func));
+    std::future<ResultType> res = task->get_future();
+    Enqueue([task]() { (*task)(); });
+    return res;
+}
+
+inline size_t ThreadPool::GetThreadsCount() const
+{
+    return m_workers.size();
+}
+}
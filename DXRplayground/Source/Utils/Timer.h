@@ -0,0 +1,34 @@
+#pragma once
+
+#include <chrono>
+
+namespace DirectxPlayground
+{
+
+class Timer
+{
+public:
+    Timer();
+
+    void Reset();
+    double GetElapsedMs() const;
+
+private:
+    std::chrono::high_resolution_clock::time_point m_start;
+};
+
+inline Timer::Timer()
+    : m_start(std::chrono::high_resolution_clock::now())
+{
+}
+
+inline void Timer::Reset()
+{
+    m_start = std::chrono::high_resolution_clock::now();
+}
+
+inline double Timer::GetElapsedMs() const
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - m_start).count();
+}
+}